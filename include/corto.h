@@ -157,6 +157,42 @@ CORTO_EXPORT
 bool corto_autoload(
     corto_bool autoload);
 
+
+/* -- OBJECT MEMORY POOLS -- */
+
+/** Counters of the object memory pools. */
+typedef struct corto_slab_stats_t {
+    uint64_t alloc;     /* Objects allocated from a pool */
+    uint64_t hit;       /* Allocations served from the thread cache */
+    uint64_t refill;    /* Allocations that refilled the thread cache */
+    uint64_t fallback;  /* Objects allocated with malloc */
+    uint64_t free;      /* Objects returned to a pool */
+} corto_slab_stats_t;
+
+/** Enable or disable object memory pools.
+ * When enabled, object memory is allocated from pools per size class, which
+ * avoids a malloc and free for every object. Disabling pools is useful when
+ * debugging memory with tools like valgrind. Pools can also be disabled by
+ * setting $CORTO_SLAB to "false". Objects that are allocated while pools are
+ * enabled are returned to their pool after disabling.
+ *
+ * @param enable Specifies whether to enable object memory pools.
+ * @return Previous value.
+ */
+CORTO_EXPORT
+bool corto_enable_slab(
+    bool enable);
+
+/** Obtain counters of the object memory pools.
+ * The pool hit rate is hit / alloc. Counters are summed over all threads, and
+ * may be approximate when other threads are creating objects.
+ *
+ * @param stats_out Pointer to a struct which receives the counters.
+ */
+CORTO_EXPORT
+void corto_slab_stats(
+    corto_slab_stats_t *stats_out);
+
 /** Utility to generate random id */
 CORTO_EXPORT
 char* corto_random_id(
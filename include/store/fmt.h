@@ -30,6 +30,10 @@ typedef struct corto_fmt_s *corto_fmt;
 
 typedef struct corto_fmt_opt {
     const char *from;
+
+    /* When not empty, only these members of a composite value are serialized.
+     * Members may be inherited from a base of the type of the value. */
+    corto_objectseq members;
 } corto_fmt_opt;
 
 CORTO_EXPORT
@@ -201,6 +201,22 @@ int16_t _corto_ptr_copy(
     corto_type type,
     void *src);
 
+/** Copy value into another value using the type serializer.
+ * Equivalent to corto_ptr_copy, but walks the type instead of using the
+ * typecache. Used to verify and benchmark the typecache against the serializer.
+ *
+ * @param dst A pointer to the destination value.
+ * @param type The type of the source and destination value.
+ * @param src A pointer to the source value.
+ * @return 0 if success, nonzero if failed.
+ * @see corto_ptr_copy
+ */
+CORTO_EXPORT
+int16_t _corto_ptr_copy_ser(
+    void *dst,
+    corto_type type,
+    void *src);
+
 /** Perform unary operator on a value.
  * @param type The type of the value.
  * @param _operator The operator to perform.
@@ -262,6 +278,22 @@ corto_equalityKind _corto_ptr_compare(
     corto_type type,
     const void *ptr2);
 
+/** Compare two values using the type serializer.
+ * Equivalent to corto_ptr_compare, but walks the type instead of using the
+ * typecache. Used to verify the typecache against the serializer.
+ *
+ * @param ptr1 A pointer to the first value.
+ * @param type The type of the value.
+ * @param ptr2 A pointer to the second value.
+ * @return CORTO_EQ, CORTO_LT, CORTO_GT when ptr1 is equal, larger or greater than ptr2.
+ * @see corto_ptr_compare
+ */
+CORTO_EXPORT
+corto_equalityKind _corto_ptr_compare_ser(
+    const void *ptr1,
+    corto_type type,
+    const void *ptr2);
+
 /** Initialize a value.
  * This function is not needed when a value is allocated with corto_ptr_new. A
  * valid example usecase for corto_ptr_init is when allocating a buffer for a
@@ -297,7 +329,9 @@ int16_t _corto_ptr_deinit(
 #define corto_ptr_fromStr(out, type, string) _corto_ptr_fromStr(out, corto_type(type), string)
 #define corto_ptr_contentof(p, type, maxLength) _corto_ptr_contentof(p, corto_type(type), maxLength)
 #define corto_ptr_copy(p, type, src) _corto_ptr_copy(p, corto_type(type), src)
+#define corto_ptr_copy_ser(p, type, src) _corto_ptr_copy_ser(p, corto_type(type), src)
 #define corto_ptr_compare(p1, type, p2) _corto_ptr_compare(p1, corto_type(type), p2)
+#define corto_ptr_compare_ser(p1, type, p2) _corto_ptr_compare_ser(p1, corto_type(type), p2)
 #define corto_ptr_init(p, type) _corto_ptr_init(p, corto_type(type))
 #define corto_ptr_deinit(p, type) _corto_ptr_deinit(p, corto_type(type))
 #define corto_ptr_new(type) _corto_ptr_new(corto_type(type))
@@ -632,6 +632,29 @@ typedef struct corto_observe__fluent {
     struct corto_observe__fluent (*type)(
         char *type);
 
+    /** Filter objects by type, including instances of subtypes.
+     * The observer will trigger on objects of the specified type, and on
+     * objects of types that inherit from or implement it.
+     *
+     * @param type A valid corto type identifier.
+     */
+    struct corto_observe__fluent (*instanceof)(
+        char *type);
+
+    /** Align observer asynchronously.
+     * By default an observer for DECLARE or DEFINE events on a scope or tree
+     * is invoked for every existing object before the observer is created. With
+     * this option, existing objects are delivered by a separate thread, in
+     * chunks of at most the specified number of objects, while the observer
+     * already receives events. Objects that are declared, defined or deleted
+     * while aligning are not aligned. If the observer has a dispatcher, events
+     * from alignment are posted to the dispatcher.
+     *
+     * @param chunk The maximum number of objects aligned at a time.
+     */
+    struct corto_observe__fluent (*align_chunked)(
+        uint32_t chunk);
+
     /** Specify callback, create observer.
      * Provide a callback function that is invoked when a matching event occurs.
      * This function returns a new observer based on the specified parameters.
@@ -1142,6 +1165,25 @@ char *corto_fullpath(
     corto_id str,
     corto_object o);
 
+/** Obtain a cached full path identifier to an object.
+ * This function returns the same path as corto_fullpath, without copying it to
+ * a buffer. The path of a named object is computed the first time this
+ * function is called, and is stored with the object. Subsequent calls return
+ * the stored path.
+ *
+ * For objects that are not named, or that have been removed from their scope,
+ * the path is not cached and a corto-managed string is returned which may change
+ * with subsequent calls to corto_fullpath and other functions that use the
+ * corto stringcache.
+ *
+ * @param o The object for which to obtain the path.
+ * @return The full path. The string is owned by the object, and is valid for as long as the object is not deleted.
+ * @see corto_fullpath corto_idof
+ */
+CORTO_EXPORT
+const char *corto_pathof(
+    corto_object o);
+
 /** Obtain a relative path identifier to an object.
  * This function returns the shortest path from the specified from object to the
  * to object, separated by sep. If to is a parent of from, this function will insert
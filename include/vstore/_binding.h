@@ -41,6 +41,7 @@
 #define corto_routerimpl(o) ((corto_routerimpl)corto_assert_type((corto_type)corto_routerimpl_o, o))
 #define corto_subscriber_event(o) ((corto_subscriber_event*)corto_assert_type((corto_type)corto_subscriber_event_o, o))
 #define corto_subscriber_eventIter(o) ((corto_subscriber_eventIter*)corto_assert_type((corto_type)corto_subscriber_eventIter_o, o))
+#define corto_threadpool(o) ((corto_threadpool)corto_assert_type((corto_type)corto_threadpool_o, o))
 
 /* -- Non-expanding typedefs -- */
 typedef corto_dispatcher _type_corto_dispatcher;
@@ -78,6 +79,7 @@ typedef corto_router _type_corto_router;
 typedef corto_routerimpl _type_corto_routerimpl;
 typedef corto_subscriber_event _type_corto_subscriber_event;
 typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
+typedef corto_threadpool _type_corto_threadpool;
 
 /* -- Argument type casting -- */
 #ifndef CORTO_IMPL
@@ -91,12 +93,14 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
 #define corto_loader_on_query_v(_this, query) _corto_loader_on_query_v(corto_loader(_this), query)
 #define corto_loader_on_resume(_this, parent, id, object) _corto_loader_on_resume(corto_loader(_this), parent, id, object)
 #define corto_mount_construct(_this) _corto_mount_construct(corto_mount(_this))
+#define corto_mount_count(_this, query) _corto_mount_count(corto_mount(_this), query)
 #define corto_mount_destruct(_this) _corto_mount_destruct(corto_mount(_this))
 #define corto_mount_historyQuery(_this, query) _corto_mount_historyQuery(corto_mount(_this), query)
 #define corto_mount_id(_this) _corto_mount_id(corto_mount(_this))
 #define corto_mount_init(_this) _corto_mount_init(corto_mount(_this))
 #define corto_mount_invoke(_this, instance, proc, argptrs) _corto_mount_invoke(corto_mount(_this), instance, corto_function(proc), argptrs)
 #define corto_mount_on_batch_notify_v(_this, events) _corto_mount_on_batch_notify_v(corto_mount(_this), events)
+#define corto_mount_on_count_v(_this, query) _corto_mount_on_count_v(corto_mount(_this), query)
 #define corto_mount_on_history_batch_notify_v(_this, events) _corto_mount_on_history_batch_notify_v(corto_mount(_this), events)
 #define corto_mount_on_history_query_v(_this, query) _corto_mount_on_history_query_v(corto_mount(_this), query)
 #define corto_mount_on_id_v(_this) _corto_mount_on_id_v(corto_mount(_this))
@@ -154,6 +158,10 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
 #define corto_subscriber_event_deinit(_this) _corto_subscriber_event_deinit(_this)
 #define corto_subscriber_event_handle(e) _corto_subscriber_event_handle(e)
 #define corto_subscriber_event_init(_this) _corto_subscriber_event_init(_this)
+#define corto_threadpool_construct(_this) _corto_threadpool_construct(corto_threadpool(_this))
+#define corto_threadpool_destruct(_this) _corto_threadpool_destruct(corto_threadpool(_this))
+#define corto_threadpool_post(_this, e) _corto_threadpool_post(corto_threadpool(_this), e)
+#define corto_threadpool_updateMetrics(_this) _corto_threadpool_updateMetrics(corto_threadpool(_this))
 #else
 /* Can't use argument type casting macro's within project, as they would
  * substitute headers in implementation files. */
@@ -167,12 +175,14 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
 #define corto_loader_on_query_v _corto_loader_on_query_v
 #define corto_loader_on_resume _corto_loader_on_resume
 #define corto_mount_construct _corto_mount_construct
+#define corto_mount_count _corto_mount_count
 #define corto_mount_destruct _corto_mount_destruct
 #define corto_mount_historyQuery _corto_mount_historyQuery
 #define corto_mount_id _corto_mount_id
 #define corto_mount_init _corto_mount_init
 #define corto_mount_invoke _corto_mount_invoke
 #define corto_mount_on_batch_notify_v _corto_mount_on_batch_notify_v
+#define corto_mount_on_count_v _corto_mount_on_count_v
 #define corto_mount_on_history_batch_notify_v _corto_mount_on_history_batch_notify_v
 #define corto_mount_on_history_query_v _corto_mount_on_history_query_v
 #define corto_mount_on_id_v _corto_mount_on_id_v
@@ -230,6 +240,10 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
 #define corto_subscriber_event_deinit _corto_subscriber_event_deinit
 #define corto_subscriber_event_handle _corto_subscriber_event_handle
 #define corto_subscriber_event_init _corto_subscriber_event_init
+#define corto_threadpool_construct _corto_threadpool_construct
+#define corto_threadpool_destruct _corto_threadpool_destruct
+#define corto_threadpool_post _corto_threadpool_post
+#define corto_threadpool_updateMetrics _corto_threadpool_updateMetrics
 /* Macro for doing argument type casting within project. */
 #define safe_corto_dispatcher_post_v(_this, e) _corto_dispatcher_post_v(corto_dispatcher(_this), e)
 #define safe_corto_event_handle(_this) _corto_event_handle(_this)
@@ -241,12 +255,14 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
 #define safe_corto_loader_on_query_v(_this, query) _corto_loader_on_query_v(corto_loader(_this), query)
 #define safe_corto_loader_on_resume(_this, parent, id, object) _corto_loader_on_resume(corto_loader(_this), parent, id, object)
 #define safe_corto_mount_construct(_this) _corto_mount_construct(corto_mount(_this))
+#define safe_corto_mount_count(_this, query) _corto_mount_count(corto_mount(_this), query)
 #define safe_corto_mount_destruct(_this) _corto_mount_destruct(corto_mount(_this))
 #define safe_corto_mount_historyQuery(_this, query) _corto_mount_historyQuery(corto_mount(_this), query)
 #define safe_corto_mount_id(_this) _corto_mount_id(corto_mount(_this))
 #define safe_corto_mount_init(_this) _corto_mount_init(corto_mount(_this))
 #define safe_corto_mount_invoke(_this, instance, proc, argptrs) _corto_mount_invoke(corto_mount(_this), instance, corto_function(proc), argptrs)
 #define safe_corto_mount_on_batch_notify_v(_this, events) _corto_mount_on_batch_notify_v(corto_mount(_this), events)
+#define safe_corto_mount_on_count_v(_this, query) _corto_mount_on_count_v(corto_mount(_this), query)
 #define safe_corto_mount_on_history_batch_notify_v(_this, events) _corto_mount_on_history_batch_notify_v(corto_mount(_this), events)
 #define safe_corto_mount_on_history_query_v(_this, query) _corto_mount_on_history_query_v(corto_mount(_this), query)
 #define safe_corto_mount_on_id_v(_this) _corto_mount_on_id_v(corto_mount(_this))
@@ -304,6 +320,10 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
 #define safe_corto_subscriber_event_deinit(_this) _corto_subscriber_event_deinit(_this)
 #define safe_corto_subscriber_event_handle(e) _corto_subscriber_event_handle(e)
 #define safe_corto_subscriber_event_init(_this) _corto_subscriber_event_init(_this)
+#define safe_corto_threadpool_construct(_this) _corto_threadpool_construct(corto_threadpool(_this))
+#define safe_corto_threadpool_destruct(_this) _corto_threadpool_destruct(corto_threadpool(_this))
+#define safe_corto_threadpool_post(_this, e) _corto_threadpool_post(corto_threadpool(_this), e)
+#define safe_corto_threadpool_updateMetrics(_this) _corto_threadpool_updateMetrics(corto_threadpool(_this))
 #endif
 #define corto_dispatcher_post(_this, e) _corto_dispatcher_post(corto_dispatcher(_this), e)
 
@@ -323,6 +343,11 @@ typedef corto_subscriber_eventIter _type_corto_subscriber_eventIter;
     ? ((_type_corto_void (*)(corto_object, corto_subscriber_eventIter))((corto_function)((corto_interface)corto_typeof(_this))->methods.buffer[((corto_method)corto_mount_on_batch_notify_o)->index - 1])->fptr)(corto_mount(_this), events) \
     : (void)corto_invoke(((corto_interface)corto_typeof(_this))->methods.buffer[((corto_method)corto_mount_on_batch_notify_o)->index - 1], NULL, corto_mount(_this), events) \
     )
+#define corto_mount_on_count(_this, query) ( \
+    ((corto_function)corto_mount_on_count_o)->kind == CORTO_PROCEDURE_CDECL \
+    ? ((_type_corto_int64 (*)(corto_object, corto_query *))((corto_function)((corto_interface)corto_typeof(_this))->methods.buffer[((corto_method)corto_mount_on_count_o)->index - 1])->fptr)(corto_mount(_this), query) \
+    : *(int64_t*)corto_invoke(((corto_interface)corto_typeof(_this))->methods.buffer[((corto_method)corto_mount_on_count_o)->index - 1], alloca(sizeof(int64_t)), corto_mount(_this), query) \
+    )
 #define corto_mount_on_history_batch_notify(_this, events) ( \
     ((corto_function)corto_mount_on_history_batch_notify_o)->kind == CORTO_PROCEDURE_CDECL \
     ? ((_type_corto_void (*)(corto_object, corto_subscriber_eventIter))((corto_function)((corto_interface)corto_typeof(_this))->methods.buffer[((corto_method)corto_mount_on_history_batch_notify_o)->index - 1])->fptr)(corto_mount(_this), events) \
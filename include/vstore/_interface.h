@@ -79,6 +79,11 @@ CORTO_EXPORT
 int16_t _corto_mount_construct(
     corto_mount _this);
 
+CORTO_EXPORT
+int64_t _corto_mount_count(
+    corto_mount _this,
+    corto_query *query);
+
 CORTO_EXPORT
 void _corto_mount_destruct(
     corto_mount _this);
@@ -108,6 +113,11 @@ void _corto_mount_on_batch_notify_v(
     corto_mount _this,
     corto_subscriber_eventIter events);
 
+CORTO_EXPORT
+int64_t _corto_mount_on_count_v(
+    corto_mount _this,
+    corto_query *query);
+
 CORTO_EXPORT
 void _corto_mount_on_history_batch_notify_v(
     corto_mount _this,
@@ -423,6 +433,26 @@ CORTO_EXPORT
 int16_t _corto_subscriber_event_init(
     corto_subscriber_event* _this);
 
+
+/* class corto/vstore/threadpool */
+
+CORTO_EXPORT
+int16_t _corto_threadpool_construct(
+    corto_threadpool _this);
+
+CORTO_EXPORT
+void _corto_threadpool_destruct(
+    corto_threadpool _this);
+
+CORTO_EXPORT
+void _corto_threadpool_post(
+    corto_threadpool _this,
+    corto_event *e);
+
+CORTO_EXPORT
+void _corto_threadpool_updateMetrics(
+    corto_threadpool _this);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,6 +29,7 @@ CORTO_META_OBJECT(class, mount);
 CORTO_META_OBJECT(struct, mountPolicy);
 CORTO_META_OBJECT(struct, mountSubscription);
 CORTO_META_OBJECT(class, loader);
+CORTO_META_OBJECT(class, threadpool);
 CORTO_META_OBJECT(struct, result);
 CORTO_META_OBJECT(struct, request);
 CORTO_META_OBJECT(struct, frame);
@@ -80,6 +81,7 @@ CORTO_META_OBJECT(method, mount_on_id);
 CORTO_META_OBJECT(method, mount_on_resume);
 CORTO_META_OBJECT(method, mount_on_query);
 CORTO_META_OBJECT(method, mount_on_history_query);
+CORTO_META_OBJECT(method, mount_on_count);
 CORTO_META_OBJECT(method, mount_on_notify);
 CORTO_META_OBJECT(method, mount_on_batch_notify);
 CORTO_META_OBJECT(method, mount_on_history_batch_notify);
@@ -76,6 +76,8 @@ typedef struct corto_observer_s {
     corto_type type;
     bool enabled;
     uint32_t active;
+    uint32_t alignChunk;
+    bool instanceOf;
 } *corto_observer;
 
 /* struct corto/vstore/query */
@@ -105,7 +107,11 @@ typedef struct corto_subscriber_s {
     uintptr_t idmatch;
     bool isAligning;
     uintptr_t alignMutex;
-    corto_objectlist alignQueue;
+    uintptr_t alignQueue;
+    uint64_t alignDuration;
+    uint32_t alignQueueMax;
+    double rate;
+    uintptr_t limiter;
 } *corto_subscriber;
 
 /* enum corto/vstore/ownership */
@@ -127,6 +133,7 @@ typedef uint32_t corto_mountMask;
     #define CORTO_MOUNT_RESUME (0x80)
     #define CORTO_MOUNT_INVOKE (0x100)
     #define CORTO_MOUNT_ID (0x200)
+    #define CORTO_MOUNT_COUNT (0x400)
 
 /* struct corto/vstore/queuePolicy */
 typedef struct corto_queuePolicy {
@@ -170,8 +177,7 @@ typedef struct corto_mount_s {
     corto_object mount;
     corto_attr attr;
     corto_mountSubscriptionList subscriptions;
-    corto_objectlist events;
-    corto_objectlist historicalEvents;
+    uintptr_t events;
     corto_time lastPoll;
     corto_time lastPost;
     corto_time lastSleep;
@@ -325,6 +331,20 @@ typedef struct corto_subscriber_event {
 
 typedef corto_iter corto_subscriber_eventIter;
 
+/* class corto/vstore/threadpool */
+typedef struct corto_threadpool_s {
+    uint32_t workers;
+    bool ordered;
+    uint64_t posted;
+    uint64_t processed;
+    uint64_t stolen;
+    uint64_t queueDepth;
+    uint64_t maxQueueDepth;
+    uint64_t latencyAvg;
+    uint64_t latencyMax;
+    uintptr_t impl;
+} *corto_threadpool;
+
 
 #ifdef __cplusplus
 }
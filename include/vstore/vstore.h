@@ -106,6 +106,9 @@ extern "C" {
 
 /* -- corto_select function -- */
 
+/* Handle to a prepared query, see the prepare fluent method */
+typedef struct corto_select_prepared corto_select_prepared;
+
 
 typedef struct corto_select__fluent {
     /** Specify a relative scope for the query.
@@ -144,6 +147,34 @@ typedef struct corto_select__fluent {
     struct corto_select__fluent (*instanceof)(
         const char *type);
 
+    /** Filter results by value.
+     * The filter compares members with literals, and combines comparisons with
+     * boolean operators, like `x > 10 && (name == "foo" || !flag)`. Members of
+     * nested structs are specified as `a.b`. Comparisons on members that do
+     * not exist in the type of a result evaluate to false.
+     *
+     * The filter is passed to mounts in the where field of the query, so mounts
+     * can filter natively. For mounts that set policy.filterResults, values
+     * returned by the mount are filtered by corto.
+     *
+     * @param filter The filter expression.
+     */
+    struct corto_select__fluent (*where)(
+        const char *filter);
+
+    /** Only serialize specified members in the values of results.
+     * Members are specified as a comma separated list, like `x, y`. Values of
+     * types that have none of the members are not returned. Only has effect
+     * when a contentType is specified.
+     *
+     * The list is passed to mounts in the member field of the query, so mounts
+     * can avoid loading members that are not requested.
+     *
+     * @param members A comma separated list of member names.
+     */
+    struct corto_select__fluent (*member)(
+        const char *members);
+
     /** Filter out results from a specific instance (mount).
      * This is typically useful when using corto_select from a mount, and the
      * mount does not want to invoke itself.
@@ -218,6 +249,23 @@ typedef struct corto_select__fluent {
      */
     struct corto_select__fluent (*yield_unknown)();
 
+    /** Query mounts concurrently.
+     * By default the mounts in a scope are queried one after another. With
+     * this option, all mounts in a scope are queried at the same time on a
+     * pool of worker threads, and results are returned in order of arrival.
+     * This reduces latency when a query is served by multiple remote mounts.
+     *
+     * Offset and limit are applied by corto, as a mount cannot know how many
+     * results other mounts return. Each mount is asked for up to offset + limit
+     * results, of which corto skips the first offset results that arrive.
+     * Because results arrive in any order, which results are on a page is
+     * approximate: paging through results with consecutive offsets can return
+     * a result more than once, or not at all. Historical queries, and selects
+     * that are started from a mount that is serving a parallel query, query
+     * mounts one after another.
+     */
+    struct corto_select__fluent (*parallel)(void);
+
     /** Return an iterator to the requested results.
      * Results are returned as corto_result instances. A corto_result contains
      * metadata and when a content type is specified, a serialized value of an
@@ -247,13 +295,31 @@ typedef struct corto_select__fluent {
         corto_objectIter *iter_out); /* Unstable API */
 
     /** Return the number of objects for a query.
-     * This function requires a walk over all the returned results to determine
-     * the total number of objects.
+     * This function does not load values. Objects in a scope of the object
+     * store are counted without iterating them, unless a filter (other than
+     * '*'), type, instanceof or where has to be evaluated. Mounts that implement
+     * on_count are asked for the number of results instead of the results.
+     * Tree queries are counted by iterating over the results.
      *
      * @return -1 if failed, otherwise the total number of objects.
      */
     int64_t (*count)(void);
 
+    /** Prepare a query for repeated execution.
+     * Parsing the expression, compiling filters and finding the mounts that
+     * can provide data for a query is done once, instead of every time the
+     * query is executed. The returned handle can be executed multiple times
+     * with corto_select_prepared_iter, also from multiple threads at the same
+     * time. The mounts of the handle are looked up again when mounts are added
+     * or removed.
+     *
+     * The offset and limit of the query are ignored, and are instead provided
+     * to corto_select_prepared_iter.
+     *
+     * @return The prepared query, NULL if failed.
+     */
+    corto_select_prepared* (*prepare)(void);
+
     /* Internal APIs */
     struct corto_select__fluent (*vstore)(
         bool enable); /* Unstable API */
@@ -303,6 +369,30 @@ struct corto_select__fluent corto_select(
     const char *expr,
     ...);
 
+/** Execute a prepared query.
+ *
+ * @param query A query returned by the prepare fluent method.
+ * @param offset Number of results to skip.
+ * @param limit Maximum number of results, 0 for no limit.
+ * @param iter_out A pointer to an iterator object.
+ * @return 0 if success, -1 if failed.
+ */
+CORTO_EXPORT
+int16_t corto_select_prepared_iter(
+    corto_select_prepared *query,
+    uint64_t offset,
+    uint64_t limit,
+    corto_resultIter *iter_out);
+
+/** Free a prepared query.
+ * A prepared query may only be freed when it is no longer executed.
+ *
+ * @param query A query returned by the prepare fluent method.
+ */
+CORTO_EXPORT
+void corto_select_prepared_free(
+    corto_select_prepared *query);
+
 
 /* -- corto_subscribe function -- */
 
@@ -361,6 +451,19 @@ typedef struct corto_subscribe__fluent {
      */
     struct corto_subscribe__fluent (*yield_unknown)(void);
 
+    /** Limit the rate at which events are delivered.
+     * Events are collected and delivered at most rate times per second. Only
+     * the last event for an object is kept between deliveries, so an object
+     * that is updated many times in an interval is delivered once, with its
+     * latest value. Events are delivered from a separate thread, or posted to
+     * the dispatcher of the subscriber if it has one. A rate of 0 (default)
+     * delivers every event.
+     *
+     * @param rate The maximum number of deliveries per second.
+     */
+    struct corto_subscribe__fluent (*rate)(
+        double rate);
+
     /** Create a mount of the specified type.
      *
      * @param type A mount type.
@@ -461,6 +564,110 @@ int16_t corto_publish(
     const char *contentType,
     void *content);
 
+/** Publish event without copying the value.
+ * This function is equivalent to `corto_publish`, except that ownership of the
+ * value is transferred to the store. The value must have been allocated in a
+ * way that matches the release function of the content type, for example with
+ * `corto_fmt_copy`.
+ *
+ * Subscribers that request the same content type as the publisher receive the
+ * published value itself, and asynchronous subscribers and dispatcher queues
+ * share it through a reference count. The value is never converted or copied
+ * for these subscribers, and is released when the last event that refers to it
+ * is deleted. With `corto_publish`, the value is copied once for asynchronous
+ * subscribers, as the publisher keeps ownership of it.
+ *
+ * @param event The event to be emitted
+ * @param id A string representing the id of the object in the form of 'foo/bar'.
+ * @param type A string representing the id of the type as returned by corto_fullpath.
+ * @param contentType A string representing the content type (format) of the specified value.
+ * @param value The serialized value. Ownership is transferred to the store.
+ * @return 0 if success, nonzero if failed.
+ * @see corto_publish
+ */
+CORTO_EXPORT
+int16_t corto_publish_shared(
+    corto_eventMask event,
+    const char *id,
+    const char *type,
+    const char *contentType,
+    void *content);
+
+
+/* -- corto_publish_batch function -- */
+
+/** Sample in a batch of published events.
+ * The members correspond with the parameters of `corto_publish`.
+ */
+typedef struct corto_publish_sample {
+    corto_eventMask event;
+    const char *id;
+    const char *type;
+    void *value;
+} corto_publish_sample;
+
+/** Publish a batch of events.
+ * This function is equivalent to calling `corto_publish` for each sample, but
+ * resolves the content type once and looks up subscribers without locking for
+ * the whole batch. Mounts that implement `on_batch_notify` receive the events
+ * of the batch that match their subscription in a single call, also when they
+ * don't have a sample rate.
+ *
+ * Samples are published in the order in which they appear in the array.
+ *
+ * @param contentType A string representing the content type of all values.
+ * @param samples An array of samples.
+ * @param count The number of samples in the array.
+ * @return 0 if success, nonzero if failed.
+ * @see corto_publish corto_publish_begin
+ */
+CORTO_EXPORT
+int16_t corto_publish_batch(
+    const char *contentType,
+    corto_publish_sample *samples,
+    uint32_t count);
+
+typedef struct corto_publish__fluent {
+    /** Add sample to batch.
+     * The strings and value are not copied, and must remain valid until the
+     * batch is committed.
+     *
+     * @param event The event to be emitted.
+     * @param id A string representing the id of the object.
+     * @param type A string representing the id of the type.
+     * @param value A string (or binary value) representing the serialized value.
+     */
+    struct corto_publish__fluent (*sample)(
+        corto_eventMask event,
+        const char *id,
+        const char *type,
+        void *value);
+
+    /** Publish the samples that were added to the batch.
+     * @return 0 if success, nonzero if failed.
+     */
+    int16_t (*commit)(void);
+} corto_publish__fluent;
+
+/** Build a batch of events, and publish it with `corto_publish_batch`.
+ *
+@verbatim
+```c
+corto_publish_begin("text/json")
+  .sample(CORTO_UPDATE, "data/a", "/test/Point", "{\"x\":10}")
+  .sample(CORTO_UPDATE, "data/b", "/test/Point", "{\"x\":20}")
+  .commit();
+```
+@endverbatim
+ *
+ * @param contentType A string representing the content type of all values.
+ * @return A fluent struct with methods to add samples to the batch.
+ * @see corto_publish_batch
+ */
+CORTO_EXPORT
+struct corto_publish__fluent corto_publish_begin(
+    const char *contentType);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,7 @@
 #include <corto/corto.h>
 #include "interface.h"
 #include "src/store/object.h"
+#include "src/vstore/observer_index.h"
 
 corto_int16 corto_type_bindMetaprocedure(
     corto_type this,
@@ -168,6 +169,7 @@ void corto_type_deinit(
     corto_type this)
 {
     free ((corto_typecache*)this->typecache);
+    corto_observer_index_typeDeinit(this);
 }
 
 corto_function corto_type_resolveProcedure(
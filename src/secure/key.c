@@ -119,9 +119,7 @@ bool corto_authorize(
     corto_secure_actionKind access)
 {
     if (corto_check_attr(object, CORTO_ATTR_NAMED)) {
-        corto_id objectId;
-        corto_fullpath(objectId, object);
-        return corto_authorize_id(objectId, access);
+        return corto_authorize_id(corto_pathof(object), access);
     } else {
         return TRUE;
     }
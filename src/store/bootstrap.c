@@ -30,14 +30,16 @@
 #include "memory_ser.h"
 #include "src/lang/class.h"
 #include "src/lang/interface.h"
+#include "src/vstore/subscriber_index.h"
+#include "src/vstore/observer_index.h"
+#include "src/vstore/fanout.h"
 
 void corto_secure_init(void);
 
 /* Declaration of the C-binding call-handler */
 void corto_invoke_cdecl(corto_function f, corto_void* result, void* args);
 
-/* TLS callback to cleanup observer administration */
-void corto_observerAdminFree(void *admin);
+/* TLS callback to cleanup declared administration */
 void corto_declaredByMeFree(void *admin);
 
 struct corto_exitHandler {
@@ -70,7 +72,6 @@ corto_rwmutex_s corto_subscriberLock;
 char *corto_appName = NULL;
 
 /* TLS keys */
-corto_tls CORTO_KEY_OBSERVER_ADMIN;
 corto_tls CORTO_KEY_DECLARED_ADMIN;
 corto_tls CORTO_KEY_LISTEN_ADMIN;
 corto_tls CORTO_KEY_OWNER;
@@ -78,6 +79,7 @@ corto_tls CORTO_KEY_ATTR;
 corto_tls CORTO_KEY_FLUENT;
 corto_tls CORTO_KEY_MOUNT_RESULT;
 corto_tls CORTO_KEY_CONSTRUCTOR_TYPE;
+corto_tls CORTO_KEY_PUBLISH;
 
 /* Delegate object variables */
 corto_member corto_type_init_o = NULL;
@@ -255,6 +257,7 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_CLASS(vstore_, routerimpl),\
     BUILTIN_CLASS(vstore_, mount),\
     BUILTIN_CLASS(vstore_, loader),\
+    BUILTIN_CLASS(vstore_, threadpool),\
     BUILTIN_CLASS(,native_type),\
     BUILTIN_CLASS(,secure_key),\
     BUILTIN_CLASS(,secure_lock)
@@ -293,6 +296,8 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_observer_type),\
     BUILTIN_OBJ(vstore_observer_enabled),\
     BUILTIN_OBJ(vstore_observer_active),\
+    BUILTIN_OBJ(vstore_observer_alignChunk),\
+    BUILTIN_OBJ(vstore_observer_instanceOf),\
     BUILTIN_OBJ(vstore_observer_init_),\
     BUILTIN_OBJ(vstore_observer_construct_),\
     BUILTIN_OBJ(vstore_observer_destruct_),\
@@ -402,6 +407,7 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_mountMask_MOUNT_RESUME),\
     BUILTIN_OBJ(vstore_mountMask_MOUNT_INVOKE),\
     BUILTIN_OBJ(vstore_mountMask_MOUNT_ID),\
+    BUILTIN_OBJ(vstore_mountMask_MOUNT_COUNT),\
     /* frameKind */\
     BUILTIN_OBJ(vstore_frameKind_FRAME_NOW),\
     BUILTIN_OBJ(vstore_frameKind_FRAME_TIME),\
@@ -680,6 +686,10 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_subscriber_isAligning),\
     BUILTIN_OBJ(vstore_subscriber_alignMutex),\
     BUILTIN_OBJ(vstore_subscriber_alignQueue),\
+    BUILTIN_OBJ(vstore_subscriber_alignDuration),\
+    BUILTIN_OBJ(vstore_subscriber_alignQueueMax),\
+    BUILTIN_OBJ(vstore_subscriber_rate),\
+    BUILTIN_OBJ(vstore_subscriber_limiter),\
     BUILTIN_OBJ(vstore_subscriber_init_),\
     BUILTIN_OBJ(vstore_subscriber_deinit_),\
     BUILTIN_OBJ(vstore_subscriber_construct_),\
@@ -712,7 +722,6 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_mount_attr),\
     BUILTIN_OBJ(vstore_mount_subscriptions),\
     BUILTIN_OBJ(vstore_mount_events),\
-    BUILTIN_OBJ(vstore_mount_historicalEvents),\
     BUILTIN_OBJ(vstore_mount_lastPoll),\
     BUILTIN_OBJ(vstore_mount_lastPost),\
     BUILTIN_OBJ(vstore_mount_lastSleep),\
@@ -731,6 +740,7 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_mount_id_),\
     BUILTIN_OBJ(vstore_mount_query_),\
     BUILTIN_OBJ(vstore_mount_historyQuery_),\
+    BUILTIN_OBJ(vstore_mount_count_),\
     BUILTIN_OBJ(vstore_mount_resume_),\
     BUILTIN_OBJ(vstore_mount_subscribe_),\
     BUILTIN_OBJ(vstore_mount_unsubscribe_),\
@@ -748,6 +758,7 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_mount_on_id_),\
     BUILTIN_OBJ(vstore_mount_on_query_),\
     BUILTIN_OBJ(vstore_mount_on_history_query_),\
+    BUILTIN_OBJ(vstore_mount_on_count_),\
     BUILTIN_OBJ(vstore_mount_on_resume_),\
     BUILTIN_OBJ(vstore_mount_on_subscribe_),\
     BUILTIN_OBJ(vstore_mount_on_unsubscribe_),\
@@ -761,6 +772,21 @@ static corto_string CORTO_BUILD = __DATE__ " " __TIME__;
     BUILTIN_OBJ(vstore_loader_destruct_),\
     BUILTIN_OBJ(vstore_loader_on_query_),\
     BUILTIN_OBJ(vstore_loader_on_resume_),\
+    /* threadpool */\
+    BUILTIN_OBJ(vstore_threadpool_workers),\
+    BUILTIN_OBJ(vstore_threadpool_ordered),\
+    BUILTIN_OBJ(vstore_threadpool_posted),\
+    BUILTIN_OBJ(vstore_threadpool_processed),\
+    BUILTIN_OBJ(vstore_threadpool_stolen),\
+    BUILTIN_OBJ(vstore_threadpool_queueDepth),\
+    BUILTIN_OBJ(vstore_threadpool_maxQueueDepth),\
+    BUILTIN_OBJ(vstore_threadpool_latencyAvg),\
+    BUILTIN_OBJ(vstore_threadpool_latencyMax),\
+    BUILTIN_OBJ(vstore_threadpool_impl),\
+    BUILTIN_OBJ(vstore_threadpool_construct_),\
+    BUILTIN_OBJ(vstore_threadpool_destruct_),\
+    BUILTIN_OBJ(vstore_threadpool_post_),\
+    BUILTIN_OBJ(vstore_threadpool_updateMetrics_),\
     /* delegatedata */\
     BUILTIN_OBJ(lang_delegatedata_instance),\
     BUILTIN_OBJ(lang_delegatedata_procedure),\
@@ -954,6 +980,11 @@ void corto_init_sequences(void) {
     corto_mount_o->implements.buffer = corto_alloc(sizeof(corto_object));
     corto_mount_o->implements.buffer[0] = corto_dispatcher_o;
 
+    /* Threadpool implements dispatcher */
+    corto_threadpool_o->implements.length = 1;
+    corto_threadpool_o->implements.buffer = corto_alloc(sizeof(corto_object));
+    corto_threadpool_o->implements.buffer[0] = corto_dispatcher_o;
+
     /* Add parameter to handleAction */
     corto_handleAction_o->parameters.length = 1;
     corto_handleAction_o->parameters.buffer = corto_calloc(sizeof(corto_parameter));
@@ -969,6 +1000,10 @@ void corto_deinit_sequences(void) {
     free (corto_mount_o->implements.buffer);
     corto_mount_o->implements.length = 0;
 
+    /* Threadpool implements dispatcher */
+    free (corto_threadpool_o->implements.buffer);
+    corto_threadpool_o->implements.length = 0;
+
     free (corto_handleAction_o->parameters.buffer);
     corto_handleAction_o->parameters.length = 0;
 }
@@ -1005,6 +1040,11 @@ void corto_environment_init(void)
         CORTO_LOG_BACKTRACE = !strcmp(enableBacktrace, "true");
     }
 
+    corto_string enableSlab = corto_getenv("CORTO_SLAB");
+    if (enableSlab) {
+        corto_enable_slab(strcmp(enableSlab, "false") != 0);
+    }
+
     corto_string errfmt = corto_getenv("CORTO_LOG_FORMAT");
     if (errfmt && errfmt[0]) {
         corto_log_fmt(errfmt);
@@ -1070,7 +1110,6 @@ int corto_start(
     corto_platform_init(appName);
 
     /* Initialize TLS keys */
-    corto_tls_new(&CORTO_KEY_OBSERVER_ADMIN, corto_observerAdminFree);
     corto_tls_new(&CORTO_KEY_DECLARED_ADMIN, corto_declaredByMeFree);
     corto_tls_new(&CORTO_KEY_LISTEN_ADMIN, NULL);
     corto_tls_new(&CORTO_KEY_OWNER, NULL);
@@ -1078,9 +1117,19 @@ int corto_start(
     corto_tls_new(&CORTO_KEY_FLUENT, NULL);
     corto_tls_new(&CORTO_KEY_MOUNT_RESULT, NULL);
     corto_tls_new(&CORTO_KEY_CONSTRUCTOR_TYPE, NULL);
+    corto_tls_new(&CORTO_KEY_PUBLISH, NULL);
     corto_tls_new(&corto_subscriber_admin.key, corto_entityAdmin_free);
     corto_tls_new(&corto_mount_admin.key, corto_entityAdmin_free);
 
+    /* Initialize epoch administration for lock-free readers */
+    corto_epoch_init();
+
+    /* Initialize table with interned object ids */
+    corto_intern_init();
+
+    /* Initialize object memory pools */
+    corto_slab_init();
+
     /* Initialize operating system environment */
     corto_environment_init();
 
@@ -1330,6 +1379,10 @@ int corto_stop(void)
     corto_int32 i;
     corto_object o;
 
+    /* Retired elements may hold claims on objects, which must be released
+     * while their types are still intact */
+    corto_epoch_flush();
+
     /* Destruct objects */
     corto_debug("cleanup builtin objects");
 
@@ -1367,12 +1420,22 @@ int corto_stop(void)
     /* Free global entity administrations */
     corto_entityAdmin_free_contents(&corto_subscriber_admin, true);
     corto_entityAdmin_free_contents(&corto_mount_admin, true);
+    corto_subscriber_index_deinit();
+    corto_observer_index_deinit();
+    corto_fanout_deinit();
 
     /* Deinit adminLock */
     corto_debug("cleanup global administration");
     corto_mutex_free(&corto_adminLock);
     corto_rwmutex_free(&corto_subscriberLock);
 
+    /* Free memory that is still waiting for lock-free readers. Retired ids
+     * are released to the intern table and retired objects are returned to
+     * their pool, so free the table and pools afterwards. */
+    corto_epoch_deinit();
+    corto_intern_deinit();
+    corto_slab_deinit();
+
     corto_log_pop();
     corto_fmt_deinit();
     corto_platform_deinit();
@@ -141,10 +141,10 @@ CORTO_STATIC_SCOPED_OBJECT(constant);
 #define CORTO_ATTR_SSOO {{1, 0, 1, 0, 1, 0, 0}}
 #define CORTO_ATTR_SSO {{1, 0, 0, 0, 1, 0, 0}}
 #define CORTO_ATTR_SO {{0, 0, 0, 0, 1, 0, 0}}
-#define CORTO_ROOT_V() {{NULL, NULL, _(scope)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{NULL,NULL,{CORTO_RWMUTEX_INIT},NULL,NULL},{CORTO_ATTR_SSOO CORTO_ADD_MAGIC, 2, (corto_type)&lang_package__o.v}}
-#define CORTO_PACKAGE_V(parent, name, description, version, author, uri) {{CORTO_OFFSET(&parent##__o, sizeof(corto_SSOO)), name, _(scope)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{NULL,NULL,{CORTO_RWMUTEX_INIT},NULL,NULL},{CORTO_ATTR_SSOO CORTO_ADD_MAGIC, 2, (corto_type)&lang_package__o.v}}, {description, version, author, "cortoproject", uri, "https://github.com/cortoproject/corto", "MIT"}
-#define CORTO_SSO_V(parent, name, type) {{CORTO_OFFSET(&parent##__o, sizeof(corto_SSOO)), name, _(scope)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{CORTO_ATTR_SSO CORTO_ADD_MAGIC, 2, (corto_type)&type##__o.v}}
-#define CORTO_SSO_PO_V(parent, name, type) {{CORTO_OFFSET(&parent##__o, sizeof(corto_SSO)), name, _(scope)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{CORTO_ATTR_SSO CORTO_ADD_MAGIC, 2, (corto_type)&type##__o.v}}
+#define CORTO_ROOT_V() {{NULL, NULL, _(hash)0, _(scope)NULL, _(index)NULL, _(path)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{NULL,NULL,{CORTO_RWMUTEX_INIT},NULL,NULL,0},{CORTO_ATTR_SSOO CORTO_ADD_MAGIC, 2, (corto_type)&lang_package__o.v}}
+#define CORTO_PACKAGE_V(parent, name, description, version, author, uri) {{CORTO_OFFSET(&parent##__o, sizeof(corto_SSOO)), name, _(hash)0, _(scope)NULL, _(index)NULL, _(path)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{NULL,NULL,{CORTO_RWMUTEX_INIT},NULL,NULL,0},{CORTO_ATTR_SSOO CORTO_ADD_MAGIC, 2, (corto_type)&lang_package__o.v}}, {description, version, author, "cortoproject", uri, "https://github.com/cortoproject/corto", "MIT"}
+#define CORTO_SSO_V(parent, name, type) {{CORTO_OFFSET(&parent##__o, sizeof(corto_SSOO)), name, _(hash)0, _(scope)NULL, _(index)NULL, _(path)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{CORTO_ATTR_SSO CORTO_ADD_MAGIC, 2, (corto_type)&type##__o.v}}
+#define CORTO_SSO_PO_V(parent, name, type) {{CORTO_OFFSET(&parent##__o, sizeof(corto_SSO)), name, _(hash)0, _(scope)NULL, _(index)NULL, _(path)NULL, _(scopeLock){CORTO_RWMUTEX_INIT}},{CORTO_ATTR_SSO CORTO_ADD_MAGIC, 2, (corto_type)&type##__o.v}}
 
 /* SSO identifier */
 #define CORTO_ID(name) name##__o
@@ -485,6 +485,7 @@ CORTO_FWDECL_VSTORE(class, router);
 CORTO_FWDECL_VSTORE(class, routerimpl);
 CORTO_FWDECL(class, table);
 CORTO_FWDECL(class, tableinstance);
+CORTO_FWDECL_VSTORE(class, threadpool);
 CORTO_FWDECL_VSTORE(class, tool);
 CORTO_FWDECL(class, unit);
 CORTO_FWDECL(class, tag);
@@ -625,6 +626,7 @@ CORTO_FWDECL__VSTORE(method, mount_on_id);
 CORTO_FWDECL__VSTORE(method, mount_on_resume);
 CORTO_FWDECL__VSTORE(method, mount_on_query);
 CORTO_FWDECL__VSTORE(method, mount_on_history_query);
+CORTO_FWDECL__VSTORE(method, mount_on_count);
 CORTO_FWDECL__VSTORE(method, mount_on_notify);
 CORTO_FWDECL__VSTORE(method, mount_on_batch_notify);
 CORTO_FWDECL__VSTORE(method, mount_on_history_batch_notify);
@@ -807,6 +809,7 @@ CORTO_BITMASK_O(vstore, mountMask);
     CORTO_CONSTANT_O(vstore_mountMask, MOUNT_RESUME);
     CORTO_CONSTANT_O(vstore_mountMask, MOUNT_INVOKE);
     CORTO_CONSTANT_O(vstore_mountMask, MOUNT_ID);
+    CORTO_CONSTANT_O(vstore_mountMask, MOUNT_COUNT);
 
 CORTO_ENUM_O(vstore, frameKind);
     CORTO_CONSTANT_O(vstore_frameKind, FRAME_NOW);
@@ -1347,6 +1350,8 @@ CORTO_PROCEDURE_O(vstore, observer, FALSE, NULL, lang_function, CORTO_LOCAL | CO
     CORTO_MEMBER_O(vstore_observer, type, lang_type, CORTO_GLOBAL);
     CORTO_MEMBER_O(vstore_observer, enabled, lang_bool, CORTO_GLOBAL);
     CORTO_MEMBER_O(vstore_observer, active, lang_uint32, CORTO_GLOBAL|CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_observer, alignChunk, lang_uint32, CORTO_GLOBAL);
+    CORTO_MEMBER_O(vstore_observer, instanceOf, lang_bool, CORTO_GLOBAL);
     CORTO_METHOD_O(vstore_observer, init, "()", lang_int16, corto_observer_init);
     CORTO_METHOD_O(vstore_observer, construct, "()", lang_int16, corto_observer_construct);
     CORTO_METHOD_O(vstore_observer, destruct, "()", lang_void, corto_observer_destruct);
@@ -1385,7 +1390,11 @@ CORTO_PROCEDURE_O(vstore, subscriber, FALSE, NULL, vstore_observer, CORTO_HIDDEN
     CORTO_MEMBER_O(vstore_subscriber, idmatch, lang_word, CORTO_READONLY|CORTO_LOCAL);
     CORTO_MEMBER_O(vstore_subscriber, isAligning, lang_bool, CORTO_LOCAL|CORTO_PRIVATE);
     CORTO_MEMBER_O(vstore_subscriber, alignMutex, lang_word, CORTO_LOCAL|CORTO_PRIVATE);
-    CORTO_MEMBER_O(vstore_subscriber, alignQueue, lang_objectlist, CORTO_LOCAL|CORTO_PRIVATE);
+    CORTO_MEMBER_O(vstore_subscriber, alignQueue, lang_word, CORTO_LOCAL|CORTO_PRIVATE);
+    CORTO_MEMBER_O(vstore_subscriber, alignDuration, lang_uint64, CORTO_READONLY|CORTO_LOCAL);
+    CORTO_MEMBER_O(vstore_subscriber, alignQueueMax, lang_uint32, CORTO_READONLY|CORTO_LOCAL);
+    CORTO_MEMBER_O(vstore_subscriber, rate, lang_float64, CORTO_GLOBAL);
+    CORTO_MEMBER_O(vstore_subscriber, limiter, lang_word, CORTO_LOCAL|CORTO_PRIVATE);
     CORTO_METHOD_O(vstore_subscriber, init, "()", lang_int16, corto_subscriber_init);
     CORTO_METHOD_O(vstore_subscriber, deinit, "()", lang_void, corto_subscriber_deinit);
     CORTO_METHOD_O(vstore_subscriber, construct, "()", lang_int16, corto_subscriber_construct);
@@ -1424,8 +1433,7 @@ CORTO_CLASS_O(vstore, mount, vstore_subscriber, CORTO_HIDDEN, CORTO_ATTR_DEFAULT
     CORTO_MEMBER_O(vstore_mount, mount, lang_object, CORTO_HIDDEN);
     CORTO_MEMBER_O(vstore_mount, attr, lang_attr, CORTO_HIDDEN);
     CORTO_MEMBER_O(vstore_mount, subscriptions, vstore_mountSubscriptionList, CORTO_READONLY);
-    CORTO_MEMBER_O(vstore_mount, events, lang_objectlist, CORTO_PRIVATE);
-    CORTO_MEMBER_O(vstore_mount, historicalEvents, lang_objectlist, CORTO_PRIVATE);
+    CORTO_MEMBER_O(vstore_mount, events, lang_word, CORTO_PRIVATE|CORTO_LOCAL);
     CORTO_MEMBER_O(vstore_mount, lastPoll, vstore_time, CORTO_PRIVATE);
     CORTO_MEMBER_O(vstore_mount, lastPost, vstore_time, CORTO_PRIVATE);
     CORTO_MEMBER_O(vstore_mount, lastSleep, vstore_time, CORTO_PRIVATE);
@@ -1451,6 +1459,7 @@ CORTO_CLASS_O(vstore, mount, vstore_subscriber, CORTO_HIDDEN, CORTO_ATTR_DEFAULT
     CORTO_METHOD_O(vstore_mount, id, "()", lang_string, corto_mount_id);
     CORTO_METHOD_O(vstore_mount, query, "(vstore/query query)", vstore_resultIter, corto_mount_query);
     CORTO_METHOD_O(vstore_mount, historyQuery, "(vstore/query query)", vstore_resultIter, corto_mount_query);
+    CORTO_METHOD_O(vstore_mount, count, "(vstore/query query)", lang_int64, corto_mount_count);
     CORTO_METHOD_O(vstore_mount, resume, "(string parent,string id,inout:object o_out)", lang_int16, corto_mount_resume);
     CORTO_METHOD_O(vstore_mount, subscribe, "(/corto/vstore/query query)", lang_void, corto_mount_subscribe);
     CORTO_METHOD_O(vstore_mount, unsubscribe, "(/corto/vstore/query query)", lang_void, corto_mount_unsubscribe);
@@ -1458,6 +1467,7 @@ CORTO_CLASS_O(vstore, mount, vstore_subscriber, CORTO_HIDDEN, CORTO_ATTR_DEFAULT
     CORTO_OVERRIDABLE_O(vstore_mount, on_id, "()", lang_string, corto_mount_on_id_v);
     CORTO_OVERRIDABLE_O(vstore_mount, on_query, "(/corto/vstore/query query)", vstore_resultIter, corto_mount_on_query_v);
     CORTO_OVERRIDABLE_O(vstore_mount, on_history_query, "(/corto/vstore/query query)", vstore_resultIter, corto_mount_on_history_query_v);
+    CORTO_OVERRIDABLE_O(vstore_mount, on_count, "(/corto/vstore/query query)", lang_int64, corto_mount_on_count_v);
     CORTO_OVERRIDABLE_O(vstore_mount, on_resume, "(string parent,string id,inout:object object)", lang_int16, corto_mount_on_resume_v);
     CORTO_OVERRIDABLE_O(vstore_mount, on_notify, "(vstore/subscriber_event event)", lang_void, corto_mount_on_notify_v);
     CORTO_OVERRIDABLE_O(vstore_mount, on_batch_notify, "(vstore/subscriber_eventIter events)", lang_void, corto_mount_on_batch_notify_v);
@@ -1545,6 +1555,24 @@ CORTO_CLASS_O(vstore, loader, vstore_mount, CORTO_READONLY, CORTO_ATTR_DEFAULT,
     CORTO_OVERRIDABLE_O(vstore_loader, on_query, "(/corto/vstore/query query)", vstore_resultIter, corto_loader_on_query_v);
     CORTO_OVERRIDE_O(vstore_loader, on_resume, "(string parent,string id,inout:object object)", lang_int16, corto_loader_on_resume);
 
+/* /corto/vstore/threadpool */
+CORTO_FW_CD(vstore, threadpool);
+CORTO_CLASS_NOBASE_O(vstore, threadpool, CORTO_ATTR_DEFAULT, NULL, CORTO_DECLARED | CORTO_VALID, NULL, NULL, CORTO_CD);
+    CORTO_MEMBER_O(vstore_threadpool, workers, lang_uint32, CORTO_GLOBAL);
+    CORTO_MEMBER_O(vstore_threadpool, ordered, lang_bool, CORTO_GLOBAL);
+    CORTO_MEMBER_O(vstore_threadpool, posted, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, processed, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, stolen, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, queueDepth, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, maxQueueDepth, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, latencyAvg, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, latencyMax, lang_uint64, CORTO_READONLY);
+    CORTO_MEMBER_O(vstore_threadpool, impl, lang_word, CORTO_PRIVATE|CORTO_LOCAL);
+    CORTO_METHOD_O(vstore_threadpool, construct, "()", lang_int16, corto_threadpool_construct);
+    CORTO_METHOD_O(vstore_threadpool, destruct, "()", lang_void, corto_threadpool_destruct);
+    CORTO_METHOD_O(vstore_threadpool, post, "(event e)", lang_void, corto_threadpool_post);
+    CORTO_METHOD_O(vstore_threadpool, updateMetrics, "()", lang_void, corto_threadpool_updateMetrics);
+
 
 #ifdef __cplusplus
 }
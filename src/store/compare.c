@@ -0,0 +1,291 @@
+#include "object.h"
+
+/* Fields for which bytewise equality is the same as value equality. Floating
+ * point values are excluded (-0.0 == 0.0, NaN != NaN). */
+#define COMPARE_IS_EXACT(kind)\
+    (((kind) >= CORTO_TC_BIN && (kind) < CORTO_TC_FLOAT) ||\
+     ((kind) >= CORTO_TC_BOOL && (kind) <= CORTO_TC_BITMASK))
+
+#define COMPARE_IS_SIMPLE(kind)\
+    ((kind) >= CORTO_TC_BIN && (kind) <= CORTO_TC_BITMASK)
+
+#define COMPARE(type, v1, v2)\
+    (*(type*)v1 > *(type*)v2\
+        ? CORTO_GT\
+        : *(type*)v1 < *(type*)v2\
+            ? CORTO_LT\
+            : CORTO_EQ)
+
+#define COMPARE_WIDTH(constant, prefix)\
+    case CORTO_TC_##constant + CORTO_WIDTH_8:\
+        return COMPARE(prefix##8_t, v1, v2);\
+    case CORTO_TC_##constant + CORTO_WIDTH_16:\
+        return COMPARE(prefix##16_t, v1, v2);\
+    case CORTO_TC_##constant + CORTO_WIDTH_32:\
+        return COMPARE(prefix##32_t, v1, v2);\
+    case CORTO_TC_##constant + CORTO_WIDTH_64:\
+        return COMPARE(prefix##64_t, v1, v2);\
+    case CORTO_TC_##constant + CORTO_WIDTH_WORD:\
+        return COMPARE(prefix##ptr_t, v1, v2)
+
+/* Collections normalize their result to LT/EQ/GT (same as compare_ser) */
+#define COMPARE_NORMALIZE(result)\
+    ((result) < 0 ? CORTO_LT : (result) > 0 ? CORTO_GT : CORTO_EQ)
+
+CORTO_SEQUENCE(dummy_seq,void*,);
+
+static
+corto_equalityKind corto_compare_simple(
+    uint8_t kind,
+    const void *v1,
+    const void *v2)
+{
+    switch(kind) {
+    case CORTO_TC_BOOL: return COMPARE(bool, v1, v2);
+    case CORTO_TC_CHAR: return COMPARE(char, v1, v2);
+    case CORTO_TC_ENUM: return COMPARE(int32_t, v1, v2);
+    case CORTO_TC_BITMASK: return COMPARE(uint32_t, v1, v2);
+    COMPARE_WIDTH(BIN, uint);
+    COMPARE_WIDTH(INT, int);
+    COMPARE_WIDTH(UINT, uint);
+    case CORTO_TC_FLOAT + CORTO_WIDTH_32: return COMPARE(float, v1, v2);
+    case CORTO_TC_FLOAT + CORTO_WIDTH_64: return COMPARE(double, v1, v2);
+    default:
+        break;
+    }
+
+    return CORTO_EQ;
+}
+
+static
+corto_equalityKind corto_compare_string(
+    const char *s1,
+    const char *s2)
+{
+    if (s1 && s2) {
+        int result = strcmp(s1, s2);
+        return COMPARE_NORMALIZE(result);
+    } else if (s1 == s2) {
+        return CORTO_EQ;
+    } else {
+        return s1 ? CORTO_GT : CORTO_LT;
+    }
+}
+
+/* Fallback for values that are not flattened in the typecache (unions, any) */
+static
+corto_equalityKind corto_compare_walk(
+    const void *p1,
+    const void *p2,
+    corto_type type)
+{
+    corto_compare_ser_t data;
+    corto_walk_opt s =
+        corto_compare_ser(CORTO_PRIVATE, CORTO_NOT, CORTO_WALK_TRACE_NEVER);
+
+    data.value = corto_value_value((void*)p2, type);
+    corto_walk_ptr(&s, (void*)p1, type, &data);
+
+    return data.result;
+}
+
+static
+corto_equalityKind corto_compare_array(
+    const void *a1,
+    uint32_t length1,
+    const void *a2,
+    uint32_t length2,
+    uint32_t element_size)
+{
+    if (length1 != length2) {
+        return length1 > length2 ? CORTO_GT : CORTO_LT;
+    }
+
+    /* Compare memory of arrays, like compare_ser */
+    if (length1) {
+        int result = memcmp(a1, a2, length1 * element_size);
+        return COMPARE_NORMALIZE(result);
+    }
+
+    return CORTO_EQ;
+}
+
+static
+corto_equalityKind corto_compare_list(
+    corto_ll l1,
+    corto_ll l2,
+    corto_type element_type)
+{
+    uint32_t count1 = l1 ? corto_ll_count(l1) : 0;
+    uint32_t count2 = l2 ? corto_ll_count(l2) : 0;
+    corto_equalityKind result = CORTO_EQ;
+
+    if (count1 != count2) {
+        return count1 > count2 ? CORTO_GT : CORTO_LT;
+    } else if (l1 && !l2) {
+        return CORTO_GT;
+    } else if (!l1 && l2) {
+        return CORTO_LT;
+    } else if (!l1) {
+        return CORTO_EQ;
+    }
+
+    bool requires_alloc = corto_collection_requiresAlloc(element_type);
+    corto_iter it1 = corto_ll_iter(l1);
+    corto_iter it2 = corto_ll_iter(l2);
+    while (!result && corto_iter_hasNext(&it1) && corto_iter_hasNext(&it2)) {
+        void *e1, *e2;
+        if (requires_alloc) {
+            e1 = corto_iter_next(&it1);
+            e2 = corto_iter_next(&it2);
+        } else {
+            e1 = corto_iter_nextPtr(&it1);
+            e2 = corto_iter_nextPtr(&it2);
+        }
+        result = corto_ptr_compare(e1, element_type, e2);
+    }
+
+    return COMPARE_NORMALIZE(result);
+}
+
+static
+corto_equalityKind corto_compare_map(
+    corto_rb m1,
+    corto_rb m2)
+{
+    uint32_t count1 = m1 ? corto_rb_count(m1) : 0;
+    uint32_t count2 = m2 ? corto_rb_count(m2) : 0;
+
+    /* Elements of maps are not compared (same as compare_ser) */
+    if (count1 != count2) {
+        return count1 > count2 ? CORTO_GT : CORTO_LT;
+    }
+
+    return CORTO_EQ;
+}
+
+/* compare_ser locates optional and observable values of the second operand at
+ * the offset of the first value from the first base, which is not a member
+ * offset as the values are stored on the heap. To return the same results as
+ * compare_ser, types with such members are compared by the serializer. */
+bool corto_compare_hasFields(
+    corto_type type)
+{
+    corto_typecache *cache = (corto_typecache*)type->typecache;
+    return cache && (cache->flags & CORTO_TC_COMPARE_BY_FIELDS);
+}
+
+corto_equalityKind corto_compare_fields(
+    const void *base1,
+    const void *base2,
+    corto_type type)
+{
+    corto_typecache *cache = (corto_typecache*)type->typecache;
+    corto_equalityKind result = CORTO_EQ;
+
+    corto_assert(cache != NULL, "corto_compare_fields called without typecache");
+
+    uint32_t i;
+    for (i = 0; !result && i < cache->field_count; i ++) {
+        corto_typecache_field *field = &cache->fields[i];
+
+        /* Private members are not compared */
+        if (field->meta_flags & CORTO_TC_META_PRIVATE) {
+            continue;
+        }
+
+        const void *p1 = CORTO_OFFSET(base1, field->offset);
+        const void *p2 = CORTO_OFFSET(base2, field->offset);
+
+        if (COMPARE_IS_EXACT(field->kind)) {
+            /* Find run of adjacent fields without padding in between, so the
+             * run can be compared with a single memcmp. Nested struct markers
+             * don't take up space and don't break a run. */
+            uint32_t run_end = field->offset + field->size;
+            uint32_t j, last = i;
+            for (j = i + 1; j < cache->field_count; j ++) {
+                corto_typecache_field *next = &cache->fields[j];
+                if (next->meta_flags & CORTO_TC_META_PRIVATE) {
+                    break;
+                }
+                if (next->kind == CORTO_TC_STRUCT) {
+                    continue;
+                }
+                if (!COMPARE_IS_EXACT(next->kind) || next->offset != run_end) {
+                    break;
+                }
+                run_end = next->offset + next->size;
+                last = j;
+            }
+
+            if (memcmp(p1, p2, run_end - field->offset)) {
+                /* memcmp doesn't order integers correctly, so find the first
+                 * field in the run that is different. */
+                for (j = i; !result && j <= last; j ++) {
+                    corto_typecache_field *f = &cache->fields[j];
+                    if (f->kind != CORTO_TC_STRUCT) {
+                        result = corto_compare_simple(f->kind,
+                            CORTO_OFFSET(base1, f->offset),
+                            CORTO_OFFSET(base2, f->offset));
+                    }
+                }
+            }
+
+            i = last;
+            continue;
+        }
+
+        if (COMPARE_IS_SIMPLE(field->kind)) {
+            result = corto_compare_simple(field->kind, p1, p2);
+            continue;
+        }
+
+        switch(field->kind) {
+        case CORTO_TC_STRING:
+            result = corto_compare_string(*(char**)p1, *(char**)p2);
+            break;
+        case CORTO_TC_REFERENCE:
+            if (*(corto_object*)p1 != *(corto_object*)p2) {
+                result = CORTO_NEQ;
+            }
+            break;
+        case CORTO_TC_STRUCT: /* Ignore; nesting is not relevant */ break;
+
+        /* Unions & any values are dynamically typed, use walk */
+        case CORTO_TC_UNION:
+            result = corto_compare_walk(
+                p1, p2, corto_type(field->data.union_type));
+            break;
+        case CORTO_TC_ANY:
+            result = corto_compare_walk(p1, p2, corto_type(corto_any_o));
+            break;
+
+        default:
+            /* Strip sub_kind from collection kinds */
+            switch(field->kind - field->kind % 10) {
+            case CORTO_TC_ARRAY:
+                result = corto_compare_array(p1, 1, p2, 1, field->size);
+                break;
+            case CORTO_TC_SEQUENCE:
+                result = corto_compare_array(
+                    ((dummy_seq*)p1)->buffer, ((dummy_seq*)p1)->length,
+                    ((dummy_seq*)p2)->buffer, ((dummy_seq*)p2)->length,
+                    corto_type_sizeof(field->data.sub_type));
+                break;
+            case CORTO_TC_LIST:
+                result = corto_compare_list(
+                    *(corto_ll*)p1, *(corto_ll*)p2, field->data.sub_type);
+                break;
+            case CORTO_TC_MAP:
+                result = corto_compare_map(*(corto_rb*)p1, *(corto_rb*)p2);
+                break;
+            default:
+                /* Ignore other instructions */
+                break;
+            }
+            break;
+        }
+    }
+
+    return result;
+}
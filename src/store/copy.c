@@ -0,0 +1,327 @@
+#include "object.h"
+
+/* Fields that hold no resources and can be copied with a plain memcpy. These
+ * are all the numeric, bool, char, enum and bitmask kinds. */
+#define COPY_IS_SIMPLE(kind)\
+    ((kind) >= CORTO_TC_BIN && (kind) <= CORTO_TC_BITMASK)
+
+/* Max number of padding bytes between two fields of a memcpy run. Gaps that
+ * are larger than this contain data that is not in the typecache (iterators),
+ * and must not be overwritten. */
+#define COPY_MAX_PADDING (sizeof(uint64_t))
+
+#define COPY_STRING(dst, src) corto_set_str((char**)dst, *(char**)src)
+#define COPY_REFERENCE(dst, src) corto_set_ref(dst, *(corto_object*)src)
+#define COPY_VALUE(dst, src) result = corto_ptr_copy(dst, sub_type, src)
+
+#define COPY_ARRAY_ELEMENTS(dst_array, src_array, size, action)\
+    end = CORTO_OFFSET(src_array, size * count);\
+    for (src_elem = src_array, dst_elem = dst_array;\
+         !result && src_elem != end;\
+         src_elem = CORTO_OFFSET(src_elem, size),\
+         dst_elem = CORTO_OFFSET(dst_elem, size))\
+    {\
+        action;\
+    }
+
+#define COPY_ARRAY(element_size, action)\
+    sub_type = field->data.array_type->elementType;\
+    count = field->data.array_type->super.max;\
+    size = element_size;\
+    COPY_ARRAY_ELEMENTS(dst, src, size, action);
+
+CORTO_SEQUENCE(dummy_seq,void*,);
+#define COPY_SEQUENCE(element_size, action) {\
+    sub_type = field->data.sub_type;\
+    count = ((dummy_seq*)src)->length;\
+    size = element_size;\
+    corto_copy_resize_sequence(dst, sub_type, count);\
+    COPY_ARRAY_ELEMENTS(\
+        ((dummy_seq*)dst)->buffer, ((dummy_seq*)src)->buffer, size, action);\
+}
+
+/* Copying arrays and sequences is similar. Parameterize macro for code reuse */
+#define COPY_ARRAY_OP(kind, size, action)\
+    case CORTO_TC_ARRAY + CORTO_TC_SUB_##kind:\
+        COPY_ARRAY(size, action);\
+        break;\
+    case CORTO_TC_SEQUENCE + CORTO_TC_SUB_##kind:\
+        COPY_SEQUENCE(size, action);\
+        break;\
+
+/* Fallback for values that are not flattened in the typecache (unions, any).
+ * Uses the same serializer settings as corto_ptr_copy did before the
+ * typecache was introduced, so behavior is identical. */
+static
+int16_t corto_copy_walk(
+    void *dst,
+    void *src,
+    corto_type type)
+{
+    corto_walk_opt s =
+        corto_copy_ser(CORTO_PRIVATE, CORTO_NOT, CORTO_WALK_TRACE_ON_FAIL);
+    corto_copy_ser_t data;
+
+    data.value = corto_value_mem(dst, type);
+
+    return corto_walk_ptr(&s, src, type, &data);
+}
+
+/* Resize sequence to length of source. Superfluous elements are deinitialized,
+ * new elements are zero-initialized (same as copy_ser). */
+static
+void corto_copy_resize_sequence(
+    dummy_seq *seq,
+    corto_type element_type,
+    uint32_t length)
+{
+    uint32_t element_size = corto_type_sizeof(element_type);
+
+    if (seq->length > length) {
+        uint32_t i;
+        for (i = length; i < seq->length; i ++) {
+            corto_ptr_deinit(
+                CORTO_OFFSET(seq->buffer, element_size * i), element_type);
+        }
+        seq->buffer = corto_realloc(seq->buffer, element_size * length);
+    } else if (seq->length < length) {
+        seq->buffer = corto_realloc(seq->buffer, element_size * length);
+        memset(CORTO_OFFSET(seq->buffer, element_size * seq->length), 0,
+            (length - seq->length) * element_size);
+    }
+
+    seq->length = length;
+}
+
+static
+int16_t corto_copy_list(
+    corto_ll *dst_ptr,
+    corto_ll src,
+    corto_type element_type,
+    uint8_t sub_kind)
+{
+    corto_ll dst = *dst_ptr;
+    bool requires_alloc = corto_collection_requiresAlloc(element_type);
+    uint32_t count = src ? corto_ll_count(src) : 0;
+    int16_t result = 0;
+
+    if (!dst) {
+        if (!src) {
+            return 0;
+        }
+        *dst_ptr = dst = corto_ll_new();
+    }
+
+    /* Resize destination list */
+    uint32_t dst_count = corto_ll_count(dst);
+    for (; dst_count > count; dst_count --) {
+        void *elem = corto_ll_takeFirst(dst);
+        if (requires_alloc) {
+            corto_ptr_free(elem, element_type);
+        } else {
+            corto_ptr_deinit(&elem, element_type);
+        }
+    }
+    for (; dst_count < count; dst_count ++) {
+        if (requires_alloc) {
+            corto_ll_insert(dst, corto_ptr_new(element_type));
+        } else {
+            corto_ptr_init(corto_ll_insert(dst, NULL), element_type);
+        }
+    }
+
+    if (src) {
+        corto_iter dst_it = corto_ll_iter(dst);
+        corto_iter src_it = corto_ll_iter(src);
+        while (!result && corto_iter_hasNext(&src_it)) {
+            void *dst_elem, *src_elem;
+            if (requires_alloc) {
+                dst_elem = corto_iter_next(&dst_it);
+                src_elem = corto_iter_next(&src_it);
+            } else {
+                dst_elem = corto_iter_nextPtr(&dst_it);
+                src_elem = corto_iter_nextPtr(&src_it);
+            }
+
+            switch(sub_kind) {
+            case CORTO_TC_SUB_STRING:
+                COPY_STRING(dst_elem, src_elem);
+                break;
+            case CORTO_TC_SUB_REFERENCE:
+                COPY_REFERENCE(dst_elem, src_elem);
+                break;
+            case CORTO_TC_SUB_SIMPLE_PTR:
+                /* Value is stored in the node pointer */
+                *(void**)dst_elem = *(void**)src_elem;
+                break;
+            default:
+                result = corto_ptr_copy(dst_elem, element_type, src_elem);
+                break;
+            }
+        }
+    } else {
+        /* List should be empty by now */
+        corto_ll_free(dst);
+        *dst_ptr = NULL;
+    }
+
+    return result;
+}
+
+static
+int16_t corto_copy_optional(
+    void **dst,
+    void *src,
+    corto_type sub_type)
+{
+    if (src) {
+        if (!*dst) {
+            *dst = corto_ptr_new(sub_type);
+        }
+        return corto_ptr_copy(*dst, sub_type, src);
+    } else if (*dst) {
+        corto_ptr_free(*dst, sub_type);
+        *dst = NULL;
+    }
+
+    return 0;
+}
+
+static
+int16_t corto_copy_observable(
+    void *dst,
+    void *src,
+    corto_type sub_type)
+{
+    if (!sub_type->reference) {
+        return corto_ptr_copy(*(void**)dst, sub_type, *(void**)src);
+    } else {
+        /* Observable reference members are automatically initialized with an
+         * orphaned object of the specified member type. */
+        corto_object dst_object = *(corto_object*)dst;
+        return corto_copy(&dst_object, *(corto_object*)src);
+    }
+}
+
+int16_t corto_copy_fields(
+    void *dst_base,
+    void *src_base,
+    corto_type type)
+{
+    corto_typecache *cache = (corto_typecache*)type->typecache;
+    int16_t result = 0;
+
+    corto_assert(cache != NULL, "corto_copy_fields called without typecache");
+
+    int i;
+    for (i = 0; !result && i < cache->field_count; i ++) {
+        corto_typecache_field *field = &cache->fields[i];
+
+        /* Private members are not copied */
+        if (field->meta_flags & CORTO_TC_META_PRIVATE) {
+            continue;
+        }
+
+        void *dst = CORTO_OFFSET(dst_base, field->offset);
+        void *src = CORTO_OFFSET(src_base, field->offset);
+
+        /* Variables used within macro's */
+        void *src_elem, *dst_elem, *end;
+        uint32_t size, count;
+        corto_type sub_type = NULL;
+
+        if (COPY_IS_SIMPLE(field->kind)) {
+            /* Coalesce adjacent simple fields into a single memcpy. Nested
+             * struct markers don't take up space and don't break a run. */
+            uint32_t run_end = field->offset + field->size;
+            int j;
+            for (j = i + 1; j < cache->field_count; j ++) {
+                corto_typecache_field *next = &cache->fields[j];
+                if (next->meta_flags & CORTO_TC_META_PRIVATE) {
+                    break;
+                }
+                if (next->kind == CORTO_TC_STRUCT) {
+                    continue;
+                }
+                if (!COPY_IS_SIMPLE(next->kind) ||
+                    next->offset < run_end ||
+                    next->offset - run_end >= COPY_MAX_PADDING)
+                {
+                    break;
+                }
+                run_end = next->offset + next->size;
+                i = j;
+            }
+
+            memcpy(dst, src, run_end - field->offset);
+            continue;
+        }
+
+        switch(field->kind) {
+        case CORTO_TC_STRING: COPY_STRING(dst, src); break;
+        case CORTO_TC_REFERENCE: COPY_REFERENCE(dst, src); break;
+        case CORTO_TC_INLINE_REFERENCE:
+            result = corto_copy_observable(dst, src, field->data.sub_type);
+            break;
+        case CORTO_TC_STRUCT: /* Ignore; nesting is not relevant */ break;
+
+        /* Unions & any values are dynamically typed, use walk */
+        case CORTO_TC_UNION:
+            result = corto_copy_walk(
+                dst, src, corto_type(field->data.union_type));
+            break;
+        case CORTO_TC_ANY:
+            result = corto_copy_walk(dst, src, corto_type(corto_any_o));
+            break;
+
+        /* Optional values are stored as pointer, regardless of subkind */
+        case CORTO_TC_OPTIONAL:
+        case CORTO_TC_OPTIONAL + CORTO_TC_SUB_STRING:
+        case CORTO_TC_OPTIONAL + CORTO_TC_SUB_REFERENCE:
+        case CORTO_TC_OPTIONAL + CORTO_TC_SUB_RESOURCE:
+        case CORTO_TC_OPTIONAL + CORTO_TC_SUB_COMPLEX:
+        case CORTO_TC_OPTIONAL + CORTO_TC_SUB_SIMPLE_PTR:
+            result = corto_copy_optional(
+                dst, *(void**)src, field->data.sub_type);
+            break;
+
+        /* Array & sequence operations. Arrays of simple elements are copied
+         * with a single memcpy */
+        case CORTO_TC_ARRAY + CORTO_TC_SUB_SIMPLE_PTR:
+            memcpy(dst, src, field->size);
+            break;
+        case CORTO_TC_SEQUENCE + CORTO_TC_SUB_SIMPLE_PTR:
+            sub_type = field->data.sub_type;
+            count = ((dummy_seq*)src)->length;
+            corto_copy_resize_sequence(dst, sub_type, count);
+            memcpy(((dummy_seq*)dst)->buffer, ((dummy_seq*)src)->buffer,
+                count * corto_type_sizeof(sub_type));
+            break;
+        COPY_ARRAY_OP(STRING, sizeof(char*), COPY_STRING(dst_elem, src_elem));
+        COPY_ARRAY_OP(REFERENCE, sizeof(void*), COPY_REFERENCE(dst_elem, src_elem));
+        COPY_ARRAY_OP(RESOURCE, sub_type->size, COPY_VALUE(dst_elem, src_elem));
+        COPY_ARRAY_OP(COMPLEX, sub_type->size, COPY_VALUE(dst_elem, src_elem));
+
+        /* List operations */
+        case CORTO_TC_LIST:
+        case CORTO_TC_LIST + CORTO_TC_SUB_STRING:
+        case CORTO_TC_LIST + CORTO_TC_SUB_REFERENCE:
+        case CORTO_TC_LIST + CORTO_TC_SUB_RESOURCE:
+        case CORTO_TC_LIST + CORTO_TC_SUB_ALLOC:
+        case CORTO_TC_LIST + CORTO_TC_SUB_COMPLEX:
+        case CORTO_TC_LIST + CORTO_TC_SUB_SIMPLE_PTR:
+            result = corto_copy_list(
+                dst,
+                *(corto_ll*)src,
+                field->data.sub_type,
+                field->kind - CORTO_TC_LIST);
+            break;
+
+        default:
+            /* Maps are not copied (same as copy_ser) */
+            break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,231 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "object.h"
+
+/* Number of retired elements after which the global epoch is advanced */
+#define CORTO_EPOCH_RETIRE_THRESHOLD (64)
+
+/* Full memory barrier, orders the epoch announcement of a reader with the
+ * loads it does in its critical section. */
+#define CORTO_EPOCH_FENCE() __sync_synchronize()
+
+typedef struct corto_epoch_item {
+    struct corto_epoch_item *next;
+    void *ptr;
+    corto_epoch_free_cb free_cb;
+} corto_epoch_item;
+
+/* Per-thread administration. Records are never freed while corto is running,
+ * so the reclaimer can walk the list without synchronizing with threads that
+ * come and go. Records of exited threads are reused by new threads. */
+typedef struct corto_epoch_thread {
+    struct corto_epoch_thread *next;
+    volatile uint32_t active; /* Is thread in critical section */
+    volatile uint32_t epoch; /* Epoch observed when entering section */
+    uint32_t depth; /* Nesting level, only accessed by owner */
+    bool in_use;
+} corto_epoch_thread;
+
+static corto_tls CORTO_KEY_EPOCH;
+static corto_mutex_s corto_epoch_lock;
+static volatile uint32_t corto_epoch_global = 0;
+static corto_epoch_thread *corto_epoch_threads = NULL;
+
+/* Elements are stored in the list of the epoch in which they were retired. An
+ * element retired in epoch e can be freed once the global epoch has advanced to
+ * e + 2, as by then all readers have started after the element was unlinked. */
+static corto_epoch_item *corto_epoch_limbo[3];
+static uint32_t corto_epoch_pending = 0;
+
+static
+void corto_epoch_thread_free(
+    void *data)
+{
+    corto_epoch_thread *thread = data;
+    thread->active = 0;
+    thread->depth = 0;
+    CORTO_EPOCH_FENCE();
+    thread->in_use = false;
+}
+
+static
+corto_epoch_thread* corto_epoch_thread_get(void)
+{
+    corto_epoch_thread *thread = corto_tls_get(CORTO_KEY_EPOCH);
+    if (!thread) {
+        corto_mutex_lock(&corto_epoch_lock);
+        for (thread = corto_epoch_threads; thread; thread = thread->next) {
+            if (!thread->in_use) {
+                break;
+            }
+        }
+        if (!thread) {
+            thread = corto_calloc(sizeof(corto_epoch_thread));
+            thread->next = corto_epoch_threads;
+            corto_epoch_threads = thread;
+        }
+        thread->in_use = true;
+        corto_mutex_unlock(&corto_epoch_lock);
+        corto_tls_set(CORTO_KEY_EPOCH, thread);
+    }
+    return thread;
+}
+
+static
+void corto_epoch_free_list(
+    corto_epoch_item *item)
+{
+    while (item) {
+        corto_epoch_item *next = item->next;
+        item->free_cb(item->ptr);
+        corto_dealloc(item);
+        item = next;
+    }
+}
+
+/* Advance the global epoch if all threads in a critical section have observed
+ * the current epoch. Must be called with corto_epoch_lock locked. On success
+ * reclaim is set to the list of elements that can be freed. */
+static
+bool corto_epoch_try_advance(
+    corto_epoch_item **reclaim)
+{
+    uint32_t epoch = corto_epoch_global;
+    corto_epoch_thread *thread;
+
+    CORTO_EPOCH_FENCE();
+
+    for (thread = corto_epoch_threads; thread; thread = thread->next) {
+        if (thread->active && thread->epoch != epoch) {
+            return false;
+        }
+    }
+
+    epoch ++;
+    corto_epoch_global = epoch;
+    CORTO_EPOCH_FENCE();
+
+    /* List of the new epoch contains elements retired two epochs ago */
+    *reclaim = corto_epoch_limbo[epoch % 3];
+    corto_epoch_limbo[epoch % 3] = NULL;
+
+    return true;
+}
+
+void corto_epoch_init(void)
+{
+    corto_tls_new(&CORTO_KEY_EPOCH, corto_epoch_thread_free);
+    corto_mutex_new(&corto_epoch_lock);
+}
+
+void corto_epoch_flush(void)
+{
+    corto_epoch_item *reclaim;
+    int i;
+
+    /* Free callbacks may retire other elements */
+    do {
+        reclaim = NULL;
+        corto_mutex_lock(&corto_epoch_lock);
+        for (i = 0; i < 3; i ++) {
+            corto_epoch_item *item = corto_epoch_limbo[i];
+            while (item) {
+                corto_epoch_item *next = item->next;
+                item->next = reclaim;
+                reclaim = item;
+                item = next;
+            }
+            corto_epoch_limbo[i] = NULL;
+        }
+        corto_epoch_pending = 0;
+        corto_mutex_unlock(&corto_epoch_lock);
+
+        corto_epoch_free_list(reclaim);
+    } while (reclaim);
+}
+
+void corto_epoch_deinit(void)
+{
+    corto_epoch_flush();
+
+    /* Records of threads that are still running are not freed, as their TLS
+     * destructor still needs to access them */
+    corto_epoch_thread *self = corto_tls_get(CORTO_KEY_EPOCH);
+    corto_epoch_thread *thread = corto_epoch_threads;
+    while (thread) {
+        corto_epoch_thread *next = thread->next;
+        if (!thread->in_use || thread == self) {
+            corto_dealloc(thread);
+        }
+        thread = next;
+    }
+    corto_epoch_threads = NULL;
+
+    corto_tls_set(CORTO_KEY_EPOCH, NULL);
+    corto_mutex_free(&corto_epoch_lock);
+}
+
+void corto_epoch_enter(void)
+{
+    corto_epoch_thread *thread = corto_epoch_thread_get();
+    if (!thread->depth ++) {
+        thread->active = 1;
+        CORTO_EPOCH_FENCE();
+        thread->epoch = corto_epoch_global;
+        CORTO_EPOCH_FENCE();
+    }
+}
+
+void corto_epoch_exit(void)
+{
+    corto_epoch_thread *thread = corto_tls_get(CORTO_KEY_EPOCH);
+    corto_assert(thread && thread->depth,
+        "corto_epoch_exit called outside of critical section");
+    if (!-- thread->depth) {
+        CORTO_EPOCH_FENCE();
+        thread->active = 0;
+    }
+}
+
+void corto_epoch_retire(
+    void *ptr,
+    corto_epoch_free_cb free_cb)
+{
+    corto_epoch_item *item = corto_alloc(sizeof(corto_epoch_item));
+    corto_epoch_item *reclaim = NULL;
+    item->ptr = ptr;
+    item->free_cb = free_cb;
+
+    corto_mutex_lock(&corto_epoch_lock);
+    uint32_t epoch = corto_epoch_global;
+    item->next = corto_epoch_limbo[epoch % 3];
+    corto_epoch_limbo[epoch % 3] = item;
+    if (++ corto_epoch_pending >= CORTO_EPOCH_RETIRE_THRESHOLD) {
+        if (corto_epoch_try_advance(&reclaim)) {
+            corto_epoch_pending = 0;
+        }
+    }
+    corto_mutex_unlock(&corto_epoch_lock);
+
+    /* Free outside of lock, as free callbacks may retire other elements */
+    corto_epoch_free_list(reclaim);
+}
@@ -0,0 +1,49 @@
+#ifndef CORTO_EPOCH_H
+#define CORTO_EPOCH_H
+
+/* Epoch based reclamation allows datastructures to be read without taking a
+ * lock, while writers (which still synchronize amongst themselves) remove and
+ * free elements from the datastructure.
+ *
+ * Readers wrap access to shared data in corto_epoch_enter/corto_epoch_exit.
+ * Writers that unlink an element pass it to corto_epoch_retire instead of
+ * freeing it. The element is freed once all threads that were reading when it
+ * was unlinked have left their critical section.
+ *
+ * Critical sections are cheap (a TLS lookup and a fence) and may be nested.
+ * Readers must not block inside a critical section, as this prevents retired
+ * elements from being reclaimed.
+ */
+
+typedef void (*corto_epoch_free_cb)(void *ptr);
+
+/* Make pointer visible to readers. Ensures that the memory it points to is
+ * initialized before readers can observe the new pointer value. */
+#define corto_epoch_publish(ptr, value)\
+    do { __sync_synchronize(); *(ptr) = (value); } while (0)
+
+/* Initialize epoch administration. Called once by corto_start. */
+void corto_epoch_init(void);
+
+/* Free all retired elements. Only valid when no thread is in a critical
+ * section, such as when corto shuts down. */
+void corto_epoch_flush(void);
+
+/* Free all retired elements and thread administrations. Called by corto_stop,
+ * after which no thread may read epoch protected data anymore. */
+void corto_epoch_deinit(void);
+
+/* Enter critical section. Data obtained within the section stays valid until
+ * the matching corto_epoch_exit. */
+void corto_epoch_enter(void);
+
+/* Leave critical section. */
+void corto_epoch_exit(void);
+
+/* Free element with free_cb when no thread can still be reading it. The element
+ * must already be unreachable for new readers. */
+void corto_epoch_retire(
+    void *ptr,
+    corto_epoch_free_cb free_cb);
+
+#endif
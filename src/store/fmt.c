@@ -79,7 +79,18 @@ void* corto_fmt_ptr_fromValue(
     corto_type t = corto_value_typeof(v);
     void *ptr = corto_mem_new(t);
 
-    if (t->flags & CORTO_TYPE_HAS_RESOURCES) {
+    if (opt && opt->members.length) {
+        /* Only copy projected members, leave other members zero */
+        void *src = corto_value_ptrof(v);
+        uint32_t i;
+        for (i = 0; i < opt->members.length; i ++) {
+            corto_member m = opt->members.buffer[i];
+            corto_ptr_copy(
+                CORTO_OFFSET(ptr, m->offset),
+                m->type,
+                CORTO_OFFSET(src, m->offset));
+        }
+    } else if (t->flags & CORTO_TYPE_HAS_RESOURCES) {
         corto_value dst = corto_value_mem(ptr, t);
         corto_value_copy(&dst, v);
     } else {
@@ -133,6 +144,10 @@ void* corto_fmt_str_fromValue(
     serData.prefixType = FALSE;
     serData.enableColors = FALSE;
 
+    if (opt) {
+        s.members = opt->members;
+    }
+
     corto_walk_value(&s, v, &serData);
     corto_string result = corto_buffer_str(&serData.buffer);
     corto_walk_deinit(&s, &serData);
@@ -0,0 +1,211 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "object.h"
+
+/* The table is split up in stripes with their own lock, so that threads that
+ * create objects don't all contend on the same lock. */
+#define CORTO_INTERN_STRIPE_BITS (6)
+#define CORTO_INTERN_STRIPES (1 << CORTO_INTERN_STRIPE_BITS)
+
+/* Initial number of buckets per stripe. Must be a power of two. */
+#define CORTO_INTERN_MIN_BUCKETS (16)
+
+/* Fold characters to lowercase in the same way as corto_compareLookupIntern */
+#define CORTO_INTERN_FOLD(ch)\
+    (((ch) >= 'A' && (ch) <= 'Z') ? (ch) + ('a' - 'A') : (ch))
+
+/* Strings are allocated in the same block as the entry. The interned string
+ * points to str, so the entry can be found from the string. */
+typedef struct corto_intern_entry {
+    struct corto_intern_entry *next;
+    uint32_t hash;
+    int32_t refcount;
+    char str[];
+} corto_intern_entry;
+
+typedef struct corto_intern_stripe {
+    corto_mutex_s lock;
+    corto_intern_entry **buckets;
+    uint32_t bucket_count;
+    uint32_t count;
+} corto_intern_stripe;
+
+static corto_intern_stripe corto_intern_table[CORTO_INTERN_STRIPES];
+
+#define corto_intern_entry_of(str)\
+    ((corto_intern_entry*)CORTO_OFFSET(str, -offsetof(corto_intern_entry, str)))
+
+/* Low bits select the stripe, high bits select the bucket */
+#define corto_intern_stripe_of(hash)\
+    (&corto_intern_table[(hash) & (CORTO_INTERN_STRIPES - 1)])
+
+#define corto_intern_bucket_of(stripe, hash)\
+    (&(stripe)->buckets[\
+        ((hash) >> CORTO_INTERN_STRIPE_BITS) & ((stripe)->bucket_count - 1)])
+
+uint32_t corto_id_hash(
+    const char *id,
+    uint32_t length)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    uint32_t i;
+    for (i = 0; i < length; i ++) {
+        char ch = id[i];
+        hash ^= (uint8_t)CORTO_INTERN_FOLD(ch);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static
+void corto_intern_grow(
+    corto_intern_stripe *stripe)
+{
+    corto_intern_entry **old = stripe->buckets;
+    uint32_t i, old_count = stripe->bucket_count;
+
+    stripe->bucket_count *= 2;
+    stripe->buckets =
+        corto_calloc(stripe->bucket_count * sizeof(corto_intern_entry*));
+
+    for (i = 0; i < old_count; i ++) {
+        corto_intern_entry *entry = old[i], *next;
+        for (; entry; entry = next) {
+            corto_intern_entry **bucket =
+                corto_intern_bucket_of(stripe, entry->hash);
+            next = entry->next;
+            entry->next = *bucket;
+            *bucket = entry;
+        }
+    }
+
+    corto_dealloc(old);
+}
+
+void corto_intern_init(void)
+{
+    int i;
+    for (i = 0; i < CORTO_INTERN_STRIPES; i ++) {
+        corto_intern_stripe *stripe = &corto_intern_table[i];
+        corto_mutex_new(&stripe->lock);
+        stripe->bucket_count = CORTO_INTERN_MIN_BUCKETS;
+        stripe->buckets =
+            corto_calloc(stripe->bucket_count * sizeof(corto_intern_entry*));
+        stripe->count = 0;
+    }
+}
+
+void corto_intern_deinit(void)
+{
+    uint32_t i, b;
+    for (i = 0; i < CORTO_INTERN_STRIPES; i ++) {
+        corto_intern_stripe *stripe = &corto_intern_table[i];
+        for (b = 0; b < stripe->bucket_count; b ++) {
+            corto_intern_entry *entry = stripe->buckets[b], *next;
+            for (; entry; entry = next) {
+                next = entry->next;
+                corto_dealloc(entry);
+            }
+        }
+        corto_dealloc(stripe->buckets);
+        stripe->buckets = NULL;
+        stripe->bucket_count = 0;
+        stripe->count = 0;
+        corto_mutex_free(&stripe->lock);
+    }
+}
+
+char* corto_intern_claim(
+    const char *str,
+    uint32_t *hash_out)
+{
+    uint32_t length = strlen(str);
+    uint32_t hash = corto_id_hash(str, length);
+    corto_intern_stripe *stripe = corto_intern_stripe_of(hash);
+    corto_intern_entry *entry;
+
+    corto_mutex_lock(&stripe->lock);
+
+    corto_intern_entry **bucket = corto_intern_bucket_of(stripe, hash);
+    for (entry = *bucket; entry; entry = entry->next) {
+        if (entry->hash == hash && !strcmp(entry->str, str)) {
+            /* Entry may have a refcount of zero if it is being released. The
+             * releasing thread checks the refcount again before freeing. */
+            corto_ainc(&entry->refcount);
+            break;
+        }
+    }
+
+    if (!entry) {
+        if (stripe->count >= stripe->bucket_count) {
+            corto_intern_grow(stripe);
+            bucket = corto_intern_bucket_of(stripe, hash);
+        }
+        entry = corto_alloc(sizeof(corto_intern_entry) + length + 1);
+        entry->hash = hash;
+        entry->refcount = 1;
+        memcpy(entry->str, str, length + 1);
+        entry->next = *bucket;
+        *bucket = entry;
+        stripe->count ++;
+    }
+
+    corto_mutex_unlock(&stripe->lock);
+
+    if (hash_out) {
+        *hash_out = hash;
+    }
+
+    return entry->str;
+}
+
+void corto_intern_release(
+    const char *str)
+{
+    corto_intern_entry *entry = corto_intern_entry_of(str);
+
+    /* Read hash before decreasing the refcount, as after that the entry may
+     * be freed by another thread. */
+    uint32_t hash = entry->hash;
+
+    if (!corto_adec(&entry->refcount)) {
+        corto_intern_stripe *stripe = corto_intern_stripe_of(hash);
+        corto_mutex_lock(&stripe->lock);
+
+        /* Entry may have been claimed and released again by other threads, in
+         * which case it is no longer in the table. */
+        corto_intern_entry **ptr = corto_intern_bucket_of(stripe, hash), *e;
+        for (; (e = *ptr); ptr = &e->next) {
+            if (e == entry) {
+                if (!entry->refcount) {
+                    *ptr = entry->next;
+                    stripe->count --;
+                    corto_dealloc(entry);
+                }
+                break;
+            }
+        }
+
+        corto_mutex_unlock(&stripe->lock);
+    }
+}
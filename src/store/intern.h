@@ -0,0 +1,36 @@
+#ifndef CORTO_INTERN_H
+#define CORTO_INTERN_H
+
+/* The intern table stores a single, refcounted copy of object identifiers and
+ * type names. Many objects share the same identifier (like "value" or
+ * "status"), and many results and events the same type, so interning them
+ * saves an allocation per object. Strings that are interned can be compared by
+ * pointer.
+ *
+ * Interned strings are hashed with corto_id_hash, which is case insensitive
+ * like the comparison functions used for scopes. The hash is returned when a
+ * string is claimed, so that it doesn't need to be computed again.
+ */
+
+/* Initialize intern table. Called once by corto_start. */
+void corto_intern_init(void);
+
+/* Free intern table. Called by corto_stop. */
+void corto_intern_deinit(void);
+
+/* Obtain interned copy of string, and increase its refcount. */
+char* corto_intern_claim(
+    const char *str,
+    uint32_t *hash_out);
+
+/* Decrease refcount of interned string. String is freed when refcount reaches
+ * zero. */
+void corto_intern_release(
+    const char *str);
+
+/* Case insensitive hash of the first length characters of an identifier */
+uint32_t corto_id_hash(
+    const char *id,
+    uint32_t length);
+
+#endif
@@ -216,6 +216,14 @@ void* corto_object_startaddr(
     return result;
 }
 
+/* Return memory of object to the pool it was allocated from */
+static
+void corto_object_dealloc(
+    corto__object* o)
+{
+    corto_slab_free(corto_object_startaddr(o), o->align.attrs.slab);
+}
+
 /* Default object compare function used as tree comparator in scope rbtree */
 static
 corto_equalityKind corto_compareDefault(
@@ -226,10 +234,19 @@ corto_equalityKind corto_compareDefault(
     int r;
     corto_assert_object(this);
     CORTO_UNUSED(this);
+
+    /* Ids are interned, so equal ids are often the same string */
+    if (o1 == o2) {
+        return CORTO_EQ;
+    }
+
     return ((r = stricmp(o1, o2)) < 0) ? CORTO_LT : (r > 0) ? CORTO_GT : CORTO_EQ;
 }
 
-/* Optimized internal object compare function used in lookup functions */
+/* Optimized internal object compare function used in lookup functions. The
+ * scope tree is ordered, so ids can't be rejected by hash here. Lookups that
+ * can use the hash of an id go through the scope index (corto_lookup_index)
+ * first, which only compares ids with a matching hash. */
 static
 corto_equalityKind corto_compareLookupIntern(
     const char *o1,
@@ -427,6 +444,7 @@ static
 void corto_adopt_replaceUnknown(
     corto_object existing,
     corto_object child,
+    corto__scope *p_scope,
     corto__scope *c_scope)
 {
     /* Move scope of the existing object to new object */
@@ -434,8 +452,9 @@ void corto_adopt_replaceUnknown(
     corto__scope *e_scope = corto_hdr_scope(_existing);
 
     /* Set scope of existing (unknown) object to scope of new object */
-    free(c_scope->id);
+    corto_intern_release(c_scope->id);
     c_scope->id = e_scope->id; /* Use existing id as it's the key in the tree */
+    c_scope->hash = e_scope->hash;
     c_scope->scope = e_scope->scope;
 
     /* Manually orphan object. This ensures that corto_destruct won't try to
@@ -444,6 +463,12 @@ void corto_adopt_replaceUnknown(
     e_scope->parent = NULL; /* orphan object */
     e_scope->id = NULL;
 
+    /* Point index to new object. The id string is reused, so the node can stay */
+    if (p_scope->index) {
+        corto_scope_index_replace(
+            p_scope->index, existing, child, c_scope->hash);
+    }
+
     /* Update parent pointers & transfer refcounts of childs */
     if (c_scope->scope) {
         struct corto_adopt_updateParents_t data = {.old = existing, .new = child};
@@ -451,6 +476,17 @@ void corto_adopt_replaceUnknown(
     }
 }
 
+/* Add existing objects of a scope to a new scope index */
+static
+int corto_adopt_index(
+    corto_object o,
+    void *ctx)
+{
+    corto__scope *scope = corto_hdr_scope(corto_hdr(o));
+    corto_scope_index_add(ctx, o, scope->id, scope->hash);
+    return 1;
+}
+
 /* Adopt an object in a scope */
 static
 corto_object corto_adopt(
@@ -498,7 +534,7 @@ corto_object corto_adopt(
                 corto_type e_type = corto_typeof(existing);
                 if (e_type == corto_unknown_o) {
                     if (childType != corto_unknown_o) {
-                        corto_adopt_replaceUnknown(existing, child, c_scope);
+                        corto_adopt_replaceUnknown(existing, child, p_scope, c_scope);
                         claimParent = false;
                         existing = child;
                         *(corto_object*)ptr = child;
@@ -537,6 +573,18 @@ corto_object corto_adopt(
                  * thread will be able to resolve / redeclare the object, but
                  * other threads will only see the object after it is defined. */
                 corto_declaredByMeAdd(child);
+
+                /* Large scopes get an index for lookups that don't lock */
+                if (p_scope->index) {
+                    corto_scope_index_add(
+                        p_scope->index, child, c_scope->id, c_scope->hash);
+                } else if (corto_rb_count(p_scope->scope) >=
+                    CORTO_SCOPE_INDEX_THRESHOLD)
+                {
+                    corto_scope_index *index = corto_scope_index_new();
+                    corto_rb_walk(p_scope->scope, corto_adopt_index, index);
+                    corto_epoch_publish(&p_scope->index, index);
+                }
             }
 
             /* Parent must not be deleted before all childs are gone. */
@@ -581,6 +629,9 @@ void corto_orphan(
         /* Remove object from parent scope */
         if (corto_rwmutex_write(&p_scope->align.scopeLock)) goto error;
         corto_rb_remove(p_scope->scope, (void*)corto_idof(o));
+        if (p_scope->index) {
+            corto_scope_index_remove(p_scope->index, o, c_scope->hash);
+        }
         if (corto_rwmutex_unlock(&p_scope->align.scopeLock)) goto error;
     }
 
@@ -589,6 +640,41 @@ error:
     corto_error("corto_orphan: lock operation of scopeLock of parent failed");
 }
 
+/* Free callback for object headers that are retired through the epoch */
+static
+void corto_epoch_dealloc(
+    void *ptr)
+{
+    corto_object_dealloc(ptr);
+}
+
+/* Release callback for ids that are retired through the epoch */
+static
+void corto_epoch_release_id(
+    void *ptr)
+{
+    corto_intern_release(ptr);
+}
+
+/* Returns whether an object may have been in a scope index. Such objects can
+ * still be accessed by lookups that don't lock the scope, and must be freed
+ * through the epoch. Any object that was adopted by its parent qualifies, since
+ * corto_adopt may build the index of the parent after this object has been
+ * sampled but before it is orphaned. Must be called before corto_deinit_scope
+ * resets the parent. Unknown objects that have been replaced have no parent
+ * anymore, but may still be referenced by lookups that started before the
+ * replace. */
+static
+bool corto_indexed(
+    corto_object o)
+{
+    corto__scope *scope = corto_hdr_scope(corto_hdr(o));
+    if (scope->parent && !corto_isorphan(o)) {
+        return true;
+    }
+    return corto_typeof(o) == corto_unknown_o;
+}
+
 /* Set key values based on object id for types that have keyfields */
 static
 int16_t corto_setKeyvalues(
@@ -640,10 +726,12 @@ corto_object corto_init_scope(
     scope = corto_hdr_scope(_o);
 
     /* Temporarily assign id */
-    scope->id = id ? corto_strdup(id) : NULL;
+    scope->id = id ? corto_intern_claim(id, &scope->hash) : NULL;
 
     /* Set parent, so that initializer can refer to it */
     scope->parent = parent;
+    scope->index = NULL;
+    scope->path = NULL;
     corto_rwmutex_new(&scope->align.scopeLock);
 
     /* Add object to the scope of the parent-object */
@@ -661,6 +749,11 @@ corto_object corto_init_scope(
 
     if (result != o) {
         corto_rwmutex_free(&scope->align.scopeLock);
+        if (scope->id) {
+            /* Existing object was returned, new object is discarded */
+            corto_intern_release(scope->id);
+            scope->id = NULL;
+        }
         _o = CORTO_OFFSET(result, -sizeof(corto__object));
         scope = corto_hdr_scope(_o);
     } else {
@@ -780,6 +873,7 @@ void corto__initObservable(
     observable->onChild = NULL;
     observable->onSelfArray = NULL;
     observable->onChildArray = NULL;
+    observable->observersAbove = 0;
 }
 
 /* Deinitialize observable header of object */
@@ -796,14 +890,17 @@ void corto__deinitObservable(
     observable = corto_hdr_observable(_o);
     corto_assert(observable != NULL, "corto__deinitObservable: called on non-observable object <%p>.", o);
 
-    /* Delete observer objects in onSelf and onChild */
+    /* Delete observer objects in onSelf and onChild. Every list entry is also
+     * in the current observer array, which is not used after this. */
     if (observable->onSelf) {
         corto__observer* observer;
         while((observer = corto_ll_takeFirst(observable->onSelf))) {
-            if (!--observer->count) {
-                observer->observer->active --;
+            corto_observer o = observer->observer;
+            if (!corto_adec(&observer->count)) {
+                o->active --;
                 corto_dealloc(observer);
             }
+            corto_release(o);
         }
         corto_ll_free(observable->onSelf);
         observable->onSelf = NULL;
@@ -812,10 +909,12 @@ void corto__deinitObservable(
     if (observable->onChild) {
         corto__observer* observer;
         while((observer = corto_ll_takeFirst(observable->onChild))) {
-            if (!--observer->count) {
-                observer->observer->active --;
+            corto_observer o = observer->observer;
+            if (!corto_adec(&observer->count)) {
+                o->active --;
                 corto_dealloc(observer);
             }
+            corto_release(o);
         }
         corto_ll_free(observable->onChild);
         observable->onChild = NULL;
@@ -835,8 +934,12 @@ void corto_init_builtin(corto_object sso) {
     scope = corto_hdr_scope(o);
     corto_assert(scope != NULL, "SSO object without a scope? That's bad.");
 
-    /* Don't call initScope because id is already set. */
+    /* Don't call initScope because id is already set. Ids of builtin objects
+     * are not interned, as they are never freed. */
     corto_rwmutex_new(&scope->align.scopeLock);
+    if (scope->id) {
+        scope->hash = corto_id_hash(scope->id, strlen(scope->id));
+    }
     if (scope->parent) {
         corto_adopt(scope->parent, sso, TRUE);
     }
@@ -869,6 +972,14 @@ int16_t corto_deinit_builtin(corto_object sso) {
         scope->scope = NULL;
     }
 
+    corto_scope_index_free(scope->index);
+    scope->index = NULL;
+
+    if (scope->path) {
+        corto_dealloc(scope->path);
+        scope->path = NULL;
+    }
+
     corto_rwmutex_free(&scope->align.scopeLock);
 
     /* Deinitialize observable */
@@ -1120,6 +1231,7 @@ corto_object corto_declare_intern(
     uint32_t size, headerSize;
     corto__object* o = NULL;
     void *mem = NULL;
+    uint8_t slab = 0;
     bool initializeScoped = !(attrs & CORTO_ATTR_NAMED);
 
     corto_assert_object(type);
@@ -1184,7 +1296,7 @@ corto_object corto_declare_intern(
     size += headerSize;
 
     /* Allocate object */
-    mem = corto_calloc(size);
+    mem = corto_slab_alloc(size, &slab);
     if (mem) {
 
         /* Offset o so it points to object */
@@ -1221,6 +1333,7 @@ corto_object corto_declare_intern(
         }
 
         o->align.attrs.orphan = orphan != 0;
+        o->align.attrs.slab = slab;
 
         corto_claim(type);
 
@@ -1260,7 +1373,7 @@ error_init: {
     corto_release(type);
 }
 error:
-    if (mem) corto_dealloc(mem);
+    if (mem) corto_slab_free(mem, slab);
     return NULL;
 }
 
@@ -1408,9 +1521,8 @@ corto_object corto_declareChild_intern(
             if ((o_ret = corto_init_scope(parent, id, type, o, orphan, forceType))) {
                 if (o_ret != o) {
                     corto_release(type);
-                    corto_dealloc(
-                        corto_object_startaddr(
-                            CORTO_OFFSET(o,-sizeof(corto__object))));
+                    corto_object_dealloc(
+                        CORTO_OFFSET(o,-sizeof(corto__object)));
                     o = o_ret;
 
                     if (newobject) {
@@ -1473,6 +1585,7 @@ corto_object corto_declareChild_intern(
                     }
                 }
             } else {
+                bool indexed = corto_indexed(o);
                 corto_deinit_scope(o);
                 if (corto_countof(o) != 1) {
                     corto_throw(
@@ -1480,7 +1593,22 @@ corto_object corto_declareChild_intern(
                       corto_fullpath(NULL, parent),
                       id);
                 } else {
-                    corto_dealloc(corto_object_startaddr(CORTO_OFFSET(o,-sizeof(corto__object))));
+                    char *o_id = corto_idof(o);
+                    corto__scope *scope = corto_hdr_scope(corto_hdr(o));
+                    if (scope->path) {
+                        corto_dealloc(scope->path);
+                    }
+                    if (indexed) {
+                        if (o_id) {
+                            corto_epoch_retire(o_id, corto_epoch_release_id);
+                        }
+                        corto_epoch_retire(_o, corto_epoch_dealloc);
+                    } else {
+                        if (o_id) {
+                            corto_intern_release(o_id);
+                        }
+                        corto_object_dealloc(_o);
+                    }
                     corto_throw("init for '%s' of '%s' failed",
                         id,
                         corto_fullpath(NULL, type));
@@ -2064,6 +2192,17 @@ bool corto_destruct(
     }
 
     _o = CORTO_OFFSET(o, -sizeof(corto__object));
+
+    /* Event records have no lifecycle. Deleting a record releases it, and
+     * records are returned to their pool when the refcount drops to zero. */
+    if (_o->align.attrs.record) {
+        if (!delete) {
+            corto_event_record_free(o);
+        }
+        if (CORTO_TRACE_MEM) corto_log_pop();
+        return delete;
+    }
+
     if (!isBuiltin) corto_ainc(&_o->refcount);
 
     if (!corto_check_state(o, CORTO_DELETED)) {
@@ -2147,6 +2286,7 @@ bool corto_destruct(
      */
 
     if (!isBuiltin && !corto_adec(&_o->refcount)) {
+        bool indexed = named && corto_indexed(o);
 
         /* Deinit writable */
         if (corto_check_attr(o, CORTO_ATTR_WRITABLE)) {
@@ -2193,8 +2333,22 @@ bool corto_destruct(
                 corto_rb_free(scope->scope);
             }
 
+            /* Lookups need a claim on this object to read its index, so the
+             * index has no readers left */
+            corto_scope_index_free(scope->index);
+            scope->index = NULL;
+
+            if (scope->path) {
+                corto_dealloc(scope->path);
+                scope->path = NULL;
+            }
+
             if (scope->id) {
-                corto_dealloc(scope->id);
+                if (indexed) {
+                    corto_epoch_retire(scope->id, corto_epoch_release_id);
+                } else {
+                    corto_intern_release(scope->id);
+                }
                 scope->id = NULL;
             }
         }
@@ -2203,7 +2357,11 @@ bool corto_destruct(
         _o->magic = CORTO_MAGIC_DESTRUCT;
 #endif
         if (CORTO_TRACE_MEM) {corto_info("DEALLOC %p", o);}
-        corto_dealloc(corto_object_startaddr(_o));
+        if (indexed) {
+            corto_epoch_retire(_o, corto_epoch_dealloc);
+        } else {
+            corto_object_dealloc(_o);
+        }
 
         result = FALSE;
     }
@@ -3029,6 +3187,44 @@ char* corto_fullpath(
     return corto_fullpath_intern(buffer, o, FALSE);
 }
 
+/* Obtain cached full object path */
+const char* corto_pathof(
+    corto_object o)
+{
+    corto_assert_object(o);
+
+    if (!o || !corto_check_attr(o, CORTO_ATTR_NAMED)) {
+        return corto_fullpath(NULL, o);
+    }
+
+    corto__scope *scope = corto_hdr_scope(corto_hdr(o));
+
+    /* The id and parent of an object don't change while it is in a scope, so
+     * the path only needs to be computed once. Once the parent is reset when
+     * an object is deleted, the path changes, and is no longer cached. */
+    if (!scope->parent && o != root_o) {
+        return corto_fullpath(NULL, o);
+    }
+
+    char *path = scope->path;
+    if (!path) {
+        corto_id buffer;
+        if (!corto_fullpath_intern(buffer, o, FALSE)) {
+            return NULL;
+        }
+
+        /* Multiple threads may compute the path at the same time. Only one
+         * of them gets to store it. */
+        path = corto_strdup(buffer);
+        if (!corto_cas(&scope->path, NULL, path)) {
+            corto_dealloc(path);
+            path = scope->path;
+        }
+    }
+
+    return path;
+}
+
 /* Store all parents of object in array */
 static
 corto_object* corto_scopeStack(
@@ -3301,6 +3497,53 @@ const char* corto_create_anonymous(
     return ptr;
 }
 
+/* Claim object if its refcount is not zero. Objects with a zero refcount are
+ * being deleted and must not be returned by a lookup. */
+static
+bool corto_claim_if_alive(
+    corto_object o)
+{
+    if (corto_isbuiltin(o)) {
+        return true;
+    }
+
+    corto__object *_o = corto_hdr(o);
+    int32_t count;
+    do {
+        if ((count = _o->refcount) <= 0) {
+            return false;
+        }
+    } while (!corto_cas(&_o->refcount, count, count + 1));
+
+    return true;
+}
+
+/* Lookup object in scope index without locking the scope. Returns false if the
+ * scope has no index or the index can't resolve the id, in which case the
+ * lookup needs to use the scope tree. If an object is found, it is claimed. */
+static
+bool corto_lookup_index(
+    corto__scope *scope,
+    const char *id,
+    uint32_t length,
+    corto_object *out)
+{
+    bool result = false;
+    corto_scope_index *index = scope->index;
+
+    if (index) {
+        corto_epoch_enter();
+        if ((result = corto_scope_index_find(index, id, length, out))) {
+            if (*out && !corto_claim_if_alive(*out)) {
+                *out = NULL;
+            }
+        }
+        corto_epoch_exit();
+    }
+
+    return result;
+}
+
 /* internal function for looking up objects in store & vstore (optional) */
 static
 corto_object corto_lookup_intern(
@@ -3351,7 +3594,7 @@ corto_object corto_lookup_intern(
             break;
         }
 
-        bool containsArgs = false;
+        bool containsArgs = false, claimed = false;
         for (next = ptr; (ch = *next) && (ch != '/') && (ch != '{'); next ++) {
             if (ch == '(') {
                 containsArgs = true;
@@ -3378,6 +3621,8 @@ corto_object corto_lookup_intern(
                     }
 
                     if (o) corto_release(o);
+                } else if (corto_lookup_index(scope, ptr, next - ptr, &o)) {
+                    claimed = true;
                 } else {
                     if (corto_rwmutex_read(&scope->align.scopeLock)) {
                         corto_throw(NULL);
@@ -3428,7 +3673,7 @@ corto_object corto_lookup_intern(
 
         /* Keep object. If the refcount was zero, this object will be deleted
          * soon, so prevent the object from being referenced again. */
-        if (o && (corto_claim(o) == 1)) {
+        if (o && !claimed && (corto_claim(o) == 1)) {
              /* Set the refcount to zero again. There can be no more objects
               * that are looking up this object right now because we have the
               * scopeLock of the parent. Additionally, the object will not yet
@@ -3691,13 +3936,47 @@ corto_object corto_get_source() {
     return corto_tls_get(CORTO_KEY_OWNER);
 }
 
-/* Publish new value for object */
-int16_t corto_publish(
+/* Publish new value for object that is loaded in the store */
+static
+int16_t corto_publish_object(
+    corto_object o,
+    corto_eventMask event,
+    const char *contentType,
+    void *content)
+{
+    int16_t result = 0;
+
+    switch(event) {
+    case CORTO_DEFINE:
+    case CORTO_UPDATE:
+        if (corto_typeof(o)->kind != CORTO_VOID) {
+            if (!(result = corto_update_begin(o))) {
+                if ((result = corto_deserialize_value(o, contentType, content))) {
+                    corto_update_cancel(o);
+                } else {
+                    corto_update_end(o);
+                }
+            }
+        } else {
+            corto_update(o);
+        }
+        break;
+    case CORTO_DELETE:
+        result = corto_delete(o);
+        break;
+    }
+
+    return result;
+}
+
+static
+int16_t corto_publish_intern(
     corto_eventMask event,
     const char *id,
     const char *type,
     const char *contentType,
-    void *content)
+    void *content,
+    bool shared)
 {
     corto_assert(id != NULL, "NULL passed to 'id' parameter of corto_publish");
 
@@ -3708,29 +3987,19 @@ int16_t corto_publish(
     CORTO_UNUSED(type);
 
     if (o) {
-        switch(event) {
-        case CORTO_DEFINE:
-        case CORTO_UPDATE:
-            if (corto_typeof(o)->kind != CORTO_VOID) {
-                if (!(result = corto_update_begin(o))) {
-                    if ((result = corto_deserialize_value(o, contentType, content))) {
-                        corto_update_cancel(o);
-                    } else {
-                        corto_update_end(o);
-                    }
-                }
-            } else {
-                corto_update(o);
+        result = corto_publish_object(o, event, contentType, content);
+        corto_release(o);
+
+        /* Value has been copied into the object, release shared value */
+        if (shared && content && contentType) {
+            corto_fmt fmt = corto_fmt_lookup(contentType);
+            if (fmt) {
+                corto_fmt_release(fmt, content);
             }
-            break;
-        case CORTO_DELETE:
-            result = corto_delete(o);
-            break;
         }
-        corto_release(o);
     } else {
         if (corto_notify_subscribersById(
-          event, id, type, contentType, (corto_word)content))
+          event, id, type, contentType, (corto_word)content, shared))
         {
             result = -1;
         }
@@ -3739,6 +4008,148 @@ int16_t corto_publish(
     return result;
 }
 
+/* Publish new value for object */
+int16_t corto_publish(
+    corto_eventMask event,
+    const char *id,
+    const char *type,
+    const char *contentType,
+    void *content)
+{
+    return corto_publish_intern(event, id, type, contentType, content, false);
+}
+
+/* Publish value that is owned by the store after the call */
+int16_t corto_publish_shared(
+    corto_eventMask event,
+    const char *id,
+    const char *type,
+    const char *contentType,
+    void *content)
+{
+    return corto_publish_intern(event, id, type, contentType, content, true);
+}
+
+/* Publish batch of values. Consecutive samples for objects that are not loaded
+ * in the store are passed to subscribers as one batch. */
+int16_t corto_publish_batch(
+    const char *contentType,
+    corto_publish_sample *samples,
+    uint32_t count)
+{
+    uint32_t i, start = 0;
+    int16_t result = 0;
+
+    for (i = 0; i < count; i ++) {
+        corto_assert(samples[i].id != NULL,
+            "NULL passed to 'id' of sample in corto_publish_batch");
+
+        corto_object o = FIND(NULL, samples[i].id);
+        if (o) {
+            /* Publish preceding samples first, to preserve order */
+            if (i > start && corto_notify_subscribersBatch(
+                contentType, &samples[start], i - start))
+            {
+                result = -1;
+            }
+
+            if (corto_publish_object(
+                o, samples[i].event, contentType, samples[i].value))
+            {
+                result = -1;
+            }
+
+            corto_release(o);
+            start = i + 1;
+        }
+    }
+
+    if (i > start && corto_notify_subscribersBatch(
+        contentType, &samples[start], i - start))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+/* Fluent request */
+typedef struct corto_publishRequest {
+    const char *contentType;
+    corto_publish_sample *samples;
+    uint32_t count;
+    uint32_t size;
+} corto_publishRequest;
+
+static
+corto_publish__fluent corto_publish__fluentGet(void);
+
+static
+corto_publish__fluent corto_publishSample(
+    corto_eventMask event,
+    const char *id,
+    const char *type,
+    void *value)
+{
+    corto_publishRequest *request = corto_tls_get(CORTO_KEY_PUBLISH);
+    if (request) {
+        if (request->count == request->size) {
+            request->size = request->size ? request->size * 2 : 64;
+            request->samples = corto_realloc(
+                request->samples, request->size * sizeof(corto_publish_sample));
+        }
+        request->samples[request->count ++] = (corto_publish_sample){
+            .event = event,
+            .id = id,
+            .type = type,
+            .value = value
+        };
+    }
+    return corto_publish__fluentGet();
+}
+
+static
+int16_t corto_publishCommit(void)
+{
+    int16_t result = -1;
+
+    corto_publishRequest *request = corto_tls_get(CORTO_KEY_PUBLISH);
+    if (request) {
+        corto_tls_set(CORTO_KEY_PUBLISH, NULL);
+        result = corto_publish_batch(
+            request->contentType, request->samples, request->count);
+        corto_dealloc(request->samples);
+        corto_dealloc(request);
+    }
+
+    return result;
+}
+
+static
+corto_publish__fluent corto_publish__fluentGet(void)
+{
+    corto_publish__fluent result;
+    result.sample = corto_publishSample;
+    result.commit = corto_publishCommit;
+    return result;
+}
+
+corto_publish__fluent corto_publish_begin(
+    const char *contentType)
+{
+    corto_publishRequest *request = corto_tls_get(CORTO_KEY_PUBLISH);
+    if (!request) {
+        request = corto_calloc(sizeof(corto_publishRequest));
+        corto_tls_set(CORTO_KEY_PUBLISH, request);
+    } else {
+        /* Discard batch that was never committed */
+        request->count = 0;
+    }
+
+    request->contentType = contentType;
+    return corto_publish__fluentGet();
+}
+
 /* Send update notification for object */
 int16_t corto_update(corto_object o) {
     corto_assert_object(o);
@@ -4963,6 +5374,12 @@ int corto_compare(
     corto_compare_ser_t data;
     corto_walk_opt s;
 
+    /* Objects of the same type can be compared with the typecache */
+    corto_type type = corto_typeof(o1);
+    if (corto_compare_hasFields(type) && corto_typeof(o2) == type) {
+        return corto_compare_fields(o1, o2, type);
+    }
+
     data.value = corto_value_value(o2, corto_typeof(o2));
 
     s = corto_compare_ser(CORTO_PRIVATE, CORTO_NOT, CORTO_WALK_TRACE_NEVER);
@@ -4987,8 +5404,15 @@ int16_t _corto_copy(corto_object *dst, corto_object src) {
         newObject = TRUE;
     }
 
-    data.value = corto_value_object(*dst, NULL);
-    result = corto_walk(&s, src, &data);
+    /* Objects of the same type can be copied with the typecache. Objects of
+     * different (castable) types require a walk. */
+    corto_type type = corto_typeof(src);
+    if (type->typecache && corto_typeof(*dst) == type) {
+        result = corto_copy_fields(*dst, src, type);
+    } else {
+        data.value = corto_value_object(*dst, NULL);
+        result = corto_walk(&s, src, &data);
+    }
 
     if (newObject) {
         corto_define(*dst);
@@ -33,6 +33,9 @@
 #include "copy_ser.h"
 #include "memory_ser.h"
 #include "typecache.h"
+#include "epoch.h"
+#include "intern.h"
+#include "slab.h"
 #include "expr.h"
 #include "cdeclhandler.h"
 
@@ -61,6 +64,7 @@ extern corto_tls CORTO_KEY_ATTR;
 extern corto_tls CORTO_KEY_DECLARED_ADMIN;
 extern corto_tls CORTO_KEY_OWNER;
 extern corto_tls CORTO_KEY_CONSTRUCTOR_TYPE;
+extern corto_tls CORTO_KEY_PUBLISH;
 
 
 /* -- OBJECT HEADER TYPES -- */
@@ -79,6 +83,10 @@ typedef struct corto__attr {
 
     /* state */
     unsigned state: 2;       /* object state (VALID | DESTRUCTED) */
+
+    /* allocation */
+    unsigned slab: 6;        /* slab size class, 0 if allocated with malloc */
+    unsigned record: 1;      /* is this a pooled event record */
 }corto__attr;
 
 /* base object header - every object has these fields */
@@ -104,11 +112,20 @@ typedef struct corto__object {
     corto_type type;
 } corto__object;
 
+/* Hash index of the objects in a scope, see scope_index.c */
+typedef struct corto_scope_index corto_scope_index;
+
+/* Number of objects in a scope after which the scope index is created */
+#define CORTO_SCOPE_INDEX_THRESHOLD (32)
+
 /* scope object header - only scoped objects have these fields */
 typedef struct corto__scope {
     corto_object parent;
-    char *id;
+    char *id; /* Interned for non-builtin objects, see intern.c */
+    uint32_t hash; /* Hash of id, computed by corto_id_hash */
     corto_rb scope;
+    corto_scope_index *index; /* Lock-free lookups for large scopes */
+    char * volatile path; /* Cached full path, see corto_pathof */
 
     /* See corto__object for why this union exists*/
     union {
@@ -127,11 +144,14 @@ typedef struct corto__writable {
 } corto__writable;
 
 /* observable object header - only observable objects have these fields */
+typedef struct corto_observerAligner corto_observerAligner;
+
 typedef struct corto__observer {
     corto_object _this;
     corto_observer observer;
     char notifyKind;
     int32_t count;
+    corto_observerAligner * volatile aligner; /* Set while aligning, see observer.c */
 } corto__observer;
 
 typedef struct corto__observable corto__observable;
@@ -146,12 +166,15 @@ struct corto__observable {
         int64_t dummy;
     } align;
 
-    /* Lockless access to observers (zero-terminated)
-     *  Element -1 contains a counter which indicates by how many
-     *  notify-functions it is being used. When this counter reaches zero, the array
-     *  can be deleted. */
+    /* Lockless access to observers (zero-terminated). Replaced arrays are
+     * retired through the epoch, see observer.c */
     corto__observer **onSelfArray;
     corto__observer **onChildArray;
+
+    /* Cached summary of whether this object or one of its parents has
+     * observers. Valid while it matches the observer generation, see
+     * corto_observersAbove */
+    volatile uint32_t observersAbove;
 };
 
 /* persistent object header - only persistent objects have these fields */
@@ -215,6 +238,19 @@ void corto_free(
     void *base_ptr,
     corto_type type);
 
+int16_t corto_copy_fields(
+    void *dst_base,
+    void *src_base,
+    corto_type type);
+
+bool corto_compare_hasFields(
+    corto_type type);
+
+corto_equalityKind corto_compare_fields(
+    const void *base1,
+    const void *base2,
+    corto_type type);
+
 int16_t corto_resume(
     corto_object parent,
     const char *expr,
@@ -242,6 +278,37 @@ corto_objectseq corto_scope_claimWithFilter(
     corto_type type,
     char *id);
 
+/* Scope index. Functions that modify the index must be called while holding
+ * the write lock of the scope. corto_scope_index_find must be called in an
+ * epoch critical section, and returns false if the index cannot resolve id. */
+corto_scope_index* corto_scope_index_new(void);
+
+void corto_scope_index_free(
+    corto_scope_index *index);
+
+void corto_scope_index_add(
+    corto_scope_index *index,
+    corto_object o,
+    const char *id,
+    uint32_t hash);
+
+void corto_scope_index_remove(
+    corto_scope_index *index,
+    corto_object o,
+    uint32_t hash);
+
+void corto_scope_index_replace(
+    corto_scope_index *index,
+    corto_object existing,
+    corto_object o,
+    uint32_t hash);
+
+bool corto_scope_index_find(
+    corto_scope_index *index,
+    const char *id,
+    uint32_t length,
+    corto_object *out);
+
 
 /* -- NOTIFICATIONS -- */
 
@@ -265,7 +332,31 @@ int16_t corto_notify_subscribersById(
     const char *path,
     const char *type,
     const char *fmtId,
-    corto_word value);
+    corto_word value,
+    bool shared);
+
+int16_t corto_notify_subscribersBatch(
+    const char *fmtId,
+    corto_publish_sample *samples,
+    uint32_t count);
+
+/* Event records that are posted to dispatchers, see vstore/event_record.c */
+corto_subscriber_event* corto_subscriber_event_new(
+    corto_subscriber subscriber,
+    corto_object instance,
+    corto_eventMask mask,
+    corto_result *r,
+    corto_fmt_data *fmt);
+
+corto_observer_event* corto_observer_event_new(
+    corto_observer observer,
+    corto_object instance,
+    corto_object observable,
+    corto_object source,
+    corto_eventMask mask);
+
+void corto_event_record_free(
+    corto_object e);
 
 
 /* -- CORE INITIALIZATION -- */
@@ -103,12 +103,28 @@ corto_int16 _corto_ptr_copy(
 {
     corto_assert_object(type);
 
+    /* Values of reference types are copied as reference, which the typecache
+     * doesn't describe. Other values can use the faster typecache. */
+    if (type->typecache && !type->reference) {
+        return corto_copy_fields(dst, src, type);
+    }
+
+    return corto_ptr_copy_ser(dst, type, src);
+}
+
+corto_int16 _corto_ptr_copy_ser(
+    void *dst,
+    corto_type type,
+    void *src)
+{
+    corto_assert_object(type);
+
     corto_walk_opt s = corto_copy_ser(CORTO_PRIVATE, CORTO_NOT, CORTO_WALK_TRACE_ON_FAIL);
     corto_copy_ser_t data;
 
     data.value = corto_value_mem(dst, type);
 
-    return corto_walk_ptr(&s, src, type, &data);;
+    return corto_walk_ptr(&s, src, type, &data);
 }
 
 corto_equalityKind _corto_ptr_compare(
@@ -117,6 +133,22 @@ corto_equalityKind _corto_ptr_compare(
     const void *p2)
 {
     corto_assert_object(type);
+
+    /* Values of reference types are compared as reference, which the
+     * typecache doesn't describe. Other values can use the faster typecache. */
+    if (corto_compare_hasFields(type) && !type->reference) {
+        return corto_compare_fields(p1, p2, type);
+    }
+
+    return corto_ptr_compare_ser(p1, type, p2);
+}
+
+corto_equalityKind _corto_ptr_compare_ser(
+    const void *p1,
+    corto_type type,
+    const void *p2)
+{
+    corto_assert_object(type);
     corto_compare_ser_t data;
     corto_walk_opt s;
 
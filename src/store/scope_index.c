@@ -0,0 +1,257 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* The scope index is a hashtable that maps identifiers of the objects in a
+ * scope to the objects. It is kept alongside the scope rbtree, which is still
+ * used for ordered iteration.
+ *
+ * Writers modify the index while holding the write lock of the scope. Readers
+ * don't take the scope lock, and instead access the index in an epoch critical
+ * section. Nodes and bucket arrays that are removed by writers are retired, so
+ * they are not freed while readers may still be accessing them.
+ *
+ * Identifiers are hashed and compared case insensitive, like the rbtree. The
+ * hash of an object id is computed when the id is interned, and is passed in
+ * from the scope header of the object. Objects are removed by pointer, so
+ * removing doesn't need to compare strings. */
+
+#include "object.h"
+
+/* Initial number of buckets. Must be a power of two. */
+#define CORTO_SCOPE_INDEX_MIN_BUCKETS (64)
+
+/* Fold characters to lowercase in the same way as corto_id_hash */
+#define CORTO_SCOPE_INDEX_FOLD(ch)\
+    (((ch) >= 'A' && (ch) <= 'Z') ? (ch) + ('a' - 'A') : (ch))
+
+typedef struct corto_scope_index_node {
+    struct corto_scope_index_node * volatile next;
+    const char *id; /* Points to id of object, which owns the memory */
+    corto_object volatile object;
+    uint32_t hash;
+} corto_scope_index_node;
+
+typedef struct corto_scope_index_table {
+    uint32_t mask;
+    corto_scope_index_node * volatile buckets[];
+} corto_scope_index_table;
+
+struct corto_scope_index {
+    corto_scope_index_table * volatile table;
+    uint32_t count;
+
+    /* Number of objects with an id that contains arguments. Lookups without
+     * arguments can match these objects (e.g. "foo" matches "foo(int32)")
+     * which cannot be done with a hash, so the index is not used for lookups
+     * while this is non-zero. */
+    volatile uint32_t args_count;
+};
+
+static
+bool corto_scope_index_equals(
+    const char *id,
+    const char *key,
+    uint32_t length)
+{
+    uint32_t i;
+    for (i = 0; i < length; i ++) {
+        char ch1 = id[i], ch2 = key[i];
+        if (!ch1) {
+            return false;
+        }
+        if (ch1 != ch2 &&
+            CORTO_SCOPE_INDEX_FOLD(ch1) != CORTO_SCOPE_INDEX_FOLD(ch2))
+        {
+            return false;
+        }
+    }
+    return !id[length];
+}
+
+static
+corto_scope_index_table* corto_scope_index_table_new(
+    uint32_t bucket_count)
+{
+    corto_scope_index_table *table = corto_calloc(sizeof(corto_scope_index_table) +
+        bucket_count * sizeof(corto_scope_index_node*));
+    table->mask = bucket_count - 1;
+    return table;
+}
+
+/* Free table with all of its nodes */
+static
+void corto_scope_index_table_free(
+    void *ptr)
+{
+    corto_scope_index_table *table = ptr;
+    uint32_t i;
+    for (i = 0; i <= table->mask; i ++) {
+        corto_scope_index_node *node = table->buckets[i];
+        while (node) {
+            corto_scope_index_node *next = node->next;
+            corto_dealloc(node);
+            node = next;
+        }
+    }
+    corto_dealloc(table);
+}
+
+static
+void corto_scope_index_node_free(
+    void *ptr)
+{
+    corto_dealloc(ptr);
+}
+
+/* Resize by creating a new table with copies of the nodes, so that readers that
+ * are still iterating the old table are not affected. */
+static
+void corto_scope_index_grow(
+    corto_scope_index *index)
+{
+    corto_scope_index_table *old = index->table;
+    corto_scope_index_table *table =
+        corto_scope_index_table_new((old->mask + 1) * 2);
+    uint32_t i;
+
+    for (i = 0; i <= old->mask; i ++) {
+        corto_scope_index_node *node;
+        for (node = old->buckets[i]; node; node = node->next) {
+            corto_scope_index_node *copy =
+                corto_alloc(sizeof(corto_scope_index_node));
+            *copy = *node;
+            copy->next = table->buckets[copy->hash & table->mask];
+            table->buckets[copy->hash & table->mask] = copy;
+        }
+    }
+
+    corto_epoch_publish(&index->table, table);
+    corto_epoch_retire(old, corto_scope_index_table_free);
+}
+
+corto_scope_index* corto_scope_index_new(void)
+{
+    corto_scope_index *index = corto_calloc(sizeof(corto_scope_index));
+    index->table = corto_scope_index_table_new(CORTO_SCOPE_INDEX_MIN_BUCKETS);
+    return index;
+}
+
+void corto_scope_index_free(
+    corto_scope_index *index)
+{
+    if (index) {
+        corto_scope_index_table_free(index->table);
+        corto_dealloc(index);
+    }
+}
+
+void corto_scope_index_add(
+    corto_scope_index *index,
+    corto_object o,
+    const char *id,
+    uint32_t hash)
+{
+    if (index->count >= index->table->mask + 1) {
+        corto_scope_index_grow(index);
+    }
+
+    if (strchr(id, '(')) {
+        index->args_count ++;
+    }
+
+    corto_scope_index_table *table = index->table;
+    corto_scope_index_node *node = corto_alloc(sizeof(corto_scope_index_node));
+    node->id = id;
+    node->object = o;
+    node->hash = hash;
+    node->next = table->buckets[node->hash & table->mask];
+    corto_epoch_publish(&table->buckets[node->hash & table->mask], node);
+
+    index->count ++;
+}
+
+void corto_scope_index_remove(
+    corto_scope_index *index,
+    corto_object o,
+    uint32_t hash)
+{
+    corto_scope_index_table *table = index->table;
+    corto_scope_index_node * volatile *ptr = &table->buckets[hash & table->mask];
+    corto_scope_index_node *node;
+
+    for (; (node = *ptr); ptr = &node->next) {
+        if (node->object == o) {
+            /* Readers that are on the node can still continue to the next */
+            corto_epoch_publish(ptr, node->next);
+            corto_epoch_retire(node, corto_scope_index_node_free);
+            if (strchr(node->id, '(')) {
+                index->args_count --;
+            }
+            index->count --;
+            break;
+        }
+    }
+}
+
+void corto_scope_index_replace(
+    corto_scope_index *index,
+    corto_object existing,
+    corto_object o,
+    uint32_t hash)
+{
+    corto_scope_index_table *table = index->table;
+    corto_scope_index_node *node;
+
+    for (node = table->buckets[hash & table->mask]; node; node = node->next) {
+        if (node->object == existing) {
+            corto_epoch_publish(&node->object, o);
+            break;
+        }
+    }
+}
+
+bool corto_scope_index_find(
+    corto_scope_index *index,
+    const char *id,
+    uint32_t length,
+    corto_object *out)
+{
+    if (index->args_count) {
+        return false;
+    }
+
+    corto_scope_index_table *table = index->table;
+    uint32_t hash = corto_id_hash(id, length);
+    corto_scope_index_node *node;
+
+    *out = NULL;
+
+    for (node = table->buckets[hash & table->mask]; node; node = node->next) {
+        if (node->hash == hash &&
+            corto_scope_index_equals(node->id, id, length))
+        {
+            *out = node->object;
+            break;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,310 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "object.h"
+
+/* Maximum number of free blocks per size class in a thread cache */
+#define CORTO_SLAB_CACHE_MAX (64)
+
+/* Number of blocks moved between a thread cache and the global pool */
+#define CORTO_SLAB_BATCH (32)
+
+/* Number of blocks allocated at once when the global pool is empty */
+#define CORTO_SLAB_CHUNK (64)
+
+#define corto_slab_size(class) ((class) * CORTO_SLAB_GRANULARITY)
+
+typedef struct corto_slab_block {
+    struct corto_slab_block *next;
+} corto_slab_block;
+
+/* Blocks are carved from chunks, which are only freed by corto_slab_deinit */
+typedef struct corto_slab_chunk {
+    /* Ensure blocks start at an address with max alignment */
+    union {
+        struct corto_slab_chunk *next;
+        uint64_t dummy[2];
+    } hdr;
+    char blocks[];
+} corto_slab_chunk;
+
+typedef struct corto_slab_pool {
+    corto_mutex_s lock;
+    corto_slab_block *free;
+    corto_slab_chunk *chunks;
+} corto_slab_pool;
+
+/* Per-thread cache. Like epoch records, caches are never freed while corto is
+ * running, so that statistics can be collected from threads that have exited.
+ * Caches of exited threads are reused by new threads. */
+typedef struct corto_slab_cache {
+    struct corto_slab_cache *next;
+    corto_slab_block *free[CORTO_SLAB_CLASSES];
+    uint32_t count[CORTO_SLAB_CLASSES];
+    corto_slab_stats_t stats; /* Only written by owner */
+    bool in_use;
+} corto_slab_cache;
+
+#ifdef CORTO_SLAB_DISABLE
+static bool corto_slab_enabled = false;
+#else
+static bool corto_slab_enabled = true;
+#endif
+
+static corto_tls CORTO_KEY_SLAB;
+static corto_mutex_s corto_slab_lock;
+static corto_slab_cache *corto_slab_caches = NULL;
+static corto_slab_pool corto_slab_pools[CORTO_SLAB_CLASSES];
+
+/* Move count blocks from the front of list to pool */
+static
+corto_slab_block* corto_slab_flush(
+    corto_slab_block *list,
+    uint32_t count,
+    uint8_t class)
+{
+    corto_slab_pool *pool = &corto_slab_pools[class - 1];
+    corto_slab_block *first = list, *last = list;
+    uint32_t i;
+
+    for (i = 1; i < count; i ++) {
+        last = last->next;
+    }
+    list = last->next;
+
+    corto_mutex_lock(&pool->lock);
+    last->next = pool->free;
+    pool->free = first;
+    corto_mutex_unlock(&pool->lock);
+
+    return list;
+}
+
+static
+void corto_slab_cache_free(
+    void *data)
+{
+    corto_slab_cache *cache = data;
+    uint32_t i;
+
+    for (i = 0; i < CORTO_SLAB_CLASSES; i ++) {
+        if (cache->count[i]) {
+            corto_slab_flush(cache->free[i], cache->count[i], i + 1);
+            cache->free[i] = NULL;
+            cache->count[i] = 0;
+        }
+    }
+
+    corto_mutex_lock(&corto_slab_lock);
+    cache->in_use = false;
+    corto_mutex_unlock(&corto_slab_lock);
+}
+
+static
+corto_slab_cache* corto_slab_cache_get(void)
+{
+    corto_slab_cache *cache = corto_tls_get(CORTO_KEY_SLAB);
+    if (!cache) {
+        corto_mutex_lock(&corto_slab_lock);
+        for (cache = corto_slab_caches; cache; cache = cache->next) {
+            if (!cache->in_use) {
+                break;
+            }
+        }
+        if (!cache) {
+            cache = corto_calloc(sizeof(corto_slab_cache));
+            cache->next = corto_slab_caches;
+            corto_slab_caches = cache;
+        }
+        cache->in_use = true;
+        corto_mutex_unlock(&corto_slab_lock);
+        corto_tls_set(CORTO_KEY_SLAB, cache);
+    }
+    return cache;
+}
+
+/* Move a batch of blocks from the global pool to the thread cache. If the pool
+ * is empty, a new chunk is allocated. */
+static
+void corto_slab_refill(
+    corto_slab_cache *cache,
+    uint8_t class)
+{
+    corto_slab_pool *pool = &corto_slab_pools[class - 1];
+    uint32_t i;
+
+    corto_mutex_lock(&pool->lock);
+    if (!pool->free) {
+        size_t size = corto_slab_size(class);
+        corto_slab_chunk *chunk = corto_alloc(
+            sizeof(corto_slab_chunk) + size * CORTO_SLAB_CHUNK);
+        chunk->hdr.next = pool->chunks;
+        pool->chunks = chunk;
+
+        for (i = 0; i < CORTO_SLAB_CHUNK; i ++) {
+            corto_slab_block *block = (void*)&chunk->blocks[i * size];
+            block->next = pool->free;
+            pool->free = block;
+        }
+    }
+
+    for (i = 0; i < CORTO_SLAB_BATCH && pool->free; i ++) {
+        corto_slab_block *block = pool->free;
+        pool->free = block->next;
+        block->next = cache->free[class - 1];
+        cache->free[class - 1] = block;
+        cache->count[class - 1] ++;
+    }
+    corto_mutex_unlock(&pool->lock);
+}
+
+void corto_slab_init(void)
+{
+    uint32_t i;
+    corto_tls_new(&CORTO_KEY_SLAB, corto_slab_cache_free);
+    corto_mutex_new(&corto_slab_lock);
+    for (i = 0; i < CORTO_SLAB_CLASSES; i ++) {
+        corto_mutex_new(&corto_slab_pools[i].lock);
+        corto_slab_pools[i].free = NULL;
+        corto_slab_pools[i].chunks = NULL;
+    }
+}
+
+void corto_slab_deinit(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < CORTO_SLAB_CLASSES; i ++) {
+        corto_slab_pool *pool = &corto_slab_pools[i];
+        corto_slab_chunk *chunk = pool->chunks;
+        while (chunk) {
+            corto_slab_chunk *next = chunk->hdr.next;
+            corto_dealloc(chunk);
+            chunk = next;
+        }
+        pool->chunks = NULL;
+        pool->free = NULL;
+        corto_mutex_free(&pool->lock);
+    }
+
+    /* Caches of threads that are still running are not freed, as their TLS
+     * destructor still needs to access them. Their blocks have been freed with
+     * the chunks, so they are emptied. */
+    corto_slab_cache *self = corto_tls_get(CORTO_KEY_SLAB);
+    corto_slab_cache *cache = corto_slab_caches;
+    while (cache) {
+        corto_slab_cache *next = cache->next;
+        if (!cache->in_use || cache == self) {
+            corto_dealloc(cache);
+        } else {
+            memset(cache->free, 0, sizeof(cache->free));
+            memset(cache->count, 0, sizeof(cache->count));
+        }
+        cache = next;
+    }
+    corto_slab_caches = NULL;
+
+    corto_tls_set(CORTO_KEY_SLAB, NULL);
+    corto_mutex_free(&corto_slab_lock);
+}
+
+void* corto_slab_alloc(
+    size_t size,
+    uint8_t *class_out)
+{
+    corto_slab_cache *cache = corto_slab_cache_get();
+    uint32_t class = (size + CORTO_SLAB_GRANULARITY - 1) / CORTO_SLAB_GRANULARITY;
+
+    if (!corto_slab_enabled || !class || class > CORTO_SLAB_CLASSES) {
+        cache->stats.fallback ++;
+        *class_out = 0;
+        return corto_calloc(size);
+    }
+
+    corto_slab_block *block = cache->free[class - 1];
+    if (block) {
+        cache->stats.hit ++;
+    } else {
+        corto_slab_refill(cache, class);
+        block = cache->free[class - 1];
+        cache->stats.refill ++;
+    }
+
+    cache->free[class - 1] = block->next;
+    cache->count[class - 1] --;
+    cache->stats.alloc ++;
+
+    memset(block, 0, corto_slab_size(class));
+    *class_out = class;
+
+    return block;
+}
+
+void corto_slab_free(
+    void *ptr,
+    uint8_t class)
+{
+    if (!class) {
+        corto_dealloc(ptr);
+        return;
+    }
+
+    corto_slab_cache *cache = corto_slab_cache_get();
+    corto_slab_block *block = ptr;
+
+    block->next = cache->free[class - 1];
+    cache->free[class - 1] = block;
+    cache->stats.free ++;
+
+    if (++ cache->count[class - 1] > CORTO_SLAB_CACHE_MAX) {
+        cache->free[class - 1] =
+            corto_slab_flush(block, CORTO_SLAB_BATCH, class);
+        cache->count[class - 1] -= CORTO_SLAB_BATCH;
+    }
+}
+
+bool corto_enable_slab(
+    bool enable)
+{
+    bool prev = corto_slab_enabled;
+    corto_slab_enabled = enable;
+    return prev;
+}
+
+void corto_slab_stats(
+    corto_slab_stats_t *stats_out)
+{
+    corto_slab_cache *cache;
+
+    memset(stats_out, 0, sizeof(corto_slab_stats_t));
+
+    /* Counters of running threads may be updated while reading them, so the
+     * result is approximate. */
+    corto_mutex_lock(&corto_slab_lock);
+    for (cache = corto_slab_caches; cache; cache = cache->next) {
+        stats_out->alloc += cache->stats.alloc;
+        stats_out->hit += cache->stats.hit;
+        stats_out->refill += cache->stats.refill;
+        stats_out->fallback += cache->stats.fallback;
+        stats_out->free += cache->stats.free;
+    }
+    corto_mutex_unlock(&corto_slab_lock);
+}
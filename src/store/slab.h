@@ -0,0 +1,43 @@
+#ifndef CORTO_SLAB_H
+#define CORTO_SLAB_H
+
+/* The slab allocator keeps pools of object memory per size class, so that
+ * applications that create and delete many objects of the same types don't
+ * need a malloc and free for every object.
+ *
+ * Each thread has a cache of free blocks per size class, which is refilled
+ * from and flushed to a global pool in batches. Allocations that are larger
+ * than the largest size class, or that are done while pools are disabled, fall
+ * back to malloc. The size class is returned on allocation and must be passed
+ * when freeing, where 0 means the memory was allocated with malloc.
+ *
+ * Pools are enabled by default. Define CORTO_SLAB_DISABLE to disable them by
+ * default, or set $CORTO_SLAB to "false" to disable them at runtime (useful
+ * when debugging memory with valgrind or address sanitizer).
+ */
+
+/* Difference in size between subsequent size classes. Multiple of the maximum
+ * alignment, so that every block is aligned. */
+#define CORTO_SLAB_GRANULARITY (32)
+
+/* Number of size classes. Allocations up to 1KB are pooled. */
+#define CORTO_SLAB_CLASSES (32)
+
+/* Initialize pools. Called once by corto_start. */
+void corto_slab_init(void);
+
+/* Free pools and all memory in them. Called by corto_stop, after which memory
+ * allocated from pools can no longer be accessed. */
+void corto_slab_deinit(void);
+
+/* Allocate zero-initialized memory. The size class is stored in class_out. */
+void* corto_slab_alloc(
+    size_t size,
+    uint8_t *class_out);
+
+/* Return memory to the pool of its size class, or free it if class is 0. */
+void corto_slab_free(
+    void *ptr,
+    uint8_t class);
+
+#endif
@@ -14,6 +14,7 @@ struct corto_typecache_block {
 
 typedef struct corto_typecache_blocks {
     uint32_t field_count;
+    uint8_t inherit_flags; /* Meta flags inherited by nested fields */
     corto_typecache_block *first;
     corto_typecache_block *current;
 } corto_typecache_blocks;
@@ -94,6 +95,9 @@ char *corto_typecache_meta_str(
     if (meta_kind & CORTO_TC_META_HAS_DEINIT) {
         corto_buffer_appendstr(&buffer, " HAS_DEINIT");
     }
+    if (meta_kind & CORTO_TC_META_PRIVATE) {
+        corto_buffer_appendstr(&buffer, " PRIVATE");
+    }
 
     return corto_buffer_str(&buffer);
 }
@@ -153,8 +157,9 @@ corto_typecache_field* corto_typecache_add(
     }
 
     f->kind = 0;
-    f->meta_flags = 0;
+    f->meta_flags = blocks->inherit_flags;
     f->offset = 0;
+    f->size = 0;
     f->name = NULL;
 
     blocks->field_count ++;
@@ -323,8 +328,14 @@ int16_t corto_typecache_type(
         } else {
             /* Keep track of how many fields are skipped by struct */
             int current_field_count = blocks->field_count;
+            uint8_t inherit_flags = blocks->inherit_flags;
             field->kind = CORTO_TC_STRUCT;
+
+            /* Fields nested in a private member are private as well */
+            blocks->inherit_flags |= field->meta_flags & CORTO_TC_META_PRIVATE;
             corto_walk_value(opt, info, blocks);
+            blocks->inherit_flags = inherit_flags;
+
             field->data.skip = blocks->field_count - current_field_count;
         }
     } else if (type->kind == CORTO_PRIMITIVE) {
@@ -356,6 +367,7 @@ int16_t corto_typecache_member(
 
     corto_typecache_field *field = corto_typecache_add(blocks);
     field->offset = corto_typecache_offset(info);
+    field->size = corto_type_sizeof(type);
     field->name = corto_idof(m);
 
     if (!type->reference) {
@@ -366,6 +378,10 @@ int16_t corto_typecache_member(
         field->meta_flags |= CORTO_TC_META_MUST_SERIALIZE;
     }
 
+    if (m->modifiers & CORTO_PRIVATE) {
+        field->meta_flags |= CORTO_TC_META_PRIVATE;
+    }
+
     if (m->modifiers & CORTO_OPTIONAL) {
         field->kind = CORTO_TC_OPTIONAL;
         field->kind += corto_typecache_get_subkind(type, false);
@@ -398,6 +414,7 @@ int16_t corto_typecache_object(
         corto_typecache_field *field = corto_typecache_add(blocks);
         corto_typecache_set_meta_flags(field, type);
         field->offset = 0;
+        field->size = corto_type_sizeof(type);
         field->meta_flags |= CORTO_TC_META_MUST_SERIALIZE;
         corto_typecache_type(opt, info, field, blocks);
     }
@@ -405,11 +422,32 @@ int16_t corto_typecache_object(
     return 0;
 }
 
+static
+int16_t corto_typecache_base(
+    corto_walk_opt *opt,
+    corto_value *info,
+    void *userData)
+{
+    corto_typecache_blocks *blocks = userData;
+    corto_struct type = corto_struct(corto_value_typeof(info->parent));
+    uint8_t inherit_flags = blocks->inherit_flags;
+
+    /* Members inherited through a private base are private as well */
+    if (type->baseAccess & CORTO_PRIVATE) {
+        blocks->inherit_flags |= CORTO_TC_META_PRIVATE;
+    }
+
+    int16_t result = corto_walk_value(opt, info, userData);
+    blocks->inherit_flags = inherit_flags;
+
+    return result;
+}
+
 corto_typecache* corto_typecache_create(
     corto_type type)
 {
     corto_typecache_block block = {0, NULL};
-    corto_typecache_blocks blocks = {0, &block, &block};
+    corto_typecache_blocks blocks = {0, 0, &block, &block};
     corto_walk_opt opt;
 
     corto_walk_init(&opt);
@@ -419,6 +457,7 @@ corto_typecache* corto_typecache_create(
     opt.aliasAction = CORTO_WALK_ALIAS_IGNORE;
     opt.metaprogram[CORTO_OBJECT] = corto_typecache_object;
     opt.metaprogram[CORTO_MEMBER] = corto_typecache_member;
+    opt.metaprogram[CORTO_BASE] = corto_typecache_base;
     opt.observable = corto_typecache_member; /* Passthrough observable */
     _corto_metawalk(&opt, type, &blocks);
 
@@ -444,6 +483,21 @@ corto_typecache* corto_typecache_create(
         } while ((block_ptr = next));
 
         result->field_count = blocks.field_count;
+        result->flags = CORTO_TC_COMPARE_BY_FIELDS;
+
+        uint32_t i;
+        for (i = 0; i < result->field_count; i ++) {
+            corto_typecache_field *field = &result->fields[i];
+            if (field->meta_flags & CORTO_TC_META_PRIVATE) {
+                continue;
+            }
+            if (field->kind == CORTO_TC_INLINE_REFERENCE ||
+                field->kind - field->kind % 10 == CORTO_TC_OPTIONAL)
+            {
+                result->flags &= ~CORTO_TC_COMPARE_BY_FIELDS;
+                break;
+            }
+        }
     }
 
     return result;
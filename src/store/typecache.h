@@ -81,13 +81,15 @@ typedef enum corto_typecache_meta_kind {
     /* There is no NEEDS_DEINIT because fields that require initialization are
      * regular resources that are already identified in kind & sub_kind */
     CORTO_TC_META_HAS_INIT = 4, /* Field has initializer hook */
-    CORTO_TC_META_HAS_DEINIT = 8 /* Field has deinitializer hook */
+    CORTO_TC_META_HAS_DEINIT = 8, /* Field has deinitializer hook */
+    CORTO_TC_META_PRIVATE = 16 /* Field is (nested in) a private member/base */
 } corto_typecache_meta_kind;
 
 typedef struct corto_typecache_field {
     uint8_t kind; /* corto_typecache_kind + corto_typecache_sub_kind */
     uint8_t meta_flags; /* corto_typecache_meta_kind */
     uint32_t offset;
+    uint32_t size; /* Size of the value stored at offset */
     const char *name;
     union {
         corto_type sub_type; /* For optional fields, sequences and lists */
@@ -97,8 +99,17 @@ typedef struct corto_typecache_field {
     } data;
 } corto_typecache_field;
 
+/* Properties of a type that are derived from its fields when the typecache is
+ * created, so they don't have to be computed for every value */
+typedef enum corto_typecache_flags {
+    /* Type has no optional or inline reference (observable) fields, which are
+     * stored on the heap, so values can be compared field by field */
+    CORTO_TC_COMPARE_BY_FIELDS = 1
+} corto_typecache_flags;
+
 typedef struct corto_typecache {
     uint32_t field_count;
+    uint32_t flags; /* corto_typecache_flags */
 
     /* Use a dynamic array that is allocated in the same block as the
      * typecache, so it can be simply cleaned up with a free() */
@@ -842,6 +842,16 @@ int16_t corto_value_compare(
 {
     corto_compare_ser_t data;
     corto_walk_opt s;
+    corto_type type = corto_value_typeof(src);
+
+    /* Use typecache when types are equal, and the value is not a reference
+     * (which is compared by pointer) */
+    if (corto_compare_hasFields(type) && corto_value_typeof(dst) == type &&
+        (!type->reference || src->kind == CORTO_OBJECT))
+    {
+        return corto_compare_fields(
+            corto_value_ptrof(src), corto_value_ptrof(dst), type);
+    }
 
     data.value = *dst;
     s = corto_compare_ser(CORTO_PRIVATE, CORTO_NOT, CORTO_WALK_TRACE_NEVER);
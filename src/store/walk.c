@@ -307,6 +307,29 @@ error:
     return -1;
 }
 
+/* A member list only applies to the composite that owns the members, so that
+ * nested composites are serialized completely */
+static
+bool corto_walk_hasMembers(
+    corto_walk_opt* this,
+    corto_interface t)
+{
+    corto_interface owner;
+
+    if (!this->members.length) {
+        return false;
+    }
+
+    owner = corto_parentof(this->members.buffer[0]);
+    do {
+        if (t == owner) {
+            return true;
+        }
+    } while ((t = t->base));
+
+    return false;
+}
+
 /* Serialize members */
 int16_t corto_walk_members(
     corto_walk_opt* this,
@@ -319,13 +342,15 @@ int16_t corto_walk_members(
     corto_member m;
     corto_walk_cb cb;
     corto_object o;
+    bool hasMembers;
 
     t = (corto_interface)corto_value_typeof(info);
     v = corto_value_ptrof(info);
     o = corto_value_objectof(info);
+    hasMembers = corto_walk_hasMembers(this, t);
 
     /* Process inheritance */
-    if (!this->members.length) {
+    if (!hasMembers) {
         if (corto_class_instanceof(corto_struct_o, t) &&
             corto_serializeMatchAccess(
                 this->accessKind, this->access, ((corto_struct)t)->baseAccess))
@@ -354,7 +379,7 @@ int16_t corto_walk_members(
     }
 
     /* Process members */
-    if (this->members.length) {
+    if (hasMembers) {
         for (i = 0; i < this->members.length; i++) {
             m = this->members.buffer[i];
             if (corto_walk_member(this, m, o, v, cb, info, userData)) {
@@ -0,0 +1,261 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <corto/corto.h>
+#include "src/vstore/event_queue.h"
+
+/* Initial number of events in a queue. Must be a power of two. */
+#define CORTO_EVENT_QUEUE_SIZE (64)
+
+typedef struct corto_event_queue_entry {
+    corto_subscriber_event *event;
+    uint32_t hash;
+} corto_event_queue_entry;
+
+struct corto_event_queue {
+    corto_event_queue_entry *entries; /* Events in order of insertion */
+    uint32_t count;
+    uint32_t size;
+
+    /* Positions in entries plus one, 0 is an empty slot. The index has twice
+     * as many slots as entries, so the load factor is at most 0.5. */
+    uint32_t *index;
+
+    uint32_t cursor;
+    bool appended; /* Entries were appended, and are not indexed */
+};
+
+static
+uint32_t corto_event_queue_hash(
+    corto_subscriber_event *e)
+{
+    uint32_t h = 2166136261u;
+    const char *ptr;
+
+    if ((ptr = e->data.parent)) {
+        while (*ptr) {
+            h = (h ^ (uint8_t)*ptr) * 16777619;
+            ptr ++;
+        }
+    }
+
+    h = (h ^ '/') * 16777619;
+
+    if ((ptr = e->data.id)) {
+        while (*ptr) {
+            h = (h ^ (uint8_t)*ptr) * 16777619;
+            ptr ++;
+        }
+    }
+
+    h ^= (uintptr_t)e->subscriber >> 4;
+    h *= 16777619;
+
+    return h;
+}
+
+static
+bool corto_event_queue_str_equal(
+    const char *s1,
+    const char *s2)
+{
+    /* Strings in event records are interned, so usually pointers are equal */
+    if (s1 == s2) {
+        return true;
+    }
+    if (!s1 || !s2) {
+        return false;
+    }
+    return !strcmp(s1, s2);
+}
+
+static
+bool corto_event_queue_equal(
+    corto_subscriber_event *e1,
+    corto_subscriber_event *e2)
+{
+    return e1->subscriber == e2->subscriber &&
+        corto_event_queue_str_equal(e1->data.id, e2->data.id) &&
+        corto_event_queue_str_equal(e1->data.parent, e2->data.parent);
+}
+
+static
+void corto_event_queue_index(
+    corto_event_queue *q,
+    uint32_t pos)
+{
+    uint32_t mask = q->size * 2 - 1;
+    uint32_t slot = q->entries[pos].hash & mask;
+
+    while (q->index[slot]) {
+        slot = (slot + 1) & mask;
+    }
+
+    q->index[slot] = pos + 1;
+}
+
+static
+void corto_event_queue_grow(
+    corto_event_queue *q)
+{
+    uint32_t i;
+
+    q->size *= 2;
+    q->entries = corto_realloc(
+        q->entries, q->size * sizeof(corto_event_queue_entry));
+
+    corto_dealloc(q->index);
+    q->index = corto_calloc(q->size * 2 * sizeof(uint32_t));
+
+    if (!q->appended) {
+        for (i = 0; i < q->count; i ++) {
+            corto_event_queue_index(q, i);
+        }
+    }
+}
+
+corto_event_queue* corto_event_queue_new(void)
+{
+    corto_event_queue *q = corto_calloc(sizeof(corto_event_queue));
+    q->size = CORTO_EVENT_QUEUE_SIZE;
+    q->entries = corto_alloc(q->size * sizeof(corto_event_queue_entry));
+    q->index = corto_calloc(q->size * 2 * sizeof(uint32_t));
+    return q;
+}
+
+void corto_event_queue_free(
+    corto_event_queue *q)
+{
+    if (q) {
+        corto_event_queue_clear(q);
+        corto_dealloc(q->entries);
+        corto_dealloc(q->index);
+        corto_dealloc(q);
+    }
+}
+
+corto_subscriber_event* corto_event_queue_add(
+    corto_event_queue *q,
+    corto_subscriber_event *e)
+{
+    uint32_t hash = corto_event_queue_hash(e);
+    uint32_t mask = q->size * 2 - 1;
+    uint32_t slot = hash & mask, pos;
+
+    corto_assert(!q->appended,
+        "corto_event_queue_add: queue contains appended events");
+
+    while ((pos = q->index[slot])) {
+        corto_event_queue_entry *entry = &q->entries[pos - 1];
+        if (entry->hash == hash && corto_event_queue_equal(entry->event, e)) {
+            corto_subscriber_event *prev = entry->event;
+            entry->event = e;
+            return prev;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (q->count == q->size) {
+        corto_event_queue_grow(q);
+    }
+
+    pos = q->count ++;
+    q->entries[pos].event = e;
+    q->entries[pos].hash = hash;
+    corto_event_queue_index(q, pos);
+
+    return NULL;
+}
+
+void corto_event_queue_append(
+    corto_event_queue *q,
+    corto_subscriber_event *e)
+{
+    q->appended = true;
+
+    if (q->count == q->size) {
+        corto_event_queue_grow(q);
+    }
+
+    q->entries[q->count].event = e;
+    q->entries[q->count].hash = 0;
+    q->count ++;
+}
+
+uint32_t corto_event_queue_count(
+    corto_event_queue *q)
+{
+    return q ? q->count : 0;
+}
+
+static
+bool corto_event_queue_hasNext(
+    corto_iter *it)
+{
+    corto_event_queue *q = it->ctx;
+    return q->cursor < q->count;
+}
+
+static
+void* corto_event_queue_next(
+    corto_iter *it)
+{
+    corto_event_queue *q = it->ctx;
+    return q->entries[q->cursor ++].event;
+}
+
+corto_subscriber_eventIter corto_event_queue_iter(
+    corto_event_queue *q)
+{
+    corto_subscriber_eventIter result;
+    memset(&result, 0, sizeof(corto_iter));
+
+    q->cursor = 0;
+    result.ctx = q;
+    result.hasNext = corto_event_queue_hasNext;
+    result.next = corto_event_queue_next;
+
+    return result;
+}
+
+void corto_event_queue_clear(
+    corto_event_queue *q)
+{
+    uint32_t i;
+
+    for (i = 0; i < q->count; i ++) {
+        corto_release(q->entries[i].event);
+    }
+
+    corto_event_queue_reset(q);
+}
+
+void corto_event_queue_reset(
+    corto_event_queue *q)
+{
+    if (q->count) {
+        memset(q->index, 0, q->size * 2 * sizeof(uint32_t));
+    }
+
+    q->count = 0;
+    q->cursor = 0;
+    q->appended = false;
+}
@@ -0,0 +1,54 @@
+#ifndef CORTO_EVENT_QUEUE_H
+#define CORTO_EVENT_QUEUE_H
+
+/* The event queue stores subscriber events in the order in which they were
+ * added, and coalesces events for the same object. When an event is added for
+ * which the queue already has an event with the same parent, id and
+ * subscriber, the new event replaces the old one at its original position.
+ *
+ * Events are stored in an array, and indexed by a hash table with open
+ * addressing that stores positions in the array. Adding an event is O(1). The
+ * queue does not synchronize access, and owns a reference to its events.
+ */
+
+typedef struct corto_event_queue corto_event_queue;
+
+/* Create a new, empty queue */
+corto_event_queue* corto_event_queue_new(void);
+
+/* Release the events in the queue and free it */
+void corto_event_queue_free(
+    corto_event_queue *q);
+
+/* Add an event to the queue. If the queue already contained an event for the
+ * same object and subscriber, it is replaced and returned. The caller is
+ * responsible for releasing the returned event. */
+corto_subscriber_event* corto_event_queue_add(
+    corto_event_queue *q,
+    corto_subscriber_event *e);
+
+/* Add an event to the end of the queue without coalescing. Appended events are
+ * not indexed, so corto_event_queue_add must not be used on the queue until it
+ * is cleared or reset. */
+void corto_event_queue_append(
+    corto_event_queue *q,
+    corto_subscriber_event *e);
+
+/* Number of events in the queue */
+uint32_t corto_event_queue_count(
+    corto_event_queue *q);
+
+/* Iterate over events in the order in which they were added */
+corto_subscriber_eventIter corto_event_queue_iter(
+    corto_event_queue *q);
+
+/* Release all events, and empty the queue so it can be reused */
+void corto_event_queue_clear(
+    corto_event_queue *q);
+
+/* Empty the queue without releasing events, for when ownership of the events
+ * was transferred while iterating over the queue */
+void corto_event_queue_reset(
+    corto_event_queue *q);
+
+#endif
@@ -0,0 +1,167 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Event records are the events that are posted to dispatchers. Creating a
+ * regular object for every event is expensive, as it is initialized and
+ * deinitialized by walking over its type, gets writable and observable headers,
+ * and copies every string. This is significant when a notification is fanned
+ * out to many asynchronous subscribers.
+ *
+ * A record has a plain object header, so that dispatchers can still claim and
+ * release it, and handlers can inspect it like any other object. Its memory is
+ * allocated from the slab pools, its members are assigned directly and its
+ * strings are interned. When the refcount of a record drops to zero,
+ * corto_destruct passes it to corto_event_record_free.
+ *
+ * Handlers must not modify a record. A handler that needs an event it can
+ * modify, or that needs to keep the event as a regular object, can make a copy
+ * with corto_copy. */
+
+#include <corto/corto.h>
+#include "src/store/object.h"
+
+static
+corto_object corto_event_record_new(
+    corto_type type)
+{
+    uint8_t slab;
+    corto__object *_o = corto_slab_alloc(
+        sizeof(corto__object) + type->size, &slab);
+
+#ifndef NDEBUG
+    _o->magic = CORTO_MAGIC;
+#endif
+    _o->refcount = 1;
+    _o->type = type;
+    _o->align.attrs.state = CORTO_VALID;
+    _o->align.attrs.slab = slab;
+    _o->align.attrs.record = TRUE;
+
+    return CORTO_OFFSET(_o, sizeof(corto__object));
+}
+
+static
+corto_object corto_event_record_claim(
+    corto_object o)
+{
+    if (o) {
+        corto_claim(o);
+    }
+    return o;
+}
+
+static
+char* corto_event_record_str(
+    const char *str)
+{
+    return str ? corto_intern_claim(str, NULL) : NULL;
+}
+
+static
+void corto_event_record_release_str(
+    const char *str)
+{
+    if (str) {
+        corto_intern_release(str);
+    }
+}
+
+corto_subscriber_event* corto_subscriber_event_new(
+    corto_subscriber subscriber,
+    corto_object instance,
+    corto_eventMask mask,
+    corto_result *r,
+    corto_fmt_data *fmt)
+{
+    corto_subscriber_event *event =
+        corto_event_record_new(corto_type(corto_subscriber_event_o));
+
+    event->super.handleAction.super.procedure = corto_subscriber_event_handle_o;
+    event->subscriber = corto_event_record_claim(subscriber);
+    event->instance = corto_event_record_claim(instance);
+    event->event = mask;
+    event->data.id = corto_event_record_str(r->id);
+    event->data.type = corto_event_record_str(r->type);
+    event->data.parent = corto_event_record_str(r->parent);
+    event->data.object = corto_event_record_claim(r->object);
+    if (fmt) {
+        event->data.value = fmt->ptr;
+        event->fmt = *fmt;
+    } else {
+        event->data.value = r->value;
+    }
+
+    return event;
+}
+
+corto_observer_event* corto_observer_event_new(
+    corto_observer observer,
+    corto_object instance,
+    corto_object observable,
+    corto_object source,
+    corto_eventMask mask)
+{
+    corto_observer_event *event =
+        corto_event_record_new(corto_type(corto_observer_event_o));
+
+    event->super.handleAction.super.procedure = corto_observer_event_handle_o;
+    event->observer = corto_event_record_claim(observer);
+    event->instance = corto_event_record_claim(instance);
+    event->data = corto_event_record_claim(observable);
+    event->source = corto_event_record_claim(source);
+    event->event = mask;
+
+    /* Set thread handle so the dispatcher can figure out whether a readlock is
+     * needed */
+    event->thread = corto_thread_self();
+
+    return event;
+}
+
+void corto_event_record_free(
+    corto_object e)
+{
+    corto__object *_o = corto_hdr(e);
+
+    if (_o->type == corto_type(corto_subscriber_event_o)) {
+        corto_subscriber_event *event = e;
+        corto_subscriber_event_deinit(event);
+        corto_release(event->subscriber);
+        corto_release(event->instance);
+        corto_release(event->source);
+        corto_release(event->data.object);
+        corto_event_record_release_str(event->data.id);
+        corto_event_record_release_str(event->data.type);
+        corto_event_record_release_str(event->data.parent);
+    } else {
+        corto_observer_event *event = e;
+        corto_release(event->observer);
+        corto_release(event->instance);
+        corto_release(event->data);
+        corto_release(event->source);
+    }
+
+#ifndef NDEBUG
+    _o->magic = CORTO_MAGIC_DESTRUCT;
+#endif
+
+    corto_slab_free(_o, _o->align.attrs.slab);
+}
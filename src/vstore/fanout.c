@@ -0,0 +1,414 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <corto/corto.h>
+#include "src/store/object.h"
+#include "src/vstore/fanout.h"
+
+/* Number of threads in the worker pool */
+#define CORTO_FANOUT_WORKERS (8)
+
+/* Number of results a fan-out can hold before workers wait for the consumer */
+#define CORTO_FANOUT_QUEUE_SIZE (64)
+
+typedef struct corto_fanout_entry {
+    corto_result result;
+    corto_fmt fmt; /* Format of value, used to release it */
+    int32_t index;
+} corto_fanout_entry;
+
+struct corto_fanout {
+    corto_mutex_s lock;
+    corto_cond_s notEmpty; /* Consumer waits for results */
+    corto_cond_s notFull;  /* Workers wait for space in queue */
+
+    corto_fanout_entry queue[CORTO_FANOUT_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t count;
+
+    uint32_t pending; /* Queries that have not finished */
+    uint32_t refs;    /* Pending queries plus one for the consumer */
+    volatile bool cancelled;
+
+    corto_fanout_entry current; /* Last result taken by the consumer */
+};
+
+typedef struct corto_fanout_job corto_fanout_job;
+struct corto_fanout_job {
+    corto_fanout_job *next;
+    corto_fanout *fanout;
+    corto_mount mount;
+    corto_query query;
+    int32_t index;
+};
+
+typedef enum corto_fanout_state {
+    CORTO_FANOUT_STOPPED,
+    CORTO_FANOUT_STARTING,
+    CORTO_FANOUT_RUNNING,
+    CORTO_FANOUT_FAILED
+} corto_fanout_state;
+
+static struct {
+    corto_mutex_s lock;
+    corto_cond_s cond;
+    corto_fanout_job *head;
+    corto_fanout_job *tail;
+    corto_thread workers[CORTO_FANOUT_WORKERS];
+    uint32_t count;
+    bool quit;
+} corto_fanout_pool;
+
+static volatile int32_t corto_fanout_poolState = CORTO_FANOUT_STOPPED;
+
+/* Set for worker threads */
+static corto_tls corto_fanout_key;
+
+/* Number of fan-outs the current thread is consuming */
+static corto_tls corto_fanout_activeKey;
+
+static
+char* corto_fanout_strdup(
+    const char *str)
+{
+    return str ? corto_strdup(str) : NULL;
+}
+
+/* Type names are shared by many results, so they are interned */
+static
+char* corto_fanout_type(
+    const char *type)
+{
+    return type ? corto_intern_claim(type, NULL) : NULL;
+}
+
+static
+void corto_fanout_entryDeinit(
+    corto_fanout_entry *e)
+{
+    if (e->result.id) corto_dealloc(e->result.id);
+    if (e->result.name) corto_dealloc(e->result.name);
+    if (e->result.parent) corto_dealloc(e->result.parent);
+    if (e->result.type) corto_intern_release(e->result.type);
+    if (e->result.value && e->fmt) {
+        corto_fmt_release(e->fmt, (void*)e->result.value);
+    }
+    memset(e, 0, sizeof(corto_fanout_entry));
+}
+
+static
+void corto_fanout_destroy(
+    corto_fanout *f)
+{
+    corto_fanout_entryDeinit(&f->current);
+    corto_mutex_free(&f->lock);
+    corto_cond_free(&f->notEmpty);
+    corto_cond_free(&f->notFull);
+    corto_dealloc(f);
+}
+
+/* Push a copy of a result to the queue. Returns -1 if the fan-out is cancelled,
+ * in which case the worker should stop iterating its mount. */
+static
+int16_t corto_fanout_push(
+    corto_fanout *f,
+    corto_result *r,
+    corto_fmt fmt,
+    int32_t index)
+{
+    corto_fanout_entry e = {
+        .result = {
+            .id = corto_fanout_strdup(r->id),
+            .name = corto_fanout_strdup(r->name),
+            .parent = corto_fanout_strdup(r->parent),
+            .type = corto_fanout_type(r->type),
+            .value = r->value && fmt ? (uintptr_t)corto_fmt_copy(fmt, (void*)r->value) : 0,
+            .flags = r->flags
+        },
+        .fmt = fmt,
+        .index = index
+    };
+
+    corto_mutex_lock(&f->lock);
+    while (f->count == CORTO_FANOUT_QUEUE_SIZE && !f->cancelled) {
+        corto_cond_wait(&f->notFull, &f->lock);
+    }
+
+    if (f->cancelled) {
+        corto_mutex_unlock(&f->lock);
+        corto_fanout_entryDeinit(&e);
+        return -1;
+    }
+
+    f->queue[(f->head + f->count) % CORTO_FANOUT_QUEUE_SIZE] = e;
+    f->count ++;
+    corto_cond_signal(&f->notEmpty);
+    corto_mutex_unlock(&f->lock);
+
+    return 0;
+}
+
+static
+void corto_fanout_run(
+    corto_fanout_job *job)
+{
+    corto_fanout *f = job->fanout;
+    corto_fmt fmt = (corto_fmt)job->mount->contentTypeOutHandle;
+    bool last;
+
+    if (!f->cancelled) {
+        corto_resultIter it = corto_mount_query(job->mount, &job->query);
+        while (corto_iter_hasNext(&it)) {
+            corto_result *r = corto_iter_next(&it);
+            if (corto_fanout_push(f, r, fmt, job->index)) {
+                corto_iter_release(&it);
+                break;
+            }
+        }
+    }
+
+    corto_ptr_deinit(&job->query, corto_query_o);
+    corto_release(job->mount);
+    corto_dealloc(job);
+
+    corto_mutex_lock(&f->lock);
+    f->pending --;
+    last = !-- f->refs;
+    corto_cond_signal(&f->notEmpty);
+    corto_mutex_unlock(&f->lock);
+
+    if (last) {
+        corto_fanout_destroy(f);
+    }
+}
+
+static
+void* corto_fanout_work(
+    void *arg)
+{
+    corto_fanout_job *job;
+
+    corto_tls_set(corto_fanout_key, arg);
+
+    while (true) {
+        corto_mutex_lock(&corto_fanout_pool.lock);
+        while (!corto_fanout_pool.head && !corto_fanout_pool.quit) {
+            corto_cond_wait(&corto_fanout_pool.cond, &corto_fanout_pool.lock);
+        }
+
+        /* Only quit when there are no more jobs */
+        if (!(job = corto_fanout_pool.head)) {
+            corto_mutex_unlock(&corto_fanout_pool.lock);
+            break;
+        }
+
+        if (!(corto_fanout_pool.head = job->next)) {
+            corto_fanout_pool.tail = NULL;
+        }
+        corto_mutex_unlock(&corto_fanout_pool.lock);
+
+        corto_fanout_run(job);
+    }
+
+    return NULL;
+}
+
+/* Start pool. Threads that use the pool while it is starting wait for it. */
+static
+int16_t corto_fanout_start(void)
+{
+    uint32_t i;
+
+    if (!__sync_bool_compare_and_swap(
+        &corto_fanout_poolState, CORTO_FANOUT_STOPPED, CORTO_FANOUT_STARTING))
+    {
+        while (corto_fanout_poolState == CORTO_FANOUT_STARTING) {
+            corto_sleep(0, 100000);
+        }
+        goto done;
+    }
+
+    corto_mutex_new(&corto_fanout_pool.lock);
+    corto_cond_new(&corto_fanout_pool.cond);
+    corto_tls_new(&corto_fanout_key, NULL);
+    corto_tls_new(&corto_fanout_activeKey, NULL);
+    corto_fanout_pool.quit = false;
+
+    for (i = 0; i < CORTO_FANOUT_WORKERS; i ++) {
+        corto_thread t = corto_thread_new(corto_fanout_work, &corto_fanout_pool);
+        if (!t) {
+            break;
+        }
+        corto_fanout_pool.workers[corto_fanout_pool.count ++] = t;
+    }
+
+    __sync_synchronize();
+    corto_fanout_poolState = corto_fanout_pool.count
+        ? CORTO_FANOUT_RUNNING
+        : CORTO_FANOUT_FAILED
+        ;
+
+done:
+    if (corto_fanout_poolState != CORTO_FANOUT_RUNNING) {
+        corto_throw("failed to start workers for parallel queries");
+        return -1;
+    }
+    return 0;
+}
+
+bool corto_fanout_available(void)
+{
+    switch(corto_fanout_poolState) {
+    case CORTO_FANOUT_FAILED:
+        return false;
+    case CORTO_FANOUT_RUNNING:
+        /* A thread that consumes a fan-out can't start another one, as the
+         * workers may all be waiting for the consumer of the first one */
+        return corto_tls_get(corto_fanout_key) == NULL &&
+               corto_tls_get(corto_fanout_activeKey) == NULL;
+    default:
+        return true;
+    }
+}
+
+corto_fanout* corto_fanout_new(void)
+{
+    if (corto_fanout_poolState != CORTO_FANOUT_RUNNING) {
+        if (corto_fanout_start()) {
+            return NULL;
+        }
+    }
+
+    corto_fanout *result = corto_calloc(sizeof(corto_fanout));
+    corto_mutex_new(&result->lock);
+    corto_cond_new(&result->notEmpty);
+    corto_cond_new(&result->notFull);
+    result->refs = 1;
+
+    uintptr_t active = (uintptr_t)corto_tls_get(corto_fanout_activeKey);
+    corto_tls_set(corto_fanout_activeKey, (void*)(active + 1));
+
+    return result;
+}
+
+void corto_fanout_query(
+    corto_fanout *f,
+    corto_mount mount,
+    corto_query *query,
+    int32_t index)
+{
+    corto_fanout_job *job = corto_calloc(sizeof(corto_fanout_job));
+    job->fanout = f;
+    job->index = index;
+    corto_set_ref(&job->mount, mount);
+    corto_ptr_copy(&job->query, corto_query_o, query);
+
+    corto_mutex_lock(&f->lock);
+    f->pending ++;
+    f->refs ++;
+    corto_mutex_unlock(&f->lock);
+
+    corto_mutex_lock(&corto_fanout_pool.lock);
+    if (corto_fanout_pool.tail) {
+        corto_fanout_pool.tail->next = job;
+    } else {
+        corto_fanout_pool.head = job;
+    }
+    corto_fanout_pool.tail = job;
+    corto_cond_signal(&corto_fanout_pool.cond);
+    corto_mutex_unlock(&corto_fanout_pool.lock);
+}
+
+corto_result* corto_fanout_next(
+    corto_fanout *f,
+    int32_t *index_out)
+{
+    corto_fanout_entryDeinit(&f->current);
+
+    corto_mutex_lock(&f->lock);
+    while (!f->count && f->pending) {
+        corto_cond_wait(&f->notEmpty, &f->lock);
+    }
+
+    if (!f->count) {
+        corto_mutex_unlock(&f->lock);
+        return NULL;
+    }
+
+    f->current = f->queue[f->head];
+    f->head = (f->head + 1) % CORTO_FANOUT_QUEUE_SIZE;
+    f->count --;
+    corto_cond_signal(&f->notFull);
+    corto_mutex_unlock(&f->lock);
+
+    if (index_out) {
+        *index_out = f->current.index;
+    }
+
+    return &f->current.result;
+}
+
+void corto_fanout_free(
+    corto_fanout *f)
+{
+    bool last;
+
+    uintptr_t active = (uintptr_t)corto_tls_get(corto_fanout_activeKey);
+    corto_tls_set(corto_fanout_activeKey, (void*)(active - 1));
+
+    corto_mutex_lock(&f->lock);
+    f->cancelled = true;
+    while (f->count) {
+        corto_fanout_entryDeinit(&f->queue[f->head]);
+        f->head = (f->head + 1) % CORTO_FANOUT_QUEUE_SIZE;
+        f->count --;
+    }
+    corto_cond_broadcast(&f->notFull);
+    last = !-- f->refs;
+    corto_mutex_unlock(&f->lock);
+
+    if (last) {
+        corto_fanout_destroy(f);
+    }
+}
+
+void corto_fanout_deinit(void)
+{
+    uint32_t i;
+
+    if (corto_fanout_poolState == CORTO_FANOUT_STOPPED) {
+        return;
+    }
+
+    corto_mutex_lock(&corto_fanout_pool.lock);
+    corto_fanout_pool.quit = true;
+    corto_cond_broadcast(&corto_fanout_pool.cond);
+    corto_mutex_unlock(&corto_fanout_pool.lock);
+
+    for (i = 0; i < corto_fanout_pool.count; i ++) {
+        corto_thread_join(corto_fanout_pool.workers[i], NULL);
+    }
+
+    corto_mutex_free(&corto_fanout_pool.lock);
+    corto_cond_free(&corto_fanout_pool.cond);
+    corto_fanout_pool.count = 0;
+    corto_fanout_poolState = CORTO_FANOUT_STOPPED;
+}
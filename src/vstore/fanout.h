@@ -0,0 +1,54 @@
+#ifndef CORTO_FANOUT_H
+#define CORTO_FANOUT_H
+
+/* A fan-out queries multiple mounts concurrently, on a pool of worker threads
+ * that is shared by all fan-outs. Workers copy the results of the mounts into
+ * a bounded queue, from which a single consumer takes them in order of
+ * arrival. When the queue is full, workers wait for the consumer, so a mount
+ * that returns many results only uses as much memory as the queue holds.
+ *
+ * Freeing a fan-out before all results are taken cancels it. Workers stop
+ * iterating their mount at the next result, and the last worker that uses the
+ * fan-out deallocates it.
+ *
+ * Workers cannot start a fan-out themselves (for example when a mount runs a
+ * select in its on_query), as that could wait for workers that are all
+ * waiting for results. For the same reason a thread cannot start a fan-out
+ * while it is consuming another one (for example when a nested select is
+ * started while iterating results), so a fan-out must be freed by the thread
+ * that created it. Use corto_fanout_available to check if a fan-out can be
+ * started by the current thread, and query sequentially when it can't.
+ */
+
+typedef struct corto_fanout corto_fanout;
+
+/* Returns true if the current thread can start a fan-out */
+bool corto_fanout_available(void);
+
+/* Create fan-out. Starts the worker pool when it is used for the first time.
+ * Returns NULL and throws if the pool could not be started. */
+corto_fanout* corto_fanout_new(void);
+
+/* Query a mount. The query is copied. The index is returned with the results
+ * of the mount, so the consumer can tell which mount returned a result. */
+void corto_fanout_query(
+    corto_fanout *fanout,
+    corto_mount mount,
+    corto_query *query,
+    int32_t index);
+
+/* Take the next result. Blocks until a result is available, and returns NULL
+ * when all mounts have been iterated. A result is valid until the next result
+ * is taken, or the fan-out is freed. Results have no history. */
+corto_result* corto_fanout_next(
+    corto_fanout *fanout,
+    int32_t *index_out);
+
+/* Free fan-out, cancels queries that have not finished */
+void corto_fanout_free(
+    corto_fanout *fanout);
+
+/* Stop the worker pool. Called by corto_stop. */
+void corto_fanout_deinit(void);
+
+#endif
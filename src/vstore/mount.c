@@ -2,10 +2,37 @@
 
 #include <corto/corto.h>
 #include "src/store/object.h"
+#include "src/vstore/event_queue.h"
 
 extern corto_tls CORTO_KEY_MOUNT_RESULT;
 corto_entityAdmin corto_mount_admin = {0, 0, CORTO_RWMUTEX_INIT, 0, 0, CORTO_MUTEX_INIT, CORTO_COND_INIT};
 
+/* Incremented after mounts are added to or removed from the mount admin, so
+ * prepared selects know when to look up their mounts again. */
+volatile uint32_t corto_mount_generation = 0;
+
+/* Events posted to a mount with a sampleRate are collected in double buffered
+ * queues. Publishers add events to the active buffers while holding the queue
+ * lock, which serializes publishers so that events can be coalesced. The poll
+ * thread takes a batch by swapping the active buffers with empty spare
+ * buffers, so that it only holds the lock for the duration of the swap and
+ * never while processing events. Publishers that reach policy.queue.max wait
+ * on the condition variable, which is signalled after every swap.
+ *
+ * The mount holds one reference to the queue, publishers hold one while they
+ * post. The reference of the mount is released through the epoch when the
+ * mount is destructed, as publishers load the queue in a critical section. */
+typedef struct corto_mount_queue {
+    corto_mutex_s lock;
+    corto_cond_s cond;
+    corto_event_queue *events;      /* Active buffers, guarded by lock */
+    corto_event_queue *historical;
+    corto_event_queue *spareEvents; /* Only accessed by poll thread */
+    corto_event_queue *spareHistorical;
+    uint64_t polls;                 /* Number of swaps, guarded by lock */
+    int32_t refcount;
+} corto_mount_queue;
+
 void corto_mount_subscribeOrMount(
     corto_mount this,
     corto_query *query,
@@ -32,6 +59,67 @@ corto_time corto_mount_doubleToTime(
     return result;
 }
 
+static
+corto_mount_queue* corto_mount_queue_new(void)
+{
+    corto_mount_queue *q = corto_calloc(sizeof(corto_mount_queue));
+    corto_mutex_new(&q->lock);
+    corto_cond_new(&q->cond);
+    q->events = corto_event_queue_new();
+    q->historical = corto_event_queue_new();
+    q->spareEvents = corto_event_queue_new();
+    q->spareHistorical = corto_event_queue_new();
+    q->refcount = 1;
+    return q;
+}
+
+static
+void corto_mount_queue_free(
+    corto_mount_queue *q)
+{
+    if (corto_event_queue_count(q->events)) {
+        corto_trace("there were %d events left in the mount event queue",
+            corto_event_queue_count(q->events));
+    }
+
+    if (corto_event_queue_count(q->historical)) {
+        corto_trace("there were %d historical events left in the mount event queue",
+            corto_event_queue_count(q->historical));
+    }
+
+    corto_event_queue_free(q->events);
+    corto_event_queue_free(q->historical);
+    corto_event_queue_free(q->spareEvents);
+    corto_event_queue_free(q->spareHistorical);
+    corto_mutex_free(&q->lock);
+    corto_cond_free(&q->cond);
+    corto_dealloc(q);
+}
+
+static
+void corto_mount_queue_release(
+    void *ptr)
+{
+    corto_mount_queue *q = ptr;
+    if (!corto_adec(&q->refcount)) {
+        corto_mount_queue_free(q);
+    }
+}
+
+/* Number of events in the active buffers that counts towards queue.max. Must
+ * be called while holding the queue lock. */
+static
+uint32_t corto_mount_queue_size(
+    corto_mount this,
+    corto_mount_queue *q)
+{
+    if (this->policy.mask & CORTO_MOUNT_HISTORY_BATCH_NOTIFY) {
+        return corto_event_queue_count(q->historical);
+    } else {
+        return corto_event_queue_count(q->events);
+    }
+}
+
 static
 void* corto_mount_thread(
     void* arg)
@@ -138,6 +226,127 @@ int corto_mount_alignSubscriptionsAction(
     return 1;
 }
 
+/* Paths of mounts that receive subscriptions (SUBSCRIBE or MOUNT). Tree
+ * observers use this to find out whether a DEFINE or DELETE of an object can
+ * change the subscriptions of a mount, before running a select to update them.
+ * The table is replaced when a mount is added or removed, and read without
+ * locking in an epoch critical section. */
+typedef struct corto_mount_subscribeTable {
+    uint32_t count;
+    struct {
+        corto_mount mount;
+        char *from; /* Owned by table, as mount may be deleted before table */
+    } entries[];
+} corto_mount_subscribeTable;
+
+static corto_mount_subscribeTable * volatile corto_mount_subscribeMounts;
+static corto_mutex_s corto_mount_subscribeLock = CORTO_MUTEX_INIT;
+
+static
+void corto_mount_subscribeTableFree(
+    void *ptr)
+{
+    corto_mount_subscribeTable *table = ptr;
+    uint32_t i;
+    for (i = 0; i < table->count; i ++) {
+        corto_dealloc(table->entries[i].from);
+    }
+    corto_dealloc(table);
+}
+
+/* Add (or remove) mount to table of mounts that receive subscriptions */
+static
+void corto_mount_subscribeTableSet(
+    corto_mount this,
+    bool add)
+{
+    corto_mutex_lock(&corto_mount_subscribeLock);
+    corto_mount_subscribeTable *old = corto_mount_subscribeMounts, *new;
+    uint32_t i, count = 0, oldCount = old ? old->count : 0;
+
+    new = corto_alloc(sizeof(corto_mount_subscribeTable) +
+        (oldCount + 1) * sizeof(new->entries[0]));
+
+    for (i = 0; i < oldCount; i ++) {
+        if (old->entries[i].mount != this) {
+            new->entries[count].mount = old->entries[i].mount;
+            new->entries[count].from = corto_strdup(old->entries[i].from);
+            count ++;
+        }
+    }
+
+    if (add) {
+        const char *from = this->super.query.from;
+        new->entries[count].mount = this;
+        new->entries[count].from = corto_strdup(from ? from : "/");
+        count ++;
+    }
+
+    new->count = count;
+    if (!count) {
+        corto_dealloc(new);
+        new = NULL;
+    }
+
+    corto_epoch_publish(&corto_mount_subscribeMounts, new);
+    corto_mutex_unlock(&corto_mount_subscribeLock);
+
+    if (old) {
+        corto_epoch_retire(old, corto_mount_subscribeTableFree);
+    }
+}
+
+/* Test whether path equals prefix, or is nested in prefix */
+static
+bool corto_mount_pathIn(
+    const char *path,
+    const char *prefix)
+{
+    const char *ptr = path, *pptr = prefix;
+
+    /* Root contains everything */
+    if (!pptr[0] || (pptr[0] == '/' && !pptr[1])) {
+        return true;
+    }
+
+    while (*pptr && tolower(*ptr) == tolower(*pptr)) {
+        ptr ++;
+        pptr ++;
+    }
+
+    return !*pptr && (!*ptr || *ptr == '/');
+}
+
+/* Returns whether a mount that receives subscriptions is mounted on a parent of
+ * the path, on the path itself, or in the tree under the path. Only then can
+ * defining or deleting the object change the subscriptions of a mount. The table
+ * is only accessed in an epoch critical section, as it may be retired by a
+ * concurrent (un)subscribe. */
+bool corto_mount_hasSubscriptionsFor(
+    const char *path)
+{
+    corto_mount_subscribeTable *table;
+    bool result = false;
+    uint32_t i;
+
+    corto_epoch_enter();
+    table = corto_mount_subscribeMounts;
+
+    if (table) {
+        for (i = 0; i < table->count; i ++) {
+            const char *from = table->entries[i].from;
+            if (corto_mount_pathIn(path, from) || corto_mount_pathIn(from, path)) {
+                result = true;
+                break;
+            }
+        }
+    }
+
+    corto_epoch_exit();
+
+    return result;
+}
+
 corto_int16 corto_mount_alignSubscriptions(corto_mount this) {
 
     if (!corto_entityAdmin_walk(&corto_subscriber_admin, corto_mount_alignSubscriptionsAction, NULL, false, this)) {
@@ -194,6 +403,7 @@ int16_t corto_mount_construct(
     /* Parse policies */
     if (this->policy.sampleRate) {
         dispatcher = this;
+        this->events = (corto_word)corto_mount_queue_new();
         this->thread = (corto_word)corto_thread_new(
             corto_mount_thread,
             this);
@@ -245,6 +455,10 @@ int16_t corto_mount_construct(
         this->policy.mask &= ~CORTO_MOUNT_ID;
     }
 
+    if (!corto_mount_hasMethod(this, "on_count")) {
+        this->policy.mask &= ~CORTO_MOUNT_COUNT;
+    }
+
     /* Set the callback function */
     corto_function(this)->kind = CORTO_PROCEDURE_CDECL;
     corto_function(this)->fptr = (corto_word)corto_mount_notify;
@@ -278,10 +492,14 @@ int16_t corto_mount_construct(
 
     /* Add mount to mount admin so it can be found by corto_select */
     corto_entityAdmin_add(&corto_mount_admin, s->query.from, this, this);
+    __sync_fetch_and_add(&corto_mount_generation, 1);
+
     /* If mount is interested in subscriptions, align from existing subscribers */
     if (this->policy.mask & (CORTO_MOUNT_SUBSCRIBE|CORTO_MOUNT_MOUNT))
     {
+        corto_mount_subscribeTableSet(this, true);
         if (corto_mount_alignSubscriptions(this)) {
+            corto_mount_subscribeTableSet(this, false);
             goto error;
         }
     }
@@ -289,6 +507,10 @@ int16_t corto_mount_construct(
     corto_int16 ret = safe_corto_subscriber_construct(this);
     if (ret) {
         corto_entityAdmin_remove(&corto_mount_admin, s->query.from, this, this, FALSE);
+        __sync_fetch_and_add(&corto_mount_generation, 1);
+        if (this->policy.mask & (CORTO_MOUNT_SUBSCRIBE|CORTO_MOUNT_MOUNT)) {
+            corto_mount_subscribeTableSet(this, false);
+        }
     } else {
         /* Make it easy to see whether this mount observes a tree, scope or self */
         int scope = corto_idmatch_get_scope(
@@ -308,10 +530,30 @@ void corto_mount_destruct(
     corto_mount this)
 {
     corto_mountSubscription *s = NULL;
+    corto_mount_queue *q = (corto_mount_queue*)this->events;
 
     /* Signal thread ASAP to stop */
     this->quit = TRUE;
 
+    /* Wake up publishers that are waiting for the queue to drain */
+    if (q) {
+        corto_mutex_lock(&q->lock);
+        corto_cond_broadcast(&q->cond);
+        corto_mutex_unlock(&q->lock);
+    }
+
+    /* Unregister mount before tearing down the queue, so that new events are
+     * no longer posted to it */
+    if (this->policy.mask & (CORTO_MOUNT_SUBSCRIBE|CORTO_MOUNT_MOUNT)) {
+        corto_mount_subscribeTableSet(this, false);
+    }
+
+    safe_corto_subscriber_destruct(this);
+    corto_assert(
+        corto_entityAdmin_remove(&corto_mount_admin, this->super.query.from, this, this, FALSE) != -1,
+        "trying to remove mount that was never added to mountAdmin");
+    __sync_fetch_and_add(&corto_mount_generation, 1);
+
     /* Unsubscribe from active subscriptions */
     if (this->subscriptions) {
         while ((s = corto_ll_takeFirst(this->subscriptions))) {
@@ -328,20 +570,11 @@ void corto_mount_destruct(
         corto_thread_join((corto_thread)this->thread, NULL);
     }
 
-    if (corto_ll_count(this->events)) {
-        corto_trace("there were %d events left in the mount event queue",
-            corto_ll_count(this->events));
+    /* Publishers that are still posting hold their own reference */
+    if (q) {
+        corto_epoch_publish(&this->events, 0);
+        corto_epoch_retire(q, corto_mount_queue_release);
     }
-
-    if (corto_ll_count(this->historicalEvents)) {
-        corto_trace("there were %d historical events left in the mount event queue",
-            corto_ll_count(this->historicalEvents));
-    }
-
-    safe_corto_subscriber_destruct(this);
-    corto_assert(
-        corto_entityAdmin_remove(&corto_mount_admin, this->super.query.from, this, this, FALSE) != -1,
-        "trying to remove mount that was never added to mountAdmin");
 }
 
 corto_string corto_mount_id(
@@ -371,6 +604,10 @@ int16_t corto_mount_init(
         this->policy.mask |= CORTO_MOUNT_HISTORY_QUERY;
     }
 
+    if (corto_mount_hasMethod(this, "on_count")) {
+        this->policy.mask |= CORTO_MOUNT_COUNT;
+    }
+
     if (corto_mount_hasMethod(this, "on_notify")) {
         this->policy.mask |= CORTO_MOUNT_NOTIFY;
     }
@@ -451,80 +688,74 @@ void corto_mount_on_notify_v(
 void corto_mount_onPoll(
     corto_mount this)
 {
-    corto_event *e;
-    corto_ll events = NULL, historicalEvents = NULL;
+    corto_mount_queue *q = (corto_mount_queue*)this->events;
+    corto_event_queue *events, *historical;
+    corto_time now;
 
-    /* Collect events */
-    if (corto_lock(this)) {
-        corto_throw(NULL);
-        corto_raise();
-    }
-
-    corto_time_get(&this->lastPoll);
-    this->lastQueueSize = 0;
-    if (corto_ll_count(this->events)) {
-        events = corto_ll_new();
-        while ((e = corto_ll_takeFirst(this->events))) {
-            corto_ll_append(events, e);
-        }
+    if (!q) {
+        return;
     }
 
-    if (corto_ll_count(this->historicalEvents)) {
-        historicalEvents = corto_ll_new();
-        while ((e = corto_ll_takeFirst(this->historicalEvents))) {
-            corto_ll_append(historicalEvents, e);
-        }
+    corto_time_get(&now);
 
-    }
-
-    if (corto_unlock(this)) {
-        corto_throw(NULL);
-        corto_raise();
-    }
+    /* Take batch by swapping active and spare buffers */
+    corto_mutex_lock(&q->lock);
+    events = q->events;
+    historical = q->historical;
+    q->events = q->spareEvents;
+    q->historical = q->spareHistorical;
+    this->lastPoll = now;
+    this->lastQueueSize = 0;
+    q->polls ++;
+    corto_cond_broadcast(&q->cond);
+    corto_mutex_unlock(&q->lock);
 
     /* If batching is enabled, call on_batch_notify */
-    if (events && this->policy.mask & CORTO_MOUNT_BATCH_NOTIFY) {
-        corto_iter it = corto_ll_iter(events);
+    if (corto_event_queue_count(events) &&
+        this->policy.mask & CORTO_MOUNT_BATCH_NOTIFY)
+    {
+        corto_iter it = corto_event_queue_iter(events);
         corto_mount_on_batch_notify(this, it);
     }
 
     /* If batching of historical data is enabled, call on_history_batch_notify */
-    if (historicalEvents && this->policy.mask & CORTO_MOUNT_HISTORY_BATCH_NOTIFY) {
-        corto_iter it = corto_ll_iter(historicalEvents);
+    if (corto_event_queue_count(historical) &&
+        this->policy.mask & CORTO_MOUNT_HISTORY_BATCH_NOTIFY)
+    {
+        corto_iter it = corto_event_queue_iter(historical);
         corto_mount_on_history_batch_notify(this, it);
-        it = corto_ll_iter(historicalEvents);
-        while (corto_iter_hasNext(&it)) {
-            corto_event *e = corto_iter_next(&it);
-            corto_release(e);
-        }
-
-        corto_ll_free(historicalEvents);
     }
 
     /* Default event handler */
-    if (events) {
-        while ((e = corto_ll_takeFirst(events))) {
-            corto_mount_notify((corto_subscriber_event*)e);
-            corto_assert(corto_release(e) == 0, "event is leaking");
+    if (corto_event_queue_count(events)) {
+        corto_iter it = corto_event_queue_iter(events);
+        while (corto_iter_hasNext(&it)) {
+            corto_mount_notify(corto_iter_next(&it));
         }
-        corto_ll_free(events);
     }
+
+    /* Release events, and reuse buffers for the next batch */
+    corto_event_queue_clear(events);
+    corto_event_queue_clear(historical);
+    q->spareEvents = events;
+    q->spareHistorical = historical;
 }
 
-static
-int corto_mount_findEvent(
-    void *o1,
-    void *o2)
+/* Deliver events of a batch published with corto_publish_batch. Mounts without
+ * a sample rate otherwise receive events one at a time, and never in a batch.
+ * Events are handled like a batch taken from the queue in onPoll. */
+void corto_mount_notifyBatch(
+    corto_mount this,
+    corto_event_queue *events)
 {
-    corto_subscriber_event *e1 = o1, *e2 = o2;
-    if (!strcmp(e2->data.id, e1->data.id) &&
-        !strcmp(e2->data.parent, e1->data.parent) &&
-        (e2->subscriber == e1->subscriber))
-    {
-        return false;
-    }
+    corto_iter it = corto_event_queue_iter(events);
+    corto_mount_on_batch_notify(this, it);
 
-    return true;
+    /* Default event handler */
+    it = corto_event_queue_iter(events);
+    while (corto_iter_hasNext(&it)) {
+        corto_mount_notify(corto_iter_next(&it));
+    }
 }
 
 void corto_mount_post(
@@ -534,66 +765,68 @@ void corto_mount_post(
     int size = 0;
     corto_time lastPoll = {0, 0};
     int lastQueueSize = 0;
-    /* If sampleRate != 0, post event to list. Another thread will process it
+    uint64_t polls = 0;
+    corto_mount_queue *q;
+
+    /* Take reference to queue, so it isn't freed by a concurrent destruct */
+    corto_epoch_enter();
+    q = (corto_mount_queue*)this->events;
+    if (q) {
+        corto_ainc(&q->refcount);
+    }
+    corto_epoch_exit();
+
+    /* If sampleRate != 0, post event to queue. Another thread will process it
      * at the specified rate. */
     if (this->policy.mask & (CORTO_MOUNT_NOTIFY | CORTO_MOUNT_BATCH_NOTIFY | CORTO_MOUNT_HISTORY_BATCH_NOTIFY))
     {
-        if (this->policy.sampleRate)
+        if (q)
         {
             /* Keep track of how often an event is added to a queue. If added to
              * only one queue, refcount does not need to be increased. If added
              * to two queues, refcount must be increased. */
             int appended = 0;
 
-            /* Append new event to queue */
-            if (corto_lock(this)) {
-                corto_throw(NULL);
-                corto_raise();
-            }
+            /* Event replaced by the new event, released outside of the lock */
+            corto_subscriber_event *replaced = NULL;
+
+            /* Append new event to active buffers */
+            corto_mutex_lock(&q->lock);
 
             /* Retrieve last poll time within lock */
             lastPoll = this->lastPoll;
             lastQueueSize = this->lastQueueSize;
+            polls = q->polls;
+
             if (this->policy.mask & CORTO_MOUNT_HISTORY_BATCH_NOTIFY) {
-                if (!this->historicalEvents) {
-                    this->historicalEvents = corto_ll_new();
-                }
-                corto_ll_append(this->historicalEvents, e);
+                corto_event_queue_append(
+                    q->historical, (corto_subscriber_event*)e);
                 appended ++;
-                size = corto_ll_count(this->historicalEvents);
             }
 
             if (this->policy.mask & (CORTO_MOUNT_NOTIFY | CORTO_MOUNT_BATCH_NOTIFY)) {
-                /* Check if there is already another event in the queue for the same object.
-                 * if so, replace event with latest update. */
-                void *ptr = NULL;
-                if (!this->events) {
-                    this->events = corto_ll_new();
-                } else {
-                    ptr = corto_ll_findPtr(this->events, corto_mount_findEvent, e);
-                }
-                if (ptr) {
-                    corto_release(*(void**)ptr);
-                    *(void**)ptr = e;
-                } else {
-                    corto_ll_append(this->events, e);
-                    appended ++;
-                }
-
-                if (!size) {
-                    size = corto_ll_count(this->events);
-                }
+                /* If there is already an event in the queue for the same
+                 * object, the queue replaces it with the latest update. */
+                replaced = corto_event_queue_add(
+                    q->events, (corto_subscriber_event*)e);
+                appended ++;
             }
 
             if (appended == 2) {
                 corto_claim(e);
             }
 
-            if (corto_unlock(this)) {
-                corto_throw(NULL);
-                corto_raise();
+            size = corto_mount_queue_size(this, q);
+
+            corto_mutex_unlock(&q->lock);
+
+            if (replaced) {
+                corto_release(replaced);
             }
 
+        } else if (this->quit) {
+            /* Mount is being destructed, drop event */
+            corto_release(e);
         } else {
             corto_event_handle(e);
             corto_assert(corto_release(e) == 0, "event is leaking");
@@ -602,7 +835,7 @@ void corto_mount_post(
 
     /* If queue.max is not specified, don't throttle */
     if (!this->policy.queue.max) {
-        return;
+        goto done;
     }
 
     /* collectCount determines how often the algorithm will evaluate the delay
@@ -685,12 +918,14 @@ void corto_mount_post(
                 }
             } else {
                 /* If time spent in current period exceeds total period time,
-                 * the OS scheduler is lagging. In that case block, as it might
-                 * be this thread that is holding up the poll thread. */
-                do {
-                    corto_sleep(0, 1000000);
-                } while ((lastPoll.nanosec == this->lastPoll.nanosec) ||
-                         (lastPoll.nanosec == this->lastPoll.nanosec));
+                 * the OS scheduler is lagging. In that case block until the
+                 * next poll, as it might be this thread that is holding up
+                 * the poll thread. */
+                corto_mutex_lock(&q->lock);
+                while (q->polls == polls && !this->quit) {
+                    corto_cond_wait(&q->cond, &q->lock);
+                }
+                corto_mutex_unlock(&q->lock);
                 this->lastSleep.sec = 0;
                 this->lastSleep.nanosec = 0;
                 this->dueSleep.sec = 0;
@@ -710,19 +945,20 @@ void corto_mount_post(
         }
     }
 
-    /* If size is equal to max, block until queue is emptied */
-    if (size == this->policy.queue.max) {
-        do {
-            corto_sleep(0, 1000000); /* fast loop to minimize blocking time */
-            corto_lock(this);
-            if (this->policy.mask & CORTO_MOUNT_HISTORY_BATCH_NOTIFY) {
-                size = corto_ll_count(this->historicalEvents);
-            } else {
-                size = corto_ll_count(this->events);
-            }
+    /* If size has reached max, block until the poll thread takes the queue */
+    if (q && size >= this->policy.queue.max) {
+        corto_mutex_lock(&q->lock);
+        while (corto_mount_queue_size(this, q) >= this->policy.queue.max &&
+               !this->quit)
+        {
+            corto_cond_wait(&q->cond, &q->lock);
+        }
+        corto_mutex_unlock(&q->lock);
+    }
 
-            corto_unlock(this);
-        } while (size == this->policy.queue.max);
+done:
+    if (q) {
+        corto_mount_queue_release(q);
     }
 }
 
@@ -879,6 +1115,18 @@ corto_resultIter corto_mount_historyQuery(
     return result;
 }
 
+int64_t corto_mount_count(
+    corto_mount this,
+    corto_query *query)
+{
+    /* Mounts that can't count results without returning them return -1 */
+    if (!(this->policy.mask & CORTO_MOUNT_COUNT)) {
+        return -1;
+    }
+
+    return corto_mount_on_count(this, query);
+}
+
 int16_t corto_mount_resumeResult(
     corto_mount this,
     const char *parent,
@@ -1486,6 +1734,15 @@ corto_resultIter corto_mount_on_history_query_v(
     return CORTO_ITER_EMPTY;
 }
 
+int64_t corto_mount_on_count_v(
+    corto_mount this,
+    corto_query *query)
+{
+    CORTO_UNUSED(this);
+    CORTO_UNUSED(query);
+    return -1;
+}
+
 void corto_mount_on_history_batch_notify_v(
     corto_mount this,
     corto_subscriber_eventIter events)
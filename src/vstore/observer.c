@@ -4,6 +4,7 @@
 
 #include "src/lang/class.h"
 #include "src/store/object.h"
+#include "src/vstore/observer_index.h"
 
 /* Fluent request */
 typedef struct corto_observeRequest {
@@ -13,19 +14,12 @@ typedef struct corto_observeRequest {
     corto_dispatcher observable;
     corto_object dispatcher;
     corto_string type;
+    bool instanceOf;
     bool enabled;
+    uint32_t alignChunk;
     void (*callback)(corto_observer_event*);
 } corto_observeRequest;
 
-/* Thread local storage key for administration that keeps track for which observables notifications take place.
- * This key points to an element in a list keyed by threadId's for which notifications have taken place. Value
- * of this element is the observable being notified at the moment. When a listen\silence call needs to clean
- * memory it can look at this administration to see if it is in use. To prevent deadlocks, listen\silence calls
- * will not look at their own threadId, since this would indicate listen\silence is called from an observer being
- * notified. This key is created in corto_start. */
-/* TODO: when a thread exits, the corresponding element must be free'd again - use tls destructor function */
-extern corto_tls CORTO_KEY_OBSERVER_ADMIN;
-
 /* Administration that keeps track of listen operations for undefined instances.
  * These operations are temporarily stored in this admin and are evaluated &
  * removed from the admin when the object is defined */
@@ -112,65 +106,105 @@ void corto_observer_delayedAdminDefine(
     }
 }
 
-typedef struct corto_observerElement {
-    corto__observer ** observers;
-    bool free;
-} corto_observerElement;
-
-typedef struct corto_observerAdmin {
-    corto_thread id;
-    corto_observerElement stack[CORTO_MAX_NOTIFY_DEPTH];
-    corto_uint32 sp;
-    corto_object from;
-} corto_observerAdmin;
-static corto_observerAdmin observerAdmin[CORTO_MAX_THREADS];
-
-/* Assumption: no more notifications are in progress when the thread
- * exits */
-void corto_observerAdminFree(
-    void *admin)
+/* Release count on observer data, and the claim on its observer. Observer data
+ * is freed when no array (or aligner) uses it anymore. */
+static
+void corto_observerRelease(
+    corto__observer* observer)
 {
-    corto_uint32 i;
-    corto_thread self = corto_thread_self();
-
-    /* No actual memory is allocated in admin. This function just clears up the
-     * slot in the thread administration */
-    CORTO_UNUSED(admin);
-
-    for(i = 0; i < CORTO_MAX_THREADS; i++) {
-        if (observerAdmin[i].id && (observerAdmin[i].id == self)) {
-            /* Free up slot of this thread */
-            observerAdmin[i].id = 0;
-        }
+    corto_observer o = observer->observer;
+    if (!corto_adec(&observer->count)) {
+        corto_dealloc(observer);
     }
+    corto_release(o);
 }
 
-/* Free observer-array */
+/* Free observer-array. Every array holds a count on its observer data, and a
+ * claim on the observer, so that observers stay alive for notifications that
+ * still use a retired array. */
 static
 void corto_observersFree(
     corto__observer** observers)
 {
     corto__observer* observer;
     while((observer = *observers)) {
-        if (!corto_adec(&observer->count)) {
-            corto_dealloc(observer);
-        }
+        corto_observerRelease(observer);
         ++observers;
     }
 }
 
-/* There is a small chance that a thread simultaneously obtains a pointer
- * to an old observers-array, then gets scheduled out and this function in
- * another thread deletes that array. Although unlikely this scenario must be
- * addressed. */
+/* Observer arrays are preceded by a header that stores the index and the
+ * number of references to the array. The observable holds one reference until
+ * the array is replaced, notifications hold one while they iterate. */
+typedef struct corto_observersHeader {
+    corto_observer_index *index;
+    int32_t refcount;
+} corto_observersHeader;
+
+#define corto_observersHeader(observers)\
+    ((corto_observersHeader*)(observers) - 1)
+
+#define corto_observersIndex(observers)\
+    (corto_observersHeader(observers)->index)
+
+/* Free observer-array */
 static
 void corto_observersArrayFree(
     corto__observer** array)
 {
+    corto_observer_index_free(corto_observersIndex(array));
+    corto_observersFree(array);
+    corto_dealloc(corto_observersHeader(array));
+}
+
+/* Release reference to observer-array */
+static
+void corto_observersArrayRelease(
+    corto__observer** array)
+{
+    if (!corto_adec(&corto_observersHeader(array)->refcount)) {
+        corto_observersArrayFree(array);
+    }
+}
+
+/* Release the reference of the observable. Called by the epoch once no
+ * notification can still be claiming the array. */
+static
+void corto_observersArrayReleaseRetired(
+    void *ptr)
+{
+    corto_observersArrayRelease(ptr);
+}
+
+/* Retire observer-array that has been replaced. Notifications that read the
+ * array before it was replaced may still be claiming it, so the reference of
+ * the observable is released by the epoch when all of them have finished. */
+static
+void corto_observersArrayRetire(
+    corto__observer** array)
+{
+    if (array) {
+        corto_epoch_retire(array, corto_observersArrayReleaseRetired);
+    }
+}
+
+/* Claim observer-array of an observable. Only reading the array happens inside
+ * the epoch critical section, so observer callbacks, which may block, don't
+ * prevent retired arrays from being reclaimed. */
+static
+corto__observer** corto_observersArrayClaim(
+    corto__observer** volatile *ptr)
+{
+    corto__observer **array;
+
+    corto_epoch_enter();
+    array = *ptr;
     if (array) {
-        corto_observersFree(array);
-        corto_dealloc(&array[-1]);
+        corto_ainc(&corto_observersHeader(array)->refcount);
     }
+    corto_epoch_exit();
+
+    return array;
 }
 
 /* Copyout observers */
@@ -186,7 +220,8 @@ void corto_observersCopyOut(
     i = 0;
     while(corto_iter_hasNext(&iter)) {
         observers[i] = corto_iter_next(&iter);
-        observers[i]->count++;
+        corto_ainc(&observers[i]->count);
+        corto_claim(observers[i]->observer);
         i++;
     }
     observers[i] = NULL;
@@ -225,117 +260,86 @@ static
 corto__observer** corto_observersArrayNew(
     corto_ll list)
 {
+    corto_observersHeader *header;
     corto__observer** array;
 
-    array = corto_alloc((corto_ll_count(list) + 2) * sizeof(corto__observer*));
-    corto_observersCopyOut(list, &array[1]);
-
-    /* Observers start from the second element */
-    return &array[1];
-}
+    header = corto_alloc(sizeof(corto_observersHeader) +
+        (corto_ll_count(list) + 1) * sizeof(corto__observer*));
+    header->refcount = 1;
 
-static
-struct corto_observerAdmin* corto_observerAdminGet(void)
-{
-    corto_observerAdmin *admin = corto_tls_get(CORTO_KEY_OBSERVER_ADMIN);
-    if (!admin) {
-        corto_thread thr = corto_thread_self();
-        corto_uint32 i;
-        do {
-            i = 0;
+    /* Observers start after the header */
+    array = (corto__observer**)(header + 1);
+    corto_observersCopyOut(list, array);
+    header->index = corto_observer_index_new(array);
 
-             /* Find a free slot for thread in administration */
-            while(observerAdmin[i].id) {
-                i++;
-                if (i >= CORTO_MAX_THREADS) {
-                    corto_critical(
-                        "maximum number of supported threads reached! (%d)",
-                        CORTO_MAX_THREADS);
-                }
-            }
-        } while(!corto_cas(&observerAdmin[i].id,0,thr));
-        admin = &observerAdmin[i];
-        admin->sp = 0;
-        corto_tls_set(CORTO_KEY_OBSERVER_ADMIN, admin);
-    }
-    return admin;
+    return array;
 }
 
-/* Push observer-array to thread administration. Rather than passing the array
- * pass the address of the array so that setting the administration can be done
- * atomic. */
+/* Incremented by two whenever observers are added or removed, so the lowest
+ * bit can store the cached summary in corto__observable::observersAbove. Starts
+ * at two so zero-initialized summaries are never valid. */
+static volatile uint32_t corto_observerGeneration = 2;
+
 static
-corto__observer** corto_observersPush(
-    corto_observerAdmin *admin,
-    corto__observer**  *observers)
+void corto_observersChanged(void)
 {
-    corto__observer** result;
-
-    result = admin->stack[admin->sp].observers = *observers;
-    if (result) {
-        admin->stack[admin->sp++].free = FALSE;
-    }
-
-    return result;
+    __sync_fetch_and_add(&corto_observerGeneration, 2);
 }
 
 static
-bool corto_observersPop(
-    corto_observerAdmin *admin)
+bool corto_observersNotEmpty(
+    corto__observer** observers)
 {
-    return admin->stack[--admin->sp].free;
+    return observers && *observers;
 }
 
+/* Returns whether object or one of its parents has observers that can receive
+ * notifications for objects in its scope. The result is cached in the
+ * observable header of every object visited, so notifications in hierarchies
+ * without observers stop bubbling at the first parent, instead of walking up to
+ * root. A change to any observer invalidates all cached results. */
 static
-bool corto_observersWaitForUnused(
-    corto__observer** observers)
+bool corto_observersAbove(
+    corto_object o,
+    uint32_t generation)
 {
-    corto_thread self = corto_thread_self();
-    corto_uint32 i, j;
-    bool inUse, freeArray = TRUE; /* Initialization to satisfy the compiler */
-
-    if (!observers) {
-        return FALSE;
-    }
-
-    /* Spinning loop which waits as long as an observer array is being used
-     * in a notification by any of the running threads. */
-    do {
-        inUse = FALSE;
-        for(i = 0; i < CORTO_MAX_THREADS; i++) {
-            if (observerAdmin[i].id) {
-                /* Check whether observer array is in use by threads other than
-                 * myself */
-                if ((observerAdmin[i].id != self)) {
-                    for(j = 0; j < observerAdmin[i].sp; j++) {
-                        if (observerAdmin[i].stack[j].observers == observers) {
-                            inUse = TRUE; /* Array is found, so keep waiting */
-                        }
-                    }
+    corto__observable *_o = corto_hdr_observable(corto_hdr(o));
+    bool result = false;
 
-                /* Check whether observer array is in use by my own thread */
-                } else {
-                    freeArray = TRUE;
-                    for(j = 0; j < observerAdmin[i].sp; j++) {
-                        /* The array is in use by my own thread so I can't keep
-                         * spinning. Notify the observing function to free the
-                         * array */
-                        if (observerAdmin[i].stack[j].observers == observers) {
-                            /* Signal notification routine to free the array */
-                            observerAdmin[i].stack[j].free = TRUE;
-                            /* Since array is still in use by me don't free */
-                            freeArray = FALSE;
-                            break;
-                        }
-                    }
-                }
-            }
+    if (_o) {
+        uint32_t cached = _o->observersAbove;
+        if ((cached & ~1) == generation) {
+            return cached & 1;
+        }
+
+        /* Order the load of the generation before the loads of the arrays, so
+         * a summary computed for a generation includes all arrays published
+         * before that generation */
+        __sync_synchronize();
+
+        /* Include onSelf observers, which are notified for orphans */
+        result = corto_observersNotEmpty(_o->onChildArray) ||
+                 corto_observersNotEmpty(_o->onSelfArray);
+    }
+
+    if (!result) {
+        corto_object parent = corto_parentof(o);
+        if (parent) {
+            result = corto_observersAbove(parent, generation);
         }
-    } while(inUse);
+    }
+
+    if (_o) {
+        _o->observersAbove = generation | result;
+    }
 
-    return freeArray;
+    return result;
 }
 
+/* See mount.c */
+bool corto_mount_hasSubscriptionsFor(
+    const char *path);
+
 static
 void corto_updateSubscriptionById(
     char *id)
@@ -362,25 +366,34 @@ void corto_updateSubscriptions(
     /* If there are no subscribers, then there are no mounts interested in
      * subscriptions */
 
-    if (corto_subscriber_admin.count &&
+    if ((observerMask & CORTO_ON_TREE) &&
+        (mask & (CORTO_DEFINE|CORTO_DELETE)) &&
+        corto_subscriber_admin.count &&
         corto_check_attr(observable, CORTO_ATTR_NAMED))
     {
-        if (observerMask & CORTO_ON_TREE) {
-            corto_log_push("update-subscription");
-
-            if (mask == CORTO_DEFINE) {
-                corto_id id;
-                corto_fullpath(id, observable);
-                strcat(id, "/");
-                corto_updateSubscriptionById(id);
-            } else if (mask == CORTO_DELETE) {
-                corto_id id;
-                corto_fullpath(id, observable);
-                corto_select("//").from(id).vstore(false).unsubscribe();
-            }
+        /* Only select when a mount that receives subscriptions is mounted on
+         * the path of the object, on one of its parents or in its tree. Other
+         * mounts can't be affected, and creating many objects under a tree
+         * observer would otherwise run a select for every object. */
+        const char *path = corto_pathof(observable);
+        if (!corto_mount_hasSubscriptionsFor(path)) {
+            return;
+        }
 
-            corto_log_pop();
+        corto_log_push("update-subscription");
+
+        if (mask == CORTO_DEFINE) {
+            corto_id id;
+            strcpy(id, path);
+            strcat(id, "/");
+            corto_updateSubscriptionById(id);
+        } else if (mask == CORTO_DELETE) {
+            corto_id id;
+            strcpy(id, path);
+            corto_select("//").from(id).vstore(false).unsubscribe();
         }
+
+        corto_log_pop();
     }
 }
 
@@ -396,7 +409,6 @@ void corto_notify_observer(
     corto_eventMask observerMask = observer->mask;
 
     if ((mask & observerMask) &&
-        (!observer->type || (observer->type == corto_typeof(observable))) &&
         (!depth || (observerMask & CORTO_ON_TREE)))
     {
         corto_object this = data->_this;
@@ -426,7 +438,6 @@ void corto_notify_observer_cdecl(
     corto_eventMask observerMask = observer->mask;
 
     if ((mask & observerMask) &&
-        (!observer->type || (observer->type == corto_typeof(observable))) &&
         (!depth || (observerMask & CORTO_ON_TREE)))
     {
         corto_object this = data->_this;
@@ -456,60 +467,102 @@ void corto_notify_observer_dispatch(
     corto_eventMask observerMask = observer->mask;
 
     if ((mask & observerMask) &&
-        (!observer->type || (observer->type == corto_typeof(observable))) &&
         (!depth || (observerMask & CORTO_ON_TREE)))
     {
         corto_dispatcher dispatcher = observer->dispatcher;
 
         if (!data->_this || (data->_this != source)) {
-            corto_observer_event *event =
-                corto(CORTO_DECLARE, {
-                    .type = corto_observer_event_o,
-                    .attrs = -1
-                });
-
-            corto_set_ref(&event->observer, observer);
-            corto_set_ref(&event->instance, data->_this);
-            corto_set_ref(&event->data, observable);
-            corto_set_ref(&event->source, source);
-            event->event = mask;
-
-            /* Set thread handle so the dispatcher can figure out whether a
-             * readlock is needed */
-            event->thread = corto_thread_self();
+            corto_observer_event *event = corto_observer_event_new(
+                observer, data->_this, observable, source, mask);
             corto_dispatcher_post(dispatcher, corto_event(event));
         }
     }
 }
 
+static
+void corto_notify_observerData(
+    corto__observer *data,
+    corto_object observable,
+    corto_object source,
+    corto_uint32 mask,
+    int depth)
+{
+    switch(data->notifyKind) {
+    case 0:
+        corto_notify_observer(data, observable, source, mask, depth);
+        break;
+    case 1:
+        corto_notify_observer_cdecl(data, observable, source, mask, depth);
+        break;
+    case 2:
+        corto_notify_observer_dispatch(data, observable, source, mask, depth);
+        break;
+    }
+}
+
+static
+void corto_observerAligner_mark(
+    corto_observerAligner *a,
+    corto_object o);
+
 static
 void corto_notify_observers_intern(
     corto__observer** observers,
     corto_object observable,
     corto_uint32 mask,
-    int depth)
+    int depth,
+    bool *subscriptionsUpdated)
 {
-    corto__observer* data;
+    corto_observer_index *index = corto_observersIndex(observers);
+    corto_type t = corto_typeof(observable);
+    uint32_t i;
+
+    /* Select the observers with a matching mask and type filter */
+    uint64_t groups = corto_observer_index_match(index, t, mask, depth);
+    if (!groups && !(index->mask & CORTO_ON_TREE)) {
+        return;
+    }
 
     corto_object prev = corto_set_source(NULL);
-    while((data = *observers)) {
-        /* Update subscriptions for tree observers */
-        corto_updateSubscriptions(data->observer->mask, mask, observable);
 
-        switch(data->notifyKind) {
-        case 0:
-            corto_notify_observer(data, observable, prev, mask, depth);
-            break;
-        case 1:
-            corto_notify_observer_cdecl(data, observable, prev, mask, depth);
-            break;
-        case 2:
-            corto_notify_observer_dispatch(data, observable, prev, mask, depth);
-            break;
+    /* Update subscriptions for tree observers. This runs a select, so it must
+     * not be called inside an epoch critical section. Subscriptions only
+     * depend on the observable, so they are updated once per notification. */
+    if (!*subscriptionsUpdated && (index->mask & CORTO_ON_TREE)) {
+        corto_updateSubscriptions(index->mask, mask, observable);
+        *subscriptionsUpdated = true;
+    }
+
+    for (i = 0; groups && i < index->count; i ++) {
+        corto__observer *data = observers[i];
+        uint8_t g = index->groupOf[i];
+
+        if (!(groups & (1ull << g))) {
+            continue;
+        }
+
+        if (index->groups[g].overflow &&
+            !corto_observer_index_matchType(data->observer, t))
+        {
+            continue;
         }
 
-        observers++;
+        /* Let aligner know it shouldn't align object. This waits for the
+         * aligner if it is delivering the object, so the live event is
+         * delivered after it. A stopped aligner is retired, so it is only
+         * accessed inside a critical section. */
+        if (data->aligner && (mask & (CORTO_DECLARE|CORTO_DEFINE|CORTO_DELETE))) {
+            corto_epoch_enter();
+            corto_observerAligner *aligner = data->aligner;
+            if (aligner) {
+                corto_observerAligner_mark(aligner, observable);
+            }
+            corto_epoch_exit();
+        }
+
+        corto_notify_observerData(data, observable, prev, mask, depth);
     }
+
     corto_set_source(prev);
 }
 
@@ -533,47 +586,52 @@ int16_t corto_notify(corto_object observable, corto_uint32 mask) {
     if (__o->align.attrs.observable) {
         _o = CORTO_OFFSET(__o, -sizeof(corto__observable));
     }
-    corto_observerAdmin *admin = corto_observerAdminGet();
 
-    /* Notify direct observers */
+    uint32_t generation = corto_observerGeneration;
+    bool subscriptionsUpdated = false;
+
+    /* Observer arrays are claimed without locking, and are released after
+     * their observers have been notified */
     if (_o) {
         /* Notify observers of observable */
         corto__observer** observers =
-            corto_observersPush(admin, &_o->onSelfArray);
+            corto_observersArrayClaim(&_o->onSelfArray);
         if (observers) {
-            corto_notify_observers_intern(observers, observable, mask, depth);
-            if (corto_observersPop(admin)) {
-                corto_observersArrayFree(observers);
-            }
+            corto_notify_observers_intern(
+                observers, observable, mask, depth, &subscriptionsUpdated);
+            corto_observersArrayRelease(observers);
         }
     }
 
     /* Bubble event up in hierarchy */
     parent = observable;
     while((parent = corto_parentof(parent))) {
+        /* Stop when none of the remaining parents has observers */
+        if (!corto_observersAbove(parent, generation)) {
+            break;
+        }
+
         corto__observable *_parent =
           corto_hdr_observable(CORTO_OFFSET(parent, -sizeof(corto__object)));
 
         if (_parent) {
             if (!isOrphan) {
                 corto__observer** observers =
-                    corto_observersPush(admin, &_parent->onChildArray);
+                    corto_observersArrayClaim(&_parent->onChildArray);
                 if (observers) {
                     corto_notify_observers_intern(
-                        observers, observable, mask, depth);
-                    if (corto_observersPop(admin)) {
-                        corto_observersArrayFree(observers);
-                    }
+                        observers, observable, mask, depth,
+                        &subscriptionsUpdated);
+                    corto_observersArrayRelease(observers);
                 }
             } else {
                 corto__observer** observers =
-                    corto_observersPush(admin, &_parent->onSelfArray);
+                    corto_observersArrayClaim(&_parent->onSelfArray);
                 if (observers) {
                     corto_notify_observers_intern(
-                        observers, parent, mask, depth);
-                    if (corto_observersPop(admin)) {
-                        corto_observersArrayFree(observers);
-                    }
+                        observers, parent, mask, depth,
+                        &subscriptionsUpdated);
+                    corto_observersArrayRelease(observers);
                 }
             }
         }
@@ -624,14 +682,16 @@ int corto_observerAlignScope(
     corto_assert_object(o);
 
     corto_observerAlignData *data = userData;
+    bool match = corto_observer_index_matchType(
+        data->observer->observer, corto_typeof(o));
 
-    if ((data->mask & CORTO_DECLARE) &&
+    if (match && (data->mask & CORTO_DECLARE) &&
         (data->mask & (CORTO_ON_SCOPE|CORTO_ON_TREE)))
     {
         corto_notify_observer(data->observer, o, o, CORTO_DECLARE, data->depth);
     }
 
-    if ((data->mask & CORTO_DEFINE) &&
+    if (match && (data->mask & CORTO_DEFINE) &&
         (data->mask & (CORTO_ON_SCOPE|CORTO_ON_TREE)) &&
         corto_check_state(o, CORTO_VALID))
     {
@@ -655,6 +715,10 @@ int corto_observerAlignScope(
     }
 }
 
+static
+void corto_observerAligner_start(
+    corto_observerAligner *a);
+
 void corto_observerAlign(
     corto_object observable,
     corto__observer *observer,
@@ -671,7 +735,10 @@ void corto_observerAlign(
     walkData.mask = mask;
     walkData.depth = 0;
 
-    if (corto_check_attr(observable, CORTO_ATTR_PERSISTENT)) {
+    if (corto_check_attr(observable, CORTO_ATTR_PERSISTENT) &&
+        corto_observer_index_matchType(
+            observer->observer, corto_typeof(observable)))
+    {
         if ((mask & CORTO_DECLARE) && (mask & CORTO_ON_SELF))
         {
             corto_notify_observer(
@@ -686,6 +753,12 @@ void corto_observerAlign(
         }
     }
 
+    /* Align children asynchronously if observer has an aligner */
+    if (observer->aligner) {
+        corto_observerAligner_start(observer->aligner);
+        return;
+    }
+
     scope = corto_scope_claim(observable);
     corto_int32 i;
     for (i = 0; i < scope.length; i++) {
@@ -694,6 +767,346 @@ void corto_observerAlign(
     corto_scope_release(scope);
 }
 
+/* Observers with an alignChunk are aligned asynchronously by an aligner
+ * thread, so that observing a large tree returns immediately. The aligner
+ * walks the tree depth first, and takes at most alignChunk objects from a scope
+ * at a time. It holds the scope lock only while taking a chunk, and keeps a
+ * claim on the objects of the chunk and on the scopes on its stack, rather
+ * than on every object in the tree.
+ *
+ * Iterators of scopes on the stack are persistent. When a scope changes while
+ * it is not locked, the iterator is obtained again and moved past the last id
+ * that was visited, like corto_select does.
+ *
+ * The observer already receives events while it is being aligned. Objects that
+ * are declared, defined or deleted during alignment are recorded by the
+ * notifier, and skipped by the aligner, so that the observer never receives a
+ * DECLARE or DEFINE from alignment after (or in addition to) the live event.
+ * The aligner holds the lock of the seen set while it checks and aligns an
+ * object, so a notifier that records the object waits until alignment of the
+ * object has been delivered, and delivers its live event after it.
+ *
+ * The aligner holds a count on the observer data and a claim on the observer
+ * and observable while it runs, so it doesn't need an epoch critical section
+ * to invoke the observer. */
+
+typedef struct corto_observerAlignFrame {
+    corto_object o;
+    jsw_rbtrav_t trav;
+    corto_iter iter;
+    bool started;
+    corto_id lastKey;
+} corto_observerAlignFrame;
+
+struct corto_observerAligner {
+    corto__observer *observer;
+    corto_object observable;
+    int mask;
+    uint32_t chunk;
+    corto_thread thread;
+    volatile bool quit;
+    bool detach; /* Stopped by a callback on the aligner thread */
+    volatile corto_thread owner; /* Aligner thread while it holds lock */
+
+    corto_observerAlignFrame *stack;
+    int32_t sp;
+    int32_t size;
+
+    /* Set of objects that received events while aligning, guarded by lock */
+    corto_mutex_s lock;
+    corto_object *seen;
+    uint32_t seenCount;
+    uint32_t seenSize; /* Zero or a power of two */
+};
+
+#define CORTO_OBSERVER_ALIGNER_HASH(o) ((uint32_t)((uintptr_t)(o) >> 4) * 2654435761u)
+
+static
+void corto_observerAligner_insert(
+    corto_observerAligner *a,
+    corto_object o)
+{
+    uint32_t mask = a->seenSize - 1;
+    uint32_t slot = CORTO_OBSERVER_ALIGNER_HASH(o) & mask;
+    while (a->seen[slot]) {
+        if (a->seen[slot] == o) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    a->seen[slot] = o;
+    a->seenCount ++;
+}
+
+/* Called by notifier, for events that affect alignment of an object. Returns
+ * after the aligner has finished delivering the object, if it was aligning it.
+ * The lock is already held if the event is raised by an aligned callback. */
+static
+void corto_observerAligner_mark(
+    corto_observerAligner *a,
+    corto_object o)
+{
+    bool locked = a->owner != corto_thread_self();
+    if (locked) {
+        corto_mutex_lock(&a->lock);
+    }
+    if ((a->seenCount + 1) * 2 > a->seenSize) {
+        corto_object *old = a->seen;
+        uint32_t i, oldSize = a->seenSize;
+        a->seenSize = oldSize ? oldSize * 2 : 64;
+        a->seen = corto_calloc(a->seenSize * sizeof(corto_object));
+        a->seenCount = 0;
+        for (i = 0; i < oldSize; i ++) {
+            if (old[i]) {
+                corto_observerAligner_insert(a, old[i]);
+            }
+        }
+        corto_dealloc(old);
+    }
+    corto_observerAligner_insert(a, o);
+    if (locked) {
+        corto_mutex_unlock(&a->lock);
+    }
+}
+
+/* Must be called while holding the lock */
+static
+bool corto_observerAligner_seen(
+    corto_observerAligner *a,
+    corto_object o)
+{
+    bool result = false;
+    if (a->seenCount) {
+        uint32_t mask = a->seenSize - 1;
+        uint32_t slot = CORTO_OBSERVER_ALIGNER_HASH(o) & mask;
+        while (a->seen[slot]) {
+            if (a->seen[slot] == o) {
+                result = true;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    return result;
+}
+
+static
+void corto_observerAligner_push(
+    corto_observerAligner *a,
+    corto_object o)
+{
+    if (a->sp == a->size) {
+        a->size = a->size ? a->size * 2 : 8;
+        a->stack = corto_realloc(
+            a->stack, a->size * sizeof(corto_observerAlignFrame));
+    }
+
+    corto_observerAlignFrame *frame = &a->stack[a->sp ++];
+    frame->o = o;
+    frame->started = false;
+    frame->lastKey[0] = '\0';
+}
+
+/* Take up to chunk objects from the scope on top of the stack. Stops after an
+ * object with a scope when aligning a tree, so that the object can be pushed
+ * on the stack and the walk remains depth first. */
+static
+uint32_t corto_observerAligner_take(
+    corto_observerAligner *a,
+    corto_object *buffer)
+{
+    corto_observerAlignFrame *frame = &a->stack[a->sp - 1];
+    uint32_t count = 0;
+
+    corto_scope_lock(frame->o);
+    corto_rb scope = corto_scopeof(frame->o);
+    if (scope) {
+        if (!frame->started) {
+            frame->iter = _corto_rb_iter(scope, &frame->trav);
+            frame->started = true;
+        } else if (corto_rb_iterChanged(&frame->iter)) {
+            frame->iter = _corto_rb_iter(scope, &frame->trav);
+            while (corto_iter_hasNext(&frame->iter)) {
+                corto_object o = corto_iter_next(&frame->iter);
+                if (stricmp(corto_idof(o), frame->lastKey) > 0) {
+                    buffer[count ++] = o;
+                    break;
+                }
+            }
+        }
+
+        while (count < a->chunk && corto_iter_hasNext(&frame->iter)) {
+            if (count && (a->mask & CORTO_ON_TREE) &&
+                corto_scopeof(buffer[count - 1]))
+            {
+                break;
+            }
+            buffer[count ++] = corto_iter_next(&frame->iter);
+        }
+
+        uint32_t i;
+        for (i = 0; i < count; i ++) {
+            corto_claim(buffer[i]);
+        }
+        if (count) {
+            strcpy(frame->lastKey, corto_idof(buffer[count - 1]));
+        }
+    }
+    corto_scope_unlock(frame->o);
+
+    return count;
+}
+
+static
+void corto_observerAligner_notify(
+    corto_observerAligner *a,
+    corto_object o)
+{
+    int depth = a->sp - 1;
+
+    /* Check and deliver while holding the lock, so live events for the object
+     * are delivered after the aligned events */
+    corto_mutex_lock(&a->lock);
+    a->owner = corto_thread_self();
+
+    /* Objects with live events, and objects that have been deleted since they
+     * were taken from their scope, are not aligned */
+    if (!a->quit &&
+        !corto_observerAligner_seen(a, o) &&
+        !corto_check_state(o, CORTO_DELETED) &&
+        corto_observer_index_matchType(a->observer->observer, corto_typeof(o)))
+    {
+        if (a->mask & CORTO_DECLARE) {
+            corto_notify_observerData(a->observer, o, o, CORTO_DECLARE, depth);
+        }
+
+        if ((a->mask & CORTO_DEFINE) && corto_check_state(o, CORTO_VALID)) {
+            corto_notify_observerData(a->observer, o, o, CORTO_DEFINE, depth);
+        }
+    }
+
+    a->owner = 0;
+    corto_mutex_unlock(&a->lock);
+}
+
+static
+void corto_observerAligner_free(
+    void *ptr)
+{
+    corto_observerAligner *a = ptr;
+    corto_mutex_free(&a->lock);
+    corto_dealloc(a->seen);
+    corto_dealloc(a->stack);
+    corto_dealloc(a);
+}
+
+static
+void* corto_observerAligner_run(
+    void *arg)
+{
+    corto_observerAligner *a = arg;
+    corto_object *buffer = corto_alloc(a->chunk * sizeof(corto_object));
+
+    /* Claim on observable is taken by corto_observerAligner_start */
+    corto_observerAligner_push(a, a->observable);
+
+    while (a->sp && !a->quit) {
+        uint32_t i, count = corto_observerAligner_take(a, buffer);
+        if (!count) {
+            corto_release(a->stack[-- a->sp].o);
+            continue;
+        }
+
+        for (i = 0; i < count; i ++) {
+            corto_observerAligner_notify(a, buffer[i]);
+        }
+
+        for (i = 0; i < count; i ++) {
+            if ((a->mask & CORTO_ON_TREE) && !a->quit &&
+                !corto_check_state(buffer[i], CORTO_DELETED) &&
+                corto_scopeof(buffer[i]))
+            {
+                /* Claim is transferred to the stack */
+                corto_observerAligner_push(a, buffer[i]);
+            } else {
+                corto_release(buffer[i]);
+            }
+        }
+    }
+
+    /* Release observer data before the observable, as releasing the
+     * observable can deinitialize its observers */
+    corto_observerRelease(a->observer);
+
+    while (a->sp) {
+        corto_release(a->stack[-- a->sp].o);
+    }
+
+    corto_dealloc(buffer);
+
+    /* Nobody joins a thread that stopped itself, so it frees the aligner */
+    if (a->detach) {
+        corto_thread_detach(corto_thread_self());
+        corto_epoch_retire(a, corto_observerAligner_free);
+    }
+
+    return NULL;
+}
+
+/* Aligner is created before the observer is added to the observable, so that
+ * no events are missed by the aligner. */
+static
+corto_observerAligner* corto_observerAligner_new(
+    corto_object observable,
+    corto__observer *observer,
+    int mask,
+    uint32_t chunk)
+{
+    corto_observerAligner *a = corto_calloc(sizeof(corto_observerAligner));
+    a->observer = observer;
+    a->observable = observable;
+    a->mask = mask;
+    a->chunk = chunk;
+    corto_mutex_new(&a->lock);
+    return a;
+}
+
+/* Called after the observer data is added to the observable, so the aligner
+ * can take a count on it */
+static
+void corto_observerAligner_start(
+    corto_observerAligner *a)
+{
+    corto_ainc(&a->observer->count);
+    corto_claim(a->observer->observer);
+    corto_claim(a->observable);
+
+    a->thread = corto_thread_new(corto_observerAligner_run, a);
+    if (!a->thread) {
+        corto_observerRelease(a->observer);
+        corto_release(a->observable);
+    }
+}
+
+/* Stop aligner when observer unobserves. Notifications in progress may still
+ * access the aligner, so it is retired instead of freed. When an observer
+ * unobserves from a callback that is invoked by the aligner, the thread can't
+ * be joined, and retires the aligner itself when it quits. */
+static
+void corto_observerAligner_stop(
+    corto_observerAligner *a)
+{
+    a->quit = true;
+    if (!a->thread) {
+        corto_epoch_retire(a, corto_observerAligner_free);
+    } else if (a->thread != corto_thread_self()) {
+        corto_thread_join(a->thread, NULL);
+        corto_epoch_retire(a, corto_observerAligner_free);
+    } else {
+        a->detach = true;
+    }
+}
+
 
 static
 corto_observe__fluent corto_observe__fluentGet(void);
@@ -709,6 +1122,8 @@ corto_observer corto_observeObserve(
     corto_set_ref(&result->instance, r->instance);
     corto_set_ref(&result->dispatcher, r->dispatcher);
     result->enabled = r->enabled;
+    result->alignChunk = r->alignChunk;
+    result->instanceOf = r->instanceOf;
     ((corto_function)result)->fptr = (corto_word)r->callback;
     ((corto_function)result)->kind = CORTO_PROCEDURE_CDECL;
     if (r->type) {
@@ -756,6 +1171,18 @@ corto_observe__fluent corto_observeType(
     return corto_observe__fluentGet();
 }
 
+static
+corto_observe__fluent corto_observeInstanceof(
+    corto_string type)
+{
+    corto_observeRequest *request = corto_tls_get(CORTO_KEY_FLUENT);
+    if (request) {
+        request->type = type;
+        request->instanceOf = TRUE;
+    }
+    return corto_observe__fluentGet();
+}
+
 static
 corto_observe__fluent corto_observeDisabled(void)
 {
@@ -777,6 +1204,17 @@ corto_observe__fluent corto_observeDispatcher(
     return corto_observe__fluentGet();
 }
 
+static
+corto_observe__fluent corto_observeAlignChunked(
+    uint32_t chunk)
+{
+    corto_observeRequest *request = corto_tls_get(CORTO_KEY_FLUENT);
+    if (request) {
+        request->alignChunk = chunk;
+    }
+    return corto_observe__fluentGet();
+}
+
 static
 corto_observer corto_observeCallback(
     void (*callback)(corto_observer_event*))
@@ -801,8 +1239,10 @@ corto_observe__fluent corto_observe__fluentGet(void)
     result.callback = corto_observeCallback;
     result.instance = corto_observeInstance;
     result.type = corto_observeType;
+    result.instanceof = corto_observeInstanceof;
     result.dispatcher = corto_observeDispatcher;
     result.disabled = corto_observeDisabled;
+    result.align_chunked = corto_observeAlignChunked;
     return result;
 }
 
@@ -1023,6 +1463,14 @@ int16_t corto_observer_observe(
     _observerData->observer = this;
     _observerData->_this = instance;
     _observerData->count = 0;
+    _observerData->aligner = NULL;
+    if (this->alignChunk &&
+        (mask & (CORTO_DECLARE|CORTO_DEFINE)) &&
+        (mask & (CORTO_ON_SCOPE|CORTO_ON_TREE)))
+    {
+        _observerData->aligner = corto_observerAligner_new(
+            observable, _observerData, mask, this->alignChunk);
+    }
     if (this->dispatcher) {
         _observerData->notifyKind = 2;
     } else if (corto_function(this)->kind == CORTO_PROCEDURE_CDECL) {
@@ -1046,7 +1494,9 @@ int16_t corto_observer_observe(
             /* Build new observer array. This array can be accessed without
              * locking and is faster than walking the linked list. */
             oldSelfArray = _o->onSelfArray;
-            _o->onSelfArray = corto_observersArrayNew(_o->onSelf);
+            corto_epoch_publish(
+                &_o->onSelfArray, corto_observersArrayNew(_o->onSelf));
+            corto_observersChanged();
         }
         if (corto_rwmutex_unlock(&_o->align.selfLock)) {
             goto error;
@@ -1069,7 +1519,9 @@ int16_t corto_observer_observe(
             /* Build new observer array. This array can be accessed without
              * locking and is faster than walking a linked list. */
             oldChildArray = _o->onChildArray;
-            _o->onChildArray = corto_observersArrayNew(_o->onChild);
+            corto_epoch_publish(
+                &_o->onChildArray, corto_observersArrayNew(_o->onChild));
+            corto_observersChanged();
         }
         if (corto_rwmutex_unlock(&_o->align.selfLock)) {
             goto error;
@@ -1077,6 +1529,9 @@ int16_t corto_observer_observe(
     }
 
     if (!added) {
+        if (_observerData->aligner) {
+            corto_observerAligner_free(_observerData->aligner);
+        }
         corto_dealloc(_observerData);
     } else {
         /* If observer is subscribed to declare/define events, align observer
@@ -1114,35 +1569,11 @@ int16_t corto_observer_observe(
         }
     }
 
-    /* From this point onwards the old observer arrays are no longer accessible.
-     * However, since notifications can still be in progress these arrays can't
-     * be deleted yet. Therefore wait until the arrays are no longer being
-     * used.
-     *
-     * The administration where this information is stored is not protected by
-     * locking so that notifying objects can remain lock-free. There is however
-     * a slight chance that a notification pushed the old array to the
-     * administration but that this change is not yet visible. In this case the
-     * functions below will assume the array is unused, which is incorrect. The
-     * chance of this happening is extremely slim as this scenario illustrates:
-     *
-     * notify: push observable array
-     * notify: call observers...
-     * listen: add observer (build new observable array)
-     * listen: waitForUnused <- due to out of order execution this thread
-     *                          can in theory not have seen the push yet.
-     *
-     * To be absolutely sure that the observed administration is up to date a
-     * memory barrier is required here. A simple mutex will not do since this
-     * would encumber the notifications too much.
-     */
-
-    if (corto_observersWaitForUnused(oldSelfArray)) {
-        corto_observersArrayFree(oldSelfArray);
-    }
-    if (corto_observersWaitForUnused(oldChildArray)) {
-        corto_observersArrayFree(oldChildArray);
-    }
+    /* From this point onwards the old observer arrays are no longer accessible
+     * to new notifications. Notifications that are still in progress may be
+     * using them, so they are retired instead of deleted. */
+    corto_observersArrayRetire(oldSelfArray);
+    corto_observersArrayRetire(oldChildArray);
 
     /* Ensure that observer isn't deleted before instance unsubscribes */
     corto_claim(this);
@@ -1243,12 +1674,13 @@ int16_t corto_observer_unobserve(
             observerData = corto_observerFind(_o->onSelf, this, instance);
             if (observerData) {
                 corto_ll_remove(_o->onSelf, observerData);
-                observerData->count--;
                 removed = TRUE;
 
                 /* Build new observer array */
                 oldSelfArray = _o->onSelfArray;
-                _o->onSelfArray = corto_observersArrayNew(_o->onSelf);
+                corto_epoch_publish(
+                    &_o->onSelfArray, corto_observersArrayNew(_o->onSelf));
+                corto_observersChanged();
             }
             if (corto_rwmutex_unlock(&_o->align.selfLock)) {
                 goto error;
@@ -1264,12 +1696,14 @@ int16_t corto_observer_unobserve(
                 observerData = corto_observerFind(_o->onChild, this, instance);
                 if (observerData) {
                     corto_ll_remove(_o->onChild, observerData);
-                    observerData->count--;
                     removed = TRUE;
 
                     /* Build new observer array */
                     oldChildArray = _o->onChildArray;
-                    _o->onChildArray = corto_observersArrayNew(_o->onChild);
+                    corto_epoch_publish(
+                        &_o->onChildArray,
+                        corto_observersArrayNew(_o->onChild));
+                    corto_observersChanged();
                 }
                 if (corto_rwmutex_unlock(&_o->align.selfLock)) {
                     goto error;
@@ -1286,6 +1720,12 @@ int16_t corto_observer_unobserve(
         goto error;
     }
 
+    if (removed && observerData->aligner) {
+        corto_observerAligner *aligner = observerData->aligner;
+        observerData->aligner = NULL;
+        corto_observerAligner_stop(aligner);
+    }
+
     if (removed) {
         this->active --;
         if (!this->active) {
@@ -1305,14 +1745,8 @@ int16_t corto_observer_unobserve(
     }
 
     /* See comments in observe */
-    /*__atomic_thread_fence (__ATOMIC_SEQ_CST);*/
-
-    if (corto_observersWaitForUnused(oldSelfArray)) {
-        corto_observersArrayFree(oldSelfArray);
-    }
-    if (corto_observersWaitForUnused(oldChildArray)) {
-        corto_observersArrayFree(oldChildArray);
-    }
+    corto_observersArrayRetire(oldSelfArray);
+    corto_observersArrayRetire(oldChildArray);
 
     /*if (observerData) {
         TODO: corto_dealloc(observerData);
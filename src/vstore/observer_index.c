@@ -0,0 +1,371 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <corto/corto.h>
+#include "src/store/object.h"
+#include "src/store/epoch.h"
+#include "src/vstore/observer_index.h"
+
+/* Ancestor bitset of a type, see observer_index.h */
+typedef struct corto_observer_index_ancestors {
+    corto_type type;
+    uint64_t bits;
+} corto_observer_index_ancestors;
+
+/* Open addressing hash table, which is not modified once it is published */
+typedef struct corto_observer_index_table {
+    uint32_t size; /* Power of two */
+    uint32_t count;
+    corto_observer_index_ancestors entries[];
+} corto_observer_index_table;
+
+#define CORTO_OBSERVER_INDEX_TABLE_SIZE (16)
+
+#define CORTO_OBSERVER_INDEX_HASH(t) ((uint32_t)((uintptr_t)(t) >> 4) * 2654435761u)
+
+static corto_mutex_s corto_observer_index_lock = CORTO_MUTEX_INIT;
+
+/* Types that have been assigned a bit, the position is the bit */
+static corto_type corto_observer_index_types[CORTO_OBSERVER_INDEX_MAX_GROUPS];
+
+/* Read by notifications without locking */
+static corto_observer_index_table * volatile corto_observer_index_ancestorTable;
+
+static
+void corto_observer_index_dealloc(
+    void *ptr)
+{
+    corto_dealloc(ptr);
+}
+
+/* Replace the table of ancestor bitsets. Must be called with lock. */
+static
+void corto_observer_index_tableSet(
+    corto_observer_index_table *table)
+{
+    corto_observer_index_table *old = corto_observer_index_ancestorTable;
+    corto_epoch_publish(&corto_observer_index_ancestorTable, table);
+    if (old) {
+        corto_epoch_retire(old, corto_observer_index_dealloc);
+    }
+}
+
+static
+void corto_observer_index_tableInsert(
+    corto_observer_index_table *table,
+    corto_type type,
+    uint64_t bits)
+{
+    uint32_t mask = table->size - 1;
+    uint32_t slot = CORTO_OBSERVER_INDEX_HASH(type) & mask;
+
+    while (table->entries[slot].type) {
+        if (table->entries[slot].type == type) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    table->entries[slot].type = type;
+    table->entries[slot].bits = bits;
+    table->count ++;
+}
+
+static
+corto_observer_index_ancestors* corto_observer_index_tableFind(
+    corto_observer_index_table *table,
+    corto_type type)
+{
+    if (table) {
+        uint32_t mask = table->size - 1;
+        uint32_t slot = CORTO_OBSERVER_INDEX_HASH(type) & mask;
+        corto_type key;
+
+        while ((key = table->entries[slot].type)) {
+            if (key == type) {
+                return &table->entries[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    return NULL;
+}
+
+/* Assign a bit to a type. Returns 0 if all bits are in use. */
+static
+uint64_t corto_observer_index_register(
+    corto_type type)
+{
+    int32_t i, slot = -1;
+    uint64_t result = 0;
+
+    corto_mutex_lock(&corto_observer_index_lock);
+    for (i = 0; i < CORTO_OBSERVER_INDEX_MAX_GROUPS; i ++) {
+        if (corto_observer_index_types[i] == type) {
+            result = 1ull << i;
+            break;
+        }
+        if (!corto_observer_index_types[i] && slot == -1) {
+            slot = i;
+        }
+    }
+
+    if (!result && slot != -1) {
+        corto_observer_index_types[slot] = type;
+        result = 1ull << slot;
+
+        /* Bitsets that were computed before don't have the bit of the type */
+        corto_observer_index_tableSet(NULL);
+    }
+    corto_mutex_unlock(&corto_observer_index_lock);
+
+    return result;
+}
+
+/* Compute ancestor bitset of a type, and add it to the table */
+static
+uint64_t corto_observer_index_ancestorsAdd(
+    corto_type t)
+{
+    corto_observer_index_table *old, *table;
+    uint64_t bits = 0;
+    uint32_t i, size;
+
+    corto_mutex_lock(&corto_observer_index_lock);
+    for (i = 0; i < CORTO_OBSERVER_INDEX_MAX_GROUPS; i ++) {
+        corto_type type = corto_observer_index_types[i];
+        if (type && ((type == t) || corto_type_instanceof(type, t))) {
+            bits |= 1ull << i;
+        }
+    }
+
+    /* Copy existing bitsets to new table. If another thread added the type in
+     * the meantime, the insert is ignored. */
+    old = corto_observer_index_ancestorTable;
+    size = old ? old->size : CORTO_OBSERVER_INDEX_TABLE_SIZE;
+    if (old && ((old->count + 1) * 2 > size)) {
+        size *= 2;
+    }
+
+    table = corto_calloc(sizeof(corto_observer_index_table) +
+        size * sizeof(corto_observer_index_ancestors));
+    table->size = size;
+
+    if (old) {
+        for (i = 0; i < old->size; i ++) {
+            if (old->entries[i].type) {
+                corto_observer_index_tableInsert(
+                    table, old->entries[i].type, old->entries[i].bits);
+            }
+        }
+    }
+
+    corto_observer_index_tableInsert(table, t, bits);
+    corto_observer_index_tableSet(table);
+    corto_mutex_unlock(&corto_observer_index_lock);
+
+    return bits;
+}
+
+static
+uint64_t corto_observer_index_ancestorsGet(
+    corto_type t)
+{
+    corto_observer_index_ancestors *entry;
+    uint64_t bits = 0;
+
+    corto_epoch_enter();
+    entry = corto_observer_index_tableFind(
+        corto_observer_index_ancestorTable, t);
+    if (entry) {
+        bits = entry->bits;
+    }
+    corto_epoch_exit();
+
+    if (entry) {
+        return bits;
+    } else {
+        return corto_observer_index_ancestorsAdd(t);
+    }
+}
+
+corto_observer_index* corto_observer_index_new(
+    corto__observer **observers)
+{
+    corto_observer_index *index;
+    uint32_t count = 0, i, g;
+
+    while (observers[count]) {
+        count ++;
+    }
+
+    index = corto_calloc(sizeof(corto_observer_index) +
+        (count < CORTO_OBSERVER_INDEX_MAX_GROUPS
+            ? count
+            : CORTO_OBSERVER_INDEX_MAX_GROUPS) *
+        sizeof(corto_observer_index_group));
+    index->count = count;
+    if (count) {
+        index->groupOf = corto_alloc(count * sizeof(uint8_t));
+    }
+
+    for (i = 0; i < count; i ++) {
+        corto_observer observer = observers[i]->observer;
+        corto_type type = observer->type;
+        bool instanceOf = type && observer->instanceOf;
+        corto_observer_index_group *group = NULL;
+
+        for (g = 0; g < index->groupCount; g ++) {
+            group = &index->groups[g];
+            if (group->overflow ||
+                ((group->type == type) && (group->instanceOf == instanceOf)))
+            {
+                break;
+            }
+        }
+
+        if (g == index->groupCount) {
+            group = &index->groups[g];
+            index->groupCount ++;
+
+            if (g == CORTO_OBSERVER_INDEX_MAX_GROUPS - 1) {
+                /* Last group collects all remaining filters */
+                group->overflow = true;
+            } else {
+                group->type = type;
+                group->instanceOf = instanceOf;
+                if (instanceOf) {
+                    group->typeBit = corto_observer_index_register(type);
+                }
+            }
+        }
+
+        group->mask |= observer->mask;
+        index->mask |= observer->mask;
+        index->groupOf[i] = g;
+    }
+
+    return index;
+}
+
+void corto_observer_index_free(
+    corto_observer_index *index)
+{
+    if (index) {
+        corto_dealloc(index->groupOf);
+        corto_dealloc(index);
+    }
+}
+
+uint64_t corto_observer_index_match(
+    corto_observer_index *index,
+    corto_type t,
+    corto_eventMask mask,
+    int depth)
+{
+    uint64_t result = 0, ancestors = 0;
+    bool ancestorsLoaded = false;
+    uint32_t g;
+
+    if (!(index->mask & mask)) {
+        return 0;
+    }
+
+    for (g = 0; g < index->groupCount; g ++) {
+        corto_observer_index_group *group = &index->groups[g];
+        uint64_t bit = 1ull << g;
+
+        if (!(group->mask & mask)) {
+            continue;
+        }
+
+        if (depth && !(group->mask & CORTO_ON_TREE)) {
+            continue;
+        }
+
+        if (!group->type || group->type == t) {
+            result |= bit;
+        } else if (group->instanceOf) {
+            if (group->typeBit) {
+                if (!ancestorsLoaded) {
+                    ancestors = corto_observer_index_ancestorsGet(t);
+                    ancestorsLoaded = true;
+                }
+                if (ancestors & group->typeBit) {
+                    result |= bit;
+                }
+            } else if (corto_type_instanceof(group->type, t)) {
+                result |= bit;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool corto_observer_index_matchType(
+    corto_observer observer,
+    corto_type t)
+{
+    corto_type type = observer->type;
+
+    if (!type || (type == t)) {
+        return true;
+    }
+
+    if (observer->instanceOf) {
+        return corto_type_instanceof(type, t);
+    }
+
+    return false;
+}
+
+void corto_observer_index_typeDeinit(
+    corto_type type)
+{
+    bool found = false;
+    int32_t i;
+
+    corto_mutex_lock(&corto_observer_index_lock);
+    for (i = 0; i < CORTO_OBSERVER_INDEX_MAX_GROUPS; i ++) {
+        if (corto_observer_index_types[i] == type) {
+            corto_observer_index_types[i] = NULL;
+            found = true;
+        }
+    }
+
+    /* The memory of the type may be reused by a new type, which would find the
+     * bitset of this type */
+    if (found || corto_observer_index_tableFind(
+        corto_observer_index_ancestorTable, type))
+    {
+        corto_observer_index_tableSet(NULL);
+    }
+    corto_mutex_unlock(&corto_observer_index_lock);
+}
+
+void corto_observer_index_deinit(void)
+{
+    corto_dealloc(corto_observer_index_ancestorTable);
+    corto_observer_index_ancestorTable = NULL;
+    memset(corto_observer_index_types, 0, sizeof(corto_observer_index_types));
+}
@@ -0,0 +1,71 @@
+#ifndef CORTO_OBSERVER_INDEX_H
+#define CORTO_OBSERVER_INDEX_H
+
+/* The observer index finds the observers in an observer array that can match
+ * an event, without evaluating the type filter of every observer. When an array
+ * is built, its observers are grouped by type filter, and every group stores
+ * the union of the event masks of its observers. A notification first selects
+ * the groups that match the event and the type of the observable, and then only
+ * visits the observers of the selected groups, in the order of the array.
+ *
+ * Observers that match instances of subtypes use ancestor bitsets. Every type
+ * that is used as filter by such an observer is assigned a bit. The ancestor
+ * bitset of a type has the bits set of all registered types it is an instance
+ * of. Bitsets are computed once per type, and stored in a table that is read
+ * without locking in an epoch critical section. Writers replace the table, and
+ * retire the old one. When more types are registered than there are bits, the
+ * remaining groups fall back to corto_type_instanceof.
+ */
+
+/* Number of groups that can be selected by a single notification */
+#define CORTO_OBSERVER_INDEX_MAX_GROUPS (64)
+
+typedef struct corto_observer_index_group {
+    corto_type type;      /* NULL for observers that match any type */
+    bool instanceOf;      /* Match instances of subtypes of type */
+    bool overflow;        /* Observers have different filters, see below */
+    uint64_t typeBit;     /* Bit of type in ancestor bitsets, 0 if none */
+    corto_eventMask mask; /* Union of masks of observers in group */
+} corto_observer_index_group;
+
+/* When an array has more filters than CORTO_OBSERVER_INDEX_MAX_GROUPS, the last
+ * group is an overflow group. It is always selected, and its observers evaluate
+ * their type filter when notified. */
+typedef struct corto_observer_index {
+    corto_eventMask mask; /* Union of masks of all observers */
+    uint32_t count;
+    uint32_t groupCount;
+    uint8_t *groupOf;     /* Group of each observer in the array */
+    corto_observer_index_group groups[];
+} corto_observer_index;
+
+/* Create index for a zero-terminated observer array */
+corto_observer_index* corto_observer_index_new(
+    corto__observer **observers);
+
+/* Free index */
+void corto_observer_index_free(
+    corto_observer_index *index);
+
+/* Return the bitset of groups that may match an event for an observable of
+ * type t. Must be called in an epoch critical section. */
+uint64_t corto_observer_index_match(
+    corto_observer_index *index,
+    corto_type t,
+    corto_eventMask mask,
+    int depth);
+
+/* Evaluate the type filter of an observer. Used when an observer is notified
+ * outside of an observer array, for example when it is aligned. */
+bool corto_observer_index_matchType(
+    corto_observer observer,
+    corto_type t);
+
+/* Forget about a type that is deallocated. Called by corto_type_deinit. */
+void corto_observer_index_typeDeinit(
+    corto_type type);
+
+/* Free the type registry. Called by corto_stop. */
+void corto_observer_index_deinit(void);
+
+#endif
@@ -0,0 +1,195 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <corto/corto.h>
+#include "src/vstore/projection.h"
+
+/* Members of a projection, resolved for a type */
+typedef struct corto_projection_binding corto_projection_binding;
+struct corto_projection_binding {
+    corto_type type;
+    corto_projection_binding *next;
+    corto_objectseq members; /* Empty if type has none of the members */
+    corto_object buffer[];
+};
+
+struct corto_projection_s {
+    char *members;
+    char **names; /* Point into members */
+    int32_t count;
+
+    /* List of bindings is only prepended to, and read without locking */
+    corto_projection_binding * volatile bindings;
+};
+
+static
+bool corto_projection_isIdChar(
+    char ch)
+{
+    return isalnum(ch) || ch == '_';
+}
+
+corto_projection corto_projection_compile(
+    const char *members)
+{
+    corto_projection result = corto_calloc(sizeof(struct corto_projection_s));
+    char *ptr, *name;
+    int32_t i;
+
+    result->members = corto_strdup(members);
+    ptr = result->members;
+
+    do {
+        while (isspace(*ptr)) {
+            ptr ++;
+        }
+
+        name = ptr;
+        while (corto_projection_isIdChar(*ptr)) {
+            ptr ++;
+        }
+
+        if (name == ptr) {
+            corto_throw("expected member name at column %d in member '%s'",
+                (int)(ptr - result->members) + 1, members);
+            goto error;
+        }
+
+        if (*ptr && *ptr != ',' && !isspace(*ptr)) {
+            corto_throw(
+                "unexpected character '%c' at column %d in member '%s'",
+                *ptr, (int)(ptr - result->members) + 1, members);
+            goto error;
+        }
+
+        while (isspace(*ptr)) {
+            *ptr = '\0';
+            ptr ++;
+        }
+
+        bool last = !*ptr;
+        if (!last && *ptr != ',') {
+            corto_throw("expected ',' at column %d in member '%s'",
+                (int)(ptr - result->members) + 1, members);
+            goto error;
+        }
+        *ptr = '\0';
+
+        /* Ignore duplicate names */
+        for (i = 0; i < result->count; i ++) {
+            if (!strcmp(result->names[i], name)) {
+                break;
+            }
+        }
+
+        if (i == result->count) {
+            result->names = corto_realloc(
+                result->names, (result->count + 1) * sizeof(char*));
+            result->names[result->count ++] = name;
+        }
+
+        if (last) {
+            break;
+        }
+
+        ptr ++;
+    } while (true);
+
+    return result;
+error:
+    corto_projection_free(result);
+    return NULL;
+}
+
+void corto_projection_free(
+    corto_projection projection)
+{
+    corto_projection_binding *b, *next;
+
+    for (b = projection->bindings; b; b = next) {
+        next = b->next;
+        corto_release(b->type);
+        corto_dealloc(b);
+    }
+
+    if (projection->names) corto_dealloc(projection->names);
+    corto_dealloc(projection->members);
+    corto_dealloc(projection);
+}
+
+static
+corto_projection_binding* corto_projection_bind(
+    corto_projection projection,
+    corto_type type)
+{
+    corto_projection_binding *b, *head;
+    int32_t i, j;
+
+    for (b = projection->bindings; b; b = b->next) {
+        if (b->type == type) {
+            return b;
+        }
+    }
+
+    b = corto_calloc(sizeof(corto_projection_binding) +
+        projection->count * sizeof(corto_object));
+    b->type = type;
+    b->members.buffer = b->buffer;
+    corto_claim(type);
+
+    if (corto_instanceof(corto_struct_o, type)) {
+        for (i = 0; i < projection->count; i ++) {
+            corto_member m = corto_interface_resolveMember(
+                type, projection->names[i]);
+
+            if (!m || m->modifiers & CORTO_PRIVATE) {
+                continue;
+            }
+
+            /* Order members by offset, which is the order of a value */
+            for (j = b->members.length; j > 0; j --) {
+                if (corto_member(b->buffer[j - 1])->offset < m->offset) {
+                    break;
+                }
+                b->buffer[j] = b->buffer[j - 1];
+            }
+
+            b->buffer[j] = m;
+            b->members.length ++;
+        }
+    }
+
+    /* If another thread binds the same type, the type is bound twice */
+    do {
+        head = projection->bindings;
+        b->next = head;
+    } while (!__sync_bool_compare_and_swap(&projection->bindings, head, b));
+
+    return b;
+}
+
+corto_objectseq* corto_projection_members(
+    corto_projection projection,
+    corto_type type)
+{
+    corto_projection_binding *b = corto_projection_bind(projection, type);
+    return b->members.length ? &b->members : NULL;
+}
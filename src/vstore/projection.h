@@ -0,0 +1,35 @@
+#ifndef CORTO_PROJECTION_H
+#define CORTO_PROJECTION_H
+
+/* A projection is the compiled form of the 'member' field of a query, which is
+ * a comma separated list of member names, for example:
+ *
+ *   x, y, name
+ *
+ * When a query has a projection, only the listed members are serialized for
+ * the values of its results. Members are resolved the first time a value of a
+ * type is serialized, and may be inherited from a base of the type. Resolved
+ * types are added to the projection without locking, which allows multiple
+ * threads to use the same projection. Only structs and classes can be
+ * projected. Values of other types, and of types that have none of the listed
+ * members, are not serialized.
+ */
+
+typedef struct corto_projection_s *corto_projection;
+
+/* Compile projection. Returns NULL and throws if the member list is invalid. */
+corto_projection corto_projection_compile(
+    const char *members);
+
+/* Free projection */
+void corto_projection_free(
+    corto_projection projection);
+
+/* Return the members of the projection for a type, in the order in which they
+ * are stored in a value. Returns NULL if no value of the type should be
+ * serialized. */
+corto_objectseq* corto_projection_members(
+    corto_projection projection,
+    corto_type type);
+
+#endif
@@ -22,11 +22,17 @@
 #include <corto/corto.h>
 
 #include "src/store/object.h"
+#include "src/vstore/where.h"
+#include "src/vstore/projection.h"
+#include "src/vstore/fanout.h"
 #include "../platform/src/idmatch.h"
 
 extern int8_t CORTO_OLS_AUGMENT;
 extern corto_tls CORTO_KEY_FLUENT;
 
+/* Incremented when mounts are added or removed, see mount.c */
+extern volatile uint32_t corto_mount_generation;
+
 struct corto_select_data;
 
 #define CORTO_MAX_MOUNTS_PER_SELECT (256)
@@ -44,6 +50,8 @@ typedef struct corto_selectRequest {
     corto_string expr;
     const char *type;
     const char *instanceof;
+    const char *where;
+    const char *member;
     uint64_t offset;
     uint64_t limit;
     uint64_t soffset;
@@ -59,6 +67,8 @@ typedef struct corto_selectRequest {
     bool queryVstore;
     bool queryStore;
     bool yield_unknown;
+    bool parallel;
+    uint64_t *counted;
 } corto_selectRequest;
 
 typedef struct corto_select_data corto_select_data;
@@ -85,6 +95,7 @@ typedef struct corto_select_frame {
     int32_t locationLength; /* Restore query when leaving frame */
     uint8_t firstMount; /* First mount loaded for frame */
     int8_t currentMount; /* Current mount being evaluated */
+    bool counted; /* Objects in scope have been counted without iterating */
 } corto_select_frame;
 
 struct corto_select_data {
@@ -141,6 +152,12 @@ struct corto_select_data {
     corto_string typeFilter;
     corto_idmatch_program typeFilterProgram;   /* Parsed program */
     corto_type instanceof;
+    corto_string where;
+    corto_where_program whereProgram;
+
+    /* Projection */
+    corto_string member;
+    corto_projection projection;
 
     /* Full path representing the current location of select */
     corto_id location;
@@ -175,6 +192,60 @@ struct corto_select_data {
     bool valueAllocated;
     corto_selectHistoryIter_t historyIterData;
     corto_result *next;
+
+    /* Set when select executes a prepared query. Expressions, programs and
+     * filters are then borrowed from the prepared query. */
+    corto_select_prepared *prepared;
+
+    /* Collect mounts in candidates instead of mounts, see LoadMounts */
+    corto_ll candidates;
+
+    /* Query the mounts of a frame concurrently */
+    bool parallel;
+
+    /* Set when select only counts results. Results that can be counted without
+     * iterating them are added to the variable counted points to, which must
+     * outlive the select data like the variable assigned to quitPtr. */
+    uint64_t *counted;
+};
+
+/* Expression of a prepared select, which may contain multiple expressions
+ * separated by ','. Segments don't store objects, which are looked up by every
+ * execution, as objects may have been created or deleted since. */
+typedef struct corto_select_preparedExpr {
+    char *expr;
+    struct corto_idmatch_program_s program;
+    corto_eventMask mask;
+    char *fullscope;
+    char *filter; /* Points into fullscope */
+    corto_idmatch_program filterProgram;
+    corto_select_segment segments[CORTO_MAX_SCOPE_DEPTH];
+} corto_select_preparedExpr;
+
+struct corto_select_prepared {
+    corto_selectRequest request; /* Settings, strings are not owned */
+    char *scope;
+    char *exprBuffer;
+    char *contentType;
+    char *typeFilter;
+    corto_idmatch_program typeFilterProgram;
+    corto_type instanceof;
+    char *where;
+    corto_where_program whereProgram;
+    char *member;
+    corto_projection projection;
+    corto_fmt dstSer;
+
+    uint32_t exprCount;
+    corto_select_preparedExpr *exprs;
+
+    /* Mounts that can provide data for each segment of each expression,
+     * before the types of the segments are evaluated. A list is NULL until it
+     * is first requested. All lists are dropped when mounts are added or
+     * removed. Protected by lock. */
+    corto_mutex_s lock;
+    uint32_t mountGeneration;
+    corto_mount **mounts; /* exprCount * CORTO_MAX_SCOPE_DEPTH lists */
 };
 
 static
@@ -231,14 +302,36 @@ int16_t corto_selectConvert(
 
     should_convert = different_from || different_fmt;
 
+    /* A mount may not apply the projection, so always project its values */
+    if (src && srcType && data->dstSer && data->projection) {
+        should_convert = true;
+    }
+
     /* If source serializer is loaded, a conversion is needed */
-    if (src && (different_from || different_fmt)) {
+    if (src && should_convert) {
         corto_type t = corto_type(corto_resolve(NULL, type));
         if (!t) {
             corto_throw("unresolved type '%s'", type);
             goto error;
         } else {
-            if (different_fmt || t->flags & CORTO_TYPE_HAS_REFERENCES) {
+            if (data->projection) {
+                corto_objectseq *members =
+                    corto_projection_members(data->projection, t);
+                if (!members) {
+                    /* Type has none of the projected members */
+                    if (dst_value) {
+                        corto_fmt_release(data->dstSer, dst_value);
+                    }
+                    *dst = 0;
+                    if (converted) *converted = true;
+                    return 0;
+                }
+                dst_opt.members = *members;
+            }
+
+            if (different_fmt || data->projection ||
+                t->flags & CORTO_TYPE_HAS_REFERENCES)
+            {
                 if (dst_value) {
                     corto_fmt_release(data->dstSer, dst_value);
                 }
@@ -340,11 +433,23 @@ void corto_setItemData(
         };
         if (item->value) {
             corto_fmt_release(data->dstSer, (void*)item->value);
+            item->value = 0;
+        }
+
+        corto_objectseq *members = NULL;
+        if (data->projection) {
+            members = corto_projection_members(
+                data->projection, corto_typeof(o));
         }
 
-        corto_value v = corto_value_object(o, NULL);
-        item->value =
-            (uintptr_t)corto_fmt_from_value(data->dstSer, &dst_opt, &v);
+        if (!data->projection || members) {
+            if (members) {
+                dst_opt.members = *members;
+            }
+            corto_value v = corto_value_object(o, NULL);
+            item->value =
+                (uintptr_t)corto_fmt_from_value(data->dstSer, &dst_opt, &v);
+        }
     }
 
     item->flags = 0;
@@ -485,6 +590,18 @@ bool corto_selectMatch(
                 corto_release(type);
             }
         }
+
+        /* Filter value. Values of mount results are filtered when they are
+         * returned by the mount, see corto_selectIterMount. */
+        if (result && o && data->whereProgram) {
+            if (!corto_read_begin(o)) {
+                result = corto_where_match(
+                    data->whereProgram, corto_typeof(o), o);
+                corto_read_end(o);
+            } else {
+                result = FALSE;
+            }
+        }
     }
 
     return result;
@@ -513,33 +630,102 @@ char* corto_selectRelativeParent(
     return parent;
 }
 
+/* Returns true if select skips the first results of a mount to apply the
+ * offset, instead of passing the offset to the mount */
+static
+bool corto_selectAppliesOffset(
+    corto_select_data *data,
+    corto_mount mount)
+{
+    return data->parallel || (data->whereProgram && mount->policy.filterResults);
+}
+
+/* Build the query for a mount, relative to the current location. The strings
+ * of the query are owned by select. */
+static
+void corto_selectMountQuery(
+    corto_select_data *data,
+    corto_mount mount,
+    corto_query *r)
+{
+    char *expr = data->mask == CORTO_ON_TREE ? "*" : data->filter ? data->filter : "*";
+    corto_query *q = &corto_subscriber(mount)->query;
+    char *parent = corto_selectRelativeParent(q, data);
+
+    corto_debug("query (select='%s' from='%s') mount '%s', location '%s'",
+      expr,
+      parent,
+      corto_fullpath(NULL, mount),
+      data->location);
+
+    *r = (corto_query){
+      .from = parent,
+      .select = expr,
+      .type = data->type,
+      .where = data->where,
+      .member = data->member,
+      .offset = (data->offset > data->count) ? data->offset - data->count : 0,
+      .limit = (data->offset > data->count || !data->limit) ? data->limit : data->limit - (data->offset - data->count),
+      .soffset = data->soffset,
+      .slimit = data->slimit,
+      .content = data->contentType ? TRUE : FALSE,
+      .timeBegin = data->from,
+      .timeEnd = data->to};
+
+    /* If select evaluates the where filter for the mount, the mount must
+     * return values, and offset and limit can only be applied after the
+     * results have been filtered. */
+    if (data->whereProgram && mount->policy.filterResults) {
+        r->content = TRUE;
+        r->offset = 0;
+        r->limit = 0;
+
+        /* Filter may use members that are not in the projection */
+        r->member = NULL;
+    } else if (data->parallel) {
+        /* Mounts are queried at the same time, so a mount cannot know how
+         * many results other mounts returned. Request enough results for the
+         * remaining offset and limit, select skips the offset. */
+        uint64_t skip = data->offset > data->skip ? data->offset - data->skip : 0;
+        r->offset = 0;
+        r->limit = data->limit ? skip + data->limit - data->count : 0;
+    }
+}
+
+/* Returns true if select can ask a mount for the number of results instead of
+ * the results. Select filters the results of mounts that set filterResults, so
+ * those mounts must return results. */
+static
+bool corto_selectCanCountMount(
+    corto_select_data *data,
+    corto_mount mount)
+{
+    return data->counted &&
+        (mount->policy.mask & CORTO_MOUNT_COUNT) &&
+        !mount->policy.filterResults &&
+        data->mask == CORTO_ON_SCOPE &&
+        !data->isHistoricalQuery &&
+        !data->mountAction;
+}
+
 static
 corto_resultIter corto_selectRequestMount(
     corto_select_data *data,
     corto_mount mount)
 {
     if (data->mountAction || (!data->quit && data->queryVstore)) {
-        char *expr = data->mask == CORTO_ON_TREE ? "*" : data->filter ? data->filter : "*";
-        corto_query *q = &corto_subscriber(mount)->query;
-        char *parent = corto_selectRelativeParent(q, data);
-
-        corto_debug("query (select='%s' from='%s') mount '%s', location '%s'",
-          expr,
-          parent,
-          corto_fullpath(NULL, mount),
-          data->location);
-
-        corto_query r = {
-          .from = parent,
-          .select = expr,
-          .type = data->type,
-          .offset = (data->offset > data->count) ? data->offset - data->count : 0,
-          .limit = (data->offset > data->count || !data->limit) ? data->limit : data->limit - (data->offset - data->count),
-          .soffset = data->soffset,
-          .slimit = data->slimit,
-          .content = data->contentType ? TRUE : FALSE,
-          .timeBegin = data->from,
-          .timeEnd = data->to};
+        corto_query r;
+        corto_selectMountQuery(data, mount, &r);
+
+        /* If only counting, ask the mount for the number of results. A mount
+         * that cannot count returns -1, and is queried for results instead. */
+        if (corto_selectCanCountMount(data, mount)) {
+            int64_t count = corto_mount_count(mount, &r);
+            if (count >= 0) {
+                *data->counted += count;
+                return CORTO_ITER_EMPTY;
+            }
+        }
 
         if (data->mountAction) {
             /* If mount-action returns non-zero, quit the walk asap */
@@ -609,6 +795,45 @@ void corto_selectHistoryRelease(
     ctx->data->item.history.ctx = NULL;
 }
 
+/* Evaluate where filter for a value returned by a mount */
+static
+bool corto_selectMatchValue(
+    corto_select_data *data,
+    corto_mount mount,
+    corto_result *result)
+{
+    corto_fmt fmt = (corto_fmt)mount->contentTypeOutHandle;
+    bool match = false;
+
+    if (!result->value || !fmt) {
+        corto_debug("where: no value for '%s' from mount '%s'",
+            result->id, corto_fullpath(NULL, mount));
+        return false;
+    }
+
+    corto_type t = corto_resolve(NULL, result->type);
+    if (!t) {
+        return false;
+    }
+
+    void *ptr = corto_mem_new(t);
+    corto_value v = corto_value_mem(ptr, t);
+    corto_fmt_opt opt = {
+        .from = mount->super.query.from
+    };
+
+    if (!corto_fmt_to_value(fmt, &opt, &v, (char*)result->value)) {
+        match = corto_where_match(data->whereProgram, t, ptr);
+    } else {
+        corto_catch();
+    }
+
+    corto_mem_free(ptr);
+    corto_release(t);
+
+    return match;
+}
+
 static
 bool corto_selectIterMount(
     corto_select_data *data,
@@ -658,6 +883,24 @@ bool corto_selectIterMount(
         }
     }
 
+    if (!(result->flags & CORTO_RESULT_HIDDEN)) {
+        /* Evaluate where filter if mount indicates it doesn't do any
+         * filtering */
+        if (data->whereProgram && mount->policy.filterResults) {
+            if (!corto_selectMatchValue(data, mount, result)) {
+                goto noMatch;
+            }
+        }
+
+        /* Skip results if the offset was not passed to the mount */
+        if (corto_selectAppliesOffset(data, mount) &&
+            data->skip < data->offset)
+        {
+            data->skip ++;
+            goto noMatch;
+        }
+    }
+
     data->next = &data->item;
     data->item.owner = mount;
     data->item.object = NULL;
@@ -791,6 +1034,167 @@ noMatch:
     return false;
 }
 
+typedef struct corto_selectFanoutIter_t {
+    corto_fanout *fanout;
+    corto_select_data *data;
+    corto_select_frame *frame;
+    corto_result *next;
+} corto_selectFanoutIter_t;
+
+static
+void corto_selectFanoutRelease(
+    corto_iter *it)
+{
+    corto_selectFanoutIter_t *ctx = it->ctx;
+    if (ctx) {
+        corto_fanout_free(ctx->fanout);
+        corto_dealloc(ctx);
+        it->ctx = NULL;
+    }
+}
+
+static
+bool corto_selectFanoutHasNext(
+    corto_iter *it)
+{
+    corto_selectFanoutIter_t *ctx = it->ctx;
+    int32_t index;
+
+    if (!ctx) {
+        return false;
+    }
+
+    if (!ctx->next) {
+        if ((ctx->next = corto_fanout_next(ctx->fanout, &index))) {
+            /* Results are evaluated for the mount that returned them */
+            ctx->frame->currentMount = index + 1;
+        } else {
+            /* All mounts of the frame have been evaluated */
+            ctx->frame->currentMount = ctx->data->mountsLoaded;
+            corto_selectFanoutRelease(it);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static
+void* corto_selectFanoutNext(
+    corto_iter *it)
+{
+    corto_selectFanoutIter_t *ctx = it->ctx;
+    corto_result *result = ctx->next;
+    ctx->next = NULL;
+    return result;
+}
+
+/* Query all mounts of a frame concurrently. Returns false if the mounts should
+ * be queried one after another. */
+static
+bool corto_selectFanout(
+    corto_select_data *data,
+    corto_select_frame *frame)
+{
+    int32_t i;
+
+    if (!data->parallel || data->quit || !data->queryVstore ||
+        (data->mountsLoaded - frame->firstMount) < 2 ||
+        !corto_fanout_available())
+    {
+        return false;
+    }
+
+    corto_fanout *fanout = corto_fanout_new();
+    if (!fanout) {
+        corto_raise();
+        return false;
+    }
+
+    corto_debug("query %d mounts in parallel",
+        data->mountsLoaded - frame->firstMount);
+
+    for (i = frame->firstMount; i < data->mountsLoaded; i ++) {
+        corto_query r;
+        corto_selectMountQuery(data, data->mounts[i], &r);
+        corto_fanout_query(fanout, data->mounts[i], &r, i);
+    }
+
+    corto_selectFanoutIter_t *ctx = corto_calloc(sizeof(corto_selectFanoutIter_t));
+    ctx->fanout = fanout;
+    ctx->data = data;
+    ctx->frame = frame;
+
+    memset(&frame->iter, 0, sizeof(corto_iter));
+    frame->iter.ctx = ctx;
+    frame->iter.hasNext = corto_selectFanoutHasNext;
+    frame->iter.next = corto_selectFanoutNext;
+    frame->iter.release = corto_selectFanoutRelease;
+    frame->currentMount = data->mountsLoaded;
+
+    return true;
+}
+
+/* Returns true if select can count the objects in a scope without matching
+ * them one by one, which is when every object in the scope is a result. */
+static
+bool corto_selectCanCountObjects(
+    corto_select_data *data)
+{
+    int32_t i;
+
+    if (!data->counted || data->mask != CORTO_ON_SCOPE) {
+        return false;
+    }
+
+    if ((data->filter && strcmp(data->filter, "*")) || data->typeFilter ||
+        data->instanceof || data->whereProgram || corto_secured())
+    {
+        return false;
+    }
+
+    /* Objects managed by a SINK mount are not returned from the store */
+    for (i = 0; i < data->mountsLoaded; i ++) {
+        corto_mount m = data->mounts[i];
+        if ((m->policy.ownership == CORTO_LOCAL_SOURCE) && !m->passThrough) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Count objects in scope. Unknown objects are hidden, unless the select
+ * yields unknown objects, in which case the size of the scope is used. */
+static
+uint64_t corto_selectCountObjects(
+    corto_select_data *data,
+    corto_object o)
+{
+    uint64_t count = 0;
+
+    corto_scope_lock(o);
+    corto_rb scope = corto_scopeof(o);
+    if (scope) {
+        if (data->yield_unknown) {
+            count = corto_rb_count(scope);
+        } else {
+            jsw_rbtrav_t trav;
+            corto_iter it;
+            it = _corto_rb_iter(scope, &trav);
+            while (corto_iter_hasNext(&it)) {
+                corto_object child = corto_iter_next(&it);
+                if (corto_typeof(child) != corto_unknown_o) {
+                    count ++;
+                }
+            }
+        }
+    }
+    corto_scope_unlock(o);
+
+    return count;
+}
+
 static
 bool corto_selectIterNext(
     corto_select_data *data,
@@ -806,9 +1210,20 @@ bool corto_selectIterNext(
     /* Select data from scope */
     if (data->queryStore && frame->o) {
 
+        /* If only counting, count objects without returning them */
+        if (!frame->counted && !frame->cur->expr &&
+            (frame->currentMount == frame->firstMount) &&
+            corto_selectCanCountObjects(data))
+        {
+            *data->counted += corto_selectCountObjects(data, frame->o);
+            frame->counted = true;
+        }
+
         /* Don't walk over objects if a frame contains a expr or if the
          * frame is already walking over a mount */
-        if (!frame->cur->expr && (frame->currentMount == frame->firstMount)) {
+        if (!frame->cur->expr && (frame->currentMount == frame->firstMount) &&
+            !frame->counted)
+        {
             corto_scope_lock(frame->o);
 
             if ((data->mask == CORTO_ON_SELF) && !data->filter) {
@@ -852,7 +1267,9 @@ bool corto_selectIterNext(
         retry = false;
         if (!data->sp || (frame->cur != data->stack[data->sp - 1].cur)) {
             if (!hasData && data->mountsLoaded && (data->mountsLoaded > frame->firstMount)) {
-                if (frame->currentMount == frame->firstMount) {
+                if (frame->currentMount == frame->firstMount &&
+                    !corto_selectFanout(data, frame))
+                {
                     frame->currentMount ++;
                     frame->iter = corto_selectRequestMount(
                       data, data->mounts[frame->currentMount - 1]);
@@ -880,6 +1297,48 @@ bool corto_selectIterNext(
     return hasData;
 }
 
+/* Add mount to the mounts of the current frame, unless it conflicts with the
+ * types of the segments that remain to be evaluated. */
+static
+int corto_selectAddMount(
+    corto_select_data *data,
+    corto_mount mount)
+{
+    /* If select query consists of multiple segments, ensure that next segments
+     * do not conflict with mount type, if set. */
+    corto_string rType = mount->super.query.type;
+    if (rType) {
+        int s = data->segment + 1;
+        while (data->segments[s].scope) {
+            corto_select_segment *segment = &data->segments[s];
+            if (segment->o) {
+                corto_id typeId;
+                if (strcmp(rType, corto_fullpath(typeId, corto_typeof(segment->o)))) {
+                    return 1;
+                }
+            }
+            s ++;
+        }
+    }
+
+    if (data->mountsLoaded == CORTO_MAX_MOUNTS_PER_SELECT) {
+        corto_throw("number of mounts exceeded (%d) for request",
+            CORTO_MAX_MOUNTS_PER_SELECT);
+        return 0;
+    }
+
+    /* Mount should be loaded */
+    data->mounts[data->mountsLoaded] = mount;
+    data->mountsLoaded ++;
+
+    corto_debug("add mount '%s' of type = '%s', mountsLoaded = %d",
+      corto_fullpath(NULL, mount),
+      corto_fullpath(NULL, corto_typeof(mount)),
+      data->mountsLoaded);
+
+    return 1;
+}
+
 /* Evaluate whether mount for specific scope should be loaded */
 static
 int corto_selectLoadMountWalk(
@@ -930,38 +1389,83 @@ int corto_selectLoadMountWalk(
         }
     }
 
-    /* If select query consists of multiple segments, ensure that next segments
-     * do not conflict with mount type, if set. */
-    if (rType) {
-        int s = data->segment + 1;
-        while (data->segments[s].scope) {
-            corto_select_segment *segment = &data->segments[s];
-            if (segment->o) {
-                corto_id typeId;
-                if (strcmp(rType, corto_fullpath(typeId, corto_typeof(segment->o)))) {
-                    return 1;
-                }
+    /* When collecting mounts for a prepared select, the segments are evaluated
+     * when the mounts are loaded */
+    if (data->candidates) {
+        corto_ll_append(data->candidates, mount);
+        return 1;
+    }
+
+    return corto_selectAddMount(data, mount);
+}
+
+/* Load mounts of a prepared query. The mounts that match the scope and the
+ * settings of the query are cached per segment, so that the mount admin only
+ * needs to be walked again after mounts have been added or removed. */
+static
+int16_t corto_selectLoadPreparedMounts(
+    corto_select_data *data,
+    corto_select_frame *frame,
+    bool recursive)
+{
+    corto_select_prepared *p = data->prepared;
+    corto_mount **list, *ptr;
+
+    corto_mutex_lock(&p->lock);
+
+    uint32_t generation = corto_mount_generation;
+    if (p->mountGeneration != generation) {
+        uint32_t i, count = p->exprCount * CORTO_MAX_SCOPE_DEPTH;
+        for (i = 0; i < count; i ++) {
+            if (p->mounts[i]) {
+                corto_dealloc(p->mounts[i]);
+                p->mounts[i] = NULL;
             }
-            s ++;
         }
+        p->mountGeneration = generation;
     }
 
-    if (data->mountsLoaded == CORTO_MAX_MOUNTS_PER_SELECT) {
-        corto_throw("number of mounts exceeded (%d) for request",
-            CORTO_MAX_MOUNTS_PER_SELECT);
-        return 0;
-    }
+    list = &p->mounts[data->exprCurrent * CORTO_MAX_SCOPE_DEPTH + data->segment];
+    if (!*list) {
+        corto_ll candidates = corto_ll_new();
+        data->candidates = candidates;
 
-    /* Mount should be loaded */
-    data->mounts[data->mountsLoaded] = mount;
-    data->mountsLoaded ++;
+        if (!corto_entityAdmin_walk(
+            &corto_mount_admin,
+            corto_selectLoadMountWalk,
+            frame->cur->scope,
+            recursive ? true : false,
+            data))
+        {
+            data->candidates = NULL;
+            corto_ll_free(candidates);
+            goto error;
+        }
 
-    corto_debug("add mount '%s' of type = '%s', mountsLoaded = %d",
-      corto_fullpath(NULL, mount),
-      corto_fullpath(NULL, corto_typeof(mount)),
-      data->mountsLoaded);
+        data->candidates = NULL;
 
-    return 1;
+        uint32_t i = 0;
+        *list = corto_alloc(
+            (corto_ll_count(candidates) + 1) * sizeof(corto_mount));
+        corto_iter it = corto_ll_iter(candidates);
+        while (corto_iter_hasNext(&it)) {
+            (*list)[i ++] = corto_iter_next(&it);
+        }
+        (*list)[i] = NULL;
+        corto_ll_free(candidates);
+    }
+
+    for (ptr = *list; *ptr; ptr ++) {
+        if (!corto_selectAddMount(data, *ptr)) {
+            goto error;
+        }
+    }
+
+    corto_mutex_unlock(&p->lock);
+    return 0;
+error:
+    corto_mutex_unlock(&p->lock);
+    return -1;
 }
 
 /* Load mounts for a frame */
@@ -987,6 +1491,10 @@ int16_t corto_selectLoadMounts(
         frame->cur->scope,
         recursive ? " recursively" : "");
 
+    if (data->prepared) {
+        return corto_selectLoadPreparedMounts(data, frame, recursive);
+    }
+
     /* Walk mount admin to obtain list of mounts for frame of current scope */
     if (!corto_entityAdmin_walk(
         &corto_mount_admin,
@@ -1076,6 +1584,7 @@ int16_t corto_selectTree(
                 frame->locationLength = strlen(data->location);
                 frame->firstMount = data->mountsLoaded;
                 frame->currentMount = frame->firstMount;
+                frame->counted = false;
                 frame->cur = prevFrame->cur;
                 corto_set_ref(&frame->o, o);
 
@@ -1153,6 +1662,7 @@ int16_t corto_selectPrepareFrame(
     corto_set_ref(&frame->o, frame->cur->o);
     frame->currentMount = 0;
     frame->firstMount = 0;
+    frame->counted = false;
 
     if (frame->o) {
         corto_rb tree = corto_scopeof(frame->o);
@@ -1267,13 +1777,20 @@ void corto_selectRelease(
 
     CORTO_UNUSED(iter);
 
-    if (data->exprStart) corto_dealloc(data->exprStart);
-    if (data->program.tokens) corto_dealloc(data->program.tokens);
-    if (data->scope) corto_dealloc(data->scope);
-    if (data->fullscope) corto_dealloc(data->fullscope);
-    if (data->filterProgram) corto_idmatch_free(data->filterProgram);
-    if (data->typeFilterProgram) corto_idmatch_free(data->typeFilterProgram);
-    if (data->instanceof) corto_release(data->instanceof);
+    /* Prepared queries own expressions, programs and filters */
+    if (!data->prepared) {
+        if (data->exprStart) corto_dealloc(data->exprStart);
+        if (data->program.tokens) corto_dealloc(data->program.tokens);
+        if (data->scope) corto_dealloc(data->scope);
+        if (data->fullscope) corto_dealloc(data->fullscope);
+        if (data->filterProgram) corto_idmatch_free(data->filterProgram);
+        if (data->typeFilterProgram) corto_idmatch_free(data->typeFilterProgram);
+        if (data->instanceof) corto_release(data->instanceof);
+        if (data->where) corto_dealloc(data->where);
+        if (data->whereProgram) corto_where_free(data->whereProgram);
+        if (data->member) corto_dealloc(data->member);
+        if (data->projection) corto_projection_free(data->projection);
+    }
 
     /* Free iterators */
     int32_t i;
@@ -1285,8 +1802,10 @@ void corto_selectRelease(
     /* Free segments */
     i = 0;
     while (data->segments[i].scope) {
-        corto_set_str(&data->segments[i].scope, NULL);
-        corto_set_str(&data->segments[i].expr, NULL);
+        if (!data->prepared) {
+            corto_set_str(&data->segments[i].scope, NULL);
+            corto_set_str(&data->segments[i].expr, NULL);
+        }
         corto_set_ref(&data->segments[i].o, NULL);
         i++;
     }
@@ -1370,12 +1889,11 @@ int16_t corto_selectSplitScope(
 
 /* Combine scope and expression, then split off id expression */
 static
-int16_t corto_selectRun(
+int16_t corto_selectParse(
     corto_select_data *data)
 {
     corto_id fullscope;
     corto_string filter = NULL;
-    corto_select_frame *frame = &data->stack[0];
 
     strcpy(fullscope, data->scope ? data->scope : "/");
     data->mask = CORTO_ON_SCOPE;
@@ -1409,14 +1927,7 @@ int16_t corto_selectRun(
         goto error;
     }
 
-    /* Prepare first frame */
-    corto_selectPrepareFrame(data, frame, 0);
-
-    /* Prepare object filter */
     data->filter = filter;
-    if (filter) {
-        data->filterProgram = corto_idmatch_compile(data->filter, FALSE, FALSE);
-    }
 
     corto_debug("id filter = '%s'", filter);
 
@@ -1425,6 +1936,75 @@ error:
     return -1;
 }
 
+/* Lookup objects for the segments of a prepared expression. Objects are not
+ * stored in the prepared query, as they may have been created or deleted since
+ * the query was prepared. */
+static
+void corto_selectLookupSegments(
+    corto_select_data *data,
+    corto_select_preparedExpr *expr)
+{
+    uint32_t i;
+
+    for (i = 0; data->segments[i].scope; i ++) {
+        corto_set_ref(&data->segments[i].o, NULL);
+    }
+
+    memset(data->segments, 0, sizeof(data->segments));
+
+    for (i = 0; expr->segments[i].scope; i ++) {
+        data->segments[i].scope = expr->segments[i].scope;
+        data->segments[i].expr = expr->segments[i].expr;
+        if (!i) {
+            corto_set_ref(&data->segments[i].o, root_o);
+        } else {
+            data->segments[i].o = corto(CORTO_LOOKUP|CORTO_UNSECURED, {
+                .parent = root_o, .id = data->segments[i].scope
+            });
+        }
+    }
+}
+
+/* Prepare evaluation of the current expression */
+static
+int16_t corto_selectRun(
+    corto_select_data *data)
+{
+    corto_select_frame *frame = &data->stack[0];
+
+    if (data->prepared) {
+        corto_select_preparedExpr *expr =
+            &data->prepared->exprs[data->exprCurrent];
+        data->program = expr->program;
+        data->mask = expr->mask;
+        data->fullscope = expr->fullscope;
+        data->filter = expr->filter;
+        data->filterProgram = expr->filterProgram;
+        corto_selectLookupSegments(data, expr);
+    } else {
+        if (corto_selectParse(data)) {
+            goto error;
+        }
+
+        /* Prepare object filter */
+        if (data->filterProgram) {
+            corto_idmatch_free(data->filterProgram);
+            data->filterProgram = NULL;
+        }
+        if (data->filter) {
+            data->filterProgram =
+                corto_idmatch_compile(data->filter, FALSE, FALSE);
+        }
+    }
+
+    /* Prepare first frame */
+    corto_selectPrepareFrame(data, frame, 0);
+
+    return 0;
+error:
+    return -1;
+}
+
 static
 corto_select_frame* corto_selectNextSegment(
     corto_select_data *data)
@@ -1451,8 +2031,12 @@ bool corto_selectNextExpr(
     bool result = FALSE;
 
     if (data->exprCurrent < data->exprCount) {
-        data->expr = &data->expr[strlen(data->expr) + 1];
         data->exprCurrent ++;
+        if (data->prepared) {
+            data->expr = data->prepared->exprs[data->exprCurrent].expr;
+        } else {
+            data->expr = &data->expr[strlen(data->expr) + 1];
+        }
         result = TRUE;
 
         corto_debug("evaluate expression '%s'", data->expr);
@@ -1460,10 +2044,12 @@ bool corto_selectNextExpr(
         corto_selectReset(data);
         data->segment = 0;
 
-        if (data->program.tokens) corto_dealloc(data->program.tokens);
-        if (corto_idmatchParseIntern(&data->program, data->expr, TRUE, FALSE)) {
-            corto_throw("select '%s' failed", data->expr);
-            goto error;
+        if (!data->prepared) {
+            if (data->program.tokens) corto_dealloc(data->program.tokens);
+            if (corto_idmatchParseIntern(&data->program, data->expr, TRUE, FALSE)) {
+                corto_throw("select '%s' failed", data->expr);
+                goto error;
+            }
         }
 
         if (corto_selectRun(data)) {
@@ -1525,53 +2111,44 @@ stop:
 }
 
 static
-corto_resultIter corto_selectPrepareIterator (
-    struct corto_selectRequest *r)
+char* corto_selectNormalizeScope(
+    const char *scope)
 {
-    corto_select_data *data = corto_calloc(sizeof(corto_select_data));
-
-    corto_resultIter result;
-    memset(&result, 0, sizeof(corto_resultIter));
-
-    const char *scope = r->scope;
-
     if (scope && *scope) {
         if (*scope != '/') {
             /* Normalize scope to properly formatted identifier */
-            data->scope = corto_asprintf("/%s", scope);
+            return corto_asprintf("/%s", scope);
         } else {
-            data->scope = corto_strdup(scope);
+            return corto_strdup(scope);
         }
     } else {
         /* If no scope is provided, a NULL indicates that the result of select
          * must include the root scope ('/') in the parent field of results. */
-        data->scope = NULL;
+        return NULL;
     }
+}
 
+static
+char* corto_selectTakeExpr(
+    struct corto_selectRequest *r)
+{
     if (r->expr && *(r->expr)) {
-        data->expr = r->expr;
+        return r->expr;
     } else {
-        data->expr = corto_strdup(".");
         corto_dealloc(r->expr);
+        return corto_strdup(".");
     }
-    data->exprStart = data->expr;
+}
 
-    data->contentType = r->contentType;
+/* Initialize select data with settings of request that are not parsed */
+static
+void corto_selectInit(
+    corto_select_data *data,
+    struct corto_selectRequest *r)
+{
     data->mountsLoaded = -1;
     data->offset = r->offset;
     data->limit = r->limit;
-    if (r->type && strlen(r->type)) {
-        data->typeFilter = strdup(r->type);
-    } else {
-        data->typeFilter = NULL;
-    }
-    if (r->instanceof) {
-        data->instanceof = corto_resolve(NULL, r->instanceof);
-        if (!data->instanceof) {
-            corto_throw("type '%s' specified in instanceof not found", r->instanceof);
-            goto error;
-        }
-    }
     data->soffset = r->soffset;
     data->slimit = r->slimit;
     data->from = r->from;
@@ -1580,6 +2157,9 @@ corto_resultIter corto_selectPrepareIterator (
     data->queryStore = r->queryStore;
     data->queryVstore = r->queryVstore;
     data->yield_unknown = r->yield_unknown;
+    data->parallel =
+        r->parallel && !r->isHistoricalQuery && !r->mountAction && !r->counted;
+    data->counted = r->counted;
     data->item.parent = data->parent;
     data->item.name = data->name;
     data->item.type = data->type;
@@ -1590,6 +2170,48 @@ corto_resultIter corto_selectPrepareIterator (
     data->mount = r->mount;
     data->valueAllocated = FALSE;
     data->mountMask = r->mountMask;
+}
+
+static
+corto_resultIter corto_selectPrepareIterator (
+    struct corto_selectRequest *r)
+{
+    corto_select_data *data = corto_calloc(sizeof(corto_select_data));
+
+    corto_resultIter result;
+    memset(&result, 0, sizeof(corto_resultIter));
+
+    corto_selectInit(data, r);
+
+    data->scope = corto_selectNormalizeScope(r->scope);
+    data->expr = corto_selectTakeExpr(r);
+    data->exprStart = data->expr;
+
+    data->contentType = r->contentType;
+    if (r->type && strlen(r->type)) {
+        data->typeFilter = strdup(r->type);
+    } else {
+        data->typeFilter = NULL;
+    }
+    if (r->instanceof) {
+        data->instanceof = corto_resolve(NULL, r->instanceof);
+        if (!data->instanceof) {
+            corto_throw("type '%s' specified in instanceof not found", r->instanceof);
+            goto error;
+        }
+    }
+    if (r->where && *r->where) {
+        data->where = corto_strdup(r->where);
+        if (!(data->whereProgram = corto_where_compile(data->where))) {
+            goto error;
+        }
+    }
+    if (r->member && *r->member) {
+        data->member = corto_strdup(r->member);
+        if (!(data->projection = corto_projection_compile(data->member))) {
+            goto error;
+        }
+    }
 
     if (data->contentType) {
         if (!(data->dstSer = corto_fmt_lookup(data->contentType))) {
@@ -1638,6 +2260,243 @@ error:
     return result;
 }
 
+/* Parse an expression of a prepared query. The parser of select is reused with
+ * temporary select data, from which the results are moved to the prepared
+ * expression. */
+static
+int16_t corto_selectPrepareExpr(
+    corto_select_prepared *p,
+    corto_select_preparedExpr *expr)
+{
+    corto_select_data *data = corto_calloc(sizeof(corto_select_data));
+    uint32_t i;
+
+    if (corto_idmatchParseIntern(&expr->program, expr->expr, TRUE, FALSE)) {
+        corto_throw("select '%s' failed", expr->expr);
+        goto error;
+    }
+
+    data->scope = p->scope;
+    data->expr = expr->expr;
+    data->program = expr->program;
+
+    if (corto_selectParse(data)) {
+        goto error;
+    }
+
+    expr->mask = data->mask;
+    expr->fullscope = data->fullscope;
+    expr->filter = data->filter;
+    if (expr->filter) {
+        expr->filterProgram = corto_idmatch_compile(expr->filter, FALSE, FALSE);
+    }
+
+    for (i = 0; data->segments[i].scope; i ++) {
+        expr->segments[i].scope = data->segments[i].scope;
+        expr->segments[i].expr = data->segments[i].expr;
+        corto_set_ref(&data->segments[i].o, NULL);
+    }
+
+    corto_dealloc(data);
+    return 0;
+error:
+    for (i = 0; data->segments[i].scope; i ++) {
+        corto_set_str(&data->segments[i].scope, NULL);
+        corto_set_str(&data->segments[i].expr, NULL);
+        corto_set_ref(&data->segments[i].o, NULL);
+    }
+    if (data->fullscope) corto_dealloc(data->fullscope);
+    corto_dealloc(data);
+    return -1;
+}
+
+static
+corto_select_prepared* corto_selectPrepare(
+    struct corto_selectRequest *r)
+{
+    corto_select_prepared *p = corto_calloc(sizeof(corto_select_prepared));
+    uint32_t i;
+
+    corto_mutex_new(&p->lock);
+
+    /* Strings of the request are not owned by the request */
+    p->request = *r;
+    p->request.scope = NULL;
+    p->request.expr = NULL;
+    p->request.type = NULL;
+    p->request.instanceof = NULL;
+    p->request.where = NULL;
+    p->request.member = NULL;
+    p->request.contentType = NULL;
+
+    p->scope = corto_selectNormalizeScope(r->scope);
+    p->exprBuffer = corto_selectTakeExpr(r);
+
+    if (r->contentType) {
+        p->contentType = corto_strdup(r->contentType);
+        if (!(p->dstSer = corto_fmt_lookup(p->contentType))) {
+            goto error;
+        }
+    }
+
+    if (r->type && strlen(r->type)) {
+        p->typeFilter = corto_strdup(r->type);
+        p->typeFilterProgram = corto_idmatch_compile(p->typeFilter, TRUE, TRUE);
+    }
+
+    if (r->instanceof) {
+        p->instanceof = corto_resolve(NULL, r->instanceof);
+        if (!p->instanceof) {
+            corto_throw("type '%s' specified in instanceof not found", r->instanceof);
+            goto error;
+        }
+    }
+
+    if (r->where && *r->where) {
+        p->where = corto_strdup(r->where);
+        if (!(p->whereProgram = corto_where_compile(p->where))) {
+            goto error;
+        }
+    }
+
+    if (r->member && *r->member) {
+        p->member = corto_strdup(r->member);
+        if (!(p->projection = corto_projection_compile(p->member))) {
+            goto error;
+        }
+    }
+
+    /* Split expression on , */
+    char *ptr = p->exprBuffer;
+    p->exprCount = 1;
+    while ((ptr = strchr(ptr, ','))) {
+        ptr ++;
+        p->exprCount ++;
+    }
+
+    p->exprs = corto_calloc(p->exprCount * sizeof(corto_select_preparedExpr));
+    p->mounts = corto_calloc(
+        p->exprCount * CORTO_MAX_SCOPE_DEPTH * sizeof(corto_mount*));
+    p->mountGeneration = corto_mount_generation;
+
+    ptr = p->exprBuffer;
+    for (i = 0; i < p->exprCount; i ++) {
+        char *next = strchr(ptr, ',');
+        if (next) {
+            *next = '\0';
+        }
+
+        p->exprs[i].expr = ptr;
+        corto_debug("expression added: '%s'", ptr);
+
+        if (corto_selectPrepareExpr(p, &p->exprs[i])) {
+            goto error;
+        }
+
+        ptr = next + 1;
+    }
+
+    return p;
+error:
+    corto_select_prepared_free(p);
+    return NULL;
+}
+
+int16_t corto_select_prepared_iter(
+    corto_select_prepared *p,
+    uint64_t offset,
+    uint64_t limit,
+    corto_resultIter *ret)
+{
+    corto_assert(p != NULL, "no prepared query provided");
+    corto_assert(ret != NULL, "no iterator provided");
+
+    corto_select_data *data = corto_calloc(sizeof(corto_select_data));
+
+    corto_log_push("select");
+    corto_debug("PREPARED '%s'", p->exprs[0].expr);
+
+    corto_selectInit(data, &p->request);
+    data->prepared = p;
+    data->offset = offset;
+    data->limit = limit;
+    data->scope = p->scope;
+    data->expr = p->exprs[0].expr;
+    data->contentType = p->contentType;
+    data->dstSer = p->dstSer;
+    data->typeFilter = p->typeFilter;
+    data->typeFilterProgram = p->typeFilterProgram;
+    data->instanceof = p->instanceof;
+    data->where = p->where;
+    data->whereProgram = p->whereProgram;
+    data->member = p->member;
+    data->projection = p->projection;
+    data->exprCount = p->exprCount - 1;
+    data->exprCurrent = 0;
+
+    memset(ret, 0, sizeof(corto_resultIter));
+    ret->ctx = data;
+    ret->hasNext = corto_selectHasNext;
+    ret->next = corto_selectNext;
+    ret->release = corto_selectRelease;
+
+    if (corto_selectRun(data)) {
+        corto_iter_release(ret);
+        goto error;
+    }
+
+    return 0;
+error:
+    return -1;
+}
+
+void corto_select_prepared_free(
+    corto_select_prepared *p)
+{
+    uint32_t i, s;
+
+    if (!p) {
+        return;
+    }
+
+    if (p->exprs) {
+        for (i = 0; i < p->exprCount; i ++) {
+            corto_select_preparedExpr *expr = &p->exprs[i];
+            if (expr->program.tokens) corto_dealloc(expr->program.tokens);
+            if (expr->fullscope) corto_dealloc(expr->fullscope);
+            if (expr->filterProgram) corto_idmatch_free(expr->filterProgram);
+            for (s = 0; expr->segments[s].scope; s ++) {
+                corto_dealloc(expr->segments[s].scope);
+                if (expr->segments[s].expr) {
+                    corto_dealloc(expr->segments[s].expr);
+                }
+            }
+        }
+        corto_dealloc(p->exprs);
+    }
+
+    if (p->mounts) {
+        for (i = 0; i < p->exprCount * CORTO_MAX_SCOPE_DEPTH; i ++) {
+            if (p->mounts[i]) corto_dealloc(p->mounts[i]);
+        }
+        corto_dealloc(p->mounts);
+    }
+
+    if (p->scope) corto_dealloc(p->scope);
+    if (p->exprBuffer) corto_dealloc(p->exprBuffer);
+    if (p->contentType) corto_dealloc(p->contentType);
+    if (p->typeFilter) corto_dealloc(p->typeFilter);
+    if (p->typeFilterProgram) corto_idmatch_free(p->typeFilterProgram);
+    if (p->instanceof) corto_release(p->instanceof);
+    if (p->where) corto_dealloc(p->where);
+    if (p->whereProgram) corto_where_free(p->whereProgram);
+    if (p->member) corto_dealloc(p->member);
+    if (p->projection) corto_projection_free(p->projection);
+
+    corto_mutex_free(&p->lock);
+    corto_dealloc(p);
+}
+
 static
 corto_select__fluent corto_select__fluentGet(void);
 
@@ -1732,6 +2591,32 @@ corto_select__fluent corto_selectorInstanceof(
     return corto_select__fluentGet();
 }
 
+static
+corto_select__fluent corto_selectorWhere(
+    const char *where)
+{
+    corto_selectRequest *request =
+      corto_tls_get(CORTO_KEY_FLUENT);
+    if (request) {
+        corto_debug("WHERE '%s'", where);
+        request->where = where;
+    }
+    return corto_select__fluentGet();
+}
+
+static
+corto_select__fluent corto_selectorMember(
+    const char *member)
+{
+    corto_selectRequest *request =
+      corto_tls_get(CORTO_KEY_FLUENT);
+    if (request) {
+        corto_debug("MEMBER '%s'", member);
+        request->member = member;
+    }
+    return corto_select__fluentGet();
+}
+
 static
 int16_t corto_selectorIter(
     corto_resultIter *ret)
@@ -1954,11 +2839,31 @@ error:
     return -1;
 }
 
+static
+corto_select_prepared* corto_selectorPrepare(void)
+{
+    corto_select_prepared *result = NULL;
+
+    corto_selectRequest *request =
+      corto_tls_get(CORTO_KEY_FLUENT);
+
+    if (request) {
+        corto_debug("PREPARE");
+        corto_tls_set(CORTO_KEY_FLUENT, NULL);
+        result = corto_selectPrepare(request);
+        corto_dealloc(request);
+    }
+
+    corto_log_pop();
+
+    return result;
+}
+
 static
 int64_t corto_selectorCount()
 {
     corto_resultIter it;
-    uint64_t count = 0;
+    uint64_t count = 0, counted = 0, offset, limit;
 
     corto_selectRequest *request =
       corto_tls_get(CORTO_KEY_FLUENT);
@@ -1966,6 +2871,16 @@ int64_t corto_selectorCount()
     if (request) {
         corto_debug("COUNT");
         corto_tls_set(CORTO_KEY_FLUENT, NULL);
+
+        /* Counting doesn't need values. Offset and limit are applied to the
+         * total, so that results can be counted without iterating them. */
+        offset = request->offset;
+        limit = request->limit;
+        request->contentType = NULL;
+        request->offset = 0;
+        request->limit = 0;
+        request->counted = &counted;
+
         it = corto_selectPrepareIterator(request);
         if (request->err) {
             goto error;
@@ -1976,6 +2891,12 @@ int64_t corto_selectorCount()
             corto_iter_next(&it);
             count ++;
         }
+
+        count += counted;
+        count = count > offset ? count - offset : 0;
+        if (limit && count > limit) {
+            count = limit;
+        }
     }
 
     return count;
@@ -2131,6 +3052,18 @@ corto_select__fluent corto_selectorYieldUnknown(void)
     return corto_select__fluentGet();
 }
 
+static
+corto_select__fluent corto_selectorParallel(void)
+{
+    corto_selectRequest *request =
+      corto_tls_get(CORTO_KEY_FLUENT);
+    if (request) {
+        request->parallel = true;
+        corto_debug("PARALLEL 'true'");
+    }
+    return corto_select__fluentGet();
+}
+
 static corto_select__fluent corto_select__fluentGet(void)
 {
     corto_select__fluent result;
@@ -2142,6 +3075,8 @@ static corto_select__fluent corto_select__fluentGet(void)
     result.slimit = corto_selectorSlimit;
     result.type = corto_selectorType;
     result.instanceof = corto_selectorInstanceof;
+    result.where = corto_selectorWhere;
+    result.member = corto_selectorMember;
     result.fromNow = corto_selectorFromNow;
     result.fromTime = corto_selectorFromTime;
     result.toNow = corto_selectorToNow;
@@ -2154,10 +3089,12 @@ static corto_select__fluent corto_select__fluentGet(void)
     result.resume = corto_selectorResume;
     result.iter_objects = corto_selectorIterObjects;
     result.count = corto_selectorCount;
+    result.prepare = corto_selectorPrepare;
     result.instance = corto_selectorInstance;
     result.mount = corto_selectorMount;
     result.vstore = corto_selectorVstore;
     result.yield_unknown = corto_selectorYieldUnknown;
+    result.parallel = corto_selectorParallel;
     return result;
 }
 
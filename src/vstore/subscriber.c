@@ -4,6 +4,8 @@
 
 #include <corto/entityadmin.h>
 #include "src/store/object.h"
+#include "src/vstore/subscriber_index.h"
+#include "src/vstore/event_queue.h"
 #include "../platform/src/idmatch.h"
 
 extern corto_tls CORTO_KEY_SUBSCRIBER_ADMIN;
@@ -22,41 +24,35 @@ typedef struct corto_subscribeRequest {
     corto_dispatcher dispatcher;
     bool enabled;
     bool yield_unknown;
+    double rate;
     void (*callback)(corto_subscriber_event*);
 } corto_subscribeRequest;
 
 corto_entityAdmin corto_subscriber_admin = {0, 0, CORTO_RWMUTEX_INIT, 0, 0, CORTO_MUTEX_INIT, CORTO_COND_INIT};
 
-static
-int corto_subscriber_findEvent(
-    void *o1,
-    void *o2)
-{
-    corto_subscriber_event *e1 = o1, *e2 = o2;
-    if (!strcmp(e2->data.id, e1->data.id) &&
-        !strcmp(e2->data.parent, e1->data.parent))
-    {
-        return false;
-    }
-    return true;
-}
-
+/* Events that arrive while aligning replace earlier events for the same
+ * object. Must be called while holding the alignMutex. */
 static
 void corto_subscriber_addToAlignQueue(
     corto_subscriber this,
     corto_subscriber_event *e)
 {
-    void *ptr = corto_ll_findPtr(this->alignQueue, corto_subscriber_findEvent, e);
-    if (ptr) {
-        *(void**)ptr = e;
+    corto_event_queue *q = (corto_event_queue*)this->alignQueue;
+    corto_subscriber_event *replaced = corto_event_queue_add(q, e);
+    if (replaced) {
+        corto_release(replaced);
     } else {
-        corto_ll_append(this->alignQueue, e);
+        uint32_t count = corto_event_queue_count(q);
+        if (count > this->alignQueueMax) {
+            this->alignQueueMax = count;
+        }
     }
 }
 
 typedef struct corto_fmtcache {
     corto_fmt src_handle;
     void* src_ptr;
+    bool shared; /* Publisher transferred ownership of src_ptr */
     void* o;
     corto_value v;
     const char *type;
@@ -68,12 +64,14 @@ static
 corto_fmtcache corto_fmtcache_init(
     corto_fmt src_handle,
     void *src_ptr,
+    bool shared,
     void *o,
     const char *type)
 {
     corto_fmtcache result = {
         .src_handle = src_handle,
         .src_ptr = (void*)src_ptr,
+        .shared = shared,
         .o = o,
         .type = type,
         .count = 1
@@ -84,6 +82,14 @@ corto_fmtcache corto_fmtcache_init(
     result.cache[0].ptr = (uintptr_t)src_ptr;
     result.cache[0].shared_count = 0;
 
+    if (shared) {
+        /* The value of the publisher is owned by the cache, and is passed
+         * as-is to all subscribers that request the same format. The count
+         * starts at one for the reference held while notifying. */
+        result.cache[0].shared_count = (uintptr_t)malloc(sizeof(int32_t));
+        *(int32_t*)result.cache[0].shared_count = 1;
+    }
+
     if (o) {
         result.v = corto_value_object(o, NULL);
     }
@@ -158,6 +164,14 @@ corto_fmt_data* corto_fmtcache_serialize(
     }
 
     if (copy) {
+        if (!index && !this->cache[0].shared_count && this->src_ptr) {
+            /* The publisher keeps ownership of its value, which may not live
+             * longer than this notification. Copy it once, and share the copy
+             * between all asynchronous subscribers. */
+            this->cache[0].ptr = (uintptr_t)corto_fmt_copy(
+                this->src_handle, this->src_ptr);
+        }
+
         if (!this->cache[index].shared_count) {
             this->cache[index].shared_count = (uintptr_t)malloc(sizeof(int32_t));
 
@@ -182,7 +196,8 @@ static
 void corto_fmtcache_deinit(
     corto_fmtcache *this)
 {
-    /* Only cleanup first element when it has a shared count */
+    /* Only cleanup first element when it has a shared count, which is when
+     * it is a copy or when ownership was transferred by the publisher */
     if (this->cache[0].shared_count) {
         corto_fmt_data_deinit(&this->cache[0]);
     }
@@ -201,6 +216,228 @@ void corto_fmtcache_deinit(
     }
 }
 
+/* Deliver events collected for a mount in a batch, see mount.c */
+void corto_mount_notifyBatch(
+    corto_mount this,
+    corto_event_queue *events);
+
+/* Events for mounts that batch notifications, collected while notifying the
+ * samples of corto_publish_batch. */
+typedef struct corto_subscriber_batch {
+    corto_ll mounts;
+} corto_subscriber_batch;
+
+typedef struct corto_subscriber_batchMount {
+    corto_mount mount;
+    corto_event_queue *events;
+} corto_subscriber_batchMount;
+
+static
+bool corto_subscriber_batchable(
+    corto_subscriber s)
+{
+    return corto_instanceof(corto_mount_o, s) &&
+        (((corto_mount)s)->policy.mask & CORTO_MOUNT_BATCH_NOTIFY);
+}
+
+static
+void corto_subscriber_batch_add(
+    corto_subscriber_batch *batch,
+    corto_mount mount,
+    corto_subscriber_event *event)
+{
+    corto_subscriber_batchMount *elem = NULL;
+
+    if (!batch->mounts) {
+        batch->mounts = corto_ll_new();
+    } else {
+        corto_iter it = corto_ll_iter(batch->mounts);
+        while (corto_iter_hasNext(&it)) {
+            corto_subscriber_batchMount *e = corto_iter_next(&it);
+            if (e->mount == mount) {
+                elem = e;
+                break;
+            }
+        }
+    }
+
+    if (!elem) {
+        elem = corto_alloc(sizeof(corto_subscriber_batchMount));
+        elem->mount = mount;
+        elem->events = corto_event_queue_new();
+        corto_ll_append(batch->mounts, elem);
+    }
+
+    /* Like the queue of a mount with a sample rate, only keep the last event
+     * for an object */
+    corto_subscriber_event *replaced = corto_event_queue_add(elem->events, event);
+    if (replaced) {
+        corto_release(replaced);
+    }
+}
+
+static
+void corto_subscriber_batch_flush(
+    corto_subscriber_batch *batch)
+{
+    corto_subscriber_batchMount *elem;
+
+    if (!batch->mounts) {
+        return;
+    }
+
+    while ((elem = corto_ll_takeFirst(batch->mounts))) {
+        corto_mount_notifyBatch(elem->mount, elem->events);
+        corto_event_queue_free(elem->events);
+        corto_dealloc(elem);
+    }
+
+    corto_ll_free(batch->mounts);
+    batch->mounts = NULL;
+}
+
+/* Invoke the callback of a subscriber for an event */
+static
+void corto_subscriber_call(
+    corto_subscriber s,
+    corto_subscriber_event *event)
+{
+    corto_function f = corto_function(s);
+
+    if (f->kind == CORTO_PROCEDURE_CDECL) {
+        if (f->fptr) {
+            ((void(*)(corto_subscriber_event*))f->fptr)(event);
+        }
+    } else {
+        void *args[] = {&event};
+        corto_invokeb(f, NULL, args);
+    }
+}
+
+/* Events for subscribers with a rate are collected by the limiter, which only
+ * keeps the last event for an object. A thread delivers the collected events
+ * at most rate times per second, by swapping the pending queue with an empty
+ * spare queue so that publishers are only blocked for the duration of the
+ * swap. Memory used by the limiter is bounded by the number of objects that
+ * are updated between deliveries, regardless of how often they are updated.
+ * While no events are pending the thread waits on a condition variable, so
+ * idle limiters don't wake up every interval. */
+typedef struct corto_subscriber_limiter {
+    corto_subscriber subscriber;
+    corto_mutex_s lock;
+    corto_cond_s cond;         /* Signalled when events become pending */
+    corto_event_queue *events; /* Pending events, guarded by lock */
+    corto_event_queue *spare;  /* Only accessed by limiter thread */
+    corto_thread thread;
+    volatile bool quit;        /* Guarded by lock */
+} corto_subscriber_limiter;
+
+static
+void* corto_subscriber_limiter_run(
+    void *arg)
+{
+    corto_subscriber_limiter *l = arg;
+    corto_subscriber s = l->subscriber;
+    double interval = 1.0 / s->rate;
+    int32_t sec = interval;
+    uint32_t nanosec = (interval - sec) * 1000000000.0;
+
+    while (true) {
+        corto_mutex_lock(&l->lock);
+        while (!l->quit && !corto_event_queue_count(l->events)) {
+            corto_cond_wait(&l->cond, &l->lock);
+        }
+        if (l->quit) {
+            corto_mutex_unlock(&l->lock);
+            break;
+        }
+        corto_event_queue *events = l->events;
+        l->events = l->spare;
+        l->spare = events;
+        corto_mutex_unlock(&l->lock);
+
+        corto_dispatcher dispatcher = corto_observer(s)->dispatcher;
+        corto_iter it = corto_event_queue_iter(events);
+        while (corto_iter_hasNext(&it)) {
+            corto_subscriber_event *e = corto_iter_next(&it);
+            if (dispatcher) {
+                /* Queue releases events when cleared, so keep event alive
+                 * for the dispatcher */
+                corto_claim(e);
+                corto_dispatcher_post(dispatcher, (corto_event*)e);
+            } else {
+                corto_subscriber_call(s, e);
+            }
+        }
+
+        corto_event_queue_clear(events);
+
+        /* Events that arrive in the meantime are delivered together */
+        corto_sleep(sec, nanosec);
+    }
+
+    return NULL;
+}
+
+static
+corto_subscriber_limiter* corto_subscriber_limiter_new(
+    corto_subscriber s)
+{
+    corto_subscriber_limiter *l = corto_calloc(sizeof(corto_subscriber_limiter));
+    l->subscriber = s;
+    corto_mutex_new(&l->lock);
+    corto_cond_new(&l->cond);
+    l->events = corto_event_queue_new();
+    l->spare = corto_event_queue_new();
+    l->thread = corto_thread_new(corto_subscriber_limiter_run, l);
+    return l;
+}
+
+/* Stop delivering events. Publishers may still add events to the limiter
+ * until the subscriber is deallocated. */
+static
+void corto_subscriber_limiter_stop(
+    corto_subscriber_limiter *l)
+{
+    if (l->thread) {
+        corto_mutex_lock(&l->lock);
+        l->quit = true;
+        corto_cond_signal(&l->cond);
+        corto_mutex_unlock(&l->lock);
+        corto_thread_join(l->thread, NULL);
+        l->thread = 0;
+    }
+}
+
+static
+void corto_subscriber_limiter_free(
+    corto_subscriber_limiter *l)
+{
+    corto_subscriber_limiter_stop(l);
+    corto_event_queue_free(l->events);
+    corto_event_queue_free(l->spare);
+    corto_cond_free(&l->cond);
+    corto_mutex_free(&l->lock);
+    corto_dealloc(l);
+}
+
+static
+void corto_subscriber_limiter_add(
+    corto_subscriber_limiter *l,
+    corto_subscriber_event *event)
+{
+    corto_mutex_lock(&l->lock);
+    corto_subscriber_event *replaced = corto_event_queue_add(l->events, event);
+    if (!replaced && corto_event_queue_count(l->events) == 1) {
+        corto_cond_signal(&l->cond);
+    }
+    corto_mutex_unlock(&l->lock);
+
+    if (replaced) {
+        corto_release(replaced);
+    }
+}
+
 static
 int16_t corto_subscriber_invoke(
     corto_object instance,
@@ -208,12 +445,17 @@ int16_t corto_subscriber_invoke(
     corto_result *r,
     corto_subscriber s,
     corto_subscriber_event *existing_event,
-    corto_fmtcache *cache)
+    corto_fmtcache *cache,
+    corto_subscriber_batch *batch)
 {
     corto_dispatcher dispatcher = ((corto_observer)s)->dispatcher;
+    corto_subscriber_limiter *limiter = (corto_subscriber_limiter*)s->limiter;
     corto_subscriber_event *event = existing_event;
     corto_fmt_data *fmt = NULL;
-    bool synchronous = !dispatcher && !s->isAligning;
+    bool limited = limiter && !s->isAligning;
+    bool batched = batch && !dispatcher && !s->isAligning && !limited &&
+        corto_subscriber_batchable(s);
+    bool synchronous = !dispatcher && !s->isAligning && !batched && !limited;
 
     if (cache && s->fmt_handle) {
         /* Use serialization cache if available & if subscriber requests a
@@ -230,7 +472,6 @@ int16_t corto_subscriber_invoke(
         /* Deliver synchronously if the subscriber does not have a dispatcher
          * and is not aligning data. */
 
-        corto_function f = corto_function(s);
         corto_subscriber_event e;
 
         if (!event) {
@@ -248,14 +489,8 @@ int16_t corto_subscriber_invoke(
             event = &e;
         }
 
-        if (f->kind == CORTO_PROCEDURE_CDECL) {
-            if (f->fptr) {
-                ((void(*)(corto_subscriber_event*))((corto_function)s)->fptr)(event);
-            }
-        } else {
-            void *args[] = {&event};
-            corto_invokeb((corto_function)s, NULL, args);
-        }
+        corto_subscriber_call(s, event);
+
         if (event != &e) {
             /* When an existing_event was provided but needs to be synchronously
              * delivered, this is an event from the alignment queue, and can be
@@ -266,31 +501,21 @@ int16_t corto_subscriber_invoke(
         /* Asynchronously deliver event to subscriber. If no event was provided,
          * create a new one */
         if (!event) {
-            event = corto(CORTO_DECLARE, {
-                .type = corto_subscriber_event_o,
-                .attrs = -1
-            });
-            corto_set_ref(&event->subscriber, s);
-            corto_set_ref(&event->instance, instance);
-            corto_set_ref(&event->source, NULL);
-            corto_set_str(&event->data.id, r->id);
-            corto_set_str(&event->data.type, r->type);
-            corto_set_str(&event->data.parent, r->parent);
-            corto_set_ref(&event->data.object, r->object);
-            event->event = mask;
-            if (fmt) {
-                event->data.value = fmt->ptr;
-                event->fmt = *fmt;
-            } else {
-                event->data.value = r->value;
-            }
-            corto_try (corto_define(event), NULL);
+            event = corto_subscriber_event_new(s, instance, mask, r, fmt);
         }
 
         if (s->isAligning) {
             /* If this happens during alignment, add event to alignment queue.
              * Ownership of event is transferred to align queue. */
             corto_subscriber_addToAlignQueue(s, event);
+        } else if (limited) {
+            /* Ownership of event is transferred to the limiter, which delivers
+             * it to the dispatcher or callback */
+            corto_subscriber_limiter_add(limiter, event);
+        } else if (batched) {
+            /* Collect event, so the mount receives the batch at once.
+             * Ownership of event is transferred to the batch. */
+            corto_subscriber_batch_add(batch, (corto_mount)s, event);
         } else {
             /* Deliver event to dispatcher */
             corto_dispatcher_post(dispatcher, (corto_event*)event);
@@ -306,40 +531,53 @@ static
 int16_t corto_subscriber_flushAlignQueue(
     corto_subscriber s)
 {
-    corto_subscriber_event *e;
-    while ((e = corto_ll_takeFirst(s->alignQueue))) {
-        if (corto_subscriber_invoke(NULL, 0, NULL, s, e, NULL)) {
-            corto_release(e);
-            goto error;
+    corto_event_queue *q = (corto_event_queue*)s->alignQueue;
+    int16_t result = 0;
+
+    corto_iter it = corto_event_queue_iter(q);
+    while (corto_iter_hasNext(&it)) {
+        corto_subscriber_event *e = corto_iter_next(&it);
+        if (corto_subscriber_invoke(NULL, 0, NULL, s, e, NULL, NULL)) {
+            result = -1;
         }
 
         /* No need to release event. Ownership is transferred to invoke */
     }
 
-    return 0;
-error:
-    return -1;
+    corto_event_queue_reset(q);
+
+    return result;
 }
 
-int16_t corto_notify_subscribersById(
+/* Number of subscribers for a sample that are collected without allocating */
+#define CORTO_SUBSCRIBER_TARGETS (32)
+
+/* Subscriber that matches a sample. Subscriber and instance are claimed. */
+typedef struct corto_subscriber_target {
+    corto_subscriber subscriber;
+    corto_object instance;
+    char *parent; /* Relative parent, points into string of node */
+} corto_subscriber_target;
+
+/* Notify subscribers of a single sample. Matching subscribers are collected in
+ * an epoch critical section, which protects the nodes of the subscriber index.
+ * They are claimed and invoked after leaving the section, as callbacks may take
+ * a long time. */
+static
+int16_t corto_notify_subscribersSample(
     corto_eventMask mask,
     const char *path,
     const char *type,
-    const char *fmt,
-    corto_word value)
+    corto_fmt fmt_handle,
+    corto_word value,
+    bool shared,
+    corto_subscriber_batch *batch)
 {
-    /* If there are no subscribers, quickly return */
-    if (!corto_subscriber_admin.count) {
-        return 0;
-    }
-
     /* Subscribers only receive data events */
     if (!(mask & (CORTO_DEFINE|CORTO_UPDATE|CORTO_DELETE))) {
-        return 0;
-    }
-
-    /* Don't notify when shutting down */
-    if (CORTO_APP_STATUS != 0) {
+        if (shared && value) {
+            corto_fmt_release(fmt_handle, (void*)value);
+        }
         return 0;
     }
 
@@ -349,13 +587,6 @@ int16_t corto_notify_subscribersById(
     corto_object object_source = owner;
     bool value_is_object = false;
 
-    /* Lookup publisher format */
-    corto_fmt fmt_handle = fmt ? corto_fmt_lookup(fmt) : NULL;
-    if (fmt && !fmt_handle) {
-        corto_throw("failed to load format '%s'", fmt);
-        goto error;
-    }
-
     /* If value is set but no format is provided, the value is an object */
     if (!fmt_handle && value) {
         /* Use provided object as intermediate, no extra serialization needed */
@@ -366,7 +597,7 @@ int16_t corto_notify_subscribersById(
 
     /* Temporary storage for serialized values */
     corto_fmtcache cache =
-        corto_fmtcache_init(fmt_handle, (void*)value, o, type);
+        corto_fmtcache_init(fmt_handle, (void*)value, shared, o, type);
 
     /* Normalize id and path */
     const char *sep = NULL, *id = strrchr(path, '/');
@@ -389,129 +620,279 @@ int16_t corto_notify_subscribersById(
         : 0
         ;
 
-    /* Determine depth at which subscribers should start being invoked */
-    int16_t depth = corto_entityAdmin_claimDepthFromId(path);
+    /* Find nodes in subscriber index on the path of the object */
+    corto_subscriber_index_node *nodes[CORTO_MAX_SCOPE_DEPTH + 1];
+    const char *exprs[CORTO_MAX_SCOPE_DEPTH + 1];
+    char *parents[CORTO_MAX_SCOPE_DEPTH + 1];
+    corto_subscriber_target buffer[CORTO_SUBSCRIBER_TARGETS];
+    corto_subscriber_target *targets = buffer;
+    uint32_t targetCount = 0, targetSize = CORTO_SUBSCRIBER_TARGETS, t;
+    int32_t i, count;
+    int16_t result = 0;
 
-    /* Obtain global administration with subscribers */
-    corto_entityAdmin *admin = corto_entityAdmin_claim(&corto_subscriber_admin);
-    corto_try(!admin, NULL);
+    corto_epoch_enter();
 
-    do {
-        uint32_t sp, s;
-        corto_id relativeParent;
+    count = corto_subscriber_index_lookup(
+        path, nodes, exprs, CORTO_MAX_SCOPE_DEPTH + 1);
 
-        /* Walk parents at specified depth */
-        for (sp = 0; sp < admin->entities[depth].length; sp ++) {
-            corto_entityPerParent *subPerParent = &admin->entities[depth].buffer[sp];
-            bool relativeParentSet = FALSE;
+    /* Notify subscribers of the deepest nodes first */
+    for (i = count - 1; i >= 0; i --) {
+        corto_subscriber_index_node *node = nodes[i];
+        const char *expr = exprs[i];
+        int set;
 
-            /* Verify if path matches with subscribers in current branch */
-            const char *expr = corto_matchParent(subPerParent->parent, path);
-            if (!expr) {
+        parents[i] = NULL;
+
+        for (set = 0; set < 2; set ++) {
+            corto_subscriber_index_set *subs = set ? node->tree : node->scope;
+            uint32_t g, e;
+
+            if (!subs) {
                 continue;
             }
 
-            /* Walk subscribers for parent */
-            for (s = 0; s < subPerParent->entities.length; s ++) {
-                corto_entity *sub = &subPerParent->entities.buffer[s];
-                corto_subscriber s = sub->e;
-                corto_object instance = sub->instance;
+            /* Subscribers in scope set select '*', which only matches direct
+             * children of the node. */
+            if (!set && ((sep > expr) || expr[0] == '.')) {
+                continue;
+            }
 
-                if (!s->query.select) {
-                    continue;
-                }
-
-                /* If notification comes from subscriber instance, ignore */
-                if (instance && (instance == owner)) {
-                    continue;
-                }
+            for (g = 0; g < subs->groupCount; g ++) {
+                corto_subscriber_index_group *group = &subs->groups[g];
 
                 /* Verify that subscription type matches */
-                if (s->query.type && strcmp(s->query.type, type)) {
+                if (group->type && strcmp(group->type, type)) {
                     continue;
                 }
 
-                /* Id match program kind 3 is '*'. Because we already gathered
-                 * some information about the identifier, it is faster to
-                 * evaluate this simple expression here. */
-                corto_idmatch_program match = (corto_idmatch_program)s->idmatch;
-                if (match->kind != 3) {
-                    if (!corto_idmatch_run(match, expr)) {
+                for (e = group->first; e < group->first + group->count; e ++) {
+                    corto_subscriber s = subs->entries[e].subscriber;
+                    corto_object instance = subs->entries[e].instance;
+
+                    if (!s->query.select) {
                         continue;
                     }
-                } else if ((sep > expr) || expr[0] == '.') {
-                    continue;
-                }
 
-                /* Relative parent will be the same for each subscriber at same depth */
-                char *parentPtr = relativeParent;
-                if (!relativeParentSet) {
-                    char *fromptr = subPerParent->parent;
-                    /* If 'from' is '/', move up one character, This ensures that
-                     * the same relativeParent buffer can be used for subscribers
-                     * that start their from with and without '/'. */
-                    if (!fromptr[1]) {
-                        fromptr ++;
+                    /* If notification comes from subscriber instance, ignore */
+                    if (instance && (instance == owner)) {
+                        continue;
+                    }
+
+                    if (set && !corto_idmatch_run(
+                        (corto_idmatch_program)s->idmatch, expr))
+                    {
+                        continue;
+                    }
+
+                    /* Relative parent will be the same for each subscriber of
+                     * the same node */
+                    if (!parents[i]) {
+                        corto_id relativeParent;
+                        char *fromptr = node->path;
+                        /* If 'from' is '/', move up one character, This ensures
+                         * that the same relativeParent buffer can be used for
+                         * subscribers that start their from with and without
+                         * '/'. */
+                        if (!fromptr[1]) {
+                            fromptr ++;
+                        }
+                        corto_path_offset(
+                            relativeParent, fromptr, parent, sepLength, true);
+                        parents[i] = corto_strdup(relativeParent);
+                    }
+                    char *parentPtr = parents[i];
+
+                    /* Subscribers with query.from set to '/' and null share the
+                     * same computed relative parent, however for subscribers
+                     * with '/' we need to strip the initial '/' */
+                    if (s->query.from && !s->query.from[1] &&
+                        (s->query.from[0] == '/'))
+                    {
+                        if (parentPtr[0] == '/' && parentPtr[1]) {
+                            parentPtr ++;
+                        } else {
+                            parentPtr = ".";
+                        }
+                    }
+
+                    if (targetCount == targetSize) {
+                        targetSize *= 2;
+                        if (targets == buffer) {
+                            targets = corto_alloc(
+                                targetSize * sizeof(corto_subscriber_target));
+                            memcpy(targets, buffer, sizeof(buffer));
+                        } else {
+                            targets = corto_realloc(targets,
+                                targetSize * sizeof(corto_subscriber_target));
+                        }
                     }
-                    corto_path_offset(
-                        relativeParent, fromptr, parent, sepLength, true);
-                    relativeParentSet = TRUE;
-                }
 
-                /* Subscribers with query.from set to '/' and null share the
-                 * same computed relative parent, however for subscribers with
-                 * '/' we need to strip the initial '/' */
-                if (s->query.from && !s->query.from[1] && (s->query.from[0] == '/')) {
-                    if (parentPtr[0] == '/' && parentPtr[1]) {
-                        parentPtr ++;
-                    } else {
-                        parentPtr = ".";
+                    /* The index claims its subscribers and instances until
+                     * the set is reclaimed, so they can be claimed here */
+                    corto_claim(s);
+                    if (instance) {
+                        corto_claim(instance);
                     }
+                    targets[targetCount ++] = (corto_subscriber_target){
+                        .subscriber = s,
+                        .instance = instance,
+                        .parent = parentPtr
+                    };
                 }
+            }
+        }
+    }
 
-                corto_result r = {
-                  .id = (char*)id,
-                  .name = NULL,
-                  .parent = parentPtr,
-                  .type = (char*)type,
-                  .flags = 0,
-                  .object = value_is_object ? o : NULL,
-                  .owner = object_source
-                };
-
-                bool isAligning = s->isAligning;
-                if (isAligning) { corto_try(
-                    corto_mutex_lock((corto_mutex)s->alignMutex), NULL
-                );}
-                corto_subscriber_invoke(instance, mask, &r, s, NULL, &cache);
-                if (isAligning) { corto_try(
-                    corto_mutex_unlock((corto_mutex)s->alignMutex), NULL
-                );}
+    corto_epoch_exit();
+
+    for (t = 0; t < targetCount; t ++) {
+        corto_subscriber s = targets[t].subscriber;
+        corto_object instance = targets[t].instance;
+
+        if (!result) {
+            corto_result r = {
+              .id = (char*)id,
+              .name = NULL,
+              .parent = targets[t].parent,
+              .type = (char*)type,
+              .flags = 0,
+              .object = value_is_object ? o : NULL,
+              .owner = object_source
+            };
+
+            bool isAligning = s->isAligning;
+            if (isAligning &&
+                corto_mutex_lock((corto_mutex)s->alignMutex))
+            {
+                corto_raise();
+                result = -1;
+            } else {
+                corto_subscriber_invoke(
+                    instance, mask, &r, s, NULL, &cache, batch);
+                if (isAligning &&
+                    corto_mutex_unlock((corto_mutex)s->alignMutex))
+                {
+                    corto_raise();
+                    result = -1;
+                }
             }
         }
-    } while (--depth >= 0);
 
-    corto_entityAdmin_release(&corto_subscriber_admin);
-    corto_fmtcache_deinit(&cache);
-    return 0;
-error:
-    corto_entityAdmin_release(&corto_subscriber_admin);
+        corto_release(s);
+        if (instance) {
+            corto_release(instance);
+        }
+    }
+
+    for (i = 0; i < count; i ++) {
+        corto_dealloc(parents[i]);
+    }
+    if (targets != buffer) {
+        corto_dealloc(targets);
+    }
+
     corto_fmtcache_deinit(&cache);
-    return -1;
+    return result;
+}
+
+int16_t corto_notify_subscribersById(
+    corto_eventMask mask,
+    const char *path,
+    const char *type,
+    const char *fmt,
+    corto_word value,
+    bool shared)
+{
+    int16_t result;
+
+    /* If there are no subscribers or when shutting down, quickly return. A
+     * shared value is owned by the store, and must still be released. */
+    if (!corto_subscriber_admin.count || CORTO_APP_STATUS != 0) {
+        corto_fmt fmt_handle;
+        if (shared && value && fmt && (fmt_handle = corto_fmt_lookup(fmt))) {
+            corto_fmt_release(fmt_handle, (void*)value);
+        }
+        return 0;
+    }
+
+    /* Lookup publisher format */
+    corto_fmt fmt_handle = fmt ? corto_fmt_lookup(fmt) : NULL;
+    if (fmt && !fmt_handle) {
+        corto_throw("failed to load format '%s'", fmt);
+        return -1;
+    }
+
+    result = corto_notify_subscribersSample(
+        mask, path, type, fmt_handle, value, shared && fmt_handle, NULL);
+
+    return result;
+}
+
+int16_t corto_notify_subscribersBatch(
+    const char *fmt,
+    corto_publish_sample *samples,
+    uint32_t count)
+{
+    corto_subscriber_batch batch = {0};
+    int16_t result = 0;
+    uint32_t i;
+
+    if (!corto_subscriber_admin.count) {
+        return 0;
+    }
+
+    if (CORTO_APP_STATUS != 0) {
+        return 0;
+    }
+
+    /* Format is resolved once for all samples */
+    corto_fmt fmt_handle = fmt ? corto_fmt_lookup(fmt) : NULL;
+    if (fmt && !fmt_handle) {
+        corto_throw("failed to load format '%s'", fmt);
+        return -1;
+    }
+
+    for (i = 0; i < count; i ++) {
+        corto_publish_sample *sample = &samples[i];
+        if (corto_notify_subscribersSample(
+            sample->event,
+            sample->id,
+            sample->type,
+            fmt_handle,
+            (corto_word)sample->value,
+            false,
+            &batch))
+        {
+            result = -1;
+            break;
+        }
+    }
+
+    /* Deliver collected events at once, as batch handlers of mounts may take
+     * a long time */
+    corto_subscriber_batch_flush(&batch);
+
+    return result;
 }
 
 int16_t corto_notify_subscribers(corto_eventMask mask, corto_object o) {
     int16_t result = 0;
 
     if (corto_subscriber_admin.count && corto_check_attr(o, CORTO_ATTR_NAMED)) {
-        corto_id path, type;
+        corto_type t = corto_typeof(o);
+        corto_id type;
 
+        /* Anonymous types are not cached, don't use the stringcache for them
+         * as it may be overwritten while notifying subscribers */
         result = corto_notify_subscribersById(
           mask,
-          corto_fullpath(path, o),
-          corto_fullpath(type, corto_typeof(o)),
+          corto_pathof(o),
+          corto_check_attr(t, CORTO_ATTR_NAMED)
+            ? corto_pathof(t)
+            : corto_fullpath(type, t),
           NULL,
-          (corto_word)o);
+          (corto_word)o,
+          false);
     }
 
     return result;
@@ -541,6 +922,7 @@ corto_subscriber corto_subscribeSubscribe(
     corto_set_ref(&((corto_observer)s)->instance, r->instance);
     corto_set_ref(&((corto_observer)s)->dispatcher, r->dispatcher);
     corto_set_str(&s->query.type, r->type);
+    s->rate = r->rate;
     ((corto_observer)s)->enabled = r->enabled;
     ((corto_function)s)->fptr = (corto_word)r->callback;
     ((corto_function)s)->kind = CORTO_PROCEDURE_CDECL;
@@ -636,6 +1018,18 @@ corto_subscribe__fluent corto_subscribeYieldUnknown(void)
     return corto_subscribe__fluentGet();
 }
 
+static
+corto_subscribe__fluent corto_subscribeRate(
+    double rate)
+{
+    corto_subscribeRequest *request = corto_tls_get(CORTO_KEY_FLUENT);
+    if (request) {
+        request->rate = rate;
+    }
+
+    return corto_subscribe__fluentGet();
+}
+
 static
 corto_subscriber corto_subscribeCallback(
     void (*callback)(corto_subscriber_event*))
@@ -700,6 +1094,7 @@ corto_subscribe__fluent corto_subscribe__fluentGet(void)
     result.dispatcher = corto_subscribeDispatcher;
     result.mount = corto_subscribeMount;
     result.yield_unknown = corto_subscribeYieldUnknown;
+    result.rate = corto_subscribeRate;
     return result;
 }
 
@@ -743,6 +1138,8 @@ uint16_t corto_subscriber_unsubscribeIntern(
         goto error;
     }
 
+    corto_subscriber_index_remove(this->query.from, this, instance, removeAll);
+
     /* Unsubscribe outside of lock for every instance that is unsubscribed */
     for (i = 0; i < count; i ++) {
         corto_select(this->query.select)
@@ -803,6 +1200,17 @@ int16_t corto_subscriber_construct(
         goto error;
     }
 
+    /* A rate of zero disables rate limiting. Written as a negation so that
+     * NaN is rejected as well. */
+    if (!(this->rate >= 0)) {
+        corto_throw("invalid rate %f for subscriber", this->rate);
+        goto error;
+    }
+
+    if (this->rate && !this->limiter) {
+        this->limiter = (corto_word)corto_subscriber_limiter_new(this);
+    }
+
     if (this->query.type) {
         corto_type type = corto_resolve(NULL, this->query.type);
         if (type) {
@@ -835,6 +1243,12 @@ void corto_subscriber_deinit(
     /* Delete idmatch resources only when subscriber itself is deallocated
      * as notifications might still take place when subscriber is deleted. */
     corto_idmatch_free((corto_idmatch_program)this->idmatch);
+    corto_event_queue_free((corto_event_queue*)this->alignQueue);
+
+    /* Events may still have been added to the limiter after it was stopped */
+    if (this->limiter) {
+        corto_subscriber_limiter_free((corto_subscriber_limiter*)this->limiter);
+    }
 }
 
 void corto_subscriber_destruct(
@@ -842,6 +1256,12 @@ void corto_subscriber_destruct(
 {
     /* Unsubscribe all entities of this subscriber */
     corto_subscriber_unsubscribeIntern(this, NULL, TRUE);
+
+    /* Don't deliver events after the subscriber has been deleted */
+    if (this->limiter) {
+        corto_subscriber_limiter_stop((corto_subscriber_limiter*)this->limiter);
+    }
+
     corto_mutex_free((corto_mutex)this->alignMutex);
     free((corto_mutex)this->alignMutex);
 
@@ -866,7 +1286,7 @@ int16_t corto_subscriber_init(
         goto error;
     }
 
-    this->alignQueue = corto_ll_new();
+    this->alignQueue = (corto_word)corto_event_queue_new();
 
     return safe_corto_function_init(this);
 error:
@@ -898,6 +1318,9 @@ int16_t corto_subscriber_subscribe(
         this,
         instance);
 
+    /* Add subscriber to index used by publishers */
+    corto_subscriber_index_add(this->query.from, this, instance);
+
     /* If subscriber was not yet enabled, subscribe to mounts */
     int16_t ret;
 
@@ -921,6 +1344,8 @@ int16_t corto_subscriber_subscribe(
     corto_claim(this);
 
     /* Align subscriber */
+    corto_time start, stop;
+    corto_time_get(&start);
     corto_mutex_lock((corto_mutex)this->alignMutex);
     this->isAligning = true;
 
@@ -928,7 +1353,7 @@ int16_t corto_subscriber_subscribe(
      * alignment has started */
     corto_observer(this)->enabled = TRUE;
 
-    if (corto_ll_count(this->alignQueue)) {
+    if (corto_event_queue_count((corto_event_queue*)this->alignQueue)) {
         corto_warning("messages in align queue before aligned messages");
     }
 
@@ -936,7 +1361,8 @@ int16_t corto_subscriber_subscribe(
      * end up in the queue */
     while (corto_iter_hasNext(&it)) {
         corto_result *r = corto_iter_next(&it);
-        corto_subscriber_invoke(instance, CORTO_DEFINE, r, this, NULL, NULL);
+        corto_subscriber_invoke(
+            instance, CORTO_DEFINE, r, this, NULL, NULL, NULL);
 
         /* Nifty trick to take ownership of the serialized value- that way there
          * is no need to make a copy. The corto_select function will now not
@@ -953,6 +1379,10 @@ int16_t corto_subscriber_subscribe(
     }
     corto_mutex_unlock((corto_mutex)this->alignMutex);
 
+    corto_time_get(&stop);
+    stop = corto_time_sub(stop, start);
+    this->alignDuration = (uint64_t)stop.sec * 1000000000 + stop.nanosec;
+
     return 0;
 error:
     return -1;
@@ -0,0 +1,554 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <corto/corto.h>
+#include "src/store/object.h"
+#include "src/vstore/subscriber_index.h"
+#include "../platform/src/idmatch.h"
+
+/* Id match program kind of the '*' expression */
+#define CORTO_SUBSCRIBER_INDEX_SCOPE_KIND (3)
+
+static corto_mutex_s corto_subscriber_index_lock = CORTO_MUTEX_INIT;
+
+static corto_subscriber_index_node corto_subscriber_index_root = {
+    .path = "/"
+};
+
+/* Compare id of node with path segment of length len */
+static
+int corto_subscriber_index_cmp(
+    const char *id,
+    const char *segment,
+    size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i ++) {
+        int ch1 = tolower((unsigned char)id[i]);
+        int ch2 = tolower((unsigned char)segment[i]);
+        if (ch1 != ch2) {
+            return ch1 - ch2;
+        }
+    }
+
+    return id[len] ? 1 : 0;
+}
+
+/* Find child of node for segment. If not found, returns NULL and sets pos to
+ * the position at which the child should be inserted. */
+static
+corto_subscriber_index_node* corto_subscriber_index_find(
+    corto_subscriber_index_node *node,
+    const char *segment,
+    size_t len,
+    uint32_t *pos)
+{
+    corto_subscriber_index_children *children = node->children;
+    uint32_t lo = 0, hi = children ? children->count : 0;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int cmp = corto_subscriber_index_cmp(
+            children->nodes[mid]->id, segment, len);
+        if (!cmp) {
+            return children->nodes[mid];
+        } else if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (pos) {
+        *pos = lo;
+    }
+
+    return NULL;
+}
+
+/* Free callback for child arrays, which are allocated as one block */
+static
+void corto_subscriber_index_dealloc(
+    void *ptr)
+{
+    corto_dealloc(ptr);
+}
+
+/* Free set. A set claims the subscribers and instances of its entries, so
+ * that they stay alive for publishers that are still reading the set after it
+ * has been replaced. When corto shuts down claims are not released, as objects
+ * may be released after their types have been deinitialized. */
+static
+void corto_subscriber_index_set_dealloc(
+    corto_subscriber_index_set *set,
+    bool release)
+{
+    if (set && release) {
+        uint32_t i;
+        for (i = 0; i < set->count; i ++) {
+            corto_release(set->entries[i].subscriber);
+            if (set->entries[i].instance) {
+                corto_release(set->entries[i].instance);
+            }
+        }
+    }
+
+    corto_dealloc(set);
+}
+
+/* Free callback for replaced sets */
+static
+void corto_subscriber_index_set_free(
+    void *ptr)
+{
+    corto_subscriber_index_set_dealloc(ptr, true);
+}
+
+/* Free node and its complete subtree */
+static
+void corto_subscriber_index_node_dealloc(
+    corto_subscriber_index_node *node,
+    bool release)
+{
+    corto_subscriber_index_children *children = node->children;
+
+    if (children) {
+        uint32_t i;
+        for (i = 0; i < children->count; i ++) {
+            corto_subscriber_index_node_dealloc(children->nodes[i], release);
+        }
+        corto_dealloc(children);
+    }
+
+    corto_subscriber_index_set_dealloc(node->scope, release);
+    corto_subscriber_index_set_dealloc(node->tree, release);
+    corto_dealloc(node->id);
+    corto_dealloc(node->path);
+    corto_dealloc(node);
+}
+
+/* Free callback for unlinked nodes */
+static
+void corto_subscriber_index_node_free(
+    void *ptr)
+{
+    corto_subscriber_index_node_dealloc(ptr, true);
+}
+
+static
+corto_subscriber_index_node* corto_subscriber_index_insert(
+    corto_subscriber_index_node *parent,
+    const char *segment,
+    size_t len,
+    uint32_t pos)
+{
+    corto_subscriber_index_children *old = parent->children;
+    uint32_t count = old ? old->count : 0;
+    corto_subscriber_index_node *node =
+        corto_calloc(sizeof(corto_subscriber_index_node));
+
+    node->id = corto_alloc(len + 1);
+    memcpy(node->id, segment, len);
+    node->id[len] = '\0';
+    node->path = corto_asprintf("%s/%s",
+        parent->parent ? parent->path : "", node->id);
+    node->parent = parent;
+
+    corto_subscriber_index_children *children = corto_alloc(
+        sizeof(corto_subscriber_index_children) +
+        (count + 1) * sizeof(corto_subscriber_index_node*));
+    children->count = count + 1;
+    if (old) {
+        memcpy(children->nodes, old->nodes,
+            pos * sizeof(corto_subscriber_index_node*));
+        memcpy(&children->nodes[pos + 1], &old->nodes[pos],
+            (count - pos) * sizeof(corto_subscriber_index_node*));
+    }
+    children->nodes[pos] = node;
+
+    corto_epoch_publish(&parent->children, children);
+    if (old) {
+        corto_epoch_retire(old, corto_subscriber_index_dealloc);
+    }
+
+    return node;
+}
+
+/* Unlink node from its parent and retire it */
+static
+void corto_subscriber_index_unlink(
+    corto_subscriber_index_node *node)
+{
+    corto_subscriber_index_node *parent = node->parent;
+    corto_subscriber_index_children *old = parent->children;
+    corto_subscriber_index_children *children = NULL;
+    uint32_t i, j = 0;
+
+    if (old->count > 1) {
+        children = corto_alloc(sizeof(corto_subscriber_index_children) +
+            (old->count - 1) * sizeof(corto_subscriber_index_node*));
+        children->count = old->count - 1;
+        for (i = 0; i < old->count; i ++) {
+            if (old->nodes[i] != node) {
+                children->nodes[j ++] = old->nodes[i];
+            }
+        }
+    }
+
+    corto_epoch_publish(&parent->children, children);
+    corto_epoch_retire(old, corto_subscriber_index_dealloc);
+    corto_epoch_retire(node, corto_subscriber_index_node_free);
+}
+
+/* Find node for path of 'from', and create it if create is true */
+static
+corto_subscriber_index_node* corto_subscriber_index_node_get(
+    const char *from,
+    bool create)
+{
+    corto_subscriber_index_node *node = &corto_subscriber_index_root;
+    const char *ptr = from;
+
+    while (ptr && *ptr) {
+        const char *segment, *end;
+        corto_subscriber_index_node *child;
+        uint32_t pos;
+
+        while (*ptr == '/') {
+            ptr ++;
+        }
+        if (!*ptr) {
+            break;
+        }
+
+        segment = ptr;
+        end = strchr(segment, '/');
+        if (!end) {
+            end = segment + strlen(segment);
+        }
+
+        child = corto_subscriber_index_find(node, segment, end - segment, &pos);
+        if (!child) {
+            if (!create) {
+                return NULL;
+            }
+            child = corto_subscriber_index_insert(
+                node, segment, end - segment, pos);
+        }
+
+        node = child;
+        ptr = end;
+    }
+
+    return node;
+}
+
+static
+bool corto_subscriber_index_type_equal(
+    const char *t1,
+    const char *t2)
+{
+    if (t1 == t2) {
+        return true;
+    }
+    if (!t1 || !t2) {
+        return false;
+    }
+    return !strcmp(t1, t2);
+}
+
+/* Create set from entries, grouped by type */
+static
+corto_subscriber_index_set* corto_subscriber_index_set_new(
+    corto_subscriber_index_entry *entries,
+    uint32_t count)
+{
+    corto_subscriber_index_set *set;
+    uint32_t i, g, groupCount = 0;
+    const char **types;
+
+    if (!count) {
+        return NULL;
+    }
+
+    types = corto_alloc(count * sizeof(char*));
+    for (i = 0; i < count; i ++) {
+        const char *type = entries[i].subscriber->query.type;
+        for (g = 0; g < groupCount; g ++) {
+            if (corto_subscriber_index_type_equal(types[g], type)) {
+                break;
+            }
+        }
+        if (g == groupCount) {
+            types[groupCount ++] = type;
+        }
+    }
+
+    set = corto_alloc(sizeof(corto_subscriber_index_set) +
+        groupCount * sizeof(corto_subscriber_index_group) +
+        count * sizeof(corto_subscriber_index_entry));
+    set->count = count;
+    set->groupCount = groupCount;
+    set->groups = CORTO_OFFSET(set, sizeof(corto_subscriber_index_set));
+    set->entries = CORTO_OFFSET(set->groups,
+        groupCount * sizeof(corto_subscriber_index_group));
+
+    /* Entries of a group keep the order in which they were added */
+    uint32_t first = 0;
+    for (g = 0; g < groupCount; g ++) {
+        corto_subscriber_index_group *group = &set->groups[g];
+        group->type = types[g];
+        group->first = first;
+        group->count = 0;
+        for (i = 0; i < count; i ++) {
+            if (corto_subscriber_index_type_equal(
+                entries[i].subscriber->query.type, types[g]))
+            {
+                set->entries[first + group->count] = entries[i];
+                group->count ++;
+            }
+        }
+        first += group->count;
+    }
+
+    for (i = 0; i < count; i ++) {
+        corto_claim(set->entries[i].subscriber);
+        if (set->entries[i].instance) {
+            corto_claim(set->entries[i].instance);
+        }
+    }
+
+    corto_dealloc(types);
+
+    return set;
+}
+
+/* Replace set of node. Returns the old set, which must be retired with
+ * corto_subscriber_index_set_retire after the index lock is released, as
+ * reclaiming it releases objects. */
+static
+corto_subscriber_index_set* corto_subscriber_index_set_replace(
+    corto_subscriber_index_set * volatile *ptr,
+    corto_subscriber_index_set *set)
+{
+    corto_subscriber_index_set *old = *ptr;
+    corto_epoch_publish(ptr, set);
+    return old;
+}
+
+static
+void corto_subscriber_index_set_retire(
+    corto_subscriber_index_set *set)
+{
+    if (set) {
+        corto_epoch_retire(set, corto_subscriber_index_set_free);
+    }
+}
+
+void corto_subscriber_index_add(
+    const char *from,
+    corto_subscriber subscriber,
+    corto_object instance)
+{
+    corto_subscriber_index_node *node;
+    corto_subscriber_index_set * volatile *ptr;
+    corto_idmatch_program program = (corto_idmatch_program)subscriber->idmatch;
+
+    corto_mutex_lock(&corto_subscriber_index_lock);
+
+    node = corto_subscriber_index_node_get(from, true);
+    if (program && program->kind == CORTO_SUBSCRIBER_INDEX_SCOPE_KIND) {
+        ptr = &node->scope;
+    } else {
+        ptr = &node->tree;
+    }
+
+    corto_subscriber_index_set *old = *ptr;
+    uint32_t count = old ? old->count : 0;
+    corto_subscriber_index_entry *entries =
+        corto_alloc((count + 1) * sizeof(corto_subscriber_index_entry));
+    uint32_t g, i = 0;
+
+    /* Restore order in which entries were added within their group */
+    if (old) {
+        for (g = 0; g < old->groupCount; g ++) {
+            memcpy(&entries[i], &old->entries[old->groups[g].first],
+                old->groups[g].count * sizeof(corto_subscriber_index_entry));
+            i += old->groups[g].count;
+        }
+    }
+    entries[count].subscriber = subscriber;
+    entries[count].instance = instance;
+
+    old = corto_subscriber_index_set_replace(
+        ptr, corto_subscriber_index_set_new(entries, count + 1));
+    corto_dealloc(entries);
+
+    for (; node; node = node->parent) {
+        node->count ++;
+    }
+
+    corto_mutex_unlock(&corto_subscriber_index_lock);
+
+    corto_subscriber_index_set_retire(old);
+}
+
+/* Remove matching entries from a set. Returns number of removed entries, and
+ * sets replaced to the old set if it was replaced. */
+static
+int32_t corto_subscriber_index_set_remove(
+    corto_subscriber_index_set * volatile *ptr,
+    corto_subscriber subscriber,
+    corto_object instance,
+    bool removeAll,
+    corto_subscriber_index_set **replaced)
+{
+    corto_subscriber_index_set *old = *ptr;
+    uint32_t i, count = 0;
+
+    if (!old) {
+        return 0;
+    }
+
+    corto_subscriber_index_entry *entries =
+        corto_alloc(old->count * sizeof(corto_subscriber_index_entry));
+
+    for (i = 0; i < old->count; i ++) {
+        corto_subscriber_index_entry *e = &old->entries[i];
+        if (e->subscriber != subscriber ||
+            (!removeAll && e->instance != instance))
+        {
+            entries[count ++] = *e;
+        }
+    }
+
+    int32_t removed = old->count - count;
+    if (removed) {
+        *replaced = corto_subscriber_index_set_replace(
+            ptr, corto_subscriber_index_set_new(entries, count));
+    }
+
+    corto_dealloc(entries);
+
+    return removed;
+}
+
+int32_t corto_subscriber_index_remove(
+    const char *from,
+    corto_subscriber subscriber,
+    corto_object instance,
+    bool removeAll)
+{
+    corto_subscriber_index_node *node, *empty = NULL;
+    corto_subscriber_index_set *scope = NULL, *tree = NULL;
+    int32_t removed = 0;
+
+    corto_mutex_lock(&corto_subscriber_index_lock);
+
+    node = corto_subscriber_index_node_get(from, false);
+    if (node) {
+        removed =
+            corto_subscriber_index_set_remove(
+                &node->scope, subscriber, instance, removeAll, &scope) +
+            corto_subscriber_index_set_remove(
+                &node->tree, subscriber, instance, removeAll, &tree);
+
+        /* Find topmost node of which the subtree has no more subscribers */
+        for (; node; node = node->parent) {
+            node->count -= removed;
+            if (!node->count && node->parent) {
+                empty = node;
+            }
+        }
+
+        if (empty) {
+            corto_subscriber_index_unlink(empty);
+        }
+    }
+
+    corto_mutex_unlock(&corto_subscriber_index_lock);
+
+    corto_subscriber_index_set_retire(scope);
+    corto_subscriber_index_set_retire(tree);
+
+    return removed;
+}
+
+int32_t corto_subscriber_index_lookup(
+    const char *path,
+    corto_subscriber_index_node **nodes,
+    const char **expr,
+    int32_t max)
+{
+    corto_subscriber_index_node *node = &corto_subscriber_index_root;
+    const char *ptr = path;
+    int32_t count = 0;
+
+    while (*ptr == '/') {
+        ptr ++;
+    }
+
+    while (node && count < max) {
+        nodes[count] = node;
+        expr[count] = *ptr ? ptr : ".";
+        count ++;
+
+        if (!*ptr) {
+            break;
+        }
+
+        const char *end = strchr(ptr, '/');
+        if (!end) {
+            end = ptr + strlen(ptr);
+        }
+
+        node = corto_subscriber_index_find(node, ptr, end - ptr, NULL);
+
+        ptr = end;
+        while (*ptr == '/') {
+            ptr ++;
+        }
+    }
+
+    return count;
+}
+
+void corto_subscriber_index_deinit(void)
+{
+    corto_subscriber_index_node *root = &corto_subscriber_index_root;
+    corto_subscriber_index_children *children = root->children;
+
+    if (children) {
+        uint32_t i;
+        for (i = 0; i < children->count; i ++) {
+            corto_subscriber_index_node_dealloc(children->nodes[i], false);
+        }
+        corto_dealloc(children);
+    }
+
+    corto_subscriber_index_set_dealloc(root->scope, false);
+    corto_subscriber_index_set_dealloc(root->tree, false);
+    root->children = NULL;
+    root->scope = NULL;
+    root->tree = NULL;
+    root->count = 0;
+}
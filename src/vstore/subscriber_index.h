@@ -0,0 +1,88 @@
+#ifndef CORTO_SUBSCRIBER_INDEX_H
+#define CORTO_SUBSCRIBER_INDEX_H
+
+/* The subscriber index finds the subscribers that can match a published path
+ * without evaluating every subscription. It is a trie on the segments of the
+ * 'from' path of subscribers. Publishing walks the trie along the segments of
+ * the published path, so only subscribers registered on a parent of the path
+ * (or on the path itself) are visited.
+ *
+ * Subscribers of a node are split in two sets. Subscribers that select '*' can
+ * only match direct children of the node, and are only visited when the node
+ * is the parent of the published path. All other subscribers are visited for
+ * every path in the subtree of the node, and still evaluate their expression.
+ * Within a set, subscribers are grouped by type filter, so that a publish only
+ * visits groups without type filter and the group with its own type.
+ *
+ * Publishers read the index without locking, in an epoch critical section.
+ * Writers synchronize amongst themselves, and replace the sets and child
+ * arrays of a node instead of modifying them, retiring the old ones. Like the
+ * rest of the store, segments are matched case insensitive.
+ */
+
+typedef struct corto_subscriber_index_entry {
+    corto_subscriber subscriber;
+    corto_object instance;
+} corto_subscriber_index_entry;
+
+/* Subscribers in a set with the same type filter. Type is NULL for subscribers
+ * that match any type. */
+typedef struct corto_subscriber_index_group {
+    const char *type;
+    uint32_t first;
+    uint32_t count;
+} corto_subscriber_index_group;
+
+typedef struct corto_subscriber_index_set {
+    uint32_t count;
+    uint32_t groupCount;
+    corto_subscriber_index_group *groups;
+    corto_subscriber_index_entry *entries;
+} corto_subscriber_index_set;
+
+typedef struct corto_subscriber_index_node corto_subscriber_index_node;
+
+typedef struct corto_subscriber_index_children {
+    uint32_t count;
+    corto_subscriber_index_node *nodes[]; /* Sorted by id */
+} corto_subscriber_index_children;
+
+struct corto_subscriber_index_node {
+    char *id;   /* Path segment, NULL for root */
+    char *path; /* Path of the node, as used in the 'from' of subscribers */
+    corto_subscriber_index_node *parent;
+    corto_subscriber_index_children * volatile children;
+    corto_subscriber_index_set * volatile scope; /* Subscribers that select '*' */
+    corto_subscriber_index_set * volatile tree;  /* All other subscribers */
+    uint32_t count; /* Subscribers in subtree, only accessed by writers */
+};
+
+/* Add subscriber for instance to the node for 'from' */
+void corto_subscriber_index_add(
+    const char *from,
+    corto_subscriber subscriber,
+    corto_object instance);
+
+/* Remove subscriber for instance, or for all instances if removeAll is true.
+ * Returns the number of removed entries. */
+int32_t corto_subscriber_index_remove(
+    const char *from,
+    corto_subscriber subscriber,
+    corto_object instance,
+    bool removeAll);
+
+/* Find the nodes on the path of an object, starting from root. For each node
+ * expr is set to the remainder of the path relative to the node, or "." for
+ * the node of the object itself. Returns the number of nodes found, which is
+ * at most max. Must be called in an epoch critical section, and the nodes may
+ * only be accessed until the section is left. */
+int32_t corto_subscriber_index_lookup(
+    const char *path,
+    corto_subscriber_index_node **nodes,
+    const char **expr,
+    int32_t max);
+
+/* Free the index. Called by corto_stop. */
+void corto_subscriber_index_deinit(void);
+
+#endif
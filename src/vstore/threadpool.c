@@ -0,0 +1,589 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <corto/corto.h>
+#include "src/store/object.h"
+
+/* The threadpool dispatches events to a fixed number of worker threads.
+ *
+ * Every worker has an inbox, which is a lock-free stack to which posting
+ * threads push events, and a work-stealing deque (Chase-Lev) which only the
+ * worker pushes to. A worker moves events from its inbox to its deque, and
+ * takes events from the bottom of its deque. Idle workers steal events from the
+ * top of the deques of other workers, so that a burst of events posted to one
+ * worker is spread out over the pool.
+ *
+ * When ordered is set, events are assigned to a worker by hashing the handler
+ * (subscriber or observer) and the object of the event. The worker handles them
+ * directly from its inbox in the order in which they were posted, and they are
+ * never stolen. This guarantees that a handler sees the events for an object in
+ * order, while events for different objects or handlers run in parallel.
+ *
+ * Deques grow when full. Thieves read the deque array in an epoch critical
+ * section, so the worker can retire the old array with corto_epoch_retire.
+ * Posting threads enqueue in an epoch critical section as well, so that the
+ * pool is retired instead of freed when the threadpool is destructed. */
+
+/* Number of workers when workers is not set */
+#define CORTO_THREADPOOL_WORKERS (4)
+
+/* Initial capacity of a deque. Must be a power of two. */
+#define CORTO_THREADPOOL_DEQUE_SIZE (256)
+
+typedef struct corto_threadpool_node {
+    struct corto_threadpool_node *next;
+    corto_event *event;
+    uint64_t posted; /* Time of post in nanoseconds */
+    bool ordered;
+    uint8_t slab;
+} corto_threadpool_node;
+
+typedef struct corto_threadpool_array {
+    int64_t size;
+    corto_threadpool_node *buffer[];
+} corto_threadpool_array;
+
+typedef struct corto_threadpool_worker {
+    struct corto_threadpool_impl *pool;
+    corto_thread thread;
+
+    /* Written by posting threads */
+    corto_threadpool_node * volatile inbox;
+    volatile uint64_t posted;
+
+    /* Deque. Bottom is only written by the worker, top is advanced with a CAS
+     * by the worker and by thieves. */
+    volatile int64_t top;
+    volatile int64_t bottom;
+    corto_threadpool_array * volatile array;
+
+    corto_mutex_s lock;
+    corto_cond_s cond;
+    volatile bool sleeping;
+
+    /* Only written by the worker */
+    uint64_t processed;
+    uint64_t stolen;
+    uint64_t latencyTotal;
+    uint64_t latencyMax;
+    uint64_t depthMax;
+} corto_threadpool_worker;
+
+typedef struct corto_threadpool_impl {
+    corto_threadpool_worker *workers;
+    uint32_t count;
+    int32_t next;
+    volatile bool quit;
+} corto_threadpool_impl;
+
+static
+uint64_t corto_threadpool_now(void)
+{
+    corto_time t;
+    corto_time_get(&t);
+    return (uint64_t)t.sec * 1000000000 + t.nanosec;
+}
+
+static
+uint64_t corto_threadpool_hash_str(
+    uint64_t h,
+    const char *str)
+{
+    if (str) {
+        while (*str) {
+            h = (h ^ (uint8_t)*str) * 1099511628211ULL;
+            str ++;
+        }
+    }
+    return h;
+}
+
+/* Obtain the key that determines the order of an event. Returns 0 for events
+ * that can be delivered in any order. */
+static
+uint64_t corto_threadpool_key(
+    corto_event *e)
+{
+    corto_type type = corto_typeof(e);
+    uint64_t h = 0;
+
+    if (type == corto_type(corto_subscriber_event_o)) {
+        corto_subscriber_event *event = (corto_subscriber_event*)e;
+        /* Use the identifier of the result, as data.object is not set for
+         * every event of an object */
+        h = (uintptr_t)event->subscriber;
+        h = corto_threadpool_hash_str(h, event->data.parent);
+        h = corto_threadpool_hash_str(h, event->data.id);
+    } else if (type == corto_type(corto_observer_event_o)) {
+        corto_observer_event *event = (corto_observer_event*)e;
+        h = (uintptr_t)event->observer ^ ((uintptr_t)event->data * 31);
+    }
+
+    /* Mix bits, so that aligned pointers spread evenly over workers */
+    if (h) {
+        h *= 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 32;
+    }
+
+    return h;
+}
+
+static
+void corto_threadpool_handle(
+    corto_threadpool_worker *w,
+    corto_threadpool_node *node)
+{
+    corto_event *e = node->event;
+    uint64_t latency = corto_threadpool_now() - node->posted;
+
+    w->latencyTotal += latency;
+    if (latency > w->latencyMax) {
+        w->latencyMax = latency;
+    }
+
+    corto_slab_free(node, node->slab);
+
+    corto_event_handle(e);
+    corto_release(e);
+
+    w->processed ++;
+}
+
+static
+void corto_threadpool_wake(
+    corto_threadpool_worker *w)
+{
+    corto_mutex_lock(&w->lock);
+    corto_cond_signal(&w->cond);
+    corto_mutex_unlock(&w->lock);
+}
+
+static
+void corto_threadpool_array_free(
+    void *ptr)
+{
+    corto_dealloc(ptr);
+}
+
+static
+corto_threadpool_array* corto_threadpool_array_new(
+    int64_t size)
+{
+    corto_threadpool_array *array = corto_alloc(
+        sizeof(corto_threadpool_array) + size * sizeof(corto_threadpool_node*));
+    array->size = size;
+    return array;
+}
+
+/* Double the size of the deque. Only called by the owner of the deque. */
+static
+corto_threadpool_array* corto_threadpool_grow(
+    corto_threadpool_worker *w,
+    int64_t top,
+    int64_t bottom)
+{
+    corto_threadpool_array *old = w->array;
+    corto_threadpool_array *array = corto_threadpool_array_new(old->size * 2);
+    int64_t i;
+
+    for (i = top; i < bottom; i ++) {
+        array->buffer[i & (array->size - 1)] = old->buffer[i & (old->size - 1)];
+    }
+
+    corto_epoch_publish(&w->array, array);
+    corto_epoch_retire(old, corto_threadpool_array_free);
+
+    return array;
+}
+
+/* Push node to bottom of deque. Only called by the owner of the deque. */
+static
+void corto_threadpool_push(
+    corto_threadpool_worker *w,
+    corto_threadpool_node *node)
+{
+    int64_t bottom = w->bottom;
+    int64_t top = w->top;
+    corto_threadpool_array *array = w->array;
+
+    if (bottom - top >= array->size) {
+        array = corto_threadpool_grow(w, top, bottom);
+    }
+
+    array->buffer[bottom & (array->size - 1)] = node;
+    __sync_synchronize();
+    w->bottom = bottom + 1;
+}
+
+/* Take node from bottom of deque. Only called by the owner of the deque. */
+static
+corto_threadpool_node* corto_threadpool_pop(
+    corto_threadpool_worker *w)
+{
+    int64_t bottom = w->bottom - 1;
+    corto_threadpool_array *array = w->array;
+    corto_threadpool_node *result = NULL;
+    int64_t top;
+
+    w->bottom = bottom;
+    __sync_synchronize();
+    top = w->top;
+
+    if (top <= bottom) {
+        result = array->buffer[bottom & (array->size - 1)];
+        if (top == bottom) {
+            /* Last element, race with thieves */
+            if (!__sync_bool_compare_and_swap(&w->top, top, top + 1)) {
+                result = NULL;
+            }
+            w->bottom = bottom + 1;
+        }
+    } else {
+        w->bottom = bottom + 1;
+    }
+
+    return result;
+}
+
+/* Take node from top of the deque of another worker */
+static
+corto_threadpool_node* corto_threadpool_steal_from(
+    corto_threadpool_worker *victim)
+{
+    corto_threadpool_node *result = NULL;
+    int64_t top = victim->top;
+    __sync_synchronize();
+    int64_t bottom = victim->bottom;
+
+    if (top < bottom) {
+        corto_epoch_enter();
+        corto_threadpool_array *array = victim->array;
+        result = array->buffer[top & (array->size - 1)];
+        corto_epoch_exit();
+        if (!__sync_bool_compare_and_swap(&victim->top, top, top + 1)) {
+            result = NULL;
+        }
+    }
+
+    return result;
+}
+
+static
+corto_threadpool_node* corto_threadpool_steal(
+    corto_threadpool_worker *w)
+{
+    corto_threadpool_impl *pool = w->pool;
+    uint32_t self = w - pool->workers, i;
+
+    for (i = 1; i < pool->count; i ++) {
+        corto_threadpool_worker *victim =
+            &pool->workers[(self + i) % pool->count];
+        corto_threadpool_node *node = corto_threadpool_steal_from(victim);
+        if (node) {
+            w->stolen ++;
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+/* Take all events from the inbox. Ordered events are handled immediately,
+ * others are pushed to the deque. Returns whether the inbox had events. */
+static
+bool corto_threadpool_drain(
+    corto_threadpool_worker *w)
+{
+    corto_threadpool_node *node, *next, *list = NULL, *ordered = NULL;
+    uint32_t pushed = 0, orderedCount = 0;
+
+    if (!w->inbox) {
+        return false;
+    }
+
+    node = __sync_lock_test_and_set(&w->inbox, NULL);
+
+    /* The inbox is a stack, reverse it to handle events in order of posting */
+    while (node) {
+        next = node->next;
+        node->next = list;
+        list = node;
+        node = next;
+    }
+
+    /* Split off ordered events before pushing the others, as pushed nodes can
+     * be stolen and freed right away. */
+    corto_threadpool_node **tail = &ordered;
+    for (node = list; node; node = next) {
+        next = node->next;
+        if (node->ordered) {
+            *tail = node;
+            tail = &node->next;
+            orderedCount ++;
+        } else {
+            corto_threadpool_push(w, node);
+            pushed ++;
+        }
+    }
+    *tail = NULL;
+
+    uint64_t depth = orderedCount + (w->bottom - w->top);
+    if (depth > w->depthMax) {
+        w->depthMax = depth;
+    }
+
+    /* Give idle workers the opportunity to steal from the deque */
+    if (pushed > 1) {
+        corto_threadpool_impl *pool = w->pool;
+        uint32_t i;
+        for (i = 0; i < pool->count; i ++) {
+            corto_threadpool_worker *peer = &pool->workers[i];
+            if (peer != w && peer->sleeping) {
+                corto_threadpool_wake(peer);
+                break;
+            }
+        }
+    }
+
+    for (node = ordered; node; node = next) {
+        next = node->next;
+        corto_threadpool_handle(w, node);
+    }
+
+    return true;
+}
+
+static
+void corto_threadpool_sleep(
+    corto_threadpool_worker *w)
+{
+    corto_mutex_lock(&w->lock);
+    w->sleeping = true;
+    __sync_synchronize();
+    if (!w->inbox && !w->pool->quit) {
+        corto_cond_wait(&w->cond, &w->lock);
+    }
+    w->sleeping = false;
+    corto_mutex_unlock(&w->lock);
+}
+
+static
+void* corto_threadpool_run(
+    void *arg)
+{
+    corto_threadpool_worker *w = arg;
+    corto_threadpool_node *node;
+
+    while (true) {
+        bool received = corto_threadpool_drain(w);
+
+        if ((node = corto_threadpool_pop(w))) {
+            corto_threadpool_handle(w, node);
+        } else if ((node = corto_threadpool_steal(w))) {
+            corto_threadpool_handle(w, node);
+        } else if (!received) {
+            /* Only quit when there are no more events for this worker */
+            if (w->pool->quit) {
+                break;
+            }
+            corto_threadpool_sleep(w);
+        }
+    }
+
+    return NULL;
+}
+
+int16_t corto_threadpool_construct(
+    corto_threadpool this)
+{
+    corto_threadpool_impl *pool = corto_calloc(sizeof(corto_threadpool_impl));
+    uint32_t i;
+
+    if (!this->workers) {
+        this->workers = CORTO_THREADPOOL_WORKERS;
+    }
+
+    pool->count = this->workers;
+    pool->workers = corto_calloc(
+        sizeof(corto_threadpool_worker) * pool->count);
+
+    for (i = 0; i < pool->count; i ++) {
+        corto_threadpool_worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->array = corto_threadpool_array_new(CORTO_THREADPOOL_DEQUE_SIZE);
+        corto_mutex_new(&w->lock);
+        corto_cond_new(&w->cond);
+    }
+
+    this->impl = (corto_word)pool;
+
+    /* Start threads after all workers are initialized, as they steal from each
+     * other */
+    for (i = 0; i < pool->count; i ++) {
+        corto_threadpool_worker *w = &pool->workers[i];
+        w->thread = corto_thread_new(corto_threadpool_run, w);
+        if (!w->thread) {
+            corto_throw("failed to start worker %u of threadpool", i);
+            goto error;
+        }
+    }
+
+    return 0;
+error:
+    return -1;
+}
+
+/* Free callback for a pool that was retired by corto_threadpool_destruct. No
+ * thread can be posting to the pool anymore. */
+static
+void corto_threadpool_free(
+    void *ptr)
+{
+    corto_threadpool_impl *pool = ptr;
+    uint32_t i;
+
+    for (i = 0; i < pool->count; i ++) {
+        corto_threadpool_worker *w = &pool->workers[i];
+        corto_threadpool_node *node;
+
+        /* Only contains events that were posted while shutting down, or if a
+         * worker failed to start */
+        while ((node = corto_threadpool_pop(w))) {
+            corto_release(node->event);
+            corto_slab_free(node, node->slab);
+        }
+        while ((node = w->inbox)) {
+            w->inbox = node->next;
+            corto_release(node->event);
+            corto_slab_free(node, node->slab);
+        }
+
+        corto_dealloc(w->array);
+        corto_mutex_free(&w->lock);
+        corto_cond_free(&w->cond);
+    }
+
+    corto_dealloc(pool->workers);
+    corto_dealloc(pool);
+}
+
+void corto_threadpool_destruct(
+    corto_threadpool this)
+{
+    corto_threadpool_impl *pool = (corto_threadpool_impl*)this->impl;
+    uint32_t i;
+
+    if (!pool) {
+        return;
+    }
+
+    /* Workers handle remaining events before they quit */
+    pool->quit = true;
+    __sync_synchronize();
+
+    for (i = 0; i < pool->count; i ++) {
+        corto_threadpool_worker *w = &pool->workers[i];
+        if (w->thread) {
+            corto_threadpool_wake(w);
+            corto_thread_join(w->thread, NULL);
+        }
+    }
+
+    corto_threadpool_updateMetrics(this);
+
+    /* Threads that are posting may still be using the pool */
+    corto_epoch_publish(&this->impl, 0);
+    corto_epoch_retire(pool, corto_threadpool_free);
+}
+
+void corto_threadpool_post(
+    corto_threadpool this,
+    corto_event *e)
+{
+    corto_threadpool_impl *pool;
+    corto_threadpool_worker *w;
+    corto_threadpool_node *node, *head;
+    uint64_t key = 0;
+    uint32_t index;
+    uint8_t slab;
+
+    /* Keeps the pool alive until the event is enqueued */
+    corto_epoch_enter();
+    pool = (corto_threadpool_impl*)this->impl;
+
+    /* Not constructed, or shutting down */
+    if (!pool || pool->quit) {
+        corto_epoch_exit();
+        corto_event_handle(e);
+        corto_release(e);
+        return;
+    }
+
+    if (this->ordered) {
+        key = corto_threadpool_key(e);
+    }
+
+    if (key) {
+        index = key % pool->count;
+    } else {
+        index = (uint32_t)corto_ainc(&pool->next) % pool->count;
+    }
+
+    w = &pool->workers[index];
+
+    node = corto_slab_alloc(sizeof(corto_threadpool_node), &slab);
+    node->event = e;
+    node->ordered = key != 0;
+    node->slab = slab;
+    node->posted = corto_threadpool_now();
+
+    do {
+        head = w->inbox;
+        node->next = head;
+    } while (!corto_cas(&w->inbox, head, node));
+
+    __sync_fetch_and_add(&w->posted, 1);
+    __sync_synchronize();
+
+    if (w->sleeping) {
+        corto_threadpool_wake(w);
+    }
+
+    corto_epoch_exit();
+}
+
+void corto_threadpool_updateMetrics(
+    corto_threadpool this)
+{
+    corto_threadpool_impl *pool = (corto_threadpool_impl*)this->impl;
+    uint64_t posted = 0, processed = 0, stolen = 0, latency = 0;
+    uint64_t latencyMax = 0, depthMax = 0;
+    uint32_t i;
+
+    if (!pool) {
+        return;
+    }
+
+    /* Counters are updated by workers while reading them, so the result is
+     * approximate while events are being handled. */
+    for (i = 0; i < pool->count; i ++) {
+        corto_threadpool_worker *w = &pool->workers[i];
+        posted += w->posted;
+        processed += w->processed;
+        stolen += w->stolen;
+        latency += w->latencyTotal;
+        if (w->latencyMax > latencyMax) {
+            latencyMax = w->latencyMax;
+        }
+        if (w->depthMax > depthMax) {
+            depthMax = w->depthMax;
+        }
+    }
+
+    this->posted = posted;
+    this->processed = processed;
+    this->stolen = stolen;
+    this->queueDepth = posted > processed ? posted - processed : 0;
+    this->maxQueueDepth = depthMax;
+    this->latencyAvg = processed ? latency / processed : 0;
+    this->latencyMax = latencyMax;
+}
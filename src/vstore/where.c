@@ -0,0 +1,719 @@
+/* Copyright (c) 2010-2018 the corto developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <corto/corto.h>
+#include "src/store/typecache.h"
+#include "src/vstore/where.h"
+
+typedef enum corto_where_op {
+    CORTO_WHERE_EQ,
+    CORTO_WHERE_NEQ,
+    CORTO_WHERE_LT,
+    CORTO_WHERE_LTE,
+    CORTO_WHERE_GT,
+    CORTO_WHERE_GTE,
+    CORTO_WHERE_AND,
+    CORTO_WHERE_OR,
+    CORTO_WHERE_NOT
+} corto_where_op;
+
+typedef enum corto_where_literalKind {
+    CORTO_WHERE_NULL,
+    CORTO_WHERE_BOOL,
+    CORTO_WHERE_INT,
+    CORTO_WHERE_FLOAT,
+    CORTO_WHERE_STRING
+} corto_where_literalKind;
+
+typedef struct corto_where_literal {
+    corto_where_literalKind kind;
+    int64_t i;    /* Set for bool, int and float */
+    double f;     /* Set for bool, int and float */
+    char *s;
+} corto_where_literal;
+
+typedef struct corto_where_node {
+    corto_where_op op;
+    int32_t left;  /* Operands of boolean operators */
+    int32_t right;
+    int32_t path;  /* Member path of comparison */
+    corto_where_literal literal;
+} corto_where_node;
+
+/* Fields of member paths, resolved for a type */
+typedef struct corto_where_binding corto_where_binding;
+struct corto_where_binding {
+    corto_type type;
+    corto_where_binding *next;
+    corto_typecache_field *fields[]; /* NULL if path is not found */
+};
+
+struct corto_where_program_s {
+    char *expr;
+    int32_t root;
+    corto_where_node *nodes;
+    int32_t nodeCount;
+    char **paths;
+    int32_t pathCount;
+
+    /* List of bindings is only prepended to, and read without locking */
+    corto_where_binding * volatile bindings;
+};
+
+typedef struct corto_where_parser {
+    corto_where_program program;
+    const char *ptr;
+} corto_where_parser;
+
+static
+int32_t corto_where_parseOr(
+    corto_where_parser *p);
+
+static
+int16_t corto_where_error(
+    corto_where_parser *p,
+    const char *msg)
+{
+    corto_throw("%s at column %d in where '%s'",
+        msg, (int)(p->ptr - p->program->expr) + 1, p->program->expr);
+    return -1;
+}
+
+static
+void corto_where_skipSpace(
+    corto_where_parser *p)
+{
+    while (isspace(*p->ptr)) {
+        p->ptr ++;
+    }
+}
+
+static
+bool corto_where_isIdChar(
+    char ch)
+{
+    return isalnum(ch) || ch == '_';
+}
+
+/* Match operator or keyword, and progress parser if matched */
+static
+bool corto_where_token(
+    corto_where_parser *p,
+    const char *token)
+{
+    size_t len = strlen(token);
+
+    corto_where_skipSpace(p);
+
+    if (strncmp(p->ptr, token, len)) {
+        return false;
+    }
+
+    /* Keywords must not be followed by an identifier character */
+    if (corto_where_isIdChar(token[0]) && corto_where_isIdChar(p->ptr[len])) {
+        return false;
+    }
+
+    p->ptr += len;
+    return true;
+}
+
+static
+int32_t corto_where_addNode(
+    corto_where_parser *p,
+    corto_where_op op,
+    int32_t left,
+    int32_t right)
+{
+    corto_where_program program = p->program;
+    int32_t result = program->nodeCount ++;
+
+    program->nodes = corto_realloc(
+        program->nodes, program->nodeCount * sizeof(corto_where_node));
+
+    corto_where_node *node = &program->nodes[result];
+    memset(node, 0, sizeof(corto_where_node));
+    node->op = op;
+    node->left = left;
+    node->right = right;
+    node->path = -1;
+
+    return result;
+}
+
+static
+int32_t corto_where_addPath(
+    corto_where_parser *p,
+    const char *path,
+    size_t len)
+{
+    corto_where_program program = p->program;
+    int32_t i;
+
+    for (i = 0; i < program->pathCount; i ++) {
+        if (!strncmp(program->paths[i], path, len) && !program->paths[i][len]) {
+            return i;
+        }
+    }
+
+    program->paths = corto_realloc(
+        program->paths, (program->pathCount + 1) * sizeof(char*));
+    program->paths[i] = corto_alloc(len + 1);
+    memcpy(program->paths[i], path, len);
+    program->paths[i][len] = '\0';
+
+    return program->pathCount ++;
+}
+
+static
+int16_t corto_where_parseString(
+    corto_where_parser *p,
+    corto_where_literal *literal)
+{
+    char quote = *p->ptr, *out;
+    const char *ptr = p->ptr + 1;
+
+    literal->kind = CORTO_WHERE_STRING;
+    out = literal->s = corto_alloc(strlen(ptr) + 1);
+
+    for (; *ptr && *ptr != quote; ptr ++) {
+        if (*ptr == '\\' && ptr[1]) {
+            ptr ++;
+        }
+        *(out ++) = *ptr;
+    }
+    *out = '\0';
+
+    if (!*ptr) {
+        return corto_where_error(p, "unterminated string");
+    }
+
+    p->ptr = ptr + 1;
+
+    return 0;
+}
+
+static
+int16_t corto_where_parseLiteral(
+    corto_where_parser *p,
+    corto_where_literal *literal)
+{
+    corto_where_skipSpace(p);
+
+    char ch = *p->ptr;
+
+    if (ch == '"' || ch == '\'') {
+        return corto_where_parseString(p, literal);
+    } else if (isdigit(ch) || ch == '-' || ch == '+' || ch == '.') {
+        char *end;
+        const char *ptr;
+        literal->f = strtod(p->ptr, &end);
+        if (end == p->ptr) {
+            return corto_where_error(p, "invalid number");
+        }
+
+        literal->kind = CORTO_WHERE_INT;
+        for (ptr = p->ptr; ptr < end; ptr ++) {
+            if (*ptr == '.' || *ptr == 'e' || *ptr == 'E') {
+                literal->kind = CORTO_WHERE_FLOAT;
+            }
+        }
+
+        if (literal->kind == CORTO_WHERE_INT) {
+            literal->i = strtoll(p->ptr, NULL, 10);
+        } else {
+            literal->i = literal->f;
+        }
+
+        p->ptr = end;
+    } else if (corto_where_token(p, "true")) {
+        literal->kind = CORTO_WHERE_BOOL;
+        literal->i = 1;
+        literal->f = 1;
+    } else if (corto_where_token(p, "false")) {
+        literal->kind = CORTO_WHERE_BOOL;
+    } else if (corto_where_token(p, "null")) {
+        literal->kind = CORTO_WHERE_NULL;
+    } else {
+        return corto_where_error(p, "expected literal");
+    }
+
+    return 0;
+}
+
+static
+int32_t corto_where_parseComparison(
+    corto_where_parser *p)
+{
+    corto_where_op op;
+    const char *path;
+
+    corto_where_skipSpace(p);
+
+    path = p->ptr;
+    while (corto_where_isIdChar(*p->ptr) || (*p->ptr == '.' && p->ptr != path)) {
+        p->ptr ++;
+    }
+
+    if (p->ptr == path || p->ptr[-1] == '.') {
+        corto_where_error(p, "expected member");
+        return -1;
+    }
+
+    size_t len = p->ptr - path;
+
+    if (corto_where_token(p, "==")) {
+        op = CORTO_WHERE_EQ;
+    } else if (corto_where_token(p, "!=")) {
+        op = CORTO_WHERE_NEQ;
+    } else if (corto_where_token(p, "<=")) {
+        op = CORTO_WHERE_LTE;
+    } else if (corto_where_token(p, ">=")) {
+        op = CORTO_WHERE_GTE;
+    } else if (corto_where_token(p, "<")) {
+        op = CORTO_WHERE_LT;
+    } else if (corto_where_token(p, ">")) {
+        op = CORTO_WHERE_GT;
+    } else if (corto_where_token(p, "=")) {
+        op = CORTO_WHERE_EQ;
+    } else {
+        corto_where_error(p, "expected comparison operator");
+        return -1;
+    }
+
+    int32_t result = corto_where_addNode(p, op, -1, -1);
+    p->program->nodes[result].path = corto_where_addPath(p, path, len);
+
+    if (corto_where_parseLiteral(p, &p->program->nodes[result].literal)) {
+        return -1;
+    }
+
+    return result;
+}
+
+static
+int32_t corto_where_parseUnary(
+    corto_where_parser *p)
+{
+    corto_where_skipSpace(p);
+
+    if ((p->ptr[0] == '!' && p->ptr[1] != '=') || corto_where_token(p, "not")) {
+        if (p->ptr[0] == '!') {
+            p->ptr ++;
+        }
+        int32_t operand = corto_where_parseUnary(p);
+        if (operand == -1) {
+            return -1;
+        }
+        return corto_where_addNode(p, CORTO_WHERE_NOT, operand, -1);
+    } else if (corto_where_token(p, "(")) {
+        int32_t result = corto_where_parseOr(p);
+        if (result == -1) {
+            return -1;
+        }
+        if (!corto_where_token(p, ")")) {
+            corto_where_error(p, "expected ')'");
+            return -1;
+        }
+        return result;
+    } else {
+        return corto_where_parseComparison(p);
+    }
+}
+
+static
+int32_t corto_where_parseAnd(
+    corto_where_parser *p)
+{
+    int32_t left = corto_where_parseUnary(p);
+
+    while (left != -1 &&
+          (corto_where_token(p, "&&") || corto_where_token(p, "and")))
+    {
+        int32_t right = corto_where_parseUnary(p);
+        if (right == -1) {
+            return -1;
+        }
+        left = corto_where_addNode(p, CORTO_WHERE_AND, left, right);
+    }
+
+    return left;
+}
+
+static
+int32_t corto_where_parseOr(
+    corto_where_parser *p)
+{
+    int32_t left = corto_where_parseAnd(p);
+
+    while (left != -1 &&
+          (corto_where_token(p, "||") || corto_where_token(p, "or")))
+    {
+        int32_t right = corto_where_parseAnd(p);
+        if (right == -1) {
+            return -1;
+        }
+        left = corto_where_addNode(p, CORTO_WHERE_OR, left, right);
+    }
+
+    return left;
+}
+
+corto_where_program corto_where_compile(
+    const char *expr)
+{
+    corto_where_program result = corto_calloc(sizeof(struct corto_where_program_s));
+    corto_where_parser p = {result, NULL};
+
+    result->expr = corto_strdup(expr);
+    p.ptr = result->expr;
+
+    if ((result->root = corto_where_parseOr(&p)) == -1) {
+        goto error;
+    }
+
+    corto_where_skipSpace(&p);
+    if (*p.ptr) {
+        corto_where_error(&p, "unexpected character");
+        goto error;
+    }
+
+    return result;
+error:
+    corto_where_free(result);
+    return NULL;
+}
+
+void corto_where_free(
+    corto_where_program program)
+{
+    corto_where_binding *b, *next;
+    int32_t i;
+
+    for (i = 0; i < program->nodeCount; i ++) {
+        if (program->nodes[i].literal.s) {
+            corto_dealloc(program->nodes[i].literal.s);
+        }
+    }
+
+    for (i = 0; i < program->pathCount; i ++) {
+        corto_dealloc(program->paths[i]);
+    }
+
+    for (b = program->bindings; b; b = next) {
+        next = b->next;
+        corto_release(b->type);
+        corto_dealloc(b);
+    }
+
+    if (program->nodes) corto_dealloc(program->nodes);
+    if (program->paths) corto_dealloc(program->paths);
+    corto_dealloc(program->expr);
+    corto_dealloc(program);
+}
+
+/* Find field for member path. Nested structs are stored in the typecache as a
+ * struct field, followed by the fields of the struct. */
+static
+corto_typecache_field* corto_where_resolve(
+    corto_typecache *cache,
+    const char *path)
+{
+    uint32_t i = 0, end = cache->field_count;
+    const char *ptr = path;
+
+    do {
+        const char *dot = strchr(ptr, '.');
+        size_t len = dot ? (size_t)(dot - ptr) : strlen(ptr);
+        corto_typecache_field *field = NULL;
+
+        for (; i < end; i ++) {
+            corto_typecache_field *f = &cache->fields[i];
+            if (f->name && !strncmp(f->name, ptr, len) && !f->name[len]) {
+                field = f;
+                break;
+            }
+            if (f->kind == CORTO_TC_STRUCT) {
+                i += f->data.skip;
+            }
+        }
+
+        if (!field || field->meta_flags & CORTO_TC_META_PRIVATE) {
+            return NULL;
+        }
+
+        if (!dot) {
+            return field;
+        }
+
+        if (field->kind != CORTO_TC_STRUCT) {
+            return NULL;
+        }
+
+        end = i + 1 + field->data.skip;
+        i ++;
+        ptr = dot + 1;
+    } while (true);
+}
+
+static
+corto_where_binding* corto_where_bind(
+    corto_where_program program,
+    corto_type type)
+{
+    corto_where_binding *b, *head;
+    int32_t i;
+
+    for (b = program->bindings; b; b = b->next) {
+        if (b->type == type) {
+            return b;
+        }
+    }
+
+    corto_typecache *cache = (corto_typecache*)type->typecache;
+
+    b = corto_alloc(sizeof(corto_where_binding) +
+        program->pathCount * sizeof(corto_typecache_field*));
+    b->type = type;
+    corto_claim(type);
+
+    for (i = 0; i < program->pathCount; i ++) {
+        b->fields[i] = cache ? corto_where_resolve(cache, program->paths[i]) : NULL;
+    }
+
+    /* If another thread binds the same type, the type is bound twice */
+    do {
+        head = program->bindings;
+        b->next = head;
+    } while (!__sync_bool_compare_and_swap(&program->bindings, head, b));
+
+    return b;
+}
+
+#define CORTO_WHERE_CMP(v1, v2) ((v1) < (v2) ? -1 : (v1) > (v2) ? 1 : 0)
+
+static
+bool corto_where_result(
+    corto_where_op op,
+    int cmp)
+{
+    switch(op) {
+    case CORTO_WHERE_EQ: return cmp == 0;
+    case CORTO_WHERE_NEQ: return cmp != 0;
+    case CORTO_WHERE_LT: return cmp < 0;
+    case CORTO_WHERE_LTE: return cmp <= 0;
+    case CORTO_WHERE_GT: return cmp > 0;
+    case CORTO_WHERE_GTE: return cmp >= 0;
+    default: return false;
+    }
+}
+
+static
+bool corto_where_isNumber(
+    corto_where_literal *literal)
+{
+    return literal->kind == CORTO_WHERE_INT ||
+           literal->kind == CORTO_WHERE_FLOAT ||
+           literal->kind == CORTO_WHERE_BOOL;
+}
+
+static
+bool corto_where_compareInt(
+    corto_where_node *node,
+    int64_t value)
+{
+    corto_where_literal *l = &node->literal;
+    if (!corto_where_isNumber(l)) {
+        return false;
+    } else if (l->kind == CORTO_WHERE_FLOAT) {
+        return corto_where_result(node->op, CORTO_WHERE_CMP((double)value, l->f));
+    } else {
+        return corto_where_result(node->op, CORTO_WHERE_CMP(value, l->i));
+    }
+}
+
+static
+bool corto_where_compareUint(
+    corto_where_node *node,
+    uint64_t value)
+{
+    corto_where_literal *l = &node->literal;
+    if (!corto_where_isNumber(l)) {
+        return false;
+    } else if (l->kind == CORTO_WHERE_FLOAT) {
+        return corto_where_result(node->op, CORTO_WHERE_CMP((double)value, l->f));
+    } else if (l->i < 0) {
+        return corto_where_result(node->op, 1);
+    } else {
+        return corto_where_result(node->op, CORTO_WHERE_CMP(value, (uint64_t)l->i));
+    }
+}
+
+static
+bool corto_where_compareFloat(
+    corto_where_node *node,
+    double value)
+{
+    corto_where_literal *l = &node->literal;
+    if (!corto_where_isNumber(l)) {
+        return false;
+    } else {
+        return corto_where_result(node->op, CORTO_WHERE_CMP(value, l->f));
+    }
+}
+
+static
+bool corto_where_compareString(
+    corto_where_node *node,
+    const char *value)
+{
+    corto_where_literal *l = &node->literal;
+    if (l->kind == CORTO_WHERE_NULL) {
+        return corto_where_result(node->op, value != NULL);
+    } else if (l->kind != CORTO_WHERE_STRING) {
+        return false;
+    } else if (!value) {
+        return corto_where_result(node->op, -1);
+    } else {
+        int cmp = strcmp(value, l->s);
+        return corto_where_result(node->op, CORTO_WHERE_CMP(cmp, 0));
+    }
+}
+
+static
+bool corto_where_compareReference(
+    corto_where_node *node,
+    corto_object value)
+{
+    corto_where_literal *l = &node->literal;
+    if (l->kind == CORTO_WHERE_NULL) {
+        return corto_where_result(node->op, value != NULL);
+    } else if (l->kind != CORTO_WHERE_STRING) {
+        return false;
+    } else if (!value) {
+        return corto_where_result(node->op, -1);
+    } else {
+        corto_id id;
+        char *path = corto_fullpath(id, value);
+
+        /* Paths without initial slash are relative to root */
+        if (l->s[0] != '/' && path[0] == '/') {
+            path ++;
+        }
+
+        int cmp = strcmp(path, l->s);
+        return corto_where_result(node->op, CORTO_WHERE_CMP(cmp, 0));
+    }
+}
+
+static
+bool corto_where_compare(
+    corto_where_node *node,
+    corto_typecache_field *field,
+    const void *ptr)
+{
+    if (!field) {
+        return false;
+    }
+
+    const void *value = CORTO_OFFSET(ptr, field->offset);
+    uint8_t kind = field->kind;
+
+    switch(kind) {
+    case CORTO_TC_BOOL:
+        return corto_where_compareInt(node, *(bool*)value);
+    case CORTO_TC_CHAR:
+        if (node->literal.kind == CORTO_WHERE_STRING && node->literal.s[0] &&
+            !node->literal.s[1])
+        {
+            return corto_where_result(node->op,
+                CORTO_WHERE_CMP(*(char*)value, node->literal.s[0]));
+        }
+        return corto_where_compareInt(node, *(char*)value);
+    case CORTO_TC_ENUM:
+        return corto_where_compareInt(node, *(int32_t*)value);
+    case CORTO_TC_BITMASK:
+        return corto_where_compareUint(node, *(uint32_t*)value);
+    case CORTO_TC_STRING:
+        return corto_where_compareString(node, *(char**)value);
+    case CORTO_TC_REFERENCE:
+        return corto_where_compareReference(node, *(corto_object*)value);
+    default:
+        break;
+    }
+
+    if (kind >= CORTO_TC_INT && kind < CORTO_TC_UINT) {
+        switch(field->size) {
+        case 1: return corto_where_compareInt(node, *(int8_t*)value);
+        case 2: return corto_where_compareInt(node, *(int16_t*)value);
+        case 4: return corto_where_compareInt(node, *(int32_t*)value);
+        case 8: return corto_where_compareInt(node, *(int64_t*)value);
+        }
+    } else if (kind >= CORTO_TC_BIN && kind < CORTO_TC_FLOAT) {
+        /* Unsigned integers and binary values */
+        switch(field->size) {
+        case 1: return corto_where_compareUint(node, *(uint8_t*)value);
+        case 2: return corto_where_compareUint(node, *(uint16_t*)value);
+        case 4: return corto_where_compareUint(node, *(uint32_t*)value);
+        case 8: return corto_where_compareUint(node, *(uint64_t*)value);
+        }
+    } else if (kind >= CORTO_TC_FLOAT && kind < CORTO_TC_BOOL) {
+        switch(field->size) {
+        case 4: return corto_where_compareFloat(node, *(float*)value);
+        case 8: return corto_where_compareFloat(node, *(double*)value);
+        }
+    }
+
+    /* Collections, composites and optional members can't be compared */
+    return false;
+}
+
+static
+bool corto_where_eval(
+    corto_where_program program,
+    corto_where_binding *binding,
+    const void *ptr,
+    int32_t n)
+{
+    corto_where_node *node = &program->nodes[n];
+
+    switch(node->op) {
+    case CORTO_WHERE_AND:
+        return corto_where_eval(program, binding, ptr, node->left) &&
+               corto_where_eval(program, binding, ptr, node->right);
+    case CORTO_WHERE_OR:
+        return corto_where_eval(program, binding, ptr, node->left) ||
+               corto_where_eval(program, binding, ptr, node->right);
+    case CORTO_WHERE_NOT:
+        return !corto_where_eval(program, binding, ptr, node->left);
+    default:
+        return corto_where_compare(node, binding->fields[node->path], ptr);
+    }
+}
+
+bool corto_where_match(
+    corto_where_program program,
+    corto_type type,
+    const void *ptr)
+{
+    corto_where_binding *binding = corto_where_bind(program, type);
+    return corto_where_eval(program, binding, ptr, program->root);
+}
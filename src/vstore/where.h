@@ -0,0 +1,40 @@
+#ifndef CORTO_WHERE_H
+#define CORTO_WHERE_H
+
+/* A where program is a compiled predicate on the value of an object, as used
+ * by the 'where' field of a query. A predicate compares members with literals,
+ * and combines comparisons with boolean operators, for example:
+ *
+ *   x > 10 && (name == "foo" || !(y <= 2.5))
+ *
+ * Members are identified by name, and members of nested structs by a path that
+ * is separated by '.'. Literals are numbers, strings in single or double
+ * quotes, true, false and null. The operators 'and', 'or' and 'not' may be used
+ * instead of '&&', '||' and '!'. Enumerations and bitmasks compare as integers,
+ * references compare with the full path of the object they point to.
+ *
+ * Member paths are resolved against the typecache the first time a value of a
+ * type is evaluated. The resolved fields are stored in the program, so that
+ * evaluation only reads values at known offsets. Resolved types are added to
+ * the program without locking, which allows multiple threads to evaluate the
+ * same program. A comparison on a member that a type does not have (or that
+ * cannot be compared with the literal) evaluates to false.
+ */
+
+typedef struct corto_where_program_s *corto_where_program;
+
+/* Compile predicate. Returns NULL and throws if the predicate is invalid. */
+corto_where_program corto_where_compile(
+    const char *expr);
+
+/* Free program */
+void corto_where_free(
+    corto_where_program program);
+
+/* Evaluate predicate for a value of the specified type */
+bool corto_where_match(
+    corto_where_program program,
+    corto_type type,
+    const void *ptr);
+
+#endif
@@ -736,3 +736,252 @@ void test_Compare_tc_nullListWithNullList(
     corto_delete(o1);
     corto_delete(o2);
 }
+
+void test_Compare_tc_structMemberOrder(
+    test_Compare this)
+{
+    test_struct_mixedPrimitives v1 = {0, 1};
+    test_struct_mixedPrimitives v2 = {0, 256};
+
+    /* Bytewise comparison would order these values the wrong way around */
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_LT);
+    test_assert(corto_ptr_compare(&v2, test_struct_mixedPrimitives_o, &v1) == CORTO_GT);
+
+    v1.a = -1;
+    v2.a = 1;
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_LT);
+}
+
+void test_Compare_tc_structFirstDifference(
+    test_Compare this)
+{
+    test_struct_mixedPrimitives v1 = {10, 20, false, 0, "Foo", 'a', {{1, 2}, {3, 4}}, 5};
+    test_struct_mixedPrimitives v2 = {10, 20, false, 0, "Foo", 'a', {{1, 2}, {3, 4}}, 5};
+
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_EQ);
+
+    v1.g.start.y = 1;
+    v1.h = 10;
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_LT);
+
+    v1.e = "Bar";
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_LT);
+
+    v1.e = "Zoo";
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_GT);
+}
+
+void test_Compare_tc_structFloatZero(
+    test_Compare this)
+{
+    test_struct_mixedPrimitives v1 = {0};
+    test_struct_mixedPrimitives v2 = {0};
+
+    v1.d = 0.0;
+    v2.d = -0.0;
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_EQ);
+
+    v2.d = 0.5;
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_LT);
+}
+
+void test_Compare_tc_structPrivateMember(
+    test_Compare this)
+{
+    test_struct_privateMember v1 = {10, 20, "Foo"};
+    test_struct_privateMember v2 = {10, 30, "Foo"};
+
+    test_assert(corto_ptr_compare(&v1, test_struct_privateMember_o, &v2) == CORTO_EQ);
+
+    v2.a = 5;
+    test_assert(corto_ptr_compare(&v1, test_struct_privateMember_o, &v2) == CORTO_GT);
+}
+
+void test_Compare_tc_structNested(
+    test_Compare this)
+{
+    test_Line v1 = {{10, 20}, {30, 40}};
+    test_Line v2 = {{10, 20}, {30, 40}};
+
+    test_assert(corto_ptr_compare(&v1, test_Line_o, &v2) == CORTO_EQ);
+
+    v2.stop.y = 50;
+    test_assert(corto_ptr_compare(&v1, test_Line_o, &v2) == CORTO_LT);
+
+    v2.start.x = 5;
+    test_assert(corto_ptr_compare(&v1, test_Line_o, &v2) == CORTO_GT);
+}
+
+void test_Compare_tc_allTypesInitialized(
+    test_Compare this)
+{
+    corto_objectseq scope = corto_scope_claim(test_o);
+    int i;
+
+    for (i = 0; i < scope.length; i ++) {
+        corto_object o = scope.buffer[i];
+        if (!corto_instanceof(corto_type_o, o)) {
+            continue;
+        }
+
+        corto_type t = o;
+        if (t->reference || t->kind == CORTO_VOID || t->kind == CORTO_ITERATOR) {
+            continue;
+        }
+
+        /* Default discriminator is not guaranteed to be valid */
+        if (t->kind == CORTO_COMPOSITE &&
+            corto_interface(t)->kind == CORTO_UNION)
+        {
+            continue;
+        }
+
+        void *v1 = corto_ptr_new(t);
+        void *v2 = corto_ptr_new(t);
+        test_assert(v1 != NULL);
+        test_assert(v2 != NULL);
+        test_assert(corto_ptr_compare(v1, t, v1) == CORTO_EQ);
+        test_assert(corto_ptr_compare(v1, t, v2) == CORTO_EQ);
+        test_assert(corto_ptr_compare_ser(v1, t, v2) == CORTO_EQ);
+
+        test_assert(corto_ptr_copy(v2, t, v1) == 0);
+        test_assert(corto_ptr_compare(v1, t, v2) == CORTO_EQ);
+        test_assert(corto_ptr_compare_ser(v1, t, v2) == CORTO_EQ);
+
+        corto_ptr_free(v1, t);
+        corto_ptr_free(v2, t);
+    }
+
+    corto_scope_release(scope);
+}
+
+/* Compare values with the typecache and with the serializer, and check that
+ * both return the same result */
+static
+corto_equalityKind compareBoth(
+    const void *v1,
+    corto_type type,
+    const void *v2)
+{
+    corto_equalityKind r1 = corto_ptr_compare(v1, type, v2);
+    corto_equalityKind r2 = corto_ptr_compare_ser(v1, type, v2);
+    test_assertint(r1, r2);
+    return r1;
+}
+
+static
+void compareAllPairs(
+    void *values,
+    int count,
+    corto_type type)
+{
+    int i, j;
+    uint32_t size = corto_type_sizeof(type);
+
+    for (i = 0; i < count; i ++) {
+        for (j = 0; j < count; j ++) {
+            void *v1 = CORTO_OFFSET(values, i * size);
+            void *v2 = CORTO_OFFSET(values, j * size);
+            corto_equalityKind r = compareBoth(v1, type, v2);
+            if (i == j) {
+                test_assert(r == CORTO_EQ);
+            }
+        }
+    }
+}
+
+void test_Compare_tc_crossCheckStruct(
+    test_Compare this)
+{
+    test_struct_mixedPrimitives v[] = {
+        {0, 1},
+        {0, 256},
+        {-1, 1},
+        {1, 1},
+        {10, 20, false, 0, "Foo", 'a', {{1, 2}, {3, 4}}, 5},
+        {10, 20, false, 0, "Bar", 'a', {{1, 2}, {3, 4}}, 5},
+        {10, 20, false, 0, NULL, 'a', {{1, 2}, {3, 4}}, 5},
+        {10, 20, true, 0, "Foo", 'a', {{1, 2}, {3, 4}}, 5},
+        {10, 20, false, -0.0, "Foo", 'a', {{1, 2}, {3, 4}}, 5},
+        {10, 20, false, 0.5, "Foo", 'a', {{1, 2}, {3, 4}}, 5},
+        {10, 20, false, 0, "Foo", 'b', {{1, 2}, {3, 4}}, 5},
+        {10, 20, false, 0, "Foo", 'a', {{1, 1}, {3, 4}}, 10},
+        {10, 20, false, 0, "Foo", 'a', {{1, 2}, {3, 4}}, 65535}
+    };
+
+    compareAllPairs(v, sizeof(v) / sizeof(v[0]), test_struct_mixedPrimitives_o);
+
+    test_struct_privateMember p[] = {
+        {10, 20, "Foo"},
+        {10, 30, "Foo"},
+        {5, 30, "Foo"},
+        {10, 20, "Bar"}
+    };
+
+    compareAllPairs(p, sizeof(p) / sizeof(p[0]), test_struct_privateMember_o);
+}
+
+void test_Compare_tc_crossCheckNested(
+    test_Compare this)
+{
+    test_Line l[] = {
+        {{10, 20}, {30, 40}},
+        {{10, 20}, {30, 50}},
+        {{5, 20}, {30, 50}},
+        {{10, -20}, {30, 40}}
+    };
+
+    compareAllPairs(l, sizeof(l) / sizeof(l[0]), test_Line_o);
+
+    test_Point3D p[] = {
+        {{1, 2}, 3},
+        {{1, 2}, 4},
+        {{0, 2}, 4},
+        {{1, 256}, 3}
+    };
+
+    compareAllPairs(p, sizeof(p) / sizeof(p[0]), test_Point3D_o);
+}
+
+void test_Compare_tc_crossCheckCollections(
+    test_Compare this)
+{
+    const char *values[] = {
+        "test/struct_sequenceInt{m={1,2,3}}",
+        "test/struct_sequenceInt{m={1,2,4}}",
+        "test/struct_sequenceInt{m={1,2}}",
+        "test/struct_sequenceInt{m={}}",
+        "test/struct_listInt{m={1,2,3}}",
+        "test/struct_listInt{m={1,2,4}}",
+        "test/struct_listInt{m={1,256}}",
+        "test/struct_listString{m={\"a\",\"b\"}}",
+        "test/struct_listString{m={\"a\",\"c\"}}",
+        "test/struct_listStruct{m={{1,2},{3,4}}}",
+        "test/struct_listStruct{m={{1,2},{3,5}}}",
+        "test/struct_arrayInt{m={1,2,3}}",
+        "test/struct_arrayInt{m={1,2,4}}"
+    };
+    int count = sizeof(values) / sizeof(values[0]);
+    corto_object o[sizeof(values) / sizeof(values[0])];
+    int i, j;
+
+    for (i = 0; i < count; i ++) {
+        o[i] = NULL;
+        test_assert(corto_deserialize(&o[i], "text/corto", values[i]) == 0);
+        test_assert(o[i] != NULL);
+    }
+
+    /* Compare all values of the same type */
+    for (i = 0; i < count; i ++) {
+        for (j = 0; j < count; j ++) {
+            corto_type t = corto_typeof(o[i]);
+            if (corto_typeof(o[j]) == t) {
+                compareBoth(o[i], t, o[j]);
+            }
+        }
+    }
+
+    for (i = 0; i < count; i ++) {
+        test_assert(corto_delete(o[i]) == 0);
+    }
+}
@@ -1966,3 +1966,153 @@ void test_Copy_tc_nullListToNullList(
     corto_delete(v1);
     corto_delete(v2);
 }
+
+void test_Copy_tc_structWithMixedPrimitives(
+    test_Copy this)
+{
+    test_struct_mixedPrimitives v1 = {
+        10, 20, true, 30.5, "Hello", 'a', {{1, 2}, {3, 4}}, 40
+    };
+    test_struct_mixedPrimitives v2;
+
+    test_assert(corto_ptr_init(&v2, test_struct_mixedPrimitives_o) == 0);
+    test_assert(corto_ptr_copy(&v2, test_struct_mixedPrimitives_o, &v1) == 0);
+    test_assertint(v2.a, 10);
+    test_assertint(v2.b, 20);
+    test_assert(v2.c == true);
+    test_assertflt(v2.d, 30.5);
+    test_assert(v2.e != v1.e);
+    test_assertstr(v2.e, "Hello");
+    test_assert(v2.f == 'a');
+    test_assertint(v2.g.start.x, 1);
+    test_assertint(v2.g.start.y, 2);
+    test_assertint(v2.g.stop.x, 3);
+    test_assertint(v2.g.stop.y, 4);
+    test_assertint(v2.h, 40);
+    test_assert(corto_ptr_compare(&v1, test_struct_mixedPrimitives_o, &v2) == CORTO_EQ);
+
+    test_assert(corto_ptr_deinit(&v2, test_struct_mixedPrimitives_o) == 0);
+}
+
+void test_Copy_tc_structWithPrivateMember(
+    test_Copy this)
+{
+    test_struct_privateMember v1 = {10, 20, "Hello"};
+    test_struct_privateMember v2;
+
+    test_assert(corto_ptr_init(&v2, test_struct_privateMember_o) == 0);
+    v2.b = 30;
+    test_assert(corto_ptr_copy(&v2, test_struct_privateMember_o, &v1) == 0);
+    test_assertint(v2.a, 10);
+    test_assertint(v2.b, 30);
+    test_assertstr(v2.c, "Hello");
+
+    test_assert(corto_ptr_deinit(&v2, test_struct_privateMember_o) == 0);
+}
+
+void test_Copy_tc_structWithPrivateBase(
+    test_Copy this)
+{
+    test_struct_privateBase v1 = {{10, 20}, 30};
+    test_struct_privateBase v2 = {{40, 50}, 60};
+
+    test_assert(corto_ptr_copy(&v2, test_struct_privateBase_o, &v1) == 0);
+    test_assertint(v2.super.x, 40);
+    test_assertint(v2.super.y, 50);
+    test_assertint(v2.z, 30);
+}
+
+void test_Copy_tc_nestedStructSequence(
+    test_Copy this)
+{
+    test_Point v[] = {{10, 20}, {30, 40}, {50, 60}};
+    test_CompositeSequence__create_auto(NULL, v1, 3, v);
+    test_CompositeSequence__create_auto(NULL, v2, 1, v);
+
+    test_assert(corto_copy(&v2, v1) == 0);
+    test_assertint(v2->length, 3);
+    test_assert(v2->buffer != v1->buffer);
+    test_assertint(v2->buffer[0].x, 10);
+    test_assertint(v2->buffer[0].y, 20);
+    test_assertint(v2->buffer[1].x, 30);
+    test_assertint(v2->buffer[1].y, 40);
+    test_assertint(v2->buffer[2].x, 50);
+    test_assertint(v2->buffer[2].y, 60);
+    test_assert(corto_compare(v1, v2) == CORTO_EQ);
+
+    corto_delete(v1);
+    corto_delete(v2);
+}
+
+void test_Copy_tc_nestedStructList(
+    test_Copy this)
+{
+    test_Point v[] = {{10, 20}, {30, 40}, {50, 60}};
+    test_CompositeList__create_auto(NULL, v1, 3, v);
+    test_CompositeList__create_auto(NULL, v2, 0, NULL);
+
+    test_assert(corto_copy(&v2, v1) == 0);
+    test_assertint(corto_ll_count(*v2), 3);
+    test_Point *p = test_CompositeList__get(*v2, 0);
+    test_assertint(p->x, 10);
+    test_assertint(p->y, 20);
+    p = test_CompositeList__get(*v2, 2);
+    test_assertint(p->x, 50);
+    test_assertint(p->y, 60);
+    test_assert(corto_compare(v1, v2) == CORTO_EQ);
+
+    corto_delete(v1);
+    corto_delete(v2);
+}
+
+/* Copy a value with the typecache and with the serializer, and verify that
+ * both produce the same value. Values are copied twice, so the second copy
+ * replaces the resources of the first. */
+static
+void copyTypecacheSerializer_run(
+    const char *value)
+{
+    corto_object src = NULL;
+    test_assert(corto_deserialize(&src, "text/corto", value) == 0);
+    test_assert(src != NULL);
+
+    corto_type type = corto_typeof(src);
+    corto_object dst_cache = corto_create(NULL, NULL, type);
+    test_assert(dst_cache != NULL);
+    corto_object dst_ser = corto_create(NULL, NULL, type);
+    test_assert(dst_ser != NULL);
+
+    test_assert(corto_ptr_copy(dst_cache, type, src) == 0);
+    test_assert(corto_ptr_copy(dst_cache, type, src) == 0);
+    test_assert(corto_ptr_copy_ser(dst_ser, type, src) == 0);
+    test_assert(corto_ptr_copy_ser(dst_ser, type, src) == 0);
+
+    test_assert(corto_ptr_compare(dst_cache, type, src) == CORTO_EQ);
+    test_assert(corto_ptr_compare(dst_ser, type, src) == CORTO_EQ);
+    test_assert(corto_ptr_compare(dst_cache, type, dst_ser) == CORTO_EQ);
+
+    test_assert(corto_delete(src) == 0);
+    test_assert(corto_delete(dst_cache) == 0);
+    test_assert(corto_delete(dst_ser) == 0);
+}
+
+void test_Copy_tc_copyTypecacheSerializer(
+    test_Copy this)
+{
+    copyTypecacheSerializer_run(
+        "test/struct_benchPrimitives{a=1,b=2,c=3,d=4,e=5.5,f=6.5,g=true}");
+
+    copyTypecacheSerializer_run(
+        "test/struct_benchNested{"
+            "a={{1,2},{3,4}},"
+            "b={10,20,30},"
+            "c={a=1,b=2,c=3,d=4,e=5.5,f=6.5,g=true}}");
+
+    copyTypecacheSerializer_run(
+        "test/struct_benchCollections{"
+            "a={1,2,3,4,5,6,7,8},"
+            "b={\"a\",\"bb\",\"ccc\",\"dddd\"},"
+            "c={{1,2},{3,4},{5,6},{7,8}},"
+            "d={1,2,3,4,5,6,7,8},"
+            "e={\"a\",\"bb\",\"ccc\",\"dddd\"}}");
+}
@@ -63,6 +63,49 @@ void test_Fullname_tc_anonymousPrimitive(
 
 }
 
+void test_Fullname_tc_cached(
+    test_Fullname this)
+{
+    corto_object a = corto_create(root_o, "a", corto_void_o);
+    test_assert(a != NULL);
+    corto_object b = corto_create(a, "b", corto_void_o);
+    test_assert(b != NULL);
+
+    const char *path = corto_pathof(b);
+    test_assert(path != NULL);
+    test_assertstr(path, "/a/b");
+
+    /* Path is computed once, and returned on subsequent calls */
+    test_assert(corto_pathof(b) == path);
+    test_assertstr(corto_pathof(a), "/a");
+
+    test_assert(corto_delete(b) == 0);
+    test_assert(corto_delete(a) == 0);
+}
+
+void test_Fullname_tc_cachedAnonymous(
+    test_Fullname this)
+{
+    corto_object o = corto_resolve(NULL, "test/Point{10, 20}");
+    test_assert(o != NULL);
+
+    test_assertstr(corto_pathof(o), "/test/Point{10,20}");
+    test_assert(corto_delete(o) == 0);
+}
+
+void test_Fullname_tc_cachedFromLang(
+    test_Fullname this)
+{
+    test_assertstr(corto_pathof(corto_int32_o), "int32");
+    test_assert(corto_pathof(corto_int32_o) == corto_pathof(corto_int32_o));
+}
+
+void test_Fullname_tc_cachedRoot(
+    test_Fullname this)
+{
+    test_assertstr(corto_pathof(root_o), "/");
+}
+
 void test_Fullname_tc_fromLang(
     test_Fullname this)
 {
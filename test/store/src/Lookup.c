@@ -647,3 +647,158 @@ void test_Lookup_tc_lookupAnonymousWithPartialMatch(
 
     corto_release(o);
 }
+
+/* Large scopes use an index for lookups, so create enough objects to exceed
+ * the index threshold */
+#define LARGE_SCOPE_COUNT (100)
+
+static
+char* largeScopeId(
+    corto_id buffer,
+    const char *prefix,
+    int i)
+{
+    sprintf(buffer, "%s%d", prefix, i);
+    return buffer;
+}
+
+void test_Lookup_tc_lookupLargeScope(
+    test_Lookup this)
+{
+    corto_object scope = corto_create(root_o, "scope", corto_void_o);
+    test_assert(scope != NULL);
+    corto_id id;
+
+    corto_object objects[LARGE_SCOPE_COUNT];
+    int i;
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        objects[i] = corto_create(scope, largeScopeId(id, "obj", i), corto_int32_o);
+        test_assert(objects[i] != NULL);
+    }
+
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        corto_object o = corto_lookup(scope, largeScopeId(id, "obj", i));
+        test_assert(o != NULL);
+        test_assert(o == objects[i]);
+        test_assertint(corto_countof(o), 2);
+        corto_release(o);
+
+        o = corto_lookup(NULL, largeScopeId(id, "scope/obj", i));
+        test_assert(o == objects[i]);
+        corto_release(o);
+    }
+
+    corto_object o = corto_lookup(scope, "obj");
+    test_assert(o == NULL);
+    o = corto_lookup(scope, "obj1000");
+    test_assert(o == NULL);
+
+    test_assert(corto_delete(scope) == 0);
+}
+
+void test_Lookup_tc_lookupLargeScopeCaseInsensitive(
+    test_Lookup this)
+{
+    corto_object scope = corto_create(root_o, "scope", corto_void_o);
+    test_assert(scope != NULL);
+    corto_id id;
+
+    corto_object objects[LARGE_SCOPE_COUNT];
+    int i;
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        objects[i] = corto_create(scope, largeScopeId(id, "Obj", i), corto_int32_o);
+        test_assert(objects[i] != NULL);
+    }
+
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        corto_object o = corto_lookup(scope, largeScopeId(id, "oBJ", i));
+        test_assert(o != NULL);
+        test_assert(o == objects[i]);
+        corto_release(o);
+    }
+
+    /* Declaring object with same id in different case returns existing */
+    corto_object o = corto_declare(scope, "OBJ10", corto_int32_o);
+    test_assert(o == objects[10]);
+    corto_release(o);
+
+    test_assert(corto_delete(scope) == 0);
+}
+
+void test_Lookup_tc_lookupLargeScopeDeleted(
+    test_Lookup this)
+{
+    corto_object scope = corto_create(root_o, "scope", corto_void_o);
+    test_assert(scope != NULL);
+    corto_id id;
+
+    corto_object objects[LARGE_SCOPE_COUNT];
+    int i;
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        objects[i] = corto_create(scope, largeScopeId(id, "obj", i), corto_int32_o);
+        test_assert(objects[i] != NULL);
+    }
+
+    for (i = 0; i < LARGE_SCOPE_COUNT; i += 2) {
+        test_assert(corto_delete(objects[i]) == 0);
+    }
+
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        corto_object o = corto_lookup(scope, largeScopeId(id, "obj", i));
+        if (i % 2) {
+            test_assert(o == objects[i]);
+            corto_release(o);
+        } else {
+            test_assert(o == NULL);
+        }
+    }
+
+    /* Recreate deleted objects */
+    for (i = 0; i < LARGE_SCOPE_COUNT; i += 2) {
+        objects[i] = corto_create(scope, largeScopeId(id, "obj", i), corto_int32_o);
+        test_assert(objects[i] != NULL);
+    }
+
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        corto_object o = corto_lookup(scope, largeScopeId(id, "obj", i));
+        test_assert(o == objects[i]);
+        corto_release(o);
+    }
+
+    test_assertint(corto_scope_size(scope), LARGE_SCOPE_COUNT);
+
+    test_assert(corto_delete(scope) == 0);
+}
+
+void test_Lookup_tc_lookupLargeScopeParentheses(
+    test_Lookup this)
+{
+    corto_object scope = corto_create(root_o, "scope", corto_void_o);
+    test_assert(scope != NULL);
+    corto_id id;
+
+    int i;
+    for (i = 0; i < LARGE_SCOPE_COUNT; i ++) {
+        test_assert(corto_create(scope, largeScopeId(id, "obj", i), corto_int32_o));
+    }
+
+    /* Lookups without arguments must still match ids with arguments */
+    corto_object f = corto_create(scope, "f(int32)", corto_void_o);
+    test_assert(f != NULL);
+
+    corto_object o = corto_lookup(scope, "f");
+    test_assert(o == f);
+    corto_release(o);
+
+    o = corto_lookup(scope, "obj10");
+    test_assert(o != NULL);
+    test_assertstr(corto_idof(o), "obj10");
+    corto_release(o);
+
+    test_assert(corto_delete(f) == 0);
+
+    o = corto_lookup(scope, "f");
+    test_assert(o == NULL);
+
+    test_assert(corto_delete(scope) == 0);
+}
@@ -2638,3 +2638,111 @@ void test_ObjectMgmt_tc_redeclareNestedUnknownOtherThread(
     corto_thread thr = corto_thread_new(thr_recreate_unknown, this);
     corto_thread_join(thr, NULL);
 }
+
+void test_ObjectMgmt_tc_sharedId(
+    test_ObjectMgmt this)
+{
+    corto_object pa = corto_create(root_o, "a", corto_void_o);
+    test_assert(pa != NULL);
+    corto_object pb = corto_create(root_o, "b", corto_void_o);
+    test_assert(pb != NULL);
+    corto_object a = corto_create(pa, "value", corto_int32_o);
+    test_assert(a != NULL);
+    corto_object b = corto_create(pb, "value", corto_int32_o);
+    test_assert(b != NULL);
+
+    /* Object ids are interned, so objects with the same id share memory */
+    test_assertstr(corto_idof(a), "value");
+    test_assert(corto_idof(a) == corto_idof(b));
+
+    test_assert(corto_delete(pa) == 0);
+    test_assert(corto_delete(pb) == 0);
+}
+
+void test_ObjectMgmt_tc_sharedIdDeleteOne(
+    test_ObjectMgmt this)
+{
+    corto_object pa = corto_create(root_o, "a", corto_void_o);
+    test_assert(pa != NULL);
+    corto_object pb = corto_create(root_o, "b", corto_void_o);
+    test_assert(pb != NULL);
+    corto_object a = corto_create(pa, "value", corto_int32_o);
+    test_assert(a != NULL);
+    corto_object b = corto_create(pb, "value", corto_int32_o);
+    test_assert(b != NULL);
+
+    test_assert(corto_delete(pa) == 0);
+
+    /* Id of remaining object must still be valid */
+    test_assertstr(corto_idof(b), "value");
+
+    corto_object o = corto_lookup(NULL, "b/value");
+    test_assert(o == b);
+    corto_release(o);
+
+    test_assert(corto_delete(pb) == 0);
+}
+
+void test_ObjectMgmt_tc_redeclareIdDifferentCase(
+    test_ObjectMgmt this)
+{
+    corto_object a = corto_create(root_o, "Value", corto_int32_o);
+    test_assert(a != NULL);
+
+    /* Ids with different case are the same object, and the id of the first
+     * declaration is kept */
+    corto_object b = corto_declare(root_o, "value", corto_int32_o);
+    test_assert(b == a);
+    test_assertstr(corto_idof(b), "Value");
+    corto_release(b);
+
+    test_assert(corto_delete(a) == 0);
+}
+
+void test_ObjectMgmt_tc_slabReuse(
+    test_ObjectMgmt this)
+{
+    corto_slab_stats_t before, after;
+    int i;
+
+    corto_slab_stats(&before);
+
+    for (i = 0; i < 100; i ++) {
+        corto_object o = corto_create(NULL, NULL, corto_int32_o);
+        test_assert(o != NULL);
+        test_assertint(*(int32_t*)o, 0);
+        *(int32_t*)o = i;
+        test_assert(corto_delete(o) == 0);
+    }
+
+    corto_slab_stats(&after);
+
+    /* Memory of deleted objects is reused from the thread cache */
+    test_assert(after.alloc - before.alloc >= 100);
+    test_assert(after.free - before.free >= 100);
+    test_assert(after.hit - before.hit >= 99);
+}
+
+void test_ObjectMgmt_tc_slabDisabled(
+    test_ObjectMgmt this)
+{
+    corto_slab_stats_t before, after;
+
+    corto_object a = corto_create(NULL, NULL, corto_int32_o);
+    test_assert(a != NULL);
+
+    bool prev = corto_enable_slab(false);
+
+    corto_slab_stats(&before);
+    corto_object b = corto_create(NULL, NULL, corto_int32_o);
+    test_assert(b != NULL);
+    corto_slab_stats(&after);
+    test_assert(after.fallback - before.fallback == 1);
+    test_assert(after.alloc == before.alloc);
+
+    /* Object allocated from pool is returned to pool while disabled */
+    test_assert(corto_delete(a) == 0);
+    test_assert(corto_delete(b) == 0);
+
+    corto_enable_slab(prev);
+}
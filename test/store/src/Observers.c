@@ -274,6 +274,119 @@ void test_Observers_tc_observeTypeFilter(
 
 }
 
+static int typeFilterCount[3];
+
+static
+void observeTypeFilter_onCount0(corto_observer_event *e)
+{
+    typeFilterCount[0] ++;
+}
+
+static
+void observeTypeFilter_onCount1(corto_observer_event *e)
+{
+    typeFilterCount[1] ++;
+}
+
+static
+void observeTypeFilter_onCount2(corto_observer_event *e)
+{
+    typeFilterCount[2] ++;
+}
+
+void test_Observers_tc_observeTypeFilterInstanceof(
+    test_Observers this)
+{
+    corto_object testRoot = corto_create(root_o, "testRoot", corto_void_o);
+    test_assert(testRoot != NULL);
+
+    corto_object p = corto_create(testRoot, "p", test_Point_o);
+    test_assert(p != NULL);
+
+    corto_object p3 = corto_create(testRoot, "p3", test_Point3D_o);
+    test_assert(p3 != NULL);
+
+    corto_object i = corto_create(testRoot, "i", corto_int32_o);
+    test_assert(i != NULL);
+
+    memset(typeFilterCount, 0, sizeof(typeFilterCount));
+
+    corto_observer exact = corto_observe(CORTO_UPDATE|CORTO_ON_SCOPE, testRoot)
+      .type("/test/Point")
+      .callback(observeTypeFilter_onCount0);
+    test_assert(exact != NULL);
+
+    corto_observer base = corto_observe(CORTO_UPDATE|CORTO_ON_SCOPE, testRoot)
+      .instanceof("/test/Point")
+      .callback(observeTypeFilter_onCount1);
+    test_assert(base != NULL);
+    test_assert(base->instanceOf == true);
+
+    test_assert(corto_update(p) == 0);
+    test_assertint(typeFilterCount[0], 1);
+    test_assertint(typeFilterCount[1], 1);
+
+    /* Only the instanceof observer matches the subtype */
+    test_assert(corto_update(p3) == 0);
+    test_assertint(typeFilterCount[0], 1);
+    test_assertint(typeFilterCount[1], 2);
+
+    test_assert(corto_update(i) == 0);
+    test_assertint(typeFilterCount[0], 1);
+    test_assertint(typeFilterCount[1], 2);
+
+    test_assert(corto_delete(exact) == 0);
+    test_assert(corto_delete(base) == 0);
+    test_assert(corto_delete(testRoot) == 0);
+}
+
+void test_Observers_tc_observeTypeFilterMultiple(
+    test_Observers this)
+{
+    corto_object testRoot = corto_create(root_o, "testRoot", corto_void_o);
+    test_assert(testRoot != NULL);
+
+    corto_object f = corto_create(testRoot, "f", corto_float32_o);
+    test_assert(f != NULL);
+
+    corto_object i = corto_create(testRoot, "i", corto_int32_o);
+    test_assert(i != NULL);
+
+    memset(typeFilterCount, 0, sizeof(typeFilterCount));
+
+    /* Observers with different filters and masks on the same observable */
+    corto_observer o1 = corto_observe(CORTO_UPDATE|CORTO_ON_SCOPE, testRoot)
+      .type("int32")
+      .callback(observeTypeFilter_onCount0);
+    test_assert(o1 != NULL);
+
+    corto_observer o2 = corto_observe(CORTO_DELETE|CORTO_ON_SCOPE, testRoot)
+      .type("float32")
+      .callback(observeTypeFilter_onCount1);
+    test_assert(o2 != NULL);
+
+    corto_observer o3 = corto_observe(CORTO_UPDATE|CORTO_ON_SCOPE, testRoot)
+      .callback(observeTypeFilter_onCount2);
+    test_assert(o3 != NULL);
+
+    test_assert(corto_update(f) == 0);
+    test_assert(corto_update(i) == 0);
+    test_assertint(typeFilterCount[0], 1);
+    test_assertint(typeFilterCount[1], 0);
+    test_assertint(typeFilterCount[2], 2);
+
+    test_assert(corto_delete(f) == 0);
+    test_assert(corto_delete(i) == 0);
+    test_assertint(typeFilterCount[0], 1);
+    test_assertint(typeFilterCount[1], 1);
+    test_assertint(typeFilterCount[2], 2);
+
+    test_assert(corto_delete(o1) == 0);
+    test_assert(corto_delete(o2) == 0);
+    test_assert(corto_delete(o3) == 0);
+    test_assert(corto_delete(testRoot) == 0);
+}
+
 void test_Observers_tc_observeTypeFilterNotAType(
     test_Observers this)
 {
@@ -438,3 +551,340 @@ void test_Observers_tc_observingTree(
     test_assert(corto_delete(observer) == 0);
 
 }
+
+static
+void unobserveInCallback_onUpdate(
+    corto_observer_event *e)
+{
+    test_Observers this = e->instance;
+    this->count ++;
+
+    /* Replaces the observer array that is being iterated over by notify */
+    test_assert(corto_observer_unobserve(e->observer, this, e->data) == 0);
+}
+
+static
+void unobserveInCallback_count(
+    corto_observer_event *e)
+{
+    test_Observers this = e->instance;
+    this->count ++;
+}
+
+void test_Observers_tc_unobserveInCallback(
+    test_Observers this)
+{
+    corto_object o = corto_create(NULL, NULL, corto_int32_o);
+    test_assert(o != NULL);
+
+    corto_observer observer1 = corto_observe(CORTO_UPDATE, o)
+      .instance(this)
+      .callback(unobserveInCallback_onUpdate);
+    test_assert(observer1 != NULL);
+
+    corto_observer observer2 = corto_observe(CORTO_UPDATE, o)
+      .instance(this)
+      .callback(unobserveInCallback_count);
+    test_assert(observer2 != NULL);
+
+    this->count = 0;
+    test_assert(corto_update(o) == 0);
+    test_assertint(this->count, 2);
+
+    /* First observer is no longer observing */
+    test_assert(corto_update(o) == 0);
+    test_assertint(this->count, 3);
+
+    test_assert(corto_delete(observer1) == 0);
+    test_assert(corto_delete(observer2) == 0);
+    test_assert(corto_delete(o) == 0);
+}
+
+#define OBSERVE_WHILE_NOTIFYING_UPDATES (10000)
+
+static volatile bool observeWhileNotifying_quit;
+
+static
+void observeWhileNotifying_onUpdate(
+    corto_observer_event *e)
+{
+    CORTO_UNUSED(e);
+}
+
+static
+void* observeWhileNotifying_thread(void *data) {
+    corto_object o = data;
+
+    /* Every observe and unobserve replaces the observer array of o, while
+     * the main thread is notifying observers of o */
+    while (!observeWhileNotifying_quit) {
+        corto_observer observer = corto_observe(CORTO_UPDATE, o)
+          .callback(observeWhileNotifying_onUpdate);
+        if (observer) {
+            corto_delete(observer);
+        }
+    }
+
+    return NULL;
+}
+
+void test_Observers_tc_observeWhileNotifying(
+    test_Observers this)
+{
+    int i;
+    corto_object o = corto_create(NULL, NULL, corto_int32_o);
+    test_assert(o != NULL);
+
+    corto_observer observer = corto_observe(CORTO_UPDATE, o)
+      .instance(this)
+      .callback(unobserveInCallback_count);
+    test_assert(observer != NULL);
+
+    this->count = 0;
+    observeWhileNotifying_quit = false;
+    corto_thread thr = corto_thread_new(observeWhileNotifying_thread, o);
+
+    for (i = 0; i < OBSERVE_WHILE_NOTIFYING_UPDATES; i ++) {
+        test_assert(corto_update(o) == 0);
+    }
+
+    observeWhileNotifying_quit = true;
+    corto_thread_join(thr, NULL);
+
+    test_assertint(this->count, OBSERVE_WHILE_NOTIFYING_UPDATES);
+
+    test_assert(corto_delete(observer) == 0);
+    test_assert(corto_delete(o) == 0);
+}
+
+void test_Observers_tc_observeTreeAfterNotify(
+    test_Observers this)
+{
+    corto_object a = corto_create(root_o, "a", corto_void_o);
+    test_assert(a != NULL);
+    corto_object b = corto_create(a, "b", corto_void_o);
+    test_assert(b != NULL);
+    corto_object c = corto_create(b, "c", corto_int32_o);
+    test_assert(c != NULL);
+
+    /* Notify without observers, which caches that parents have no observers */
+    test_assert(corto_update(c) == 0);
+
+    corto_observer observer = corto_observe(CORTO_UPDATE|CORTO_ON_TREE, a)
+      .instance(this)
+      .callback(unobserveInCallback_count);
+    test_assert(observer != NULL);
+
+    this->count = 0;
+    test_assert(corto_update(c) == 0);
+    test_assertint(this->count, 1);
+
+    test_assert(corto_delete(observer) == 0);
+
+    test_assert(corto_update(c) == 0);
+    test_assertint(this->count, 1);
+
+    test_assert(corto_delete(a) == 0);
+}
+
+#define NOTIFY_DEPTH_UPDATES (10)
+
+void test_Observers_tc_notifyDepth(
+    test_Observers this)
+{
+    int depths[] = {1, 4, 8, 12};
+    uint32_t i;
+    int j, k;
+
+    for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i ++) {
+        corto_object top = corto_create(root_o, "depth", corto_void_o);
+        test_assert(top != NULL);
+
+        corto_object leaf = top;
+        for (j = 0; j < depths[i]; j ++) {
+            leaf = corto_create(leaf, "n", corto_void_o);
+            test_assert(leaf != NULL);
+        }
+
+        /* Observer at the top of the hierarchy, so notifications bubble up
+         * through all levels */
+        corto_observer observer = corto_observe(CORTO_UPDATE|CORTO_ON_TREE, top)
+          .instance(this)
+          .callback(unobserveInCallback_count);
+        test_assert(observer != NULL);
+
+        this->count = 0;
+        for (k = 0; k < NOTIFY_DEPTH_UPDATES; k ++) {
+            test_assert(corto_update(leaf) == 0);
+        }
+        test_assertint(this->count, NOTIFY_DEPTH_UPDATES);
+
+        /* Parents of the leaf are also in the tree of the observer */
+        test_assert(corto_update(corto_parentof(leaf)) == 0);
+        test_assertint(this->count, NOTIFY_DEPTH_UPDATES + (depths[i] > 1));
+
+        test_assert(corto_delete(observer) == 0);
+
+        test_assert(corto_update(leaf) == 0);
+        test_assertint(this->count, NOTIFY_DEPTH_UPDATES + (depths[i] > 1));
+
+        test_assert(corto_delete(top) == 0);
+    }
+}
+
+#define ALIGN_CHUNKED_OBJECTS (1000)
+#define ALIGN_CHUNKED_NEW (100)
+#define ALIGN_CHUNKED_TOTAL (ALIGN_CHUNKED_OBJECTS + ALIGN_CHUNKED_NEW)
+
+static int32_t alignChunkedCount[ALIGN_CHUNKED_TOTAL];
+static int32_t alignChunkedTotal;
+
+/* Invoked from the aligner thread and from the thread that defines objects.
+ * The value of an object is its index in alignChunkedCount. */
+static
+void alignChunked_onDefine(corto_observer_event *e) {
+    int32_t index = *(int32_t*)e->data;
+    corto_ainc(&alignChunkedCount[index]);
+    corto_ainc(&alignChunkedTotal);
+}
+
+static
+bool alignChunked_wait(int32_t total) {
+    int i;
+    for (i = 0; i < 1000 && alignChunkedTotal < total; i ++) {
+        corto_sleep(0, 1000000);
+    }
+
+    /* Give aligner time to deliver duplicates, if there are any */
+    corto_sleep(0, 10000000);
+    return alignChunkedTotal == total;
+}
+
+void test_Observers_tc_observeAlignChunked(
+    test_Observers this)
+{
+    int i;
+
+    memset(alignChunkedCount, 0, sizeof(alignChunkedCount));
+    alignChunkedTotal = 0;
+
+    corto_object data = corto_create(root_o, "data", corto_void_o);
+    test_assert(data != NULL);
+
+    for (i = 0; i < ALIGN_CHUNKED_OBJECTS; i ++) {
+        corto_id id;
+        sprintf(id, "o%d", i);
+        int32_t *o = corto_declare(data, id, corto_int32_o);
+        test_assert(o != NULL);
+        *o = i;
+        test_assert(corto_define(o) == 0);
+    }
+
+    corto_observer observer = corto_observe(CORTO_DEFINE|CORTO_ON_SCOPE, data)
+      .align_chunked(16)
+      .callback(alignChunked_onDefine);
+    test_assert(observer != NULL);
+
+    /* Objects defined while aligning are delivered once, by notify */
+    for (i = ALIGN_CHUNKED_OBJECTS; i < ALIGN_CHUNKED_TOTAL; i ++) {
+        corto_id id;
+        sprintf(id, "o%d", i);
+        int32_t *o = corto_declare(data, id, corto_int32_o);
+        test_assert(o != NULL);
+        *o = i;
+        test_assert(corto_define(o) == 0);
+    }
+
+    test_assert(alignChunked_wait(ALIGN_CHUNKED_TOTAL));
+
+    for (i = 0; i < ALIGN_CHUNKED_TOTAL; i ++) {
+        test_assertint(alignChunkedCount[i], 1);
+    }
+
+    test_assert(corto_delete(observer) == 0);
+    test_assert(corto_delete(data) == 0);
+}
+
+void test_Observers_tc_observeAlignChunkedTree(
+    test_Observers this)
+{
+    int i, j, index = 0;
+
+    memset(alignChunkedCount, 0, sizeof(alignChunkedCount));
+    alignChunkedTotal = 0;
+
+    corto_object data = corto_create(root_o, "data", corto_void_o);
+    test_assert(data != NULL);
+
+    /* Scopes are int32 objects too, so every object has an index */
+    for (i = 0; i < 10; i ++) {
+        corto_id id;
+        sprintf(id, "s%d", i);
+        int32_t *s = corto_declare(data, id, corto_int32_o);
+        test_assert(s != NULL);
+        *s = index ++;
+        test_assert(corto_define(s) == 0);
+
+        for (j = 0; j < 10; j ++) {
+            sprintf(id, "o%d", j);
+            int32_t *o = corto_declare(s, id, corto_int32_o);
+            test_assert(o != NULL);
+            *o = index ++;
+            test_assert(corto_define(o) == 0);
+        }
+    }
+
+    corto_observer observer = corto_observe(CORTO_DEFINE|CORTO_ON_TREE, data)
+      .align_chunked(4)
+      .callback(alignChunked_onDefine);
+    test_assert(observer != NULL);
+
+    test_assert(alignChunked_wait(index));
+
+    for (i = 0; i < index; i ++) {
+        test_assertint(alignChunkedCount[i], 1);
+    }
+
+    test_assert(corto_delete(observer) == 0);
+    test_assert(corto_delete(data) == 0);
+}
+
+#define BULK_DEFINE_OBJECTS (1000)
+
+static
+void bulkDefine_onDefine(corto_observer_event *e) {
+    test_Observers this = e->instance;
+    this->count ++;
+}
+
+void test_Observers_tc_treeObserverBulkDefine(
+    test_Observers this)
+{
+    int i;
+
+    corto_object data = corto_create(root_o, "data", corto_void_o);
+    test_assert(data != NULL);
+
+    /* Subscribers enable updating mount subscriptions for tree observers */
+    corto_subscriber s = corto_subscribe("*").from("/other").callback(NULL);
+    test_assert(s != NULL);
+
+    corto_observer observer = corto_observe(CORTO_DEFINE|CORTO_ON_TREE, data)
+      .instance(this)
+      .callback(bulkDefine_onDefine);
+    test_assert(observer != NULL);
+
+    this->count = 0;
+    for (i = 0; i < BULK_DEFINE_OBJECTS; i ++) {
+        corto_id id;
+        sprintf(id, "o%d", i);
+        test_assert(corto_create(data, id, corto_void_o) != NULL);
+    }
+
+    test_assertint(this->count, BULK_DEFINE_OBJECTS);
+    test_assertint(corto_scope_size(data), BULK_DEFINE_OBJECTS);
+
+    test_assert(corto_delete(observer) == 0);
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(data) == 0);
+}
@@ -0,0 +1,14 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+void test_BatchReplicator_on_batch_notify(
+    test_BatchReplicator this,
+    corto_subscriber_eventIter events)
+{
+    this->batchCount ++;
+    while (corto_iter_hasNext(&events)) {
+        corto_iter_next(&events);
+        this->eventCount ++;
+    }
+}
@@ -0,0 +1,101 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+int16_t test_CountMount_construct(
+    test_CountMount this)
+{
+    corto_set_str(&corto_subscriber(this)->query.from, this->mount);
+
+    corto_result__assign(
+        corto_resultList__append_alloc(this->data),
+        "a",                        /* id */
+        NULL,                       /* name */
+        ".",                        /* parent */
+        "int32",                    /* type */
+        0,                          /* value */
+        TRUE                        /* is node a leaf */
+    );
+
+    corto_result__assign(
+        corto_resultList__append_alloc(this->data),
+        "ab",                       /* id */
+        NULL,                       /* name */
+        ".",                        /* parent */
+        "string",                   /* type */
+        0,                          /* value */
+        TRUE                        /* is node a leaf */
+    );
+
+    corto_result__assign(
+        corto_resultList__append_alloc(this->data),
+        "c",                        /* id */
+        NULL,                       /* name */
+        ".",                        /* parent */
+        "float64",                  /* type */
+        0,                          /* value */
+        TRUE                        /* is node a leaf */
+    );
+
+    return corto_super_construct(this);
+}
+
+/* Custom release function */
+void test_CountMount_iterRelease(corto_iter *iter) {
+    corto_ll_iter_s *data = iter->ctx;
+    corto_resultList__clear(data->list);
+    corto_ll_free(data->list);
+    corto_ll_iterRelease(iter);
+}
+
+corto_resultIter test_CountMount_on_query(
+    test_CountMount this,
+    corto_query *query)
+{
+    corto_iter iter = corto_ll_iter(this->data);
+    corto_ll data = corto_ll_new();
+
+    this->queryCount ++;
+
+    corto_resultIter__foreach(iter, e) {
+        if (corto_idmatch(query->from, e.parent) &&
+            corto_idmatch(query->select, e.id))
+        {
+            corto_result__assign(
+                corto_resultList__append_alloc(data),
+                e.id,
+                e.id,
+                e.parent,
+                e.type,
+                0,
+                e.flags
+            );
+        }
+    }
+
+    corto_iter result = corto_ll_iterAlloc(data);
+    result.release = test_CountMount_iterRelease;
+    return result;
+}
+
+int64_t test_CountMount_on_count(
+    test_CountMount this,
+    corto_query *query)
+{
+    int64_t count = 0;
+
+    if (!this->canCount) {
+        return -1;
+    }
+
+    corto_iter iter = corto_ll_iter(this->data);
+    corto_resultIter__foreach(iter, e) {
+        if (corto_idmatch(query->from, e.parent) &&
+            corto_idmatch(query->select, e.id))
+        {
+            count ++;
+        }
+    }
+
+    return count;
+}
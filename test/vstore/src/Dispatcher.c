@@ -127,3 +127,79 @@ void test_Dispatcher_tc_observerSubscriberDispatcher(
     test_assert(corto_delete(d) == 0);
     test_assert(corto_delete(obj) == 0);
 }
+
+static corto_subscriber_event *claimedEvent;
+
+void subscriberClaimCallback(corto_subscriber_event *event) {
+    /* Events posted to a dispatcher can be kept after the callback */
+    if (event->event == CORTO_UPDATE) {
+        corto_claim(event);
+        claimedEvent = event;
+    }
+}
+
+void test_Dispatcher_tc_subscriberEventClaim(
+    test_Dispatcher this)
+{
+    corto_object obj = corto_create(root_o, "data/obj", corto_void_o);
+    corto_dispatcher d = test_FooDispatcher__create(NULL, NULL);
+    corto_subscriber s = corto_subscribe("data/obj")
+        .instance(this)
+        .dispatcher(d)
+        .callback(subscriberClaimCallback);
+    test_assert(s != NULL);
+
+    claimedEvent = NULL;
+    test_assert(corto_update(obj) == 0);
+    test_assert(claimedEvent != NULL);
+    test_assert(corto_typeof(claimedEvent) == corto_type(corto_subscriber_event_o));
+    test_assertstr(claimedEvent->data.id, "obj");
+    test_assertstr(claimedEvent->data.type, "void");
+    test_assert(claimedEvent->subscriber == s);
+    test_assert(claimedEvent->instance == this);
+    test_assert(claimedEvent->event == CORTO_UPDATE);
+    test_assert(corto_release(claimedEvent) > 0);
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(d) == 0);
+    test_assert(corto_delete(obj) == 0);
+}
+
+void subscriberCopyCallback(corto_subscriber_event *event) {
+    test_Dispatcher instance = event->instance;
+    corto_subscriber_event *copy = NULL;
+
+    if (event->event != CORTO_UPDATE) {
+        return;
+    }
+
+    /* Copy converts the event into a regular object */
+    test_assert(corto_copy(&copy, event) == 0);
+    test_assert(copy != NULL);
+    test_assert(copy != event);
+    test_assertstr(copy->data.id, "obj");
+    test_assertstr(copy->data.type, "void");
+    test_assert(copy->data.id != event->data.id);
+    test_assert(corto_delete(copy) == 0);
+
+    instance->subscriberPosted ++;
+}
+
+void test_Dispatcher_tc_subscriberEventCopy(
+    test_Dispatcher this)
+{
+    corto_object obj = corto_create(root_o, "data/obj", corto_void_o);
+    corto_dispatcher d = test_FooDispatcher__create(NULL, NULL);
+    corto_subscriber s = corto_subscribe("data/obj")
+        .instance(this)
+        .dispatcher(d)
+        .callback(subscriberCopyCallback);
+    test_assert(s != NULL);
+
+    test_assert(corto_update(obj) == 0);
+    test_assertint(this->subscriberPosted, 1);
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(d) == 0);
+    test_assert(corto_delete(obj) == 0);
+}
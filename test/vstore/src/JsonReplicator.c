@@ -25,6 +25,11 @@ corto_resultIter test_JsonReplicator_on_query(
 {
     corto_ll data = corto_ll_new();
 
+    /* Keep track of filter and projection, so tests can verify they are passed
+     * to mounts */
+    corto_set_str(&this->where, query->where);
+    corto_set_str(&this->member, query->member);
+
     /* Create top level objects */
     corto_result__assign(
         corto_resultList__append_alloc(data),
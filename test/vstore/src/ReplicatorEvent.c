@@ -508,6 +508,111 @@ void test_ReplicatorEvent_tc_rateLimitThreeObjects(
     test_assert(ret == 0);
 }
 
+void test_ReplicatorEvent_tc_rateLimitManyObjects(
+    test_ReplicatorEvent this)
+{
+    corto_int16 ret;
+    int cycles = 100, count = 1000;
+    int32_t *objects[1000];
+    corto_time timeout = {60, 0};
+    test_setTimeout(&timeout);
+    if (test_runslow()) {
+        cycles = 10;
+    }
+
+    corto_void__create_auto(root_o, parent);
+    test_assert(parent != NULL);
+    corto_mountPolicy policy = {.sampleRate = 5};
+    corto_query q = {.select = "/", .from = corto_fullpath(NULL, parent)};
+    test_EventReplicator__create_auto(NULL, mount, &q, &policy);
+    test_assert(mount != NULL);
+
+    corto_int32 i, j;
+    for (i = 0; i < count; i ++) {
+        corto_id id;
+        sprintf(id, "obj%d", i);
+        objects[i] = corto_declare(parent, id, corto_int32_o);
+        test_assert(objects[i] != NULL);
+    }
+
+    /* Wait until declare events are processed */
+    corto_sleep(0, 400000000);
+    int32_t initialCount = mount->updateCount;
+
+    /* Updates for the same object are coalesced within a poll cycle */
+    corto_time start, stop;
+    corto_time_get(&start);
+    for (j = 0; j < cycles; j ++) {
+        for (i = 0; i < count; i ++) {
+            ret = corto_int32__update(objects[i], j);
+            test_assert(ret == 0);
+        }
+    }
+
+    corto_time_get(&stop);
+    // Wait 2/frequency to ensure mount has processed all data
+    corto_sleep(0, 400000000);
+    corto_float64 t = corto_time_toDouble(corto_time_sub(stop, start));
+    int32_t updateCount = mount->updateCount - initialCount;
+    test_assert(updateCount <= count * ceil(t * 5.0 + 1.0));
+    test_assert(updateCount >= count);
+
+    for (i = 0; i < count; i ++) {
+        test_assert(corto_delete(objects[i]) == 0);
+    }
+    ret = corto_delete(mount);
+    test_assert(ret == 0);
+    ret = corto_delete(parent);
+    test_assert(ret == 0);
+}
+
+void test_ReplicatorEvent_tc_rateLimitQueueMax(
+    test_ReplicatorEvent this)
+{
+    corto_int16 ret;
+    int count = 50;
+    int32_t *objects[50];
+    corto_time timeout = {60, 0};
+    test_setTimeout(&timeout);
+
+    corto_void__create_auto(root_o, parent);
+    test_assert(parent != NULL);
+    corto_mountPolicy policy = {.sampleRate = 20, .queue = {.max = 10}};
+    corto_query q = {.select = "/", .from = corto_fullpath(NULL, parent)};
+    test_EventReplicator__create_auto(NULL, mount, &q, &policy);
+    test_assert(mount != NULL);
+
+    corto_int32 i;
+    for (i = 0; i < count; i ++) {
+        corto_id id;
+        sprintf(id, "obj%d", i);
+        objects[i] = corto_declare(parent, id, corto_int32_o);
+        test_assert(objects[i] != NULL);
+    }
+
+    // Wait 2/frequency to ensure mount has processed all data
+    corto_sleep(0, 100000000);
+    int32_t initialCount = mount->updateCount;
+
+    /* Publisher blocks when the queue is full, until the poll thread takes
+     * the queue. No events may be lost. */
+    for (i = 0; i < count; i ++) {
+        ret = corto_int32__update(objects[i], i);
+        test_assert(ret == 0);
+    }
+
+    corto_sleep(0, 100000000);
+    test_assertint(mount->updateCount - initialCount, count);
+
+    for (i = 0; i < count; i ++) {
+        test_assert(corto_delete(objects[i]) == 0);
+    }
+    ret = corto_delete(mount);
+    test_assert(ret == 0);
+    ret = corto_delete(parent);
+    test_assert(ret == 0);
+}
+
 void test_ReplicatorEvent_tc_rateLimitAlign(
     test_ReplicatorEvent this)
 {
@@ -526,6 +631,36 @@ void test_ReplicatorEvent_tc_rateLimitAlign(
     test_assert(corto_define(mnt) == 0);
 }
 
+void test_ReplicatorEvent_tc_publishBatch(
+    test_ReplicatorEvent this)
+{
+    corto_publish_sample samples[] = {
+        {CORTO_UPDATE, "/data/a", "/corto/lang/int32", "10"},
+        {CORTO_UPDATE, "/data/b", "/corto/lang/int32", "20"},
+        {CORTO_UPDATE, "/data/c", "/corto/lang/int32", "30"},
+        {CORTO_UPDATE, "/data/a", "/corto/lang/int32", "40"}
+    };
+
+    corto_query q = {.select = "*", .from = "/data"};
+    test_BatchReplicator__create_auto(NULL, mount, &q, NULL);
+    test_assert(mount != NULL);
+    test_assert(corto_mount(mount)->policy.mask & CORTO_MOUNT_BATCH_NOTIFY);
+
+    test_assert(corto_publish_batch("text/corto", samples, 4) == 0);
+
+    /* Mount has no sample rate, but still receives one batch, in which the
+     * events for /data/a are coalesced */
+    test_assertint(mount->batchCount, 1);
+    test_assertint(mount->eventCount, 3);
+
+    test_assert(corto_publish(
+        CORTO_UPDATE, "/data/a", "/corto/lang/int32", "text/corto", "50") == 0);
+    test_assertint(mount->batchCount, 1);
+    test_assertint(mount->eventCount, 3);
+
+    test_assert(corto_delete(mount) == 0);
+}
+
 void test_ReplicatorEvent_tc_sequenceToSequenceResize(
     test_ReplicatorEvent this)
 {
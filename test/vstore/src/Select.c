@@ -1988,3 +1988,102 @@ void test_Select_teardown(
 {
     /* Insert implementation */
 }
+
+void test_Select_tc_selectPreparedOffsetLimit(
+    test_Select this)
+{
+    corto_select_prepared *q = corto_select("ab*").from("/a").prepare();
+    test_assert(q != NULL);
+
+    corto_iter all, page;
+    corto_result *r;
+    test_assert(corto_select_prepared_iter(q, 0, 0, &all) == 0);
+
+    /* Iterators of the same query can be used at the same time */
+    test_assert(corto_select_prepared_iter(q, 2, 3, &page) == 0);
+
+    int count = 0;
+    while (corto_iter_hasNext(&all)) {
+        r = corto_iter_next(&all);
+        if (count >= 2 && count < 5) {
+            corto_id id;
+            strcpy(id, r->id);
+            test_assert(corto_iter_hasNext(&page));
+            r = corto_iter_next(&page);
+            test_assertstr(r->id, id);
+        }
+        count ++;
+    }
+
+    test_assertint(count, 6);
+    test_assert(!corto_iter_hasNext(&page));
+
+    test_assert(corto_select_prepared_iter(q, 4, 0, &page) == 0);
+    count = 0;
+    while (corto_iter_hasNext(&page)) {
+        corto_iter_next(&page);
+        count ++;
+    }
+    test_assertint(count, 2);
+
+    corto_select_prepared_free(q);
+}
+
+void test_Select_tc_selectPreparedUnknownInstanceof(
+    test_Select this)
+{
+    corto_select_prepared *q =
+        corto_select("*").from("/a").instanceof("/does/not/exist").prepare();
+    test_assert(q == NULL);
+    test_assert(corto_catch() != 0);
+}
+
+void test_Select_tc_count(
+    test_Select this)
+{
+    test_assertint(corto_select("*").from("/a").count(), 8);
+    test_assertint(corto_select("/").from("/a").count(), 8);
+    test_assertint(corto_select("a/*").count(), 8);
+    test_assertint(corto_select("*").from("/a/c/b").count(), 1);
+    test_assertint(corto_select("*").from("/a/b").count(), 0);
+}
+
+void test_Select_tc_countOffsetLimit(
+    test_Select this)
+{
+    test_assertint(corto_select("*").from("/a").offset(2).count(), 6);
+    test_assertint(corto_select("*").from("/a").limit(3).count(), 3);
+    test_assertint(
+        corto_select("*").from("/a").offset(2).limit(3).count(), 3);
+    test_assertint(
+        corto_select("*").from("/a").offset(6).limit(5).count(), 2);
+    test_assertint(corto_select("*").from("/a").offset(10).count(), 0);
+}
+
+void test_Select_tc_countFilter(
+    test_Select this)
+{
+    test_assertint(corto_select("ab*").from("/a").count(), 6);
+    test_assertint(corto_select("ab?").from("/a").count(), 2);
+    test_assertint(corto_select("abc").from("/a").count(), 1);
+    test_assertint(corto_select("*").from("/a").type("void").count(), 8);
+    test_assertint(corto_select("*").from("/a").type("int32").count(), 0);
+    test_assertint(corto_select("//").from("/a/c").count(), 16);
+}
+
+void test_Select_tc_countUnknown(
+    test_Select this)
+{
+    corto_object hello = corto_create(root_o, "data/bar/hello", corto_void_o);
+    test_assert(hello != NULL);
+
+    corto_object bar = corto_parentof(hello);
+    test_assert(bar != NULL);
+    test_assert(corto_typeof(bar) == corto_unknown_o);
+
+    test_assertint(corto_select("*").from("data").count(), 0);
+    test_assertint(corto_select("*").from("data").yield_unknown().count(), 1);
+    test_assertint(corto_select("*").from("data/bar").count(), 1);
+
+    test_assert(corto_delete(hello) == 0);
+}
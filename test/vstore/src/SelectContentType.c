@@ -503,3 +503,258 @@ void test_SelectContentType_tc_selectTypeWithConstruct(
 
     test_assertint(test_ContentTypeTest_get_construct_called_count(), 0);
 }
+
+void test_SelectContentType_tc_selectWhereFromObjects(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    corto_int16 ret = corto_select("obj/*").where("x > 20").iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "b");
+    test_assertstr(result->parent, "/obj");
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "c");
+    test_assertstr(result->parent, "/obj");
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectWhereFromJson(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    corto_int16 ret = corto_select("json/*")
+        .contentType("text/json")
+        .where("x > 20 && y < 60")
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "b");
+    test_assertstr(result->parent, "/json");
+    test_assertstr(result->type, "/test/Point");
+    test_assertstr(corto_result_getText(result), "{\"x\":30,\"y\":40}");
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectWhereNot(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    corto_int16 ret = corto_select("obj/*")
+        .where("not (x == 30) and y != 20")
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "c");
+
+    test_assert(!corto_iter_hasNext(&iter));
+
+    ret = corto_select("obj/*").where("!(x < 20 || y > 50)").iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "b");
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectWhereOffsetLimit(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    /* Offset and limit apply to filtered results */
+    corto_int16 ret = corto_select("json/*")
+        .where("x >= 30")
+        .offset(1)
+        .limit(1)
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "c");
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectWherePushdown(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+
+    corto_object scope = corto_void__create(root_o, "pushdown");
+    test_assert(scope != NULL);
+
+    test_JsonReplicator m =
+        test_JsonReplicator__create(NULL, NULL, scope, "/test/Point");
+    test_assert(m != NULL);
+
+    corto_int16 ret = corto_select("pushdown/*").where("y == 40").iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    test_assertstr(((corto_result*)corto_iter_next(&iter))->id, "b");
+    test_assert(!corto_iter_hasNext(&iter));
+
+    test_assertstr(m->where, "y == 40");
+
+    test_assert(corto_delete(m) == 0);
+    test_assert(corto_delete(scope) == 0);
+}
+
+void test_SelectContentType_tc_selectWhereInvalid(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+
+    corto_int16 ret = corto_select("obj/*").where("x >").iter( &iter );
+    test_assert(ret != 0);
+    test_assert(corto_catch() != 0);
+
+    ret = corto_select("obj/*").where("x == 10 &&").iter( &iter );
+    test_assert(ret != 0);
+    test_assert(corto_catch() != 0);
+}
+
+void test_SelectContentType_tc_selectMemberFromObjects(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    corto_int16 ret = corto_select("obj/*")
+        .contentType("text/corto")
+        .member("y")
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "a");
+    test_assertstr(corto_result_getText(result), "{20}");
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "b");
+    test_assertstr(corto_result_getText(result), "{40}");
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "c");
+    test_assertstr(corto_result_getText(result), "{60}");
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectMemberBinary(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+    test_Point *p;
+
+    /* Members that are not in the projection are not copied */
+    corto_int16 ret = corto_select("obj/b")
+        .contentType("binary/corto")
+        .member("y")
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "b");
+    p = (test_Point*)result->value;
+    test_assert(p != NULL);
+    test_assertint(p->x, 0);
+    test_assertint(p->y, 40);
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectMemberFromJson(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    corto_object scope = corto_void__create(root_o, "projection");
+    test_assert(scope != NULL);
+
+    test_JsonReplicator m =
+        test_JsonReplicator__create(NULL, NULL, scope, "/test/Point");
+    test_assert(m != NULL);
+
+    /* Mount doesn't apply the projection, so select applies it */
+    corto_int16 ret = corto_select("projection/*")
+        .contentType("text/corto")
+        .member(" x ")
+        .limit(1)
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "a");
+    test_assertstr(corto_result_getText(result), "{10}");
+
+    test_assert(!corto_iter_hasNext(&iter));
+
+    test_assertstr(m->member, " x ");
+
+    test_assert(corto_delete(m) == 0);
+    test_assert(corto_delete(scope) == 0);
+}
+
+void test_SelectContentType_tc_selectMemberNotInType(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+    corto_result *result;
+
+    /* Values of types without projected members are not serialized */
+    corto_int16 ret = corto_select("obj/a")
+        .contentType("text/corto")
+        .member("z")
+        .iter( &iter );
+    test_assert(ret == 0);
+
+    test_assert(corto_iter_hasNext(&iter));
+    result = corto_iter_next(&iter);
+    test_assertstr(result->id, "a");
+    test_assert(result->value == 0);
+
+    test_assert(!corto_iter_hasNext(&iter));
+}
+
+void test_SelectContentType_tc_selectMemberInvalid(
+    test_SelectContentType this)
+{
+    corto_iter iter;
+
+    corto_int16 ret = corto_select("obj/*").member("x,").iter( &iter );
+    test_assert(ret != 0);
+    test_assert(corto_catch() != 0);
+
+    ret = corto_select("obj/*").member("x.y").iter( &iter );
+    test_assert(ret != 0);
+    test_assert(corto_catch() != 0);
+}
@@ -1619,3 +1619,399 @@ void test_SelectMount_tc_selectTreeFromInitialSlashInMountResult(
 
     test_assert(corto_iter_hasNext(&it) == false);
 }
+
+void test_SelectMount_tc_selectPrepared(
+    test_SelectMount this)
+{
+    corto_select_prepared *q = corto_select("a/*z").from("/").prepare();
+    test_assert(q != NULL);
+
+    int i;
+    for (i = 0; i < 3; i ++) {
+        corto_iter it;
+        corto_result *r;
+        test_assert(corto_select_prepared_iter(q, 0, 0, &it) == 0);
+
+        test_assert(corto_iter_hasNext(&it));
+        r = corto_iter_next(&it);
+        test_assertstr(r->id, "yz");
+        test_assertstr(r->parent, "a");
+        test_assertstr(r->type, "string");
+
+        test_assert(corto_iter_hasNext(&it));
+        r = corto_iter_next(&it);
+        test_assertstr(r->id, "xyz");
+        test_assertstr(r->parent, "a");
+        test_assertstr(r->type, "float64");
+
+        test_assert(!corto_iter_hasNext(&it));
+    }
+
+    corto_select_prepared_free(q);
+}
+
+void test_SelectMount_tc_selectPreparedMountAdded(
+    test_SelectMount this)
+{
+    corto_select_prepared *q = corto_select("*").from("data").prepare();
+    test_assert(q != NULL);
+
+    corto_iter it;
+    test_assert(corto_select_prepared_iter(q, 0, 0, &it) == 0);
+    test_assert(!corto_iter_hasNext(&it));
+
+    /* Adding a mount invalidates the mounts of the prepared query */
+    corto_object vmount = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmount != NULL);
+
+    test_assert(corto_select_prepared_iter(q, 0, 0, &it) == 0);
+    test_assert(corto_iter_hasNext(&it));
+    test_assertstr(((corto_result*)corto_iter_next(&it))->id, "a");
+    test_assert(corto_iter_hasNext(&it));
+    test_assertstr(((corto_result*)corto_iter_next(&it))->id, "b");
+    test_assert(corto_iter_hasNext(&it));
+    test_assertstr(((corto_result*)corto_iter_next(&it))->id, "c");
+    test_assert(!corto_iter_hasNext(&it));
+
+    test_assert(corto_delete(vmount) == 0);
+
+    test_assert(corto_select_prepared_iter(q, 0, 0, &it) == 0);
+    test_assert(!corto_iter_hasNext(&it));
+
+    corto_select_prepared_free(q);
+}
+
+void test_SelectMount_tc_selectPreparedMultipleExpr(
+    test_SelectMount this)
+{
+    corto_select_prepared *q = corto_select("a/x,a/xyz").from("/").prepare();
+    test_assert(q != NULL);
+
+    int i;
+    for (i = 0; i < 2; i ++) {
+        corto_iter it;
+        corto_result *r;
+        test_assert(corto_select_prepared_iter(q, 0, 0, &it) == 0);
+
+        test_assert(corto_iter_hasNext(&it));
+        r = corto_iter_next(&it);
+        test_assertstr(r->id, "x");
+        test_assertstr(r->type, "uint32");
+
+        test_assert(corto_iter_hasNext(&it));
+        r = corto_iter_next(&it);
+        test_assertstr(r->id, "xyz");
+        test_assertstr(r->type, "float64");
+
+        test_assert(!corto_iter_hasNext(&it));
+    }
+
+    corto_select_prepared_free(q);
+}
+
+void test_SelectMount_tc_selectParallel(
+    test_SelectMount this)
+{
+    corto_object vmountA = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmountA != NULL);
+    corto_object vmountB = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmountB != NULL);
+
+    corto_iter it;
+    test_assert(corto_select("*")
+        .from("data")
+        .contentType("text/corto")
+        .parallel()
+        .iter(&it) == 0);
+
+    /* Results arrive in any order, so count them per id */
+    int a = 0, b = 0, c = 0;
+    while (corto_iter_hasNext(&it)) {
+        corto_result *r = corto_iter_next(&it);
+        test_assertstr(r->parent, ".");
+        if (!strcmp(r->id, "a")) {
+            test_assertstr(r->type, "int32");
+            test_assertstr(corto_result_getText(r), "10");
+            a ++;
+        } else if (!strcmp(r->id, "b")) {
+            test_assertstr(r->type, "string");
+            b ++;
+        } else if (!strcmp(r->id, "c")) {
+            test_assertstr(r->type, "float64");
+            c ++;
+        } else {
+            test_assert(false);
+        }
+    }
+
+    test_assertint(a, 2);
+    test_assertint(b, 2);
+    test_assertint(c, 2);
+
+    test_assert(corto_delete(vmountA) == 0);
+    test_assert(corto_delete(vmountB) == 0);
+}
+
+void test_SelectMount_tc_selectParallelOffsetLimit(
+    test_SelectMount this)
+{
+    corto_object vmountA = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmountA != NULL);
+    corto_object vmountB = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmountB != NULL);
+
+    corto_iter it;
+    test_assert(corto_select("*")
+        .from("data")
+        .offset(2)
+        .limit(3)
+        .parallel()
+        .iter(&it) == 0);
+
+    int count = 0;
+    while (corto_iter_hasNext(&it)) {
+        corto_iter_next(&it);
+        count ++;
+    }
+
+    test_assertint(count, 3);
+
+    test_assert(corto_select("*")
+        .from("data")
+        .offset(5)
+        .limit(3)
+        .parallel()
+        .iter(&it) == 0);
+
+    count = 0;
+    while (corto_iter_hasNext(&it)) {
+        corto_iter_next(&it);
+        count ++;
+    }
+
+    test_assertint(count, 1);
+
+    test_assert(corto_delete(vmountA) == 0);
+    test_assert(corto_delete(vmountB) == 0);
+}
+
+/* Returns a bit per id returned by a parallel select, and fails when an id is
+ * returned more than once */
+static
+int selectParallelIds(
+    uint64_t offset,
+    uint64_t limit,
+    int *count)
+{
+    const char *ids = "abcd";
+    int found = 0;
+    corto_iter it;
+
+    test_assert(corto_select("*")
+        .from("data")
+        .offset(offset)
+        .limit(limit)
+        .parallel()
+        .iter(&it) == 0);
+
+    *count = 0;
+    while (corto_iter_hasNext(&it)) {
+        corto_result *r = corto_iter_next(&it);
+        test_assert(strlen(r->id) == 1);
+        char *ptr = strchr(ids, r->id[0]);
+        test_assert(ptr != NULL);
+        int bit = 1 << (ptr - ids);
+        test_assert(!(found & bit));
+        found |= bit;
+        (*count) ++;
+    }
+
+    return found;
+}
+
+void test_SelectMount_tc_selectParallelOffsetLimitUneven(
+    test_SelectMount this)
+{
+    corto_result item = {
+        .id = "d",
+        .parent = ".",
+        .type = "int32",
+        .flags = CORTO_RESULT_LEAF
+    };
+
+    /* Mounts return a different number of results (a, b, c and d) */
+    corto_object vmount = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmount != NULL);
+    test_ObjectMount omount = test_ObjectMount__create(
+        NULL, NULL, "*", "data", &item);
+    test_assert(omount != NULL);
+
+    int count;
+
+    test_assertint(selectParallelIds(0, 4, &count), 0xf);
+    test_assertint(count, 4);
+
+    test_assertint(selectParallelIds(0, 0, &count), 0xf);
+    test_assertint(count, 4);
+
+    /* Which results are skipped depends on the order in which they arrive */
+    selectParallelIds(1, 2, &count);
+    test_assertint(count, 2);
+
+    selectParallelIds(1, 0, &count);
+    test_assertint(count, 3);
+
+    /* Offset is larger than the number of results of either mount */
+    selectParallelIds(3, 3, &count);
+    test_assertint(count, 1);
+
+    test_assertint(selectParallelIds(4, 1, &count), 0);
+    test_assertint(count, 0);
+
+    test_assert(corto_delete(vmount) == 0);
+    test_assert(corto_delete(omount) == 0);
+}
+
+void test_SelectMount_tc_selectParallelRelease(
+    test_SelectMount this)
+{
+    corto_object mount = corto_create(root_o, "mount", corto_void_o);
+
+    test_MountIterCount mountA = test_MountIterCount__create(NULL, NULL, mount);
+    test_assert(mountA != NULL);
+
+    test_MountIterCount mountB = test_MountIterCount__create(NULL, NULL, mount);
+    test_assert(mountB != NULL);
+
+    corto_iter it;
+    test_assert(corto_select("*").from("/mount").parallel().iter(&it) == 0);
+
+    int i;
+    for (i = 0; i < 5; i++) {
+        test_assert(corto_iter_hasNext(&it));
+        test_assert(corto_iter_next(&it) != NULL);
+    }
+
+    /* Releasing the iterator cancels queries that are still running. Workers
+     * keep a reference to their mount, so mounts can be deleted. */
+    corto_iter_release(&it);
+
+    test_assert(corto_delete(mountA) == 0);
+    test_assert(corto_delete(mountB) == 0);
+    test_assert(corto_delete(mount) == 0);
+}
+
+void test_SelectMount_tc_selectParallelNested(
+    test_SelectMount this)
+{
+    corto_object vmountA = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmountA != NULL);
+    corto_object vmountB = test_VirtualMount__create(NULL, NULL, "data");
+    test_assert(vmountB != NULL);
+
+    corto_iter it;
+    test_assert(corto_select("*")
+        .from("data")
+        .parallel()
+        .iter(&it) == 0);
+
+    /* A select started while iterating a parallel select queries mounts
+     * sequentially, as the workers may be waiting for this thread */
+    int count = 0;
+    while (corto_iter_hasNext(&it)) {
+        corto_iter_next(&it);
+
+        corto_iter nested;
+        test_assert(corto_select("*")
+            .from("data")
+            .parallel()
+            .iter(&nested) == 0);
+
+        int nestedCount = 0;
+        while (corto_iter_hasNext(&nested)) {
+            corto_iter_next(&nested);
+            nestedCount ++;
+        }
+
+        test_assertint(nestedCount, 6);
+        count ++;
+    }
+
+    test_assertint(count, 6);
+
+    test_assert(corto_delete(vmountA) == 0);
+    test_assert(corto_delete(vmountB) == 0);
+}
+
+void test_SelectMount_tc_count(
+    test_SelectMount this)
+{
+    /* ListMount doesn't implement on_count, so results are iterated */
+    test_assertint(corto_select("*").from("/a").count(), 3);
+    test_assertint(corto_select("x*").from("/a").count(), 2);
+    test_assertint(corto_select("*").from("/a/x").count(), 3);
+    test_assertint(corto_select("*").from("/a").offset(1).count(), 2);
+}
+
+void test_SelectMount_tc_countOnCount(
+    test_SelectMount this)
+{
+    test_CountMount mount = test_CountMount__create(NULL, NULL, "numbers", true);
+    test_assert(mount != NULL);
+
+    test_assertint(corto_select("*").from("numbers").count(), 3);
+    test_assertint(mount->queryCount, 0);
+
+    /* Objects in the store are added to the count of the mount */
+    corto_object d = corto_create(root_o, "numbers/d", corto_void_o);
+    test_assert(d != NULL);
+
+    test_assertint(corto_select("*").from("numbers").count(), 4);
+    test_assertint(mount->queryCount, 0);
+
+    test_assert(corto_delete(d) == 0);
+    test_assert(corto_delete(mount) == 0);
+}
+
+void test_SelectMount_tc_countOnCountFilter(
+    test_SelectMount this)
+{
+    test_CountMount mount = test_CountMount__create(NULL, NULL, "numbers", true);
+    test_assert(mount != NULL);
+
+    test_assertint(corto_select("a*").from("numbers").count(), 2);
+    test_assertint(corto_select("c").from("numbers").count(), 1);
+    test_assertint(corto_select("d").from("numbers").count(), 0);
+    test_assertint(mount->queryCount, 0);
+
+    test_assert(corto_delete(mount) == 0);
+}
+
+void test_SelectMount_tc_countOnCountUnavailable(
+    test_SelectMount this)
+{
+    test_CountMount mount = test_CountMount__create(NULL, NULL, "numbers", false);
+    test_assert(mount != NULL);
+
+    /* Mount returns -1 from on_count, so select falls back to on_query */
+    test_assertint(corto_select("*").from("numbers").count(), 3);
+    test_assertint(mount->queryCount, 1);
+
+    test_assert(corto_delete(mount) == 0);
+}
+
+void test_SelectMount_tc_countOnCountOffsetLimit(
+    test_SelectMount this)
+{
+    test_CountMount mount = test_CountMount__create(NULL, NULL, "numbers", true);
+    test_assert(mount != NULL);
+
+    test_assertint(corto_select("*").from("numbers").offset(1).count(), 2);
+    test_assertint(corto_select("*").from("numbers").limit(2).count(), 2);
+    test_assertint(
+        corto_select("*").from("numbers").offset(2).limit(5).count(), 1);
+    test_assertint(corto_select("*").from("numbers").offset(4).count(), 0);
+    test_assertint(mount->queryCount, 0);
+
+    test_assert(corto_delete(mount) == 0);
+}
@@ -672,3 +672,295 @@ void test_Subscribe_tc_subscribePartialMatchingParentObject(
 
     test_assert(corto_delete(s) == 0);
 }
+
+#define MANY_SCOPES (100)
+
+static corto_subscriber manyScopesSubscribers[MANY_SCOPES];
+static int32_t manyScopesCount[MANY_SCOPES];
+static int32_t manyScopesTreeCount;
+
+static
+void subscribeManyScopesOnUpdate(corto_subscriber_event *e)
+{
+    int i;
+    for (i = 0; i < MANY_SCOPES; i ++) {
+        if (manyScopesSubscribers[i] == e->subscriber) {
+            manyScopesCount[i] ++;
+        }
+    }
+}
+
+static
+void subscribeManyScopesTreeOnUpdate(corto_subscriber_event *e)
+{
+    manyScopesTreeCount ++;
+}
+
+void test_Subscribe_tc_subscribeManyScopes(
+    test_Subscribe this)
+{
+    corto_subscriber *s = manyScopesSubscribers;
+    int i;
+
+    for (i = 0; i < MANY_SCOPES; i ++) {
+        corto_id from;
+        sprintf(from, "/data/s%d", i);
+        manyScopesCount[i] = 0;
+        s[i] = corto_subscribe("*").from(from)
+          .callback(subscribeManyScopesOnUpdate);
+        test_assert(s[i] != NULL);
+    }
+
+    corto_subscriber tree = corto_subscribe("//").from("/data")
+      .callback(subscribeManyScopesTreeOnUpdate);
+    test_assert(tree != NULL);
+    manyScopesTreeCount = 0;
+
+    test_assert(corto_publish(CORTO_UPDATE, "/data/s42/x", "void", NULL, 0) == 0);
+    test_assert(corto_publish(CORTO_UPDATE, "/DATA/S7/x", "void", NULL, 0) == 0);
+
+    /* '*' doesn't match objects that are not a direct child */
+    test_assert(corto_publish(CORTO_UPDATE, "/data/s42/x/y", "void", NULL, 0) == 0);
+
+    for (i = 0; i < MANY_SCOPES; i ++) {
+        if (i == 42 || i == 7) {
+            test_assertint(manyScopesCount[i], 1);
+        } else {
+            test_assertint(manyScopesCount[i], 0);
+        }
+    }
+    test_assertint(manyScopesTreeCount, 3);
+
+    /* Deleting a subscriber removes it from the index */
+    test_assert(corto_delete(s[42]) == 0);
+    test_assert(corto_publish(CORTO_UPDATE, "/data/s42/x", "void", NULL, 0) == 0);
+    test_assertint(manyScopesCount[42], 1);
+    test_assertint(manyScopesTreeCount, 4);
+
+    for (i = 0; i < MANY_SCOPES; i ++) {
+        if (i != 42) {
+            test_assert(corto_delete(s[i]) == 0);
+        }
+    }
+
+    test_assert(corto_delete(tree) == 0);
+    memset(manyScopesSubscribers, 0, sizeof(manyScopesSubscribers));
+}
+
+void test_Subscribe_tc_subscribeManyScopesTypeFilter(
+    test_Subscribe this)
+{
+    corto_subscriber *s = manyScopesSubscribers;
+    int i;
+
+    for (i = 0; i < 3; i ++) {
+        manyScopesCount[i] = 0;
+    }
+
+    s[0] = corto_subscribe("*").from("/data")
+      .type("/corto/lang/int32")
+      .callback(subscribeManyScopesOnUpdate);
+    test_assert(s[0] != NULL);
+
+    s[1] = corto_subscribe("*").from("/data")
+      .type("/corto/lang/string")
+      .callback(subscribeManyScopesOnUpdate);
+    test_assert(s[1] != NULL);
+
+    s[2] = corto_subscribe("*").from("/data")
+      .callback(subscribeManyScopesOnUpdate);
+    test_assert(s[2] != NULL);
+
+    test_assert(corto_publish(
+        CORTO_UPDATE, "/data/x", "/corto/lang/int32", "text/corto", "10") == 0);
+
+    test_assertint(manyScopesCount[0], 1);
+    test_assertint(manyScopesCount[1], 0);
+    test_assertint(manyScopesCount[2], 1);
+
+    for (i = 0; i < 3; i ++) {
+        test_assert(corto_delete(s[i]) == 0);
+    }
+    memset(manyScopesSubscribers, 0, sizeof(manyScopesSubscribers));
+}
+
+#define PUBLISH_BATCH_SAMPLES (3)
+
+static char *publishBatchIds[PUBLISH_BATCH_SAMPLES];
+static int32_t publishBatchCount;
+
+static
+void publishBatchOnUpdate(corto_subscriber_event *e) {
+    if (publishBatchCount < PUBLISH_BATCH_SAMPLES) {
+        publishBatchIds[publishBatchCount] = corto_strdup(e->data.id);
+    }
+    publishBatchCount ++;
+}
+
+static
+void publishBatchClear(void) {
+    int i;
+    for (i = 0; i < PUBLISH_BATCH_SAMPLES; i ++) {
+        corto_dealloc(publishBatchIds[i]);
+        publishBatchIds[i] = NULL;
+    }
+    publishBatchCount = 0;
+}
+
+void test_Subscribe_tc_publishBatch(
+    test_Subscribe this)
+{
+    corto_publish_sample samples[] = {
+        {CORTO_UPDATE, "/data/a", "/corto/lang/int32", "10"},
+        {CORTO_UPDATE, "/data/b", "/corto/lang/int32", "20"},
+        {CORTO_UPDATE, "/data/c", "/corto/lang/int32", "30"}
+    };
+
+    publishBatchClear();
+
+    corto_subscriber s = corto_subscribe("*").from("/data")
+      .callback(publishBatchOnUpdate);
+    test_assert(s != NULL);
+
+    test_assert(corto_publish_batch("text/corto", samples, 3) == 0);
+
+    test_assertint(publishBatchCount, 3);
+    test_assertstr(publishBatchIds[0], "a");
+    test_assertstr(publishBatchIds[1], "b");
+    test_assertstr(publishBatchIds[2], "c");
+
+    test_assert(corto_delete(s) == 0);
+    publishBatchClear();
+}
+
+void test_Subscribe_tc_publishBatchFluent(
+    test_Subscribe this)
+{
+    publishBatchClear();
+
+    corto_subscriber s = corto_subscribe("*").from("/data")
+      .callback(publishBatchOnUpdate);
+    test_assert(s != NULL);
+
+    test_assert(corto_publish_begin("text/corto")
+      .sample(CORTO_UPDATE, "/data/a", "/corto/lang/int32", "10")
+      .sample(CORTO_UPDATE, "/data/b", "/corto/lang/int32", "20")
+      .sample(CORTO_UPDATE, "/data/c", "/corto/lang/int32", "30")
+      .commit() == 0);
+
+    test_assertint(publishBatchCount, 3);
+    test_assertstr(publishBatchIds[0], "a");
+    test_assertstr(publishBatchIds[1], "b");
+    test_assertstr(publishBatchIds[2], "c");
+
+    /* An empty batch is not an error */
+    test_assert(corto_publish_begin("text/corto").commit() == 0);
+    test_assertint(publishBatchCount, 3);
+
+    test_assert(corto_delete(s) == 0);
+    publishBatchClear();
+}
+
+#define RATE_UPDATES (1000)
+
+static int32_t rateCount;
+static int32_t rateLastValue;
+
+/* Called from the thread of the limiter. Values are stored atomically, as they
+ * are read by the test while the limiter is running. */
+static
+void subscribeRateOnUpdate(corto_subscriber_event *e) {
+    if (!strcmp(e->data.id, "x")) {
+        __sync_lock_test_and_set(&rateLastValue, atoi((char*)e->data.value));
+    }
+    corto_ainc(&rateCount);
+}
+
+void test_Subscribe_tc_subscribeRate(
+    test_Subscribe this)
+{
+    int i;
+
+    rateCount = 0;
+    rateLastValue = -1;
+
+    corto_subscriber s = corto_subscribe("*").from("/data")
+      .contentType("text/corto")
+      .rate(20)
+      .callback(subscribeRateOnUpdate);
+    test_assert(s != NULL);
+    test_assert(s->rate == 20);
+
+    for (i = 0; i < RATE_UPDATES; i ++) {
+        corto_id value;
+        sprintf(value, "%d", i);
+        test_assert(corto_publish(
+            CORTO_UPDATE, "/data/x", "/corto/lang/int32", "text/corto", value) == 0);
+        test_assert(corto_publish(
+            CORTO_UPDATE, "/data/y", "/corto/lang/int32", "text/corto", value) == 0);
+    }
+
+    /* Wait until the latest value of both objects has been delivered */
+    for (i = 0; i < 100; i ++) {
+        if (rateLastValue == RATE_UPDATES - 1 && rateCount >= 2) {
+            break;
+        }
+        corto_sleep(0, 10000000);
+    }
+
+    test_assertint(rateLastValue, RATE_UPDATES - 1);
+
+    /* Updates in an interval are delivered as one event per object */
+    test_assert(rateCount >= 2);
+    test_assert(rateCount < RATE_UPDATES);
+
+    test_assert(corto_delete(s) == 0);
+}
+
+void test_Subscribe_tc_subscribeRateInvalid(
+    test_Subscribe this)
+{
+    corto_subscriber s = corto_subscribe("*").from("/data")
+      .rate(-1)
+      .callback(subscribeRateOnUpdate);
+    test_assert(s == NULL);
+    test_assert(corto_catch() != 0);
+}
+
+#define ALIGN_OBJECTS (1000)
+
+static int32_t alignCount;
+
+static
+void subscribeAlignMetricsOnDefine(corto_subscriber_event *e) {
+    alignCount ++;
+}
+
+void test_Subscribe_tc_subscribeAlignMetrics(
+    test_Subscribe this)
+{
+    int i;
+
+    corto_object data = corto_create(root_o, "data", corto_void_o);
+    test_assert(data != NULL);
+
+    for (i = 0; i < ALIGN_OBJECTS; i ++) {
+        corto_id id;
+        sprintf(id, "o%d", i);
+        test_assert(corto_create(data, id, corto_int32_o) != NULL);
+    }
+
+    alignCount = 0;
+
+    corto_subscriber s = corto_subscribe("*").from("/data")
+      .callback(subscribeAlignMetricsOnDefine);
+    test_assert(s != NULL);
+
+    /* Every object is queued once during alignment */
+    test_assertint(alignCount, ALIGN_OBJECTS);
+    test_assertint(s->alignQueueMax, ALIGN_OBJECTS);
+    test_assert(s->alignDuration != 0);
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(data) == 0);
+}
@@ -502,3 +502,86 @@ void test_SubscribeContentType_tc_subscribeTypeWithConstruct(
     test_assert(corto_delete(s) == 0);
     test_assertint(test_ContentTypeTest_get_construct_called_count(), 0);
 }
+
+static void *lastValue;
+
+static
+void sharedJson(corto_subscriber_event *e) {
+    test_SubscribeContentType this = e->instance;
+    if (!strcmp(e->data.id, "c") && this->eventsReceived >= 3) {
+        test_assertstr(corto_result_getText(&e->data), "{\"x\":70,\"y\":80}");
+        lastValue = (void*)e->data.value;
+    }
+    this->eventsReceived ++;
+}
+
+void test_SubscribeContentType_tc_publishSharedJson(
+    test_SubscribeContentType this)
+{
+    corto_subscriber s = corto_subscribe("json/*")
+        .instance(this)
+        .contentType("text/json")
+        .callback(sharedJson);
+
+    test_assert(s != 0);
+    test_assertint(this->eventsReceived, 3);
+
+    /* Ownership of value is transferred, subscriber receives the same pointer */
+    char *value = corto_strdup("{\"x\":70,\"y\":80}");
+    lastValue = NULL;
+    test_assert(corto_publish_shared(CORTO_UPDATE, "json/c", "/test/Point", "text/json", value) == 0);
+    test_assertint(this->eventsReceived, 4);
+    test_assert(lastValue == value);
+
+    test_assert(corto_delete(s) == 0);
+}
+
+void test_SubscribeContentType_tc_publishSharedJsonDispatch(
+    test_SubscribeContentType this)
+{
+    test_FooDispatcher dispatcher = test_FooDispatcher__create(NULL, NULL);
+
+    corto_subscriber s = corto_subscribe("json/*")
+        .instance(this)
+        .contentType("text/json")
+        .dispatcher(dispatcher)
+        .callback(sharedJson);
+
+    test_assert(s != 0);
+    test_assertint(this->eventsReceived, 3);
+
+    /* Asynchronous subscribers share the value without copying it */
+    char *value = corto_strdup("{\"x\":70,\"y\":80}");
+    lastValue = NULL;
+    test_assert(corto_publish_shared(CORTO_UPDATE, "json/c", "/test/Point", "text/json", value) == 0);
+    test_assertint(this->eventsReceived, 4);
+    test_assert(lastValue == value);
+
+    test_assert(corto_delete(s) == 0);
+}
+
+void test_SubscribeContentType_tc_publishCopyJsonDispatch(
+    test_SubscribeContentType this)
+{
+    test_FooDispatcher dispatcher = test_FooDispatcher__create(NULL, NULL);
+
+    corto_subscriber s = corto_subscribe("json/*")
+        .instance(this)
+        .contentType("text/json")
+        .dispatcher(dispatcher)
+        .callback(sharedJson);
+
+    test_assert(s != 0);
+    test_assertint(this->eventsReceived, 3);
+
+    /* Publisher keeps ownership, so asynchronous subscribers get a copy */
+    char *value = corto_strdup("{\"x\":70,\"y\":80}");
+    lastValue = NULL;
+    test_assert(corto_publish(CORTO_UPDATE, "json/c", "/test/Point", "text/json", value) == 0);
+    test_assertint(this->eventsReceived, 4);
+    test_assert(lastValue != NULL);
+    test_assert(lastValue != value);
+    corto_dealloc(value);
+
+    test_assert(corto_delete(s) == 0);
+}
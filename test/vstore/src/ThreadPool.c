@@ -0,0 +1,265 @@
+/* This is a managed file. Do not delete this comment. */
+
+#include <include/test.h>
+
+#define ORDERED_OBJECTS (16)
+#define ORDERED_UPDATES (100)
+#define BATCHED_EVENTS (10000)
+#define BATCHED_BATCH (1000)
+
+static int32_t handled;
+static int32_t updateCount[ORDERED_OBJECTS];
+static bool outOfOrder;
+
+/* Callbacks run in worker threads, so tests check results in the main thread */
+static
+void threadPoolCallback(corto_subscriber_event *event) {
+    if (event->event == CORTO_UPDATE) {
+        corto_ainc(&handled);
+    }
+}
+
+static
+void threadPoolObserverCallback(corto_observer_event *event) {
+    corto_ainc(&handled);
+}
+
+static
+void threadPoolOrderedCallback(corto_subscriber_event *event) {
+    int index = atoi(event->data.id + 1);
+
+    /* Events for the same object are never handled concurrently, so the counter
+     * doesn't need to be atomic */
+    if (event->event == CORTO_UPDATE) {
+        updateCount[index] ++;
+    } else if (event->event == CORTO_DELETE) {
+        if (updateCount[index] != ORDERED_UPDATES) {
+            outOfOrder = true;
+        }
+        corto_ainc(&handled);
+    }
+}
+
+static
+bool threadPoolWait(int32_t count) {
+    int i;
+    for (i = 0; i < 10000 && handled < count; i ++) {
+        corto_sleep(0, 1000000);
+    }
+    return handled == count;
+}
+
+static
+corto_threadpool threadPoolCreate(uint32_t workers, bool ordered) {
+    corto_threadpool pool = corto_declare(NULL, NULL, corto_threadpool_o);
+    if (pool) {
+        pool->workers = workers;
+        pool->ordered = ordered;
+        if (corto_define(pool)) {
+            corto_delete(pool);
+            pool = NULL;
+        }
+    }
+    return pool;
+}
+
+void test_ThreadPool_tc_defaultWorkers(
+    test_ThreadPool this)
+{
+    corto_threadpool pool = corto_create(NULL, NULL, corto_threadpool_o);
+    test_assert(pool != NULL);
+    test_assertint(pool->workers, 4);
+    test_assert(pool->ordered == false);
+    test_assert(corto_delete(pool) == 0);
+}
+
+void test_ThreadPool_tc_subscriberEvents(
+    test_ThreadPool this)
+{
+    int i;
+    corto_object obj = corto_create(root_o, "data/obj", corto_void_o);
+    corto_threadpool pool = threadPoolCreate(2, false);
+    test_assert(pool != NULL);
+
+    corto_subscriber s = corto_subscribe("data/obj")
+        .dispatcher(pool)
+        .callback(threadPoolCallback);
+    test_assert(s != NULL);
+
+    handled = 0;
+    for (i = 0; i < 1000; i ++) {
+        test_assert(corto_update(obj) == 0);
+    }
+
+    test_assert(threadPoolWait(1000));
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(pool) == 0);
+    test_assert(corto_delete(obj) == 0);
+}
+
+void test_ThreadPool_tc_observerEvents(
+    test_ThreadPool this)
+{
+    int i;
+    corto_object obj = corto_create(root_o, "data/obj", corto_void_o);
+    corto_threadpool pool = threadPoolCreate(2, false);
+    test_assert(pool != NULL);
+
+    corto_observer o = corto_observe(CORTO_UPDATE, obj)
+        .dispatcher(pool)
+        .callback(threadPoolObserverCallback);
+    test_assert(o != NULL);
+
+    handled = 0;
+    for (i = 0; i < 1000; i ++) {
+        test_assert(corto_update(obj) == 0);
+    }
+
+    test_assert(threadPoolWait(1000));
+
+    test_assert(corto_delete(o) == 0);
+    test_assert(corto_delete(pool) == 0);
+    test_assert(corto_delete(obj) == 0);
+}
+
+void test_ThreadPool_tc_ordered(
+    test_ThreadPool this)
+{
+    corto_object objects[ORDERED_OBJECTS];
+    int i, j;
+
+    corto_threadpool pool = threadPoolCreate(4, true);
+    test_assert(pool != NULL);
+
+    for (i = 0; i < ORDERED_OBJECTS; i ++) {
+        char id[16];
+        sprintf(id, "data/o%d", i);
+        objects[i] = corto_create(root_o, id, corto_void_o);
+        test_assert(objects[i] != NULL);
+        updateCount[i] = 0;
+    }
+
+    corto_subscriber s = corto_subscribe("*").from("/data")
+        .dispatcher(pool)
+        .callback(threadPoolOrderedCallback);
+    test_assert(s != NULL);
+
+    handled = 0;
+    outOfOrder = false;
+
+    /* Interleave updates for objects, so events for one object are spread
+     * out over the queues of the workers if they were not ordered. */
+    for (j = 0; j < ORDERED_UPDATES; j ++) {
+        for (i = 0; i < ORDERED_OBJECTS; i ++) {
+            test_assert(corto_update(objects[i]) == 0);
+        }
+    }
+
+    for (i = 0; i < ORDERED_OBJECTS; i ++) {
+        test_assert(corto_delete(objects[i]) == 0);
+    }
+
+    test_assert(threadPoolWait(ORDERED_OBJECTS));
+    test_assert(!outOfOrder);
+
+    for (i = 0; i < ORDERED_OBJECTS; i ++) {
+        test_assertint(updateCount[i], ORDERED_UPDATES);
+    }
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(pool) == 0);
+}
+
+void test_ThreadPool_tc_metrics(
+    test_ThreadPool this)
+{
+    int i;
+    corto_object obj = corto_create(root_o, "data/obj", corto_void_o);
+    corto_threadpool pool = threadPoolCreate(2, false);
+    test_assert(pool != NULL);
+
+    corto_subscriber s = corto_subscribe("data/obj")
+        .dispatcher(pool)
+        .callback(threadPoolCallback);
+    test_assert(s != NULL);
+
+    /* Align delivers a DEFINE event before subscribe returns */
+    corto_threadpool_updateMetrics(pool);
+    uint64_t posted = pool->posted;
+
+    handled = 0;
+    for (i = 0; i < 100; i ++) {
+        test_assert(corto_update(obj) == 0);
+    }
+
+    test_assert(threadPoolWait(100));
+
+    /* Wait for worker to increase processed counter after the callback */
+    for (i = 0; i < 1000; i ++) {
+        corto_threadpool_updateMetrics(pool);
+        if (!pool->queueDepth) {
+            break;
+        }
+        corto_sleep(0, 1000000);
+    }
+
+    test_assert(pool->posted - posted == 100);
+    test_assert(pool->processed == pool->posted);
+    test_assertint(pool->queueDepth, 0);
+    test_assert(pool->maxQueueDepth >= 1);
+    test_assert(pool->latencyMax >= pool->latencyAvg);
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(pool) == 0);
+    test_assert(corto_delete(obj) == 0);
+}
+
+void test_ThreadPool_tc_batchedEvents(
+    test_ThreadPool this)
+{
+    int i;
+    corto_object obj = corto_create(root_o, "data/obj", corto_void_o);
+    corto_threadpool pool = threadPoolCreate(4, false);
+    test_assert(pool != NULL);
+
+    corto_subscriber s = corto_subscribe("data/obj")
+        .dispatcher(pool)
+        .callback(threadPoolCallback);
+    test_assert(s != NULL);
+
+    corto_threadpool_updateMetrics(pool);
+    uint64_t posted = pool->posted;
+
+    handled = 0;
+
+    /* Post in batches, and wait for the previous batch before posting the
+     * next one, so at most two batches are queued at any time */
+    for (i = 0; i < BATCHED_EVENTS; i ++) {
+        test_assert(corto_update(obj) == 0);
+        if (!((i + 1) % BATCHED_BATCH)) {
+            while (handled < i + 1 - BATCHED_BATCH) {
+                corto_sleep(0, 100000);
+            }
+        }
+    }
+
+    test_assert(threadPoolWait(BATCHED_EVENTS));
+
+    /* Wait for workers to increase processed counters after the callbacks */
+    for (i = 0; i < 1000; i ++) {
+        corto_threadpool_updateMetrics(pool);
+        if (!pool->queueDepth) {
+            break;
+        }
+        corto_sleep(0, 1000000);
+    }
+
+    test_assert(pool->posted - posted == BATCHED_EVENTS);
+    test_assert(pool->processed == pool->posted);
+    test_assert(pool->maxQueueDepth <= 2 * BATCHED_BATCH + 1);
+
+    test_assert(corto_delete(s) == 0);
+    test_assert(corto_delete(pool) == 0);
+    test_assert(corto_delete(obj) == 0);
+}